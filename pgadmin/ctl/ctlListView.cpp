@@ -17,12 +17,33 @@
 
 // App headers
 #include "ctl/ctlListView.h"
+#include "db/pgConn.h"
+#include "schema/pgObject.h"
 #include "utils/misc.h"
 
+// The item of a request of AppendRowsAsync(), before and after its result
+// came in
+#define ASYNC_ROWS          -2
+#define ASYNC_ROWS_DONE     -3
+
+
+wxArrayPtrVoid ctlListView::s_views;
+
 
 ctlListView::ctlListView(wxWindow *p, int id, wxPoint pos, wxSize siz, long attr)
 	: wxListView(p, id, pos, siz, attr | wxLC_REPORT)
 {
+	asyncLoop = NULL;
+	Connect(GetId(), PGConnResultEvent, pgConnResultEventHandler(ctlListView::OnAsyncResult));
+	s_views.Add(this);
+}
+
+
+ctlListView::~ctlListView()
+{
+	s_views.Remove(this);
+	ClearAsync();
+	pgConn::CancelAsync(this);
 }
 
 
@@ -143,3 +164,184 @@ void ctlListView::CreateColumns(wxImageList *images, const wxString &str1, const
 	if (images)
 		SetImageList(images, wxIMAGE_LIST_SMALL);
 }
+
+
+long ctlListView::AppendItemsAsync(pgConn *conn, const wxString &query, const wxArrayString &params)
+{
+	return SetItemAsync(-1, -1, conn, query, params);
+}
+
+
+long ctlListView::SetItemAsync(long item, int column, pgConn *conn, const wxString &query, const wxArrayString &params, pgObject *owner)
+{
+	long request = conn->ExecuteSetAsync(query, params, this, GetId());
+
+	if (request)
+	{
+		asyncRequests.Add(request);
+		asyncItems.Add(item);
+		asyncColumns.Add(column);
+		asyncOwners.Add(owner);
+		asyncSets.Add(NULL);
+		asyncErrors.Add(wxEmptyString);
+	}
+	return request;
+}
+
+
+long ctlListView::AppendRowsAsync(pgConn *conn, const wxString &query, pgObject *owner, int step)
+{
+	long request = SetItemAsync(ASYNC_ROWS, step, conn, query, wxArrayString(), owner);
+
+	// Without a background query, the rows are read here, but still wait
+	// their turn
+	if (!request)
+	{
+		asyncRequests.Add(0);
+		asyncItems.Add(ASYNC_ROWS_DONE);
+		asyncColumns.Add(step);
+		asyncOwners.Add(owner);
+		asyncSets.Add(conn->ExecuteSet(query));
+		asyncErrors.Add(conn->GetLastError());
+		ShowAsyncRows();
+	}
+	return request;
+}
+
+
+void ctlListView::ClearAsync()
+{
+	for (size_t i = 0; i < asyncRequests.GetCount(); i++)
+	{
+		if (asyncRequests[i])
+			pgConn::CancelAsync(asyncRequests[i]);
+		delete (pgSet *)asyncSets[i];
+	}
+
+	asyncRequests.Clear();
+	asyncItems.Clear();
+	asyncColumns.Clear();
+	asyncOwners.Clear();
+	asyncSets.Clear();
+	asyncErrors.Clear();
+
+	if (asyncLoop)
+		asyncLoop->Exit();
+}
+
+
+void ctlListView::WaitAsync()
+{
+	if (asyncRequests.IsEmpty())
+		return;
+
+	wxWindowDisabler disabler;
+	wxEventLoop loop;
+
+	asyncLoop = &loop;
+	loop.Run();
+	asyncLoop = NULL;
+}
+
+
+// Show the rows of the requests of AppendRowsAsync() which came in, up to
+// the first one still outstanding
+void ctlListView::ShowAsyncRows()
+{
+	size_t i = 0;
+
+	while (i < asyncRequests.GetCount() && asyncItems[i] != ASYNC_ROWS)
+	{
+		if (asyncItems[i] != ASYNC_ROWS_DONE)
+		{
+			i++;
+			continue;
+		}
+
+		pgSet *set = (pgSet *)asyncSets[i];
+		pgObject *owner = (pgObject *)asyncOwners[i];
+		wxString error = asyncErrors[i];
+		int step = asyncColumns[i];
+
+		asyncRequests.RemoveAt(i);
+		asyncItems.RemoveAt(i);
+		asyncColumns.RemoveAt(i);
+		asyncOwners.RemoveAt(i);
+		asyncSets.RemoveAt(i);
+		asyncErrors.RemoveAt(i);
+
+		if (!set)
+			wxLogError(wxT("%s"), error.c_str());
+		else if (owner)
+			owner->ShowAsyncRows(this, set, step);
+
+		delete set;
+	}
+}
+
+
+void ctlListView::ForgetAsyncOwner(pgObject *owner)
+{
+	for (size_t i = 0; i < s_views.GetCount(); i++)
+	{
+		ctlListView *view = (ctlListView *)s_views[i];
+
+		for (size_t j = 0; j < view->asyncOwners.GetCount(); j++)
+		{
+			if (view->asyncOwners[j] == owner)
+				view->asyncOwners[j] = NULL;
+		}
+	}
+}
+
+
+void ctlListView::OnAsyncResult(pgConnResultEvent &ev)
+{
+	pgSet *set = ev.DetachSet();
+	int index = asyncRequests.Index(ev.GetRequest());
+
+	if (index != wxNOT_FOUND && asyncItems[index] == ASYNC_ROWS)
+	{
+		asyncItems[index] = ASYNC_ROWS_DONE;
+		asyncSets[index] = set;
+		asyncErrors[index] = ev.GetError();
+		set = NULL;
+
+		ShowAsyncRows();
+	}
+	else if (index != wxNOT_FOUND)
+	{
+		long item = asyncItems[index];
+		int column = asyncColumns[index];
+		pgObject *owner = (pgObject *)asyncOwners[index];
+
+		asyncRequests.RemoveAt(index);
+		asyncItems.RemoveAt(index);
+		asyncColumns.RemoveAt(index);
+		asyncOwners.RemoveAt(index);
+		asyncSets.RemoveAt(index);
+		asyncErrors.RemoveAt(index);
+
+		if (set && owner)
+			owner->SetAsyncResult(set);
+
+		if (!set)
+			wxLogError(wxT("%s"), ev.GetError().c_str());
+		else if (item < 0)
+		{
+			for (int col = 0 ; col < set->NumCols() ; col++)
+			{
+				if (!set->ColName(col).IsEmpty())
+					AppendItem(set->ColName(col), set->GetVal(col));
+			}
+		}
+		else if (item < GetItemCount() && !set->Eof())
+			SetItem(item, column, set->GetVal(0));
+	}
+
+	if (set)
+		delete set;
+
+	if (asyncLoop && asyncRequests.IsEmpty())
+		asyncLoop->Exit();
+}
@@ -0,0 +1,197 @@
+//////////////////////////////////////////////////////////////////////////
+//
+// pgAdmin III - PostgreSQL Tools
+//
+// Copyright (C) 2002 - 2016, The pgAdmin Development Team
+// This software is released under the PostgreSQL Licence
+//
+// ctlResultFindBar.cpp - Find bar for result grids
+//
+//////////////////////////////////////////////////////////////////////////
+
+#include "pgAdmin3.h"
+
+// wxWindows headers
+#include <wx/wx.h>
+#include <wx/aui/aui.h>
+
+// App headers
+#include "ctl/ctlResultFindBar.h"
+#include "ctl/ctlSQLGrid.h"
+#include "db/pgSetSearch.h"
+
+#define CTL_FINDTEXT        1000
+#define CTL_FINDCASE        1001
+#define CTL_FINDREGEX       1002
+#define CTL_FINDNEXT        1003
+#define CTL_FINDPREVIOUS    1004
+#define CTL_FINDCLOSE       1005
+
+// How often the progress of the search is looked at
+#define FIND_POLL_INTERVAL  200
+
+
+BEGIN_EVENT_TABLE(ctlResultFindBar, wxPanel)
+	EVT_TEXT(CTL_FINDTEXT,          ctlResultFindBar::OnTextChanged)
+	EVT_TEXT_ENTER(CTL_FINDTEXT,    ctlResultFindBar::OnFindNext)
+	EVT_CHECKBOX(CTL_FINDCASE,      ctlResultFindBar::OnOptionChanged)
+	EVT_CHECKBOX(CTL_FINDREGEX,     ctlResultFindBar::OnOptionChanged)
+	EVT_BUTTON(CTL_FINDNEXT,        ctlResultFindBar::OnFindNext)
+	EVT_BUTTON(CTL_FINDPREVIOUS,    ctlResultFindBar::OnFindPrevious)
+	EVT_BUTTON(CTL_FINDCLOSE,       ctlResultFindBar::OnClose)
+	EVT_TIMER(wxID_ANY,             ctlResultFindBar::OnTimer)
+END_EVENT_TABLE()
+
+
+ctlResultFindBar::ctlResultFindBar(wxWindow *parent, ctlSQLGrid *_grid)
+	: wxPanel(parent, wxID_ANY), grid(_grid), timer(this), movePending(false), moveForward(true)
+{
+	wxBoxSizer *sizer = new wxBoxSizer(wxHORIZONTAL);
+
+	txtFind = new wxTextCtrl(this, CTL_FINDTEXT, wxEmptyString, wxDefaultPosition, wxSize(200, -1), wxTE_PROCESS_ENTER);
+	chkMatchCase = new wxCheckBox(this, CTL_FINDCASE, _("Match case"));
+	chkRegex = new wxCheckBox(this, CTL_FINDREGEX, _("Regular expression"));
+	stStatus = new wxStaticText(this, wxID_ANY, wxEmptyString);
+
+	sizer->Add(new wxStaticText(this, wxID_ANY, _("Find:")), 0, wxALIGN_CENTER_VERTICAL | wxALL, 4);
+	sizer->Add(txtFind, 0, wxALIGN_CENTER_VERTICAL | wxALL, 4);
+	sizer->Add(new wxButton(this, CTL_FINDPREVIOUS, _("&Previous")), 0, wxALIGN_CENTER_VERTICAL | wxALL, 4);
+	sizer->Add(new wxButton(this, CTL_FINDNEXT, _("&Next")), 0, wxALIGN_CENTER_VERTICAL | wxALL, 4);
+	sizer->Add(chkMatchCase, 0, wxALIGN_CENTER_VERTICAL | wxALL, 4);
+	sizer->Add(chkRegex, 0, wxALIGN_CENTER_VERTICAL | wxALL, 4);
+	sizer->Add(stStatus, 1, wxALIGN_CENTER_VERTICAL | wxALL, 4);
+	sizer->Add(new wxButton(this, CTL_FINDCLOSE, _("Close")), 0, wxALIGN_CENTER_VERTICAL | wxALL, 4);
+
+	SetSizer(sizer);
+	sizer->SetSizeHints(this);
+}
+
+
+ctlResultFindBar::~ctlResultFindBar()
+{
+	timer.Stop();
+}
+
+
+void ctlResultFindBar::Activate()
+{
+	txtFind->SetFocus();
+	txtFind->SetSelection(-1, -1);
+	Restart();
+}
+
+
+void ctlResultFindBar::Restart()
+{
+	movePending = false;
+	errMsg = wxEmptyString;
+
+	if (txtFind->GetValue().IsEmpty())
+		grid->StopSearch();
+	else
+		grid->StartSearch(txtFind->GetValue(), chkMatchCase->GetValue(), chkRegex->GetValue(), errMsg);
+
+	UpdateStatus();
+}
+
+
+void ctlResultFindBar::Find(bool forward)
+{
+	// The rows may have changed since, which ends the search
+	if (!grid->GetSearch())
+		Restart();
+	if (!grid->GetSearch())
+		return;
+
+	moveForward = forward;
+	movePending = (grid->FindMatch(forward) == PGSETSEARCH_PENDING);
+	if (!movePending && grid->GetSearch()->IsDone() && !grid->GetSearch()->GetMatchCount())
+		wxBell();
+
+	UpdateStatus();
+}
+
+
+void ctlResultFindBar::UpdateStatus()
+{
+	pgSetSearch *search = grid->GetSearch();
+
+	if (!search)
+	{
+		stStatus->SetLabel(errMsg);
+		timer.Stop();
+		return;
+	}
+
+	long matches = search->GetMatchCount();
+
+	if (search->IsDone())
+	{
+		if (!matches)
+			stStatus->SetLabel(_("Not found."));
+		else
+			stStatus->SetLabel(wxString::Format(wxPLURAL("%ld match.", "%ld matches.", matches), matches));
+		if (!movePending)
+			timer.Stop();
+	}
+	else
+	{
+		long rows = search->GetRowCount();
+		stStatus->SetLabel(wxString::Format(_("Searching: %d%%, %ld matches so far."),
+		                                    rows ? (int)(search->GetRowsScanned() * 100 / rows) : 0, matches));
+	}
+
+	if ((movePending || !search->IsDone()) && !timer.IsRunning())
+		timer.Start(FIND_POLL_INTERVAL);
+
+	Layout();
+}
+
+
+void ctlResultFindBar::OnTimer(wxTimerEvent &ev)
+{
+	if (movePending && grid->GetSearch())
+		movePending = (grid->FindMatch(moveForward) == PGSETSEARCH_PENDING);
+
+	UpdateStatus();
+}
+
+
+void ctlResultFindBar::OnTextChanged(wxCommandEvent &ev)
+{
+	Restart();
+}
+
+
+void ctlResultFindBar::OnOptionChanged(wxCommandEvent &ev)
+{
+	Restart();
+}
+
+
+void ctlResultFindBar::OnFindNext(wxCommandEvent &ev)
+{
+	Find(true);
+}
+
+
+void ctlResultFindBar::OnFindPrevious(wxCommandEvent &ev)
+{
+	Find(false);
+}
+
+
+void ctlResultFindBar::OnClose(wxCommandEvent &ev)
+{
+	timer.Stop();
+	movePending = false;
+	grid->StopSearch();
+
+	wxAuiManager *manager = wxAuiManager::GetManager(this);
+	if (manager)
+	{
+		manager->GetPane(this).Hide();
+		manager->Update();
+	}
+	grid->SetFocus();
+}
@@ -16,6 +16,7 @@
 #include <wx/clipbrd.h>
 
 #include "db/pgConn.h"
+#include "db/pgSetSearch.h"
 #include "ctl/ctlSQLGrid.h"
 #include "utils/sysSettings.h"
 #include "frm/frmExport.h"
@@ -24,6 +25,11 @@
 #define EXTRAEXTENT_HEIGHT 6
 #define EXTRAEXTENT_WIDTH  6
 
+// Autosizing looks at this many rows of each column, and measures the
+// widest few cells according to the estimated text width
+#define AUTOSIZE_SAMPLE_ROWS     500
+#define AUTOSIZE_MEASURED_CELLS  3
+
 BEGIN_EVENT_TABLE(ctlSQLGrid, wxGrid)
 	EVT_MOUSEWHEEL(ctlSQLGrid::OnMouseWheel)
 	EVT_GRID_COL_SIZE(ctlSQLGrid::OnGridColSize)
@@ -34,6 +40,8 @@ IMPLEMENT_DYNAMIC_CLASS(ctlSQLGrid, wxGrid)
 
 ctlSQLGrid::ctlSQLGrid()
 {
+	search = NULL;
+	searchFromCursor = false;
 }
 
 ctlSQLGrid::ctlSQLGrid(wxWindow *parent, wxWindowID id, const wxPoint &pos, const wxSize &size)
@@ -53,6 +61,70 @@ ctlSQLGrid::ctlSQLGrid(wxWindow *parent, wxWindowID id, const wxPoint &pos, cons
 	SetDefaultCellOverflow(false);
 
 	Connect(wxID_ANY, wxEVT_GRID_LABEL_LEFT_DCLICK, wxGridEventHandler(ctlSQLGrid::OnLabelDoubleClick));
+
+	search = NULL;
+	searchFromCursor = false;
+}
+
+ctlSQLGrid::~ctlSQLGrid()
+{
+	StopSearch();
+}
+
+bool ctlSQLGrid::StartSearch(const wxString &pattern, bool matchCase, bool useRegex, wxString &errMsg)
+{
+	StopSearch();
+
+	if (pattern.IsEmpty())
+		return false;
+
+	search = CreateSearch(pattern, matchCase, useRegex);
+	if (!search)
+	{
+		errMsg = _("There are no results to search.");
+		return false;
+	}
+	if (!search->IsOk())
+	{
+		StopSearch();
+		errMsg = _("Invalid regular expression.");
+		return false;
+	}
+
+	search->Start();
+	searchFromCursor = true;
+	return true;
+}
+
+int ctlSQLGrid::FindMatch(bool forward)
+{
+	if (!search)
+		return PGSETSEARCH_NONE;
+
+	long row = GetGridCursorRow();
+	int col = GetGridCursorCol();
+
+	// The first match may be the cell the cursor is on
+	if (searchFromCursor)
+		col += forward ? -1 : 1;
+
+	int status = search->FindNext(row, col, forward);
+	if (status == PGSETSEARCH_FOUND && row < GetNumberRows() && col < GetNumberCols())
+	{
+		searchFromCursor = false;
+		MakeCellVisible((int)row, col);
+		SetGridCursor((int)row, col);
+	}
+	return status;
+}
+
+void ctlSQLGrid::StopSearch()
+{
+	if (search)
+	{
+		delete search;
+		search = NULL;
+	}
 }
 
 void ctlSQLGrid::OnGridColSize(wxGridSizeEvent &event)
@@ -119,7 +191,7 @@ wxString ctlSQLGrid::GetExportLine(int row, int col1, int col2)
 	return GetExportLine(row, cols);
 }
 
-wxString ctlSQLGrid::GetExportLine(int row, wxArrayInt cols)
+wxString ctlSQLGrid::GetExportLine(int row, const wxArrayInt &cols)
 {
 	wxString str;
 	unsigned int col;
@@ -159,21 +231,7 @@ wxString ctlSQLGrid::GetColumnName(int colNum)
 	return columnName;
 }
 
-void ctlSQLGrid::AppendColumnHeader(wxString &str, int start, int end)
-{
-	size_t i, arrsize;
-	arrsize = (end - start + 1);
-	wxArrayInt columns;
-
-	for(i = 0; i < arrsize; i++)
-	{
-		columns.Add(start + i);
-	}
-
-	AppendColumnHeader(str, columns);
-}
-
-void ctlSQLGrid::AppendColumnHeader(wxString &str, wxArrayInt columns)
+void ctlSQLGrid::AppendColumnHeader(wxString &str, const wxArrayInt &columns)
 {
 	if(settings->GetColumnNames())
 	{
@@ -197,81 +255,63 @@ void ctlSQLGrid::AppendColumnHeader(wxString &str, wxArrayInt columns)
 	}
 }
 
-int ctlSQLGrid::Copy()
+bool ctlSQLGrid::GetSelectedRowsAndCols(wxArrayInt &rows, wxArrayInt &cols)
 {
-	wxString str;
-	int copied = 0;
-	size_t i;
-
-
+	int row, col;
 
 	if (GetSelectedRows().GetCount())
 	{
-		AppendColumnHeader(str, 0, (GetNumberCols() - 1));
-
-		wxArrayInt rows = GetSelectedRows();
-
-		for (i = 0 ; i < rows.GetCount() ; i++)
-		{
-			str.Append(GetExportLine(rows.Item(i)));
-
-			if (rows.GetCount() > 1)
-				str.Append(END_OF_LINE);
-		}
-
-		copied = rows.GetCount();
+		rows = GetSelectedRows();
+		for (col = 0 ; col < GetNumberCols() ; col++)
+			cols.Add(col);
 	}
 	else if (GetSelectedCols().GetCount())
 	{
-		wxArrayInt cols = GetSelectedCols();
-		size_t numRows = GetNumberRows();
-
-		AppendColumnHeader(str, cols);
-
-		for (i = 0 ; i < numRows ; i++)
-		{
-			str.Append(GetExportLine(i, cols));
+		int numRows = GetNumberRows();
 
-			if (numRows > 1)
-				str.Append(END_OF_LINE);
-		}
-
-		copied = numRows;
+		cols = GetSelectedCols();
+		rows.Alloc(numRows);
+		for (row = 0 ; row < numRows ; row++)
+			rows.Add(row);
 	}
 	else if (GetSelectionBlockTopLeft().GetCount() > 0 &&
 	         GetSelectionBlockBottomRight().GetCount() > 0)
 	{
-		unsigned int x1, x2, y1, y2;
+		int x1, x2, y1, y2;
 
 		x1 = GetSelectionBlockTopLeft()[0].GetCol();
 		x2 = GetSelectionBlockBottomRight()[0].GetCol();
 		y1 = GetSelectionBlockTopLeft()[0].GetRow();
 		y2 = GetSelectionBlockBottomRight()[0].GetRow();
 
-		AppendColumnHeader(str, x1, x2);
-
-		for (i = y1; i <= y2; i++)
-		{
-			str.Append(GetExportLine(i, x1, x2));
-
-			if (y2 > y1)
-				str.Append(END_OF_LINE);
-		}
-
-		copied = y2 - y1 + 1;
+		rows.Alloc(y2 - y1 + 1);
+		for (row = y1 ; row <= y2 ; row++)
+			rows.Add(row);
+		for (col = x1 ; col <= x2 ; col++)
+			cols.Add(col);
 	}
 	else
 	{
-		int row, col;
+		rows.Add(GetGridCursorRow());
+		cols.Add(GetGridCursorCol());
+		return false;
+	}
 
-		row = GetGridCursorRow();
-		col = GetGridCursorCol();
+	return true;
+}
 
-		AppendColumnHeader(str, col, col);
+int ctlSQLGrid::Copy()
+{
+	wxString str;
+	wxArrayInt rows, cols;
 
-		str.Append(GetExportLine(row, col, col));
-		copied = 1;
-	}
+	GetSelectedRowsAndCols(rows, cols);
+
+	AppendColumnHeader(str, cols);
+
+	int copied = rows.GetCount();
+	if (!AppendLines(str, rows, cols))
+		return 0;
 
 	if (copied && wxTheClipboard->Open())
 	{
@@ -286,6 +326,19 @@ int ctlSQLGrid::Copy()
 	return copied;
 }
 
+bool ctlSQLGrid::AppendLines(wxString &str, const wxArrayInt &rows, const wxArrayInt &cols)
+{
+	for (size_t i = 0 ; i < rows.GetCount() ; i++)
+	{
+		str.Append(GetExportLine(rows.Item(i), cols));
+
+		if (rows.GetCount() > 1)
+			str.Append(END_OF_LINE);
+	}
+
+	return true;
+}
+
 void ctlSQLGrid::OnLabelDoubleClick(wxGridEvent &event)
 {
 	int maxHeight, maxWidth;
@@ -459,9 +512,29 @@ void ctlSQLGrid::AutoSizeColumns(bool setAsMin)
 	colMaxSizes.Empty();
 
 	/* We need to check each cell's width to choose best. wxGrid::AutoSizeColumns()
-	 * is good, but looping through long result sets gives a noticeable slowdown.
-	 * Thus we'll check every first 500 cells for each column.
+	 * is good, but looping through long result sets gives a noticeable slowdown,
+	 * as it asks the renderer to measure every cell. Thus we'll look at 500
+	 * cells for each column: the first ones, and some spread over the rest.
+	 * Their width is estimated from the widths of their characters, and only
+	 * the widest few are measured by the renderer.
 	 */
+	wxArrayInt sampleRows;
+	if (nRows <= AUTOSIZE_SAMPLE_ROWS)
+	{
+		for (row = 0 ; row < nRows ; row++)
+			sampleRows.Add(row);
+	}
+	else
+	{
+		int head = AUTOSIZE_SAMPLE_ROWS / 2, spread = AUTOSIZE_SAMPLE_ROWS - head;
+
+		for (row = 0 ; row < head ; row++)
+			sampleRows.Add(row);
+		for (int i = 0 ; i < spread ; i++)
+			sampleRows.Add(head + (int)((double)(nRows - head) * i / spread));
+	}
+
+	wxClientDC dc(GetGridWindow());
 
 	// First pass: auto-size columns
 	for (col = 0 ; col < nCols; col++)
@@ -474,12 +547,34 @@ void ctlSQLGrid::AutoSizeColumns(bool setAsMin)
 		}
 		else
 		{
-			wxClientDC dc(GetGridWindow());
+			int widest[AUTOSIZE_MEASURED_CELLS], widestRows[AUTOSIZE_MEASURED_CELLS];
+			int i, nWidest = 0;
+
+			dc.SetFont(GetDefaultCellFont());
+			for (size_t sample = 0 ; sample < sampleRows.GetCount() ; sample++)
+			{
+				row = sampleRows.Item(sample);
+				int width = EstimateTextWidth(dc, GetCellValue(row, col));
+
+				// Keep the widest cells, widest first
+				if (nWidest == AUTOSIZE_MEASURED_CELLS && width <= widest[nWidest - 1])
+					continue;
+				if (nWidest < AUTOSIZE_MEASURED_CELLS)
+					nWidest++;
+				for (i = nWidest - 1 ; i > 0 && widest[i - 1] < width ; i--)
+				{
+					widest[i] = widest[i - 1];
+					widestRows[i] = widestRows[i - 1];
+				}
+				widest[i] = width;
+				widestRows[i] = row;
+			}
+
 			newSize = 0;
 			// get cells's width
-			for (row = 0 ; row < wxMin(nRows, 500) ; row++)
+			for (i = 0 ; i < nWidest ; i++)
 			{
-				wxSize size = GetBestSize(row, col);
+				wxSize size = GetBestSize(widestRows[i], col);
 				if ( size.x > newSize )
 					newSize = size.x;
 			}
@@ -531,6 +626,63 @@ void ctlSQLGrid::AutoSizeColumns(bool setAsMin)
 	}
 }
 
+// The width of the text in the font of the DC, as the sum of the widths of
+// its characters. Kerning makes it an estimate, but a close one, taking no
+// more than a table lookup per character once the font is known.
+int ctlSQLGrid::EstimateTextWidth(wxDC &dc, const wxString &text)
+{
+	wxCoord w, h;
+	int c;
+
+	if (!glyphFont.Ok() || glyphFont != dc.GetFont())
+	{
+		glyphFont = dc.GetFont();
+		glyphWidths.clear();
+
+		for (c = 0 ; c < 128 ; c++)
+		{
+			if (c < ' ' || c == 127)
+				asciiWidths[c] = 0;
+			else
+			{
+				dc.GetTextExtent(wxString((wxChar)c), &w, &h);
+				asciiWidths[c] = w;
+			}
+		}
+	}
+
+	int width = 0, lineWidth = 0;
+	size_t len = text.Length();
+
+	for (size_t i = 0 ; i < len ; i++)
+	{
+		wxChar ch = text.GetChar(i);
+		c = (int)ch;
+
+		if (c == '\n')
+		{
+			width = wxMax(width, lineWidth);
+			lineWidth = 0;
+		}
+		else if (c >= 0 && c < 128)
+			lineWidth += asciiWidths[c];
+		else
+		{
+			GlyphWidthHashMap::iterator it = glyphWidths.find(c);
+			if (it == glyphWidths.end())
+			{
+				dc.GetTextExtent(wxString(ch), &w, &h);
+				glyphWidths[c] = w;
+				lineWidth += w;
+			}
+			else
+				lineWidth += it->second;
+		}
+	}
+
+	return wxMax(width, lineWidth);
+}
+
 wxString ctlSQLGrid::GetColKeyValue(int col)
 {
 	wxString colKey = wxString::Format(wxT("%d:"), col) + GetColLabelValue(col);
@@ -17,17 +17,219 @@
 
 #include "db/pgConn.h"
 #include "db/pgQueryThread.h"
+#include "db/pgSetSearch.h"
+#include "db/pgSetStats.h"
 #include "ctl/ctlSQLResult.h"
 #include "utils/sysSettings.h"
+#include "utils/utf8.h"
+#include "utils/workerProgress.h"
 #include "frm/frmExport.h"
 
+// The number of rendered cells kept, a few screens full
+#define CELL_CACHE_SIZE     4096
+
+// The rows handed over at a time by a progressive query
+#define STREAM_CHUNK_ROWS   1000
+
+// Copies of more cells are made by a worker thread
+#define COPY_THREAD_CELLS   100000
+
+// The copier reports its progress every so many rows
+#define COPY_PROGRESS_ROWS  1000
+
+// The figures for the selected numbers wait for the selection to settle
+// for so many milliseconds, and are then looked for as often
+#define STATS_DELAY         150
+
+const wxEventType SelectionStatsEvent = wxNewEventType();
+
+
+// A figure for the status bar, with the decimal mark of the grid
+static wxString FormatStat(double value, const wxString &decimalMark)
+{
+	wxString text = wxString::Format(wxT("%.15g"), value);
+
+	if (!decimalMark.IsEmpty())
+	{
+		wxString point = wxString::Format(wxT("%.1f"), 1.5).Mid(1, 1);
+		if (point != decimalMark)
+			text.Replace(point, decimalMark);
+	}
+	return text;
+}
+
+
+// Renders the cells to copy as UTF-8 text, reading them straight from the
+// result rather than through the grid. The rules of sqlResultTable::Render()
+// and ctlSQLGrid::GetExportLine() are taken on the GUI thread beforehand.
+class sqlResultCopier : public wxThread
+{
+public:
+	sqlResultCopier(sqlResultTable *table, pgSet *_set, const wxArrayInt &_rows, const wxArrayInt &_cols, const wxArrayInt &_quoted,
+	                workerProgress *_progress);
+
+	void *Entry();
+
+	const wxMemoryBuffer &GetText() const
+	{
+		return text;
+	}
+
+private:
+	void Append(const char *data, size_t len);
+	void AppendValue(const char *value, size_t len, bool numeric);
+
+	pgSet *set;
+	wxArrayInt rows, cols, quoted, numeric;
+
+	wxCharBuffer separator, quoteChar, endOfLine, nullText, decimalMark, thousandsSeparator;
+	size_t separatorLen, quoteLen, endOfLineLen, nullLen, decimalMarkLen, thousandsSeparatorLen;
+	size_t maxColSize;
+
+	pgSetRow values;
+
+	wxMemoryBuffer text;
+	workerProgress *progress;
+};
+
+
+sqlResultCopier::sqlResultCopier(sqlResultTable *table, pgSet *_set, const wxArrayInt &_rows, const wxArrayInt &_cols, const wxArrayInt &_quoted,
+                                 workerProgress *_progress)
+	: wxThread(wxTHREAD_JOINABLE), set(_set), rows(_rows), cols(_cols), quoted(_quoted),
+	  separator(settings->GetCopyColSeparator().mb_str(wxConvUTF8)),
+	  quoteChar(settings->GetCopyQuoteChar().mb_str(wxConvUTF8)),
+	  endOfLine(wxString(END_OF_LINE).mb_str(wxConvUTF8)),
+	  nullText(wxString(table->indicateNull ? wxT("<NULL>") : wxT("")).mb_str(wxConvUTF8)),
+	  decimalMark(table->decimalMark.mb_str(wxConvUTF8)),
+	  thousandsSeparator(table->thousandsSeparator.mb_str(wxConvUTF8)),
+	  maxColSize(table->maxColSize), progress(_progress)
+{
+	separatorLen = strlen(separator);
+	quoteLen = strlen(quoteChar);
+	endOfLineLen = strlen(endOfLine);
+	nullLen = strlen(nullText);
+	decimalMarkLen = strlen(decimalMark);
+	thousandsSeparatorLen = strlen(thousandsSeparator);
+
+	for (size_t i = 0 ; i < cols.GetCount() ; i++)
+	{
+		int col = cols.Item(i);
+		numeric.Add(col < (int)table->numericCols.GetCount() && table->numericCols.Item(col));
+	}
+}
+
+
+void sqlResultCopier::Append(const char *data, size_t len)
+{
+	size_t used = text.GetDataLen();
+
+	if (used + len > text.GetBufSize())
+		text.SetBufSize(wxMax(used + len, text.GetBufSize() * 2));
+
+	memcpy((char *)text.GetData() + used, data, len);
+	text.SetDataLen(used + len);
+}
+
+
+void sqlResultCopier::AppendValue(const char *value, size_t len, bool numeric)
+{
+	size_t i;
+
+	if (numeric)
+	{
+		// The separators go into the integer part, counting from its end
+		size_t intLen = 0;
+		while (intLen < len && value[intLen] != '.')
+			intLen++;
+
+		for (i = 0 ; i < len ; i++)
+		{
+			if (thousandsSeparatorLen && i > 0 && i < intLen && (intLen - i) % 3 == 0 && (i > 1 || value[0] != '-'))
+				Append(thousandsSeparator, thousandsSeparatorLen);
+
+			if (value[i] == '.' && decimalMarkLen)
+				Append(decimalMark, decimalMarkLen);
+			else
+				Append(value + i, 1);
+		}
+		return;
+	}
+
+	// Count characters, not bytes, to cut long values
+	size_t chars = 0;
+	for (i = 0 ; i < len ; i++)
+	{
+		if ((value[i] & 0xC0) != 0x80 && chars++ == maxColSize)
+		{
+			Append(value, i);
+			Append(" (...)", 6);
+			return;
+		}
+	}
+
+	Append(value, len);
+}
+
+
+void *sqlResultCopier::Entry()
+{
+	size_t row, col, size = 0;
+
+	// Size the text up front, as closely as the lengths tell
+	for (row = 0 ; row < rows.GetCount() && !progress->IsCancelled() ; row++)
+	{
+		set->SeekRow(rows.Item(row), values);
+
+		for (col = 0 ; col < cols.GetCount() ; col++)
+		{
+			size_t len = values.Length(cols.Item(col));
+			size += separatorLen + 2 * quoteLen + wxMax(len, nullLen) + 6;
+			if (numeric.Item(col))
+				size += len / 3 * thousandsSeparatorLen + decimalMarkLen;
+		}
+		size += endOfLineLen;
+	}
+	text.SetBufSize(size + 1);
+
+	for (row = 0 ; row < rows.GetCount() && !progress->IsCancelled() ; row++)
+	{
+		set->SeekRow(rows.Item(row), values);
+
+		for (col = 0 ; col < cols.GetCount() ; col++)
+		{
+			if (col > 0)
+				Append(separator, separatorLen);
+			if (quoted.Item(col))
+				Append(quoteChar, quoteLen);
+
+			if (values.IsNull(cols.Item(col)))
+				Append(nullText, nullLen);
+			else
+				AppendValue(values.Value(cols.Item(col)), values.Length(cols.Item(col)), numeric.Item(col) != 0);
+
+			if (quoted.Item(col))
+				Append(quoteChar, quoteLen);
+		}
+
+		if (rows.GetCount() > 1)
+			Append(endOfLine, endOfLineLen);
+
+		if ((row + 1) % COPY_PROGRESS_ROWS == 0)
+			progress->Update((int)row + 1);
+	}
+
+	progress->Done();
+	return 0;
+}
 
 
 ctlSQLResult::ctlSQLResult(wxWindow *parent, pgConn *_conn, wxWindowID id, const wxPoint &pos, const wxSize &size)
-	: ctlSQLGrid(parent, id, pos, size)
+	: ctlSQLGrid(parent, id, pos, size), statsTimer(this)
 {
 	conn = _conn;
 	thread = NULL;
+	index = NULL;
+	stats = NULL;
 
 	SetTable(new sqlResultTable(), true);
 
@@ -35,12 +237,23 @@ ctlSQLResult::ctlSQLResult(wxWindow *parent, pgConn *_conn, wxWindowID id, const
 	SetSizer(new wxBoxSizer(wxVERTICAL));
 
 	Connect(wxID_ANY, wxEVT_GRID_RANGE_SELECT, wxGridRangeSelectEventHandler(ctlSQLResult::OnGridSelect));
+	Connect(wxID_ANY, wxEVT_GRID_SELECT_CELL, wxGridEventHandler(ctlSQLResult::OnCellSelect));
+	Connect(wxID_ANY, wxEVT_TIMER, wxTimerEventHandler(ctlSQLResult::OnStatsTimer));
+	Connect(wxID_ANY, SettingsChangedEvent, wxCommandEventHandler(ctlSQLResult::OnSettingsChanged));
+	Connect(wxID_ANY, SetIndexBuiltEvent, wxCommandEventHandler(ctlSQLResult::OnIndexBuilt));
+	Connect(wxID_ANY, SetStatsDoneEvent, wxCommandEventHandler(ctlSQLResult::OnStatsDone));
+	settings->AddChangeHandler(this);
 }
 
 
 
 ctlSQLResult::~ctlSQLResult()
 {
+	settings->RemoveChangeHandler(this);
+
+	// The frame may be going too, so nothing is sent up any more
+	StopStats();
+	statsText = wxEmptyString;
 	Abort();
 
 	if (thread)
@@ -67,9 +280,19 @@ bool ctlSQLResult::Export()
 {
 	if (NumRows() > 0)
 	{
+		// The rows as shown, sorted and filtered
+		sqlResultTable *table = (sqlResultTable *)GetTable();
+		wxArrayInt rows;
+		if (table->IsMapped())
+		{
+			rows.Alloc(GetNumberRows());
+			for (int row = 0 ; row < GetNumberRows() ; row++)
+				rows.Add(table->MapRow(row));
+		}
+
 		frmExport dlg(this);
 		if (dlg.ShowModal() == wxID_OK)
-			return dlg.Export(NULL);
+			return dlg.Export(thread->DataSet(), rows);
 	}
 	return false;
 }
@@ -94,8 +317,56 @@ bool ctlSQLResult::ToFile(frmExport *frm)
 	return false;
 }
 
+bool ctlSQLResult::AppendLines(wxString &str, const wxArrayInt &rows, const wxArrayInt &cols)
+{
+	if ((double)rows.GetCount() * cols.GetCount() < COPY_THREAD_CELLS || !thread || !thread->DataValid() ||
+	        thread->DataSet()->IsBinary() || &thread->DataSet()->GetConversion() != &wxConvUTF8)
+		return ctlSQLGrid::AppendLines(str, rows, cols);
+
+	wxArrayInt quoted;
+	for (size_t i = 0 ; i < cols.GetCount() ; i++)
+	{
+		if (settings->GetCopyQuoting() == 1)
+			quoted.Add(IsColText(cols.Item(i)));
+		else
+			quoted.Add(settings->GetCopyQuoting() == 2);
+	}
+
+	// The copier reads the rows of the result, not of the grid
+	sqlResultTable *table = (sqlResultTable *)GetTable();
+	wxArrayInt resultRows;
+	if (table->IsMapped())
+	{
+		resultRows.Alloc(rows.GetCount());
+		for (size_t i = 0 ; i < rows.GetCount() ; i++)
+			resultRows.Add(table->MapRow(rows.Item(i)));
+	}
+
+	workerProgress progress(this, _("Copy"), _("Copying the selection to the clipboard."), (int)rows.GetCount());
+	sqlResultCopier *copier = new sqlResultCopier(table, thread->DataSet(), table->IsMapped() ? resultRows : rows, cols, quoted, &progress);
+	if (copier->Create() != wxTHREAD_NO_ERROR || copier->Run() != wxTHREAD_NO_ERROR)
+	{
+		delete copier;
+		return ctlSQLGrid::AppendLines(str, rows, cols);
+	}
+
+	bool copied = progress.Wait();
+	copier->Wait();
+
+	if (copied)
+		str.Append(DecodeUTF8((const char *)copier->GetText().GetData(), copier->GetText().GetDataLen()));
+
+	delete copier;
+	return copied;
+}
+
+
 bool ctlSQLResult::IsColText(int col)
 {
+	// Not known before a progressive query completes
+	if (col >= (int)colTypClasses.GetCount())
+		return true;
+
 	switch (colTypClasses.Item(col))
 	{
 		case PGTYPCLASS_NUMERIC:
@@ -107,7 +378,8 @@ bool ctlSQLResult::IsColText(int col)
 }
 
 
-int ctlSQLResult::Execute(const wxString &query, int resultToRetrieve, wxWindow *caller, long eventId, void *data)
+int ctlSQLResult::Execute(const wxString &query, int resultToRetrieve, wxWindow *caller, long eventId, void *data, bool progressive,
+                          dataFileWriter *copyOutFile, bool copyOutCRLF, bool copyOutHeader)
 {
 	wxGridTableMessage *msg;
 	sqlResultTable *table = (sqlResultTable *)GetTable();
@@ -134,6 +406,19 @@ int ctlSQLResult::Execute(const wxString &query, int resultToRetrieve, wxWindow
 
 	((sqlResultTable *)GetTable())->SetThread(thread);
 
+	if (copyOutFile)
+		thread->SetCopyOutFile(copyOutFile, copyOutCRLF, copyOutHeader);
+
+	// Streaming hands over the rows of the first result only, so it can't
+	// be used if an other one was asked for.
+	if (progressive && resultToRetrieve <= 0)
+	{
+		thread->SetStreaming(STREAM_CHUNK_ROWS);
+		thread->SetSpillThreshold((size_t)wxMax(settings->GetResultSpillThreshold(), 0L) * 1024 * 1024,
+		                          settings->GetResultSpillDirectory());
+		((sqlResultTable *)GetTable())->SetStreaming(true);
+	}
+
 	thread->Run();
 	return RunStatus();
 }
@@ -141,6 +426,17 @@ int ctlSQLResult::Execute(const wxString &query, int resultToRetrieve, wxWindow
 
 int ctlSQLResult::Abort()
 {
+	StopSearch();
+	StopStats();
+	ShowStats(wxEmptyString);
+
+	if (index)
+	{
+		StopIndexBuild();
+		delete index;
+		index = NULL;
+	}
+
 	if (thread)
 	{
 		((sqlResultTable *)GetTable())->SetThread(0);
@@ -159,36 +455,111 @@ int ctlSQLResult::Abort()
 
 
 
-void ctlSQLResult::DisplayData(bool single)
+void ctlSQLResult::AppendRows()
 {
-	if (!thread || !thread->DataValid())
-		return;
+	sqlResultTable *table = (sqlResultTable *)GetTable();
 
-	if (thread->ReturnCode() != PGRES_TUPLES_OK)
+	if (!thread || !thread->DataValid() || !table->IsStreaming())
 		return;
 
-	rowcountSuppressed = single;
-	Freeze();
-
-	/*
-	 * Resize and repopulate by informing it to delete all the rows and
-	 * columns, then append the correct number of them. Probably is a
-	 * better way to do this.
-	 */
 	wxGridTableMessage *msg;
+	long nRows = NumRows();
+
+	if (!GetNumberCols())
+	{
+		rowcountSuppressed = false;
+		table->SetFormat();
+
+		msg = new wxGridTableMessage(table, wxGRIDTABLE_NOTIFY_COLS_APPENDED, thread->DataSet()->NumCols());
+		ProcessTableMessage(*msg);
+		delete msg;
+	}
+
+	if (nRows > GetNumberRows())
+	{
+		msg = new wxGridTableMessage(table, wxGRIDTABLE_NOTIFY_ROWS_APPENDED, nRows - GetNumberRows());
+		ProcessTableMessage(*msg);
+		delete msg;
+	}
+}
+
+
+bool ctlSQLResult::IsStreaming()
+{
+	return ((sqlResultTable *)GetTable())->IsStreaming();
+}
+
+
+void ctlSQLResult::DiscardRows()
+{
 	sqlResultTable *table = (sqlResultTable *)GetTable();
+
+	if (!table->IsStreaming())
+		return;
+
+	wxGridTableMessage *msg;
 	msg = new wxGridTableMessage(table, wxGRIDTABLE_NOTIFY_ROWS_DELETED, 0, GetNumberRows());
 	ProcessTableMessage(*msg);
 	delete msg;
 	msg = new wxGridTableMessage(table, wxGRIDTABLE_NOTIFY_COLS_DELETED, 0, GetNumberCols());
 	ProcessTableMessage(*msg);
 	delete msg;
-	msg = new wxGridTableMessage(table, wxGRIDTABLE_NOTIFY_ROWS_APPENDED, NumRows());
-	ProcessTableMessage(*msg);
-	delete msg;
-	msg = new wxGridTableMessage(table, wxGRIDTABLE_NOTIFY_COLS_APPENDED, thread->DataSet()->NumCols());
-	ProcessTableMessage(*msg);
-	delete msg;
+
+	// The table shows nothing more of the result, and isn't streaming
+	// anymore
+	table->SetThread(0);
+}
+
+
+void ctlSQLResult::DisplayData(bool single)
+{
+	if (!thread || !thread->DataValid())
+	{
+		DiscardRows();
+		return;
+	}
+
+	if (thread->ReturnCode() != PGRES_TUPLES_OK)
+	{
+		DiscardRows();
+		return;
+	}
+
+	sqlResultTable *table = (sqlResultTable *)GetTable();
+	wxGridTableMessage *msg;
+
+	if (table->IsStreaming() && !single)
+	{
+		// Most rows are shown already: add the last ones, then format the
+		// columns now the connection is free to look up their types.
+		AppendRows();
+		table->SetStreaming(false);
+		Freeze();
+	}
+	else
+	{
+		table->SetStreaming(false);
+		rowcountSuppressed = single;
+		Freeze();
+
+		/*
+		 * Resize and repopulate by informing it to delete all the rows and
+		 * columns, then append the correct number of them. Probably is a
+		 * better way to do this.
+		 */
+		msg = new wxGridTableMessage(table, wxGRIDTABLE_NOTIFY_ROWS_DELETED, 0, GetNumberRows());
+		ProcessTableMessage(*msg);
+		delete msg;
+		msg = new wxGridTableMessage(table, wxGRIDTABLE_NOTIFY_COLS_DELETED, 0, GetNumberCols());
+		ProcessTableMessage(*msg);
+		delete msg;
+		msg = new wxGridTableMessage(table, wxGRIDTABLE_NOTIFY_ROWS_APPENDED, NumRows());
+		ProcessTableMessage(*msg);
+		delete msg;
+		msg = new wxGridTableMessage(table, wxGRIDTABLE_NOTIFY_COLS_APPENDED, thread->DataSet()->NumCols());
+		ProcessTableMessage(*msg);
+		delete msg;
+	}
 
 	if (single)
 	{
@@ -196,13 +567,17 @@ void ctlSQLResult::DisplayData(bool single)
 		colTypes.Add(wxT(""));
 		colTypClasses.Add(0L);
 
+		table->SetFormat();
 		AutoSizeColumn(0, false, false);
 	}
 	else
 	{
 		long col, nCols = thread->DataSet()->NumCols();
 
+		thread->DataSet()->ResolveColTypes();
+		table->SetFormat();
 		AutoSizeColumns(false);
+		ForceRefresh();
 
 		for (col = 0 ; col < nCols ; col++)
 		{
@@ -226,6 +601,160 @@ void ctlSQLResult::DisplayData(bool single)
 
 
 
+bool ctlSQLResult::CanSortRows()
+{
+	return thread && thread->DataValid() && RunStatus() == PGRES_TUPLES_OK &&
+	       !thread->DataSet()->IsBinary() && !rowcountSuppressed;
+}
+
+
+void ctlSQLResult::SortRows(int col, bool descending)
+{
+	if (!CanSortRows() || col < 0 || col >= GetNumberCols())
+		return;
+
+	if (!index)
+		index = new pgSetIndex(thread->DataSet());
+	StopIndexBuild();
+	index->SetSort(col, descending);
+	ApplyIndex();
+}
+
+
+void ctlSQLResult::FilterRows(int row, int col, bool exclude)
+{
+	if (!CanSortRows() || row < 0 || row >= GetNumberRows() || col < 0 || col >= GetNumberCols())
+		return;
+
+	if (!index)
+		index = new pgSetIndex(thread->DataSet());
+	StopIndexBuild();
+	index->AddFilter(((sqlResultTable *)GetTable())->MapRow(row), col, exclude);
+	ApplyIndex();
+}
+
+
+void ctlSQLResult::RemoveSort()
+{
+	if (!index || !CanSortRows())
+		return;
+
+	StopIndexBuild();
+	index->RemoveSort();
+	ApplyIndex();
+}
+
+
+void ctlSQLResult::RemoveFilters()
+{
+	if (!index || !CanSortRows())
+		return;
+
+	StopIndexBuild();
+	index->RemoveFilters();
+	ApplyIndex();
+}
+
+
+pgSetSearch *ctlSQLResult::CreateSearch(const wxString &pattern, bool matchCase, bool useRegex)
+{
+	if (!thread || !thread->DataValid() || RunStatus() != PGRES_TUPLES_OK)
+		return NULL;
+
+	sqlResultTable *table = (sqlResultTable *)GetTable();
+	pgSet *set = thread->DataSet();
+	pgSetSearch *search = new pgSetSearch(set, set->NumCols(), pattern, matchCase, useRegex);
+
+	if (table->IsMapped())
+	{
+		for (int row = 0 ; row < table->GetNumberRows() ; row++)
+			search->AddRow(table->MapRow(row));
+	}
+	return search;
+}
+
+
+void ctlSQLResult::ApplyIndex()
+{
+	// Matches are positions in the grid
+	StopSearch();
+
+	if (!index->IsSorted() && !index->IsFiltered())
+	{
+		ShowIndexRows(NULL);
+		return;
+	}
+
+	// The rows of a big result take a while, so they are built off the GUI
+	// thread; the grid keeps showing the old order until they're ready
+	if (index->StartBuild(this))
+	{
+		wxBeginBusyCursor();
+		return;
+	}
+
+	wxBusyCursor wait;
+	wxArrayInt rows;
+	index->Build(rows);
+	ShowIndexRows(&rows);
+}
+
+
+void ctlSQLResult::OnIndexBuilt(wxCommandEvent &event)
+{
+	wxArrayInt rows;
+
+	// A build stopped in the meantime has nothing to show
+	if (!index || !index->GetBuilt(rows))
+		return;
+
+	wxEndBusyCursor();
+	ShowIndexRows(&rows);
+}
+
+
+void ctlSQLResult::StopIndexBuild()
+{
+	if (index && index->IsBuilding())
+	{
+		index->StopBuild();
+		wxEndBusyCursor();
+	}
+}
+
+
+// Without rows, the rows of the set are shown as they come
+void ctlSQLResult::ShowIndexRows(const wxArrayInt *rows)
+{
+	sqlResultTable *table = (sqlResultTable *)GetTable();
+	int oldRows = GetNumberRows();
+
+	if (rows)
+		table->SetRowMap(*rows);
+	else
+		table->ClearRowMap();
+
+	ClearSelection();
+	SelectionChanged();
+	BeginBatch();
+
+	int newRows = table->GetNumberRows();
+	wxGridTableMessage *msg = NULL;
+	if (newRows < oldRows)
+		msg = new wxGridTableMessage(table, wxGRIDTABLE_NOTIFY_ROWS_DELETED, newRows, oldRows - newRows);
+	else if (newRows > oldRows)
+		msg = new wxGridTableMessage(table, wxGRIDTABLE_NOTIFY_ROWS_APPENDED, newRows - oldRows);
+	if (msg)
+	{
+		ProcessTableMessage(*msg);
+		delete msg;
+	}
+
+	EndBatch();
+	ForceRefresh();
+}
+
+
 wxString ctlSQLResult::GetMessagesAndClear()
 {
 	if (thread)
@@ -273,6 +802,14 @@ OID ctlSQLResult::InsertedOid() const
 }
 
 
+long ctlSQLResult::CopyRowsWritten() const
+{
+	if (thread)
+		return thread->CopyRowsWritten();
+	return 0;
+}
+
+
 int ctlSQLResult::RunStatus()
 {
 	if (!thread)
@@ -310,6 +847,135 @@ wxString ctlSQLResult::OnGetItemText(long item, long col) const
 void ctlSQLResult::OnGridSelect(wxGridRangeSelectEvent &event)
 {
 	SetFocus();
+	SelectionChanged();
+}
+
+
+void ctlSQLResult::OnCellSelect(wxGridEvent &event)
+{
+	SelectionChanged();
+	event.Skip();
+}
+
+
+void ctlSQLResult::SelectionChanged()
+{
+	StopStats();
+	statsTimer.Start(STATS_DELAY, wxTIMER_ONE_SHOT);
+}
+
+
+void ctlSQLResult::StartStats()
+{
+	sqlResultTable *table = (sqlResultTable *)GetTable();
+	wxArrayInt rows, cols, setRows, setCols;
+	size_t i;
+
+	if (!thread || thread->IsRunning() || !thread->DataValid() || thread->ReturnCode() != PGRES_TUPLES_OK ||
+	        !GetSelectedRowsAndCols(rows, cols))
+	{
+		ShowStats(wxEmptyString);
+		return;
+	}
+
+	for (i = 0 ; i < cols.GetCount() ; i++)
+	{
+		int col = cols.Item(i);
+		if (col >= 0 && col < (int)colTypClasses.GetCount() && colTypClasses.Item(col) == PGTYPCLASS_NUMERIC)
+			setCols.Add(col);
+	}
+	if (setCols.IsEmpty())
+	{
+		ShowStats(wxEmptyString);
+		return;
+	}
+
+	// The figures are worked out from the rows of the result
+	int numRows = GetNumberRows();
+	setRows.Alloc(rows.GetCount());
+	for (i = 0 ; i < rows.GetCount() ; i++)
+	{
+		if (rows.Item(i) >= 0 && rows.Item(i) < numRows)
+			setRows.Add(table->MapRow(rows.Item(i)));
+	}
+
+	stats = new pgSetStats(thread->DataSet(), setRows, setCols, this);
+	if (stats->Create() != wxTHREAD_NO_ERROR || stats->Run() != wxTHREAD_NO_ERROR)
+	{
+		delete stats;
+		stats = NULL;
+		ShowStats(wxEmptyString);
+	}
+}
+
+
+void ctlSQLResult::StopStats()
+{
+	statsTimer.Stop();
+
+	if (stats)
+	{
+		stats->Cancel();
+		stats->Wait();
+		delete stats;
+		stats = NULL;
+	}
+}
+
+
+// The selection has settled
+void ctlSQLResult::OnStatsTimer(wxTimerEvent &event)
+{
+	if (!stats)
+		StartStats();
+}
+
+
+void ctlSQLResult::OnStatsDone(wxCommandEvent &event)
+{
+	// Figures stopped in the meantime have nothing to show
+	if (!stats || !stats->IsDone())
+		return;
+
+	stats->Wait();
+
+	wxString text;
+	if (stats->count)
+	{
+		wxString decimalMark = settings->GetDecimalMark();
+		text.Printf(_("Count: %ld  Sum: %s  Avg: %s  Min: %s  Max: %s  Distinct: %ld"),
+		            stats->count,
+		            FormatStat(stats->sum, decimalMark).c_str(),
+		            FormatStat(stats->sum / stats->count, decimalMark).c_str(),
+		            FormatStat(stats->min, decimalMark).c_str(),
+		            FormatStat(stats->max, decimalMark).c_str(),
+		            stats->distinct);
+	}
+
+	delete stats;
+	stats = NULL;
+
+	ShowStats(text);
+}
+
+
+void ctlSQLResult::ShowStats(const wxString &text)
+{
+	if (text == statsText)
+		return;
+	statsText = text;
+
+	wxCommandEvent ev(SelectionStatsEvent, GetId());
+	ev.SetEventObject(this);
+	ev.SetString(text);
+	GetEventHandler()->ProcessEvent(ev);
+}
+
+
+void ctlSQLResult::OnSettingsChanged(wxCommandEvent &event)
+{
+	((sqlResultTable *)GetTable())->SetFormat();
+	ForceRefresh();
 }
 
 wxString sqlResultTable::GetValue(int row, int col)
@@ -318,47 +984,40 @@ wxString sqlResultTable::GetValue(int row, int col)
 	{
 		if (col >= 0)
 		{
-			thread->DataSet()->Locate(row + 1);
-			if (settings->GetIndicateNull() && thread->DataSet()->IsNull(col))
-				return wxT("<NULL>");
-			else
+			// Cells are kept by their row in the result, so they stay valid
+			// when the rows are sorted or filtered
+			row = MapRow(row);
+			wxLongLong_t key = (wxLongLong_t)row * thread->DataSet()->NumCols() + col;
+
+			sqlResultCellHash::iterator it = cellIndex.find(key);
+			if (it != cellIndex.end())
 			{
+				int cell = it->second;
+				Unlink(cell);
+				MakeNewest(cell);
+				return cells[cell].value;
+			}
+
+			wxString value = Render(row, col);
 
-				wxString decimalMark = wxT(".");
-				wxString s = thread->DataSet()->GetVal(col);
-
-				if(thread->DataSet()->ColTypClass(col) == PGTYPCLASS_NUMERIC &&
-				        settings->GetDecimalMark().Length() > 0)
-				{
-					decimalMark = settings->GetDecimalMark();
-					s.Replace(wxT("."), decimalMark);
-
-				}
-				if (thread->DataSet()->ColTypClass(col) == PGTYPCLASS_NUMERIC &&
-				        settings->GetThousandsSeparator().Length() > 0)
-				{
-					/* Add thousands separator */
-					size_t pos = s.find(decimalMark);
-					if (pos == wxString::npos)
-						pos = s.length();
-					while (pos > 3)
-					{
-						pos -= 3;
-						if (pos > 1 || !s.StartsWith(wxT("-")))
-							s.insert(pos, settings->GetThousandsSeparator());
-					}
-					return s;
-				}
-				else
-				{
-					wxString data = thread->DataSet()->GetVal(col);
-
-					if (data.Length() > (size_t)settings->GetMaxColSize())
-						return thread->DataSet()->GetVal(col).Left(settings->GetMaxColSize()) + wxT(" (...)");
-					else
-						return thread->DataSet()->GetVal(col);
-				}
+			int cell;
+			if (!cells)
+				cells = new sqlResultCell[CELL_CACHE_SIZE];
+			if (cellCount < CELL_CACHE_SIZE)
+				cell = cellCount++;
+			else
+			{
+				cell = oldestCell;
+				cellIndex.erase(cells[cell].key);
+				Unlink(cell);
 			}
+
+			cells[cell].key = key;
+			cells[cell].value = value;
+			cellIndex[key] = cell;
+			MakeNewest(cell);
+
+			return value;
 		}
 		else
 			return thread->DataSet()->ColName(col);
@@ -366,13 +1025,124 @@ wxString sqlResultTable::GetValue(int row, int col)
 	return wxEmptyString;
 }
 
+
+wxString sqlResultTable::Render(int row, int col)
+{
+	pgSet *set = thread->DataSet();
+
+	set->Locate(row + 1);
+	if (indicateNull && set->IsNull(col))
+		return wxT("<NULL>");
+
+	wxString s = set->GetVal(col);
+
+	if (col < (int)numericCols.GetCount() && numericCols.Item(col))
+	{
+		wxString mark = wxT(".");
+		if (!decimalMark.IsEmpty())
+		{
+			s.Replace(wxT("."), decimalMark);
+			mark = decimalMark;
+		}
+		if (!thousandsSeparator.IsEmpty())
+		{
+			/* Add thousands separator */
+			size_t pos = s.find(mark);
+			if (pos == wxString::npos)
+				pos = s.length();
+			while (pos > 3)
+			{
+				pos -= 3;
+				if (pos > 1 || !s.StartsWith(wxT("-")))
+					s.insert(pos, thousandsSeparator);
+			}
+		}
+		return s;
+	}
+
+	if (s.Length() > maxColSize)
+		return s.Left(maxColSize) + wxT(" (...)");
+
+	return s;
+}
+
+
+void sqlResultTable::SetFormat()
+{
+	indicateNull = settings->GetIndicateNull();
+	decimalMark = settings->GetDecimalMark();
+	thousandsSeparator = settings->GetThousandsSeparator();
+	maxColSize = (size_t)settings->GetMaxColSize();
+
+	numericCols.Empty();
+	if (thread && thread->DataValid() && !streaming)
+	{
+		pgSet *set = thread->DataSet();
+		for (int col = 0 ; col < set->NumCols() ; col++)
+			numericCols.Add(set->ColTypClass(col) == PGTYPCLASS_NUMERIC);
+	}
+
+	ClearCache();
+}
+
+
+void sqlResultTable::ClearCache()
+{
+	cellIndex.clear();
+	cellCount = 0;
+	newestCell = oldestCell = -1;
+}
+
+
+void sqlResultTable::Unlink(int cell)
+{
+	if (cells[cell].newer >= 0)
+		cells[cells[cell].newer].older = cells[cell].older;
+	else
+		newestCell = cells[cell].older;
+
+	if (cells[cell].older >= 0)
+		cells[cells[cell].older].newer = cells[cell].newer;
+	else
+		oldestCell = cells[cell].newer;
+}
+
+
+void sqlResultTable::MakeNewest(int cell)
+{
+	cells[cell].newer = -1;
+	cells[cell].older = newestCell;
+
+	if (newestCell >= 0)
+		cells[newestCell].newer = cell;
+	else
+		oldestCell = cell;
+
+	newestCell = cell;
+}
+
+
 sqlResultTable::sqlResultTable()
 {
 	thread = NULL;
+	streaming = false;
+	mapped = false;
+	cells = NULL;
+
+	ClearCache();
+	SetFormat();
+}
+
+
+sqlResultTable::~sqlResultTable()
+{
+	delete[] cells;
 }
 
 int sqlResultTable::GetNumberRows()
 {
+	if (mapped)
+		return rowMap.GetCount();
 	if (thread && thread->DataValid())
 		return thread->DataSet()->NumRows();
 	return 0;
@@ -382,8 +1152,12 @@ int sqlResultTable::GetNumberRows()
 wxString sqlResultTable::GetColLabelValue(int col)
 {
 	if (thread && thread->DataValid())
+	{
+		if (streaming)
+			return thread->DataSet()->ColName(col);
 		return thread->DataSet()->ColName(col) + wxT("\n") +
 		       thread->DataSet()->ColFullType(col);
+	}
 	return wxEmptyString;
 }
 
@@ -20,6 +20,7 @@ pgadmin3_SOURCES += \
         ctl/ctlSQLBox.cpp \
         ctl/ctlSQLGrid.cpp \
         ctl/ctlSQLResult.cpp \
+        ctl/ctlResultFindBar.cpp \
         ctl/ctlDefaultSecurityPanel.cpp \
         ctl/ctlSeclabelPanel.cpp \
         ctl/ctlSecurityPanel.cpp \
@@ -12,7 +12,14 @@
 pgadmin3_SOURCES += \
 	db/keywords.c \
 	db/pgConn.cpp \
+	db/pgConnMonitor.cpp \
+	db/pgConnPool.cpp \
+	db/pgQueryProfiler.cpp \
 	db/pgSet.cpp \
+	db/pgSetIndex.cpp \
+	db/pgSetSearch.cpp \
+	db/pgSetStats.cpp \
+	db/pgSetSpill.cpp \
 	db/pgQueryThread.cpp
 
 EXTRA_DIST += \
@@ -28,6 +28,7 @@ typedef u_long in_addr_t;
 #include <arpa/inet.h>
 #include <netdb.h>
 #include <netinet/in.h>
+#include <poll.h>
 
 #ifndef INADDR_NONE
 #define INADDR_NONE (-1)
@@ -41,9 +42,26 @@ typedef u_long in_addr_t;
 #include "db/pgConn.h"
 #include "utils/misc.h"
 #include "db/pgSet.h"
+#include "db/pgConnMonitor.h"
+#include "db/pgConnPool.h"
+#include "db/pgQueryProfiler.h"
 
 double pgConn::libpqVersion = 8.0;
 
+static long s_backendCount = 0;
+static wxMutex s_backendCountMutex;
+
+// Read once, by the first connection, which is always made by the GUI thread
+static long s_keepaliveIdle = -1;
+
+// The most statements prepared by a connection at any time
+#define STATEMENT_CACHE_SIZE    64
+
+// Once a connection has been idle for the configured time, probe it this
+// often (seconds), and give up after this many unanswered probes
+#define KEEPALIVE_INTERVAL      10L
+#define KEEPALIVE_COUNT         3
+
 static void pgNoticeProcessor(void *arg, const char *message)
 {
 	((pgConn *)arg)->Notice(message);
@@ -84,6 +102,14 @@ pgConn::pgConn(const wxString &server, const wxString &service, const wxString &
 	conn = 0;
 	noticeArg = 0;
 	connStatus = PGCONN_BAD;
+	typeCacheLoaded = false;
+	statementCacheSerial = statementCacheClock = 0;
+	statementCacheHits = statementCacheMisses = 0;
+	statementCacheDisabled = false;
+	pool = 0;
+	backendCounted = false;
+	healthStatus = PGCONN_OK;
+	monitored = false;
 
 	// Create the connection string
 	if (!server.IsEmpty())
@@ -192,6 +218,17 @@ pgConn::pgConn(const wxString &server, const wxString &service, const wxString &
 		}
 	}
 
+	// Have the system notice a server that went away without closing the
+	// connection, so the connection monitor finds it lost.
+	if (s_keepaliveIdle < 0)
+		s_keepaliveIdle = settings->GetKeepaliveIdle();
+	if (libpqVersion > 8.4 && s_keepaliveIdle > 0)
+	{
+		connstr.Append(wxT(" keepalives=1 keepalives_idle=") + NumToStr(s_keepaliveIdle));
+		connstr.Append(wxT(" keepalives_interval=") + NumToStr(KEEPALIVE_INTERVAL));
+		connstr.Append(wxT(" keepalives_count=") + NumToStr((long)KEEPALIVE_COUNT));
+	}
+
 	connstr.Trim(false);
 
 	dbHost = server;
@@ -226,6 +263,7 @@ pgConn::pgConn(const wxString &server, const wxString &service, const wxString &
 
 pgConn::~pgConn()
 {
+	ClosePool();
 	Close();
 }
 
@@ -249,10 +287,30 @@ bool pgConn::DoConnect()
 	if (!Initialize())
 		return false;
 
+	CountBackend(true);
+	pgConnMonitor::Watch(this);
 	return true;
 }
 
 
+void pgConn::CountBackend(bool open)
+{
+	if (open == backendCounted)
+		return;
+
+	wxMutexLocker lock(s_backendCountMutex);
+	s_backendCount += open ? 1 : -1;
+	backendCounted = open;
+}
+
+
+long pgConn::GetBackendCount()
+{
+	wxMutexLocker lock(s_backendCountMutex);
+	return s_backendCount;
+}
+
+
 bool pgConn::Initialize()
 {
 	// Set client encoding to Unicode/Ascii, Datestyle to ISO, and ask for notices.
@@ -329,11 +387,17 @@ void pgConn::Close()
 {
 	if (conn)
 	{
+		if (statementCacheHits || statementCacheMisses)
+			wxLogInfo(wxT("Statement cache of %s: %ld hits, %ld misses"),
+			          GetName().c_str(), statementCacheHits, statementCacheMisses);
+
 		CancelExecution();
+		pgConnMonitor::Unwatch(this);
 		PQfinish(conn);
 	}
 	conn = 0;
 	connStatus = PGCONN_BAD;
+	CountBackend(false);
 }
 
 
@@ -345,6 +409,8 @@ bool pgConn::Reconnect()
 
 	// Reset any vars that need to be in a defined state before connecting
 	needColQuoting = false;
+	FlushTypeCache();
+	FlushStatementCache();
 
 	// Attempt the reconnect
 	if (!DoConnect())
@@ -377,6 +443,14 @@ pgConn *pgConn::Duplicate(const wxString &_appName)
 	for (size_t index = FEATURE_INITIALIZED; index < FEATURE_LAST; index++)
 		res->features[index] = features[index];
 
+	// Both connections see the same catalog, so share what we know about types
+	{
+		wxMutexLocker lock(typeCacheMutex);
+		res->typeCache = typeCache;
+		res->fullTypeCache = fullTypeCache;
+		res->typeCacheLoaded = typeCacheLoaded;
+	}
+
 	return res;
 }
 
@@ -746,9 +820,11 @@ bool pgConn::ExecuteVoid(const wxString &sql, bool reportError)
 
 	wxLogSql(wxT("Void query (%s:%d): %s"), this->GetHost().c_str(), this->GetPort(), sql.c_str());
 
+	double start = pgQueryProfiler::Now();
 	SetConnCancel();
 	qryRes = PQexec(conn, sql.mb_str(*conv));
 	ResetConnCancel();
+	pgQueryProfiler::Record(sql, start, qryRes);
 
 	lastResultStatus = PQresultStatus(qryRes);
 	SetLastResultError(qryRes);
@@ -779,9 +855,11 @@ wxString pgConn::ExecuteScalar(const wxString &sql, bool reportError)
 		PGresult *qryRes;
 		wxLogSql(wxT("Scalar query (%s:%d): %s"), this->GetHost().c_str(), this->GetPort(), sql.c_str());
 
+		double start = pgQueryProfiler::Now();
 		SetConnCancel();
 		qryRes = PQexec(conn, sql.mb_str(*conv));
 		ResetConnCancel();
+		pgQueryProfiler::Record(sql, start, qryRes);
 
 		lastResultStatus = PQresultStatus(qryRes);
 		SetLastResultError(qryRes);
@@ -822,9 +900,11 @@ pgSet *pgConn::ExecuteSet(const wxString &sql, bool reportError)
 		PGresult *qryRes;
 		wxLogSql(wxT("Set query (%s:%d): %s"), this->GetHost().c_str(), this->GetPort(), sql.c_str());
 
+		double start = pgQueryProfiler::Now();
 		SetConnCancel();
 		qryRes = PQexec(conn, sql.mb_str(*conv));
 		ResetConnCancel();
+		pgQueryProfiler::Record(sql, start, qryRes);
 
 		lastResultStatus = PQresultStatus(qryRes);
 		SetLastResultError(qryRes);
@@ -851,6 +931,298 @@ pgSet *pgConn::ExecuteSet(const wxString &sql, bool reportError)
 	return new pgSet();
 }
 
+
+
+wxString pgConn::ExecuteScalar(const wxString &sql, const wxArrayString &params, bool reportError)
+{
+	wxString result;
+
+	if (GetStatus() == PGCONN_OK)
+	{
+		wxLogSql(wxT("Scalar query (%s:%d): %s"), this->GetHost().c_str(), this->GetPort(), sql.c_str());
+
+		PGresult *qryRes = ExecutePrepared(sql, params);
+
+		lastResultStatus = PQresultStatus(qryRes);
+		SetLastResultError(qryRes);
+
+		// Check for errors
+		if (lastResultStatus != PGRES_TUPLES_OK && lastResultStatus != PGRES_COMMAND_OK)
+		{
+			LogError(!reportError);
+			PQclear(qryRes);
+			return wxEmptyString;
+		}
+
+		// Check for a returned row
+		if (PQntuples(qryRes) < 1)
+		{
+			wxLogInfo(wxT("Query returned no tuples"));
+			PQclear(qryRes);
+			return wxEmptyString;
+		}
+
+		// Retrieve the query result and return it.
+		result = wxString(PQgetvalue(qryRes, 0, 0), *conv);
+
+		wxLogSql(wxT("Query result: %s"), result.c_str());
+
+		// Cleanup & exit
+		PQclear(qryRes);
+	}
+
+	return result;
+}
+
+
+pgSet *pgConn::ExecuteSet(const wxString &sql, const wxArrayString &params, bool reportError)
+{
+	// Execute the query and get the status.
+	if (GetStatus() == PGCONN_OK)
+	{
+		wxLogSql(wxT("Set query (%s:%d): %s"), this->GetHost().c_str(), this->GetPort(), sql.c_str());
+
+		PGresult *qryRes = ExecutePrepared(sql, params);
+
+		lastResultStatus = PQresultStatus(qryRes);
+		SetLastResultError(qryRes);
+
+		if (lastResultStatus == PGRES_TUPLES_OK || lastResultStatus == PGRES_COMMAND_OK)
+			return new pgSet(qryRes, this, *conv, needColQuoting);
+
+		LogError(!reportError);
+		PQclear(qryRes);
+	}
+	return new pgSet();
+}
+
+//////////////////////////////////////////////////////////////////////////
+// Prepared statement cache
+//////////////////////////////////////////////////////////////////////////
+
+// The server forgets prepared statements on DISCARD or DEALLOCATE, and a
+// pooler may hand the next query to a session that never had them. Only
+// "prepared statement does not exist" is taken for that; any other error
+// is the query's own.
+static bool IsStaleStatement(PGresult *res)
+{
+	if (PQresultStatus(res) != PGRES_FATAL_ERROR)
+		return false;
+
+	const char *state = PQresultErrorField(res, PG_DIAG_SQLSTATE);
+
+	return state && !strcmp(state, "26000");
+}
+
+
+PGresult *pgConn::ExecutePrepared(const wxString &sql, const wxArrayString &params)
+{
+	int nParams = params.GetCount();
+	wxCharBuffer *buffers = new wxCharBuffer[nParams];
+	const char **values = new const char *[nParams];
+	PGresult *qryRes = NULL;
+
+	for (int i = 0; i < nParams; i++)
+	{
+		buffers[i] = params[i].mb_str(*conv);
+		values[i] = buffers[i];
+	}
+
+	wxCharBuffer query = sql.mb_str(*conv);
+
+	double start = pgQueryProfiler::Now();
+	SetConnCancel();
+
+	pgPreparedStatementHash::iterator it = preparedStatements.find(sql);
+	bool cached = (!statementCacheDisabled && it != preparedStatements.end());
+
+	// Preparing costs a round trip of its own, which one-off queries
+	// without parameters never make up for
+	bool prepare = cached;
+	if (!statementCacheDisabled && !cached)
+	{
+		statementCacheMisses++;
+
+		if (nParams > 0 || statementsSeen.find(sql) != statementsSeen.end())
+			prepare = true;
+		else
+		{
+			if (statementsSeen.size() >= STATEMENT_CACHE_SIZE * 4)
+				statementsSeen.clear();
+			statementsSeen.insert(sql);
+		}
+	}
+
+	if (prepare)
+	{
+		wxString name;
+
+		if (cached)
+		{
+			statementCacheHits++;
+			it->second.lastUsed = ++statementCacheClock;
+			name = it->second.name;
+		}
+		else
+			name = PrepareStatement(sql, query, nParams, qryRes);
+
+		if (!name.IsEmpty())
+		{
+			qryRes = PQexecPrepared(conn, name.mb_str(*conv), nParams, values, NULL, NULL, 0);
+
+			// A cached statement may have been dropped since: prepare it
+			// once more, and try again
+			if (cached && IsStaleStatement(qryRes))
+			{
+				PQclear(qryRes);
+				qryRes = NULL;
+
+				preparedStatements.erase(sql);
+				name = PrepareStatement(sql, query, nParams, qryRes);
+
+				if (!name.IsEmpty())
+					qryRes = PQexecPrepared(conn, name.mb_str(*conv), nParams, values, NULL, NULL, 0);
+			}
+
+			// Statements vanishing right after being prepared are a sign
+			// of a pooler in between, such as pgbouncer in transaction
+			// mode: stop preparing statements, and run the query as is.
+			if (!name.IsEmpty() && IsStaleStatement(qryRes))
+			{
+				wxLogInfo(wxT("Prepared statements don't persist on %s, not caching them any more"), GetName().c_str());
+
+				PQclear(qryRes);
+				qryRes = NULL;
+				FlushStatementCache();
+				statementCacheDisabled = true;
+			}
+		}
+	}
+
+	if (!prepare || (statementCacheDisabled && !qryRes))
+		qryRes = PQexecParams(conn, query, nParams, NULL, values, NULL, NULL, 0);
+
+	ResetConnCancel();
+	pgQueryProfiler::Record(sql, start, qryRes);
+
+	delete [] values;
+	delete [] buffers;
+
+	return qryRes;
+}
+
+
+// Prepare the statement for the query under a new name, making room in the
+// cache if needed. On failure the result of PQprepare is handed back.
+wxString pgConn::PrepareStatement(const wxString &sql, const char *query, int nParams, PGresult *&errorResult)
+{
+	if (preparedStatements.size() >= STATEMENT_CACHE_SIZE)
+	{
+		// Drop the statement used least recently
+		pgPreparedStatementHash::iterator it, lru = preparedStatements.end();
+
+		for (it = preparedStatements.begin(); it != preparedStatements.end(); ++it)
+		{
+			if (lru == preparedStatements.end() || it->second.lastUsed < lru->second.lastUsed)
+				lru = it;
+		}
+
+		wxString deallocate = wxT("DEALLOCATE ") + lru->second.name;
+		PQclear(PQexec(conn, deallocate.mb_str(*conv)));
+		preparedStatements.erase(lru);
+	}
+
+	wxString name = wxString::Format(wxT("pgadmin_stmt_%ld"), ++statementCacheSerial);
+	PGresult *res = PQprepare(conn, name.mb_str(*conv), query, nParams, NULL);
+
+	if (PQresultStatus(res) != PGRES_COMMAND_OK)
+	{
+		errorResult = res;
+		return wxEmptyString;
+	}
+	PQclear(res);
+
+	pgPreparedStatement &stmt = preparedStatements[sql];
+	stmt.name = name;
+	stmt.lastUsed = ++statementCacheClock;
+
+	return name;
+}
+
+
+// The statements are gone with the session they were prepared in
+void pgConn::FlushStatementCache()
+{
+	preparedStatements.clear();
+	statementsSeen.clear();
+	statementCacheDisabled = false;
+}
+
+//////////////////////////////////////////////////////////////////////////
+// Background queries
+//////////////////////////////////////////////////////////////////////////
+
+const wxEventType PGConnResultEvent = wxNewEventType();
+
+pgConnResultEvent::pgConnResultEvent(int id, long request, pgSet *set, const wxString &error)
+	: wxCommandEvent(PGConnResultEvent, id), m_request(request), m_set(set), m_error(error)
+{
+}
+
+
+// Events cross threads, so don't share the string data
+pgConnResultEvent::pgConnResultEvent(const pgConnResultEvent &ev)
+	: wxCommandEvent(ev), m_request(ev.m_request), m_set(ev.m_set), m_error(ev.m_error.c_str())
+{
+}
+
+
+long pgConn::ExecuteSetAsync(const wxString &sql, wxEvtHandler *handler, int id, void *data)
+{
+	return ExecuteSetAsync(sql, wxArrayString(), handler, id, data);
+}
+
+
+long pgConn::ExecuteSetAsync(const wxString &sql, const wxArrayString &params, wxEvtHandler *handler, int id, void *data)
+{
+	if (GetStatus() != PGCONN_OK || !handler)
+		return 0;
+
+	return GetPool()->Queue(sql, params, handler, id, data);
+}
+
+
+void pgConn::CancelAsync(long request)
+{
+	pgConnPool::Cancel(request);
+}
+
+
+// Called before the handler goes away
+void pgConn::CancelAsync(wxEvtHandler *handler)
+{
+	pgConnPool::Cancel(handler);
+}
+
+
+pgConnPool *pgConn::GetPool()
+{
+	if (!pool)
+		pool = new pgConnPool(this);
+
+	return pool;
+}
+
+
+void pgConn::ClosePool()
+{
+	if (pool)
+	{
+		delete pool;
+		pool = 0;
+	}
+}
+
 //////////////////////////////////////////////////////////////////////////
 // COPY functions
 //////////////////////////////////////////////////////////////////////////
@@ -864,6 +1236,8 @@ bool pgConn::StartCopy(const wxString query)
 	PGresult *qryRes;
 
 	wxLogSql(wxT("COPY query (%s:%d): %s"), this->GetHost().c_str(), this->GetPort(), query.c_str());
+	// The COPY may be cancelled until its final status is in
+	SetConnCancel();
 	qryRes = PQexec(conn, query.mb_str(*conv));
 	lastResultStatus = PQresultStatus(qryRes);
 	SetLastResultError(qryRes);
@@ -871,6 +1245,7 @@ bool pgConn::StartCopy(const wxString query)
 	// Check for errors
 	if (lastResultStatus != PGRES_COPY_IN)
 	{
+		ResetConnCancel();
 		LogError(false);
 		PQclear(qryRes);
 		return false;
@@ -888,6 +1263,49 @@ bool pgConn::PutCopyData(const char *data, long count)
 	return result == 1;
 }
 
+bool pgConn::SetNonBlocking(bool nonBlocking)
+{
+	return PQsetnonblocking(conn, nonBlocking ? 1 : 0) == 0;
+}
+
+int pgConn::TryPutCopyData(const char *data, long count)
+{
+	return PQputCopyData(conn, data, count);
+}
+
+int pgConn::FlushCopyData(int msec)
+{
+	int pending = PQflush(conn);
+	if (pending != 1)
+		return pending;
+
+	int sock = PQsocket(conn);
+	if (sock < 0)
+		return -1;
+
+#ifdef __WXMSW__
+	fd_set writeFds;
+	struct timeval timeout;
+
+	FD_ZERO(&writeFds);
+	FD_SET(sock, &writeFds);
+	timeout.tv_sec = msec / 1000;
+	timeout.tv_usec = (msec % 1000) * 1000;
+
+	select(sock + 1, NULL, &writeFds, NULL, &timeout);
+#else
+	struct pollfd fds;
+
+	fds.fd = sock;
+	fds.events = POLLOUT;
+	fds.revents = 0;
+
+	poll(&fds, 1, msec);
+#endif
+
+	return PQflush(conn);
+}
+
 bool pgConn::EndPutCopy(const wxString errormsg)
 {
 	int result;
@@ -907,6 +1325,7 @@ bool pgConn::GetCopyFinalStatus(void)
 
 	// Get status
 	qryRes = PQgetResult(conn);
+	ResetConnCancel();
 	lastResultStatus = PQresultStatus(qryRes);
 
 	// Check for errors
@@ -972,13 +1391,20 @@ bool pgConn::IsAlive()
 	{
 		if (conn)
 		{
+			pgConnMonitor::Unwatch(this);
 			PQfinish(conn);
 			conn = 0;
 			connStatus = PGCONN_BROKEN;
+			CountBackend(false);
 		}
 		return false;
 	}
 
+	// The monitor notices a lost connection without a round trip; only a
+	// failed transaction still needs to be rolled back.
+	if (monitored && PQtransactionStatus(conn) != PQTRANS_INERROR)
+		return true;
+
 	PGresult *qryRes = PQexec(conn, "SELECT 1;");
 	lastResultStatus = PQresultStatus(qryRes);
 	if (lastResultStatus != PGRES_TUPLES_OK)
@@ -993,9 +1419,11 @@ bool pgConn::IsAlive()
 	// Check for errors
 	if (lastResultStatus != PGRES_TUPLES_OK)
 	{
+		pgConnMonitor::Unwatch(this);
 		PQfinish(conn);
 		conn = 0;
 		connStatus = PGCONN_BROKEN;
+		CountBackend(false);
 		return false;
 	}
 
@@ -1009,7 +1437,13 @@ int pgConn::GetStatus() const
 		return PGCONN_BAD;
 
 	if (conn)
-		((pgConn *)this)->connStatus = PQstatus(conn);
+	{
+		// libpq only learns the connection is lost when it next uses it
+		if (healthStatus == PGCONN_BROKEN)
+			((pgConn *)this)->connStatus = PGCONN_BROKEN;
+		else
+			((pgConn *)this)->connStatus = PQstatus(conn);
+	}
 
 	return connStatus;
 }
@@ -1017,12 +1451,16 @@ int pgConn::GetStatus() const
 
 void pgConn::Reset()
 {
+	pgConnMonitor::Unwatch(this);
 	PQreset(conn);
 
 	// Reset any vars that need to be in a defined state before connecting
 	needColQuoting = false;
+	FlushTypeCache();
+	FlushStatementCache();
 
-	Initialize();
+	if (Initialize())
+		pgConnMonitor::Watch(this);
 }
 
 
@@ -1240,6 +1678,142 @@ bool pgConn::TableHasColumn(wxString schemaname, wxString tblname, const wxStrin
 	return false;
 }
 
+//////////////////////////////////////////////////////////////////////////
+// Type catalog cache
+//////////////////////////////////////////////////////////////////////////
+
+void pgConn::FlushTypeCache()
+{
+	wxMutexLocker lock(typeCacheMutex);
+
+	typeCache.clear();
+	fullTypeCache.clear();
+	typeCacheLoaded = false;
+}
+
+
+// Read the pg_type rows matching the restriction (all of them if empty)
+// into the cache. Must be called with typeCacheMutex held.
+bool pgConn::CacheTypes(const wxString &restriction)
+{
+	wxString sql =
+	    wxT("SELECT oid, CASE WHEN typbasetype=0 THEN oid ELSE typbasetype END AS basetype,\n")
+	    wxT("       format_type(oid, NULL) AS typname\n")
+	    wxT("  FROM pg_type");
+
+	if (!restriction.IsEmpty())
+		sql += wxT("\n WHERE ") + restriction;
+
+	pgSet *set = ExecuteSet(sql, false);
+	bool ok = (lastResultStatus == PGRES_TUPLES_OK);
+	if (set)
+	{
+		while (!set->Eof())
+		{
+			pgTypeCacheEntry &entry = typeCache[set->GetOid(0)];
+			entry.baseType = set->GetOid(1);
+			entry.typClass = pgSet::TypClassFromOid(entry.baseType);
+			entry.name = set->GetVal(2);
+
+			set->MoveNext();
+		}
+		delete set;
+	}
+	return ok;
+}
+
+
+bool pgConn::ResolveTypes(long count, const OID *oids, const long *mods,
+                          wxString *names, wxString *fullNames, int *classes)
+{
+	if (GetStatus() != PGCONN_OK)
+		return false;
+
+	wxMutexLocker lock(typeCacheMutex);
+	long col;
+
+	// The whole catalog is read once per connection, types created later
+	// are picked up in bulk below.
+	if (!typeCacheLoaded)
+		typeCacheLoaded = CacheTypes(wxEmptyString);
+
+	wxString missing;
+	for (col = 0 ; col < count ; col++)
+	{
+		if (typeCache.find(oids[col]) == typeCache.end())
+		{
+			if (!missing.IsEmpty())
+				missing += wxT(", ");
+			missing += NumToStr(oids[col]);
+		}
+	}
+
+	if (!missing.IsEmpty() && CacheTypes(wxT("oid IN (") + missing + wxT(")")))
+	{
+		// Remember types that don't exist (anymore), so we won't ask again
+		for (col = 0 ; col < count ; col++)
+		{
+			if (typeCache.find(oids[col]) == typeCache.end())
+			{
+				pgTypeCacheEntry &entry = typeCache[oids[col]];
+				entry.baseType = oids[col];
+				entry.typClass = PGTYPCLASS_OTHER;
+			}
+		}
+	}
+
+	// The full type name depends on the typmod too, so it's cached separately
+	if (fullNames)
+	{
+		wxString sql;
+		for (col = 0 ; col < count ; col++)
+		{
+			wxString key = NumToStr(oids[col]) + wxT(":") + NumToStr(mods[col]);
+			if (fullTypeCache.find(key) == fullTypeCache.end() &&
+			        !sql.Contains(wxT("'") + key + wxT("'")))
+			{
+				if (!sql.IsEmpty())
+					sql += wxT("\nUNION ALL ");
+				sql += wxT("SELECT '") + key + wxT("', format_type(") + NumToStr(oids[col])
+				       + wxT(", ") + NumToStr(mods[col]) + wxT(")");
+			}
+		}
+
+		if (!sql.IsEmpty())
+		{
+			pgSet *set = ExecuteSet(sql, false);
+			if (set)
+			{
+				while (!set->Eof())
+				{
+					fullTypeCache[set->GetVal(0)] = set->GetVal(1);
+					set->MoveNext();
+				}
+				delete set;
+			}
+		}
+	}
+
+	for (col = 0 ; col < count ; col++)
+	{
+		pgTypeCacheHash::iterator type = typeCache.find(oids[col]);
+		bool found = (type != typeCache.end());
+
+		if (names)
+			names[col] = found ? type->second.name : wxString();
+		if (classes)
+			classes[col] = found ? type->second.typClass : (int)PGTYPCLASS_OTHER;
+		if (fullNames)
+		{
+			pgFullTypeCacheHash::iterator fullType =
+			    fullTypeCache.find(NumToStr(oids[col]) + wxT(":") + NumToStr(mods[col]));
+			fullNames[col] = (fullType != fullTypeCache.end()) ? fullType->second : wxString();
+		}
+	}
+
+	return true;
+}
+
 void pgError::SetError(PGresult *_res, wxMBConv *_conv)
 {
 	if (!_conv)
@@ -0,0 +1,227 @@
+//////////////////////////////////////////////////////////////////////////
+//
+// pgAdmin III - PostgreSQL Tools
+//
+// Copyright (C) 2002 - 2016, The pgAdmin Development Team
+// This software is released under the PostgreSQL Licence
+//
+// pgConnMonitor.cpp - Watches the health of open connections
+//
+//////////////////////////////////////////////////////////////////////////
+
+#include "pgAdmin3.h"
+
+// wxWindows headers
+#include <wx/wx.h>
+
+// PostgreSQL headers
+#include <libpq-fe.h>
+
+// Socket checks
+#ifdef __WXMSW__
+#include <winsock.h>
+#else
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <poll.h>
+#include <errno.h>
+#endif
+
+// App headers
+#include "db/pgConn.h"
+#include "db/pgConnMonitor.h"
+#include "utils/sysSettings.h"
+
+const wxEventType PGConnStatusEvent = wxNewEventType();
+
+static wxMutex s_mutex;
+static wxArrayPtrVoid s_watched;
+static wxEvtHandler *s_handler = 0;
+static pgConnMonitor *s_monitor = 0;
+static bool s_shutDown = false;
+
+// Read once, by the first connection, which is always made by the GUI thread
+static long s_interval = -1;
+
+
+// Is the socket still connected to the server? Data waiting to be read may
+// be a notice or the result of a query being run; only the end of the
+// stream means the server has gone.
+static bool SocketAlive(int sock)
+{
+	if (sock < 0)
+		return false;
+
+	int error = 0;
+#ifdef __WXMSW__
+	int len = sizeof(error);
+#else
+	socklen_t len = sizeof(error);
+#endif
+
+	if (getsockopt(sock, SOL_SOCKET, SO_ERROR, (char *)&error, &len) != 0 || error != 0)
+		return false;
+
+#ifdef __WXMSW__
+	fd_set input;
+	struct timeval timeout = { 0, 0 };
+
+	FD_ZERO(&input);
+	FD_SET(sock, &input);
+	if (select(sock + 1, &input, NULL, NULL, &timeout) <= 0)
+		return true;
+#else
+	struct pollfd input;
+
+	input.fd = sock;
+	input.events = POLLIN;
+	input.revents = 0;
+	if (poll(&input, 1, 0) <= 0)
+		return true;
+	if (input.revents & (POLLERR | POLLNVAL))
+		return false;
+#endif
+
+	// libpq keeps its sockets non-blocking, so this can't hang even if the
+	// thread using the connection has read the data in the meantime.
+	char c;
+	int flags = MSG_PEEK;
+#ifdef MSG_DONTWAIT
+	flags |= MSG_DONTWAIT;
+#endif
+	int received = recv(sock, &c, 1, flags);
+
+	if (received > 0)
+		return true;
+	if (received == 0)
+		return false;
+
+#ifdef __WXMSW__
+	error = WSAGetLastError();
+	return error == WSAEWOULDBLOCK || error == WSAEINTR;
+#else
+	return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+#endif
+}
+
+
+pgConnMonitor::pgConnMonitor(long _interval)
+	: wxThread(wxTHREAD_JOINABLE), interval(_interval), stopping(false), wakeUp(sleepMutex)
+{
+}
+
+
+void *pgConnMonitor::Entry()
+{
+	wxMutexLocker lock(sleepMutex);
+
+	while (!stopping)
+	{
+		wakeUp.WaitTimeout(interval * 1000);
+		if (!stopping)
+			Check();
+	}
+
+	return 0;
+}
+
+
+void pgConnMonitor::Check()
+{
+	wxMutexLocker lock(s_mutex);
+
+	for (size_t i = 0 ; i < s_watched.GetCount() ; i++)
+	{
+		pgConn *conn = (pgConn *)s_watched.Item(i);
+
+		if (conn->healthStatus != PGCONN_OK || SocketAlive(PQsocket(conn->conn)))
+			continue;
+
+		conn->healthStatus = PGCONN_BROKEN;
+
+		if (s_handler)
+		{
+			wxCommandEvent ev(PGConnStatusEvent);
+			ev.SetClientData(conn);
+			ev.SetInt(PGCONN_BROKEN);
+			s_handler->AddPendingEvent(ev);
+		}
+	}
+}
+
+
+void pgConnMonitor::Watch(pgConn *conn)
+{
+	wxMutexLocker lock(s_mutex);
+
+	if (s_interval < 0)
+		s_interval = settings->GetConnectionCheckInterval();
+
+	conn->healthStatus = PGCONN_OK;
+	if (s_interval <= 0 || s_shutDown || !conn->conn)
+		return;
+
+	if (!s_monitor)
+	{
+		s_monitor = new pgConnMonitor(s_interval);
+		if (s_monitor->Create() != wxTHREAD_NO_ERROR || s_monitor->Run() != wxTHREAD_NO_ERROR)
+		{
+			wxLogError(_("Couldn't start the connection monitor."));
+			delete s_monitor;
+			s_monitor = 0;
+			s_shutDown = true;
+			return;
+		}
+	}
+
+	if (s_watched.Index(conn) == wxNOT_FOUND)
+		s_watched.Add(conn);
+	conn->monitored = true;
+}
+
+
+void pgConnMonitor::Unwatch(pgConn *conn)
+{
+	wxMutexLocker lock(s_mutex);
+
+	int index = s_watched.Index(conn);
+	if (index != wxNOT_FOUND)
+		s_watched.RemoveAt(index);
+	conn->monitored = false;
+}
+
+
+void pgConnMonitor::SetHandler(wxEvtHandler *handler)
+{
+	wxMutexLocker lock(s_mutex);
+
+	s_handler = handler;
+}
+
+
+void pgConnMonitor::Shutdown()
+{
+	pgConnMonitor *monitor;
+	{
+		wxMutexLocker lock(s_mutex);
+
+		monitor = s_monitor;
+		s_monitor = 0;
+		s_shutDown = true;
+
+		for (size_t i = 0 ; i < s_watched.GetCount() ; i++)
+			((pgConn *)s_watched.Item(i))->monitored = false;
+		s_watched.Clear();
+	}
+
+	if (monitor)
+	{
+		{
+			wxMutexLocker lock(monitor->sleepMutex);
+			monitor->stopping = true;
+			monitor->wakeUp.Signal();
+		}
+		monitor->Wait();
+		delete monitor;
+	}
+}
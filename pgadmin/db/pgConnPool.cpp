@@ -0,0 +1,557 @@
+//////////////////////////////////////////////////////////////////////////
+//
+// pgAdmin III - PostgreSQL Tools
+//
+// Copyright (C) 2002 - 2016, The pgAdmin Development Team
+// This software is released under the PostgreSQL Licence
+//
+// pgConnPool.cpp - Pool of connections for background work
+//
+//////////////////////////////////////////////////////////////////////////
+
+#include "pgAdmin3.h"
+
+// wxWindows headers
+#include <wx/wx.h>
+
+// App headers
+#include "db/pgConn.h"
+#include "db/pgConnPool.h"
+#include "db/pgQueryProfiler.h"
+#include "utils/sysSettings.h"
+
+// Connections idle for this long (seconds) are checked before they're used
+#define HEALTH_CHECK_INTERVAL   30
+
+// How often (milliseconds) idle threads look for connections to close
+#define MAINTENANCE_INTERVAL    10000
+
+// How long (milliseconds) a background query waits for a connection
+#define BORROW_TIMEOUT          30000
+
+
+struct pgAsyncRequest
+{
+	long number;
+	wxString sql;
+	wxArrayString params;
+	wxEvtHandler *handler;
+	int id;
+	void *data;
+	wxString site;
+	bool cancelled;
+};
+
+
+// Runs the queued queries of a pool, each on a connection borrowed from it
+class pgConnWorker : public wxThread
+{
+public:
+	pgConnWorker(pgConnPool *_pool);
+
+protected:
+	void *Entry();
+
+private:
+	void Execute(pgConn *conn);
+	void Post(pgSet *set, const wxString &error);
+
+	pgConnPool *pool;
+
+	// Guarded by the mutex of the pool
+	pgAsyncRequest *current;
+	pgConn *session;
+
+	friend class pgConnPool;
+};
+
+
+// All pools, so requests can be cancelled by number
+static wxArrayPtrVoid s_pools;
+static wxMutex s_poolsMutex;
+static long s_requestSerial = 0;
+
+// Connections being opened by pools at the moment
+static long s_connecting = 0;
+static wxMutex s_connectingMutex;
+
+
+pgConnPool::pgConnPool(pgConn *_master)
+	: master(_master), returned(mutex), queued(mutex)
+{
+	stopping = false;
+	open = 0;
+	waitingWorkers = 0;
+
+	minSize = settings->GetPoolMinConnections();
+	maxSize = settings->GetPoolMaxConnections();
+	if (maxSize < 1)
+		maxSize = 1;
+	if (minSize > maxSize)
+		minSize = maxSize;
+	idleTimeout = settings->GetPoolIdleTimeout();
+	maxBackends = settings->GetMaxBackends();
+
+	wxMutexLocker lock(s_poolsMutex);
+	s_pools.Add(this);
+}
+
+
+pgConnPool::~pgConnPool()
+{
+	{
+		wxMutexLocker lock(s_poolsMutex);
+		s_pools.Remove(this);
+	}
+
+	size_t i;
+
+	mutex.Lock();
+
+	stopping = true;
+	for (i = 0; i < workers.GetCount(); i++)
+	{
+		pgConnWorker *worker = (pgConnWorker *)workers[i];
+		if (worker->current)
+		{
+			worker->current->cancelled = true;
+			if (worker->session)
+				worker->session->CancelExecution();
+		}
+	}
+	queued.Broadcast();
+	returned.Broadcast();
+
+	mutex.Unlock();
+
+	for (i = 0; i < workers.GetCount(); i++)
+	{
+		pgConnWorker *worker = (pgConnWorker *)workers[i];
+		worker->Wait();
+		delete worker;
+	}
+
+	for (i = 0; i < requests.GetCount(); i++)
+		delete requests[i];
+
+	for (i = 0; i < idle.GetCount(); i++)
+		delete (pgConn *)idle[i];
+}
+
+
+pgConn *pgConnPool::Borrow(long timeout)
+{
+	wxLongLong deadline = wxGetLocalTimeMillis() + timeout;
+	wxMutexLocker lock(mutex);
+
+	while (!stopping)
+	{
+		Evict();
+
+		if (!idle.IsEmpty())
+		{
+			// The connection returned last is the least likely to be gone
+			size_t last = idle.GetCount() - 1;
+			pgConn *conn = (pgConn *)idle[last];
+			bool check = (time(NULL) - idleSince[last] >= HEALTH_CHECK_INTERVAL);
+
+			idle.RemoveAt(last);
+			idleSince.RemoveAt(last);
+
+			bool alive;
+			if (check)
+			{
+				mutex.Unlock();
+				alive = conn->IsAlive();
+				mutex.Lock();
+			}
+			else
+				alive = (conn->GetStatus() == PGCONN_OK);
+
+			if (alive)
+				return conn;
+
+			wxLogInfo(wxT("Dropping a broken connection from the pool of %s"), master->GetName().c_str());
+			Discard(conn);
+			continue;
+		}
+
+		if (open < maxSize)
+		{
+			bool capped = false;
+			pgConn *conn = Open(capped);
+
+			if (conn || !capped)
+				return conn;
+		}
+
+		// Wait for a connection to be returned, if there is any to come
+		long remaining = (deadline - wxGetLocalTimeMillis()).ToLong();
+		if (remaining <= 0 || !open)
+			break;
+
+		returned.WaitTimeout(remaining);
+	}
+
+	return NULL;
+}
+
+
+void pgConnPool::Return(pgConn *conn)
+{
+	wxMutexLocker lock(mutex);
+
+	// Anything left behind by the borrower makes the connection unfit for
+	// the next one
+	if (stopping || conn->GetStatus() != PGCONN_OK || conn->GetTxStatus() != PGCONN_TXSTATUS_IDLE)
+		Discard(conn);
+	else
+	{
+		idle.Add(conn);
+		idleSince.Add((long)time(NULL));
+		returned.Signal();
+	}
+}
+
+
+// Called with the mutex held, which is released while connecting
+pgConn *pgConnPool::Open(bool &capped)
+{
+	{
+		wxMutexLocker lock(s_connectingMutex);
+
+		if (pgConn::GetBackendCount() + s_connecting >= maxBackends)
+		{
+			wxLogInfo(wxT("Not opening another connection to %s, %ld are open already"), master->GetName().c_str(), maxBackends);
+			capped = true;
+			return NULL;
+		}
+		s_connecting++;
+	}
+
+	open++;
+	mutex.Unlock();
+
+	pgConn *conn = master->Duplicate();
+
+	mutex.Lock();
+
+	{
+		wxMutexLocker lock(s_connectingMutex);
+		s_connecting--;
+	}
+
+	if (conn->GetStatus() != PGCONN_OK)
+	{
+		wxLogInfo(wxT("Failed to open a pooled connection to %s: %s"), master->GetName().c_str(), conn->GetLastError().c_str());
+		Discard(conn);
+		return NULL;
+	}
+
+	return conn;
+}
+
+
+// Called with the mutex held
+void pgConnPool::Discard(pgConn *conn)
+{
+	delete conn;
+	open--;
+
+	// Someone waiting may open a new one instead
+	returned.Signal();
+}
+
+
+// Called with the mutex held
+void pgConnPool::Evict()
+{
+	time_t now = time(NULL);
+
+	while (open > minSize && !idle.IsEmpty() && now - idleSince[0] >= idleTimeout)
+	{
+		pgConn *conn = (pgConn *)idle[0];
+		idle.RemoveAt(0);
+		idleSince.RemoveAt(0);
+
+		Discard(conn);
+	}
+}
+
+
+int pgConnPool::GetOpenCount()
+{
+	wxMutexLocker lock(mutex);
+	return open;
+}
+
+
+int pgConnPool::GetIdleCount()
+{
+	wxMutexLocker lock(mutex);
+	return idle.GetCount();
+}
+
+
+long pgConnPool::Queue(const wxString &sql, const wxArrayString &params, wxEvtHandler *handler, int id, void *data)
+{
+	// The threads get their own copies of the strings
+	pgAsyncRequest *request = new pgAsyncRequest;
+	request->sql = wxString(sql.c_str());
+	for (size_t i = 0; i < params.GetCount(); i++)
+		request->params.Add(wxString(params[i].c_str()));
+	request->handler = handler;
+	request->id = id;
+	request->data = data;
+	request->site = wxString(pgQueryProfiler::GetSite().c_str());
+	request->cancelled = false;
+
+	{
+		wxMutexLocker lock(s_poolsMutex);
+		request->number = ++s_requestSerial;
+	}
+
+	long number = request->number;
+
+	wxMutexLocker lock(mutex);
+
+	if (stopping)
+	{
+		delete request;
+		return 0;
+	}
+
+	requests.Add(request);
+
+	// One more thread while they're all busy
+	if ((size_t)waitingWorkers < requests.GetCount() && workers.GetCount() < (size_t)maxSize)
+	{
+		pgConnWorker *worker = new pgConnWorker(this);
+		if (worker->Create() != wxTHREAD_NO_ERROR || worker->Run() != wxTHREAD_NO_ERROR)
+			delete worker;
+		else
+			workers.Add(worker);
+	}
+
+	if (workers.IsEmpty())
+	{
+		wxLogError(_("Failed to start the background query thread."));
+		requests.Remove(request);
+		delete request;
+		return 0;
+	}
+
+	queued.Signal();
+	return number;
+}
+
+
+void pgConnPool::Cancel(long request)
+{
+	wxMutexLocker lock(s_poolsMutex);
+
+	for (size_t i = 0; i < s_pools.GetCount(); i++)
+	{
+		if (((pgConnPool *)s_pools[i])->CancelRequest(request))
+			break;
+	}
+}
+
+
+void pgConnPool::Cancel(wxEvtHandler *handler)
+{
+	wxMutexLocker lock(s_poolsMutex);
+
+	for (size_t i = 0; i < s_pools.GetCount(); i++)
+		((pgConnPool *)s_pools[i])->CancelRequests(handler);
+}
+
+
+bool pgConnPool::CancelRequest(long request)
+{
+	wxMutexLocker lock(mutex);
+	size_t i;
+
+	for (i = 0; i < requests.GetCount(); i++)
+	{
+		if (requests[i]->number == request)
+		{
+			delete requests[i];
+			requests.RemoveAt(i);
+			return true;
+		}
+	}
+
+	for (i = 0; i < workers.GetCount(); i++)
+	{
+		pgConnWorker *worker = (pgConnWorker *)workers[i];
+		if (worker->current && worker->current->number == request)
+		{
+			worker->current->cancelled = true;
+			if (worker->session)
+				worker->session->CancelExecution();
+			return true;
+		}
+	}
+
+	return false;
+}
+
+
+void pgConnPool::CancelRequests(wxEvtHandler *handler)
+{
+	wxMutexLocker lock(mutex);
+	size_t i = 0;
+
+	while (i < requests.GetCount())
+	{
+		if (requests[i]->handler == handler)
+		{
+			delete requests[i];
+			requests.RemoveAt(i);
+		}
+		else
+			i++;
+	}
+
+	for (i = 0; i < workers.GetCount(); i++)
+	{
+		pgConnWorker *worker = (pgConnWorker *)workers[i];
+		if (worker->current && worker->current->handler == handler)
+		{
+			worker->current->cancelled = true;
+			if (worker->session)
+				worker->session->CancelExecution();
+		}
+	}
+}
+
+
+//////////////////////////////////////////////////////////////////////////
+
+pgConnWorker::pgConnWorker(pgConnPool *_pool)
+	: wxThread(wxTHREAD_JOINABLE), pool(_pool), current(0), session(0)
+{
+}
+
+
+void *pgConnWorker::Entry()
+{
+	while (true)
+	{
+		pool->mutex.Lock();
+
+		pool->waitingWorkers++;
+		while (!pool->stopping && pool->requests.IsEmpty())
+		{
+			// Nothing to do, so close what has been idle for too long
+			if (pool->queued.WaitTimeout(MAINTENANCE_INTERVAL) == wxCOND_TIMEOUT)
+				pool->Evict();
+		}
+		pool->waitingWorkers--;
+
+		if (pool->stopping)
+		{
+			pool->mutex.Unlock();
+			break;
+		}
+
+		current = pool->requests[0];
+		pool->requests.RemoveAt(0);
+
+		pool->mutex.Unlock();
+
+		pgConn *conn = pool->Borrow(BORROW_TIMEOUT);
+		if (!conn)
+		{
+			Post(0, _("No connection to the server is available for background queries."));
+			continue;
+		}
+
+		Execute(conn);
+		pool->Return(conn);
+	}
+
+	return 0;
+}
+
+
+void pgConnWorker::Execute(pgConn *conn)
+{
+	{
+		wxMutexLocker lock(pool->mutex);
+
+		if (current->cancelled)
+		{
+			delete current;
+			current = 0;
+			return;
+		}
+		session = conn;
+	}
+
+	wxLogSql(wxT("Background query (%s:%d): %s"), conn->GetHost().c_str(), conn->GetPort(), current->sql.c_str());
+
+	// Attribute the query to whoever queued it
+	pgProfilerSite site(current->site);
+
+	PGresult *qryRes;
+	if (current->params.IsEmpty())
+	{
+		double start = pgQueryProfiler::Now();
+		conn->SetConnCancel();
+		qryRes = PQexec(conn->conn, current->sql.mb_str(*conn->conv));
+		conn->ResetConnCancel();
+		pgQueryProfiler::Record(current->sql, start, qryRes);
+	}
+	else
+		qryRes = conn->ExecutePrepared(current->sql, current->params);
+
+	{
+		wxMutexLocker lock(pool->mutex);
+		session = 0;
+	}
+
+	int status = PQresultStatus(qryRes);
+	if (status == PGRES_TUPLES_OK || status == PGRES_COMMAND_OK)
+	{
+		// The set belongs to the connection the query was queued on, but
+		// that one is the GUI's: the DateStyle is read from this one
+		pgConn *master = pool->master;
+		Post(new pgSet(qryRes, master, *master->conv, master->needColQuoting, conn), wxEmptyString);
+	}
+	else
+	{
+		wxString error;
+		if (qryRes)
+			error = wxString(PQresultErrorMessage(qryRes), *conn->conv);
+		else
+			error = conn->GetLastError();
+
+		PQclear(qryRes);
+		Post(0, error);
+	}
+}
+
+
+// Hand the result over, unless nobody is waiting for it any more
+void pgConnWorker::Post(pgSet *set, const wxString &error)
+{
+	wxMutexLocker lock(pool->mutex);
+
+	if (current->cancelled || pool->stopping)
+	{
+		wxLogSql(wxT("Background query cancelled"));
+		if (set)
+			delete set;
+	}
+	else
+	{
+		pgConnResultEvent ev(current->id, current->number, set, error);
+		ev.SetClientData(current->data);
+		current->handler->AddPendingEvent(ev);
+	}
+
+	delete current;
+	current = 0;
+}
@@ -0,0 +1,298 @@
+//////////////////////////////////////////////////////////////////////////
+//
+// pgAdmin III - PostgreSQL Tools
+//
+// Copyright (C) 2002 - 2016, The pgAdmin Development Team
+// This software is released under the PostgreSQL Licence
+//
+// pgQueryProfiler.cpp - Records the queries pgAdmin runs
+//
+//////////////////////////////////////////////////////////////////////////
+
+#include "pgAdmin3.h"
+
+// wxWindows headers
+#include <wx/wx.h>
+#include <wx/arrimpl.cpp>
+
+#ifdef __WXMSW__
+#include <wx/msw/wrapwin.h>
+#define PROFILER_THREAD_LOCAL __declspec(thread)
+#else
+#include <sys/time.h>
+#define PROFILER_THREAD_LOCAL __thread
+#endif
+
+// App headers
+#include "db/pgQueryProfiler.h"
+
+WX_DEFINE_OBJARRAY(pgProfiledQueryArray);
+
+// The number of queries kept; a power of two
+#define PROFILER_SLOTS      4096
+
+// The leading part of the query text kept
+#define PROFILER_SQL_LEN    256
+
+// The rows measured to estimate the size of a result
+#define PROFILER_SAMPLE_ROWS 256
+
+
+// A slot of the ring buffer. The writer takes its slot by incrementing the
+// number of queries recorded, and marks it as complete by setting the
+// sequence number last. Readers only trust copies during which the sequence
+// number didn't change.
+typedef struct pgProfilerSlot
+{
+	volatile long seq;
+	double msec;
+	long rows;
+	long bytes;
+	char sql[PROFILER_SQL_LEN];
+	char site[64];
+} pgProfilerSlot;
+
+static pgProfilerSlot s_slots[PROFILER_SLOTS];
+static volatile long s_recorded = 0;
+static volatile long s_cleared = 0;
+
+static PROFILER_THREAD_LOCAL pgProfilerSite *s_site = 0;
+
+
+static long AtomicIncrement(volatile long *value)
+{
+#ifdef __WXMSW__
+	return InterlockedIncrement(value);
+#else
+	return __sync_add_and_fetch(value, 1);
+#endif
+}
+
+
+static void Barrier()
+{
+#ifdef __WXMSW__
+	MemoryBarrier();
+#else
+	__sync_synchronize();
+#endif
+}
+
+
+// Copy as much of the UTF-8 text as fits, without splitting a character
+static void CopyText(char *dest, size_t size, const char *text)
+{
+	size_t len = text ? strlen(text) : 0;
+
+	if (len >= size)
+	{
+		len = size - 1;
+		while (len > 0 && (text[len] & 0xC0) == 0x80)
+			len--;
+	}
+
+	memcpy(dest, text, len);
+	dest[len] = 0;
+}
+
+
+double pgQueryProfiler::Now()
+{
+#ifdef __WXMSW__
+	static LARGE_INTEGER frequency = { 0 };
+	LARGE_INTEGER counter;
+
+	if (!frequency.QuadPart)
+		QueryPerformanceFrequency(&frequency);
+	QueryPerformanceCounter(&counter);
+
+	return counter.QuadPart * 1000.0 / frequency.QuadPart;
+#else
+	struct timeval tv;
+	gettimeofday(&tv, NULL);
+
+	return tv.tv_sec * 1000.0 + tv.tv_usec / 1000.0;
+#endif
+}
+
+
+void pgQueryProfiler::Record(const wxString &sql, double start, PGresult *res)
+{
+	long rows = 0, bytes = 0;
+
+	// Measuring every value would cost as much as reading the result, so
+	// the size of a large one is extrapolated from a sample of its rows
+	if (res && PQresultStatus(res) == PGRES_TUPLES_OK)
+	{
+		int nRows = PQntuples(res), nCols = PQnfields(res);
+		int step = nRows > PROFILER_SAMPLE_ROWS ? nRows / PROFILER_SAMPLE_ROWS : 1;
+		int sampled = 0;
+		double sample = 0;
+
+		rows = nRows;
+		for (int row = 0; row < nRows; row += step)
+		{
+			for (int col = 0; col < nCols; col++)
+				sample += PQgetlength(res, row, col);
+			sampled++;
+		}
+		if (sampled)
+			bytes = (long)(sample * nRows / sampled);
+	}
+
+	Record(sql, start, rows, bytes);
+}
+
+
+void pgQueryProfiler::Record(const wxString &sql, double start, long rows, long bytes)
+{
+	double msec = Now() - start;
+
+	long number = AtomicIncrement(&s_recorded);
+	pgProfilerSlot &slot = s_slots[(number - 1) & (PROFILER_SLOTS - 1)];
+
+	slot.seq = 0;
+	Barrier();
+
+	slot.msec = msec;
+	slot.rows = rows;
+	slot.bytes = bytes;
+	CopyText(slot.sql, sizeof(slot.sql), sql.Left(PROFILER_SQL_LEN).mb_str(wxConvUTF8));
+	CopyText(slot.site, sizeof(slot.site), s_site ? s_site->GetName() : "");
+
+	Barrier();
+	slot.seq = number;
+}
+
+
+void pgQueryProfiler::GetQueries(pgProfiledQueryArray &queries)
+{
+	long recorded = s_recorded;
+	long first = recorded - PROFILER_SLOTS + 1;
+
+	if (first <= s_cleared)
+		first = s_cleared + 1;
+
+	for (long number = first; number <= recorded; number++)
+	{
+		pgProfilerSlot &slot = s_slots[(number - 1) & (PROFILER_SLOTS - 1)];
+		pgProfilerSlot copy;
+
+		if (slot.seq != number)
+			continue;
+
+		memcpy(&copy, &slot, sizeof(copy));
+		Barrier();
+
+		if (slot.seq != number)
+			continue;
+
+		pgProfiledQuery query;
+		query.sql = wxString(copy.sql, wxConvUTF8);
+		query.site = wxString(copy.site, wxConvUTF8);
+		query.msec = copy.msec;
+		query.rows = copy.rows;
+		query.bytes = copy.bytes;
+		queries.Add(query);
+	}
+}
+
+
+void pgQueryProfiler::Clear()
+{
+	s_cleared = s_recorded;
+}
+
+
+wxString pgQueryProfiler::GetSite()
+{
+	if (s_site)
+		return wxString(s_site->GetName(), wxConvUTF8);
+
+	return wxEmptyString;
+}
+
+
+wxString pgQueryProfiler::GetShape(const wxString &sql)
+{
+	wxString shape;
+	size_t len = sql.Length(), i = 0;
+	bool space = false;
+
+	while (i < len)
+	{
+		wxChar c = sql[i];
+
+		if (wxIsspace(c))
+		{
+			space = true;
+			i++;
+			continue;
+		}
+
+		if (space && !shape.IsEmpty())
+			shape += wxT(" ");
+		space = false;
+
+		if (c == '\'')
+		{
+			// A string literal, with quotes doubled inside
+			for (i++; i < len; i++)
+			{
+				if (sql[i] == '\'')
+				{
+					if (i + 1 < len && sql[i + 1] == '\'')
+						i++;
+					else
+						break;
+				}
+			}
+			i++;
+			shape += wxT("?");
+		}
+		else if (c == '"')
+		{
+			// A quoted identifier is part of the shape
+			size_t start = i;
+			for (i++; i < len && sql[i] != '"'; i++)
+				;
+			i++;
+			shape += sql.Mid(start, i - start);
+		}
+		else if (wxIsalpha(c) || c == '_' || c == '$')
+		{
+			size_t start = i;
+			while (i < len && (wxIsalnum(sql[i]) || sql[i] == '_' || sql[i] == '$'))
+				i++;
+			shape += sql.Mid(start, i - start);
+		}
+		else if (wxIsdigit(c))
+		{
+			while (i < len && (wxIsalnum(sql[i]) || sql[i] == '.'))
+				i++;
+			shape += wxT("?");
+		}
+		else
+		{
+			shape += c;
+			i++;
+		}
+	}
+
+	return shape;
+}
+
+
+pgProfilerSite::pgProfilerSite(const wxString &site)
+{
+	CopyText(name, sizeof(name), site.mb_str(wxConvUTF8));
+
+	previous = s_site;
+	s_site = this;
+}
+
+
+pgProfilerSite::~pgProfilerSite()
+{
+	s_site = previous;
+}
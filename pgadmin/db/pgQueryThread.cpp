@@ -17,15 +17,27 @@
 // PostgreSQL headers
 #include <libpq-fe.h>
 
+// Socket waiting
+#ifdef __WXMSW__
+#include <winsock.h>
+#else
+#include <poll.h>
+#include <unistd.h>
+#include <fcntl.h>
+#endif
+
 // App headers
 #include "db/pgSet.h"
 #include "db/pgConn.h"
 #include "db/pgQueryThread.h"
+#include "utils/dataFile.h"
 #include "db/pgQueryResultEvent.h"
+#include "db/pgQueryProfiler.h"
 #include "utils/pgDefs.h"
 #include "utils/sysLogger.h"
 
 const wxEventType PGQueryResultEvent = wxNewEventType();
+const wxEventType PGQueryRowsEvent = wxNewEventType();
 
 // default notice processor for the pgQueryThread
 // we do assume that the argument passed will be always the
@@ -48,8 +60,13 @@ pgQueryThread::pgQueryThread(pgConn *_conn, wxEvtHandler *_caller,
 	wxThread(wxTHREAD_JOINABLE), m_currIndex(-1), m_conn(_conn),
 	m_cancelled(false), m_multiQueries(true), m_useCallable(false),
 	m_caller(_caller), m_processor(pgNoticeProcessor), m_noticeHandler(NULL),
-	m_eventOnCancellation(true)
+	m_eventOnCancellation(true), m_pipelining(false), m_binaryResults(false), m_queryStart(0),
+	m_streamChunkRows(0), m_streamMaxMemory(0), m_streamSpillThreshold(0), m_streamChunk(NULL),
+	m_streamBytes(0), m_streamLimit(0), m_streamSuspended(false), m_streamRows(0), m_streamDataBytes(0),
+	m_streamCond(m_streamMutex), m_copyOutFile(NULL), m_copyOutCRLF(false), m_copyOutHeader(false), m_copyOutRows(0)
 {
+	InitWakeUp();
+
 	// check if we can really use the enterprisedb callable statement and
 	// required
 #ifdef __WXMSW__
@@ -98,8 +115,13 @@ pgQueryThread::pgQueryThread(pgConn *_conn, const wxString &_qry,
 	: wxThread(wxTHREAD_JOINABLE), m_currIndex(-1), m_conn(_conn),
 	  m_cancelled(false), m_multiQueries(false), m_useCallable(false),
 	  m_caller(NULL), m_processor(pgNoticeProcessor), m_noticeHandler(NULL),
-	  m_eventOnCancellation(true)
+	  m_eventOnCancellation(true), m_pipelining(false), m_binaryResults(false), m_queryStart(0),
+	  m_streamChunkRows(0), m_streamMaxMemory(0), m_streamSpillThreshold(0), m_streamChunk(NULL),
+	  m_streamBytes(0), m_streamLimit(0), m_streamSuspended(false), m_streamRows(0), m_streamDataBytes(0),
+	  m_streamCond(m_streamMutex), m_copyOutFile(NULL), m_copyOutCRLF(false), m_copyOutHeader(false), m_copyOutRows(0)
 {
+	InitWakeUp();
+
 	if (m_conn && m_conn->conn)
 	{
 		PQsetnonblocking(m_conn->conn, 1);
@@ -122,6 +144,141 @@ void pgQueryThread::SetEventOnCancellation(bool eventOnCancelled)
 	m_eventOnCancellation = eventOnCancelled;
 }
 
+void pgQueryThread::SetStreaming(long chunkRows, size_t maxMemory)
+{
+	m_streamChunkRows = chunkRows;
+	m_streamMaxMemory = maxMemory;
+}
+
+
+void pgQueryThread::SetSpillThreshold(size_t bytes, const wxString &dir)
+{
+	m_streamSpillThreshold = bytes;
+	m_streamSpillDir = dir;
+}
+
+
+void pgQueryThread::SetCopyOutFile(dataFileWriter *file, bool crlf, bool header)
+{
+	m_copyOutFile = file;
+	m_copyOutCRLF = crlf;
+	m_copyOutHeader = header;
+	m_copyOutRows = 0;
+}
+
+
+void pgQueryThread::FetchMore()
+{
+	wxMutexLocker lock(m_streamMutex);
+
+	m_streamLimit += m_streamMaxMemory;
+	m_streamCond.Signal();
+}
+
+
+void pgQueryThread::CancelExecution()
+{
+	m_cancelled = true;
+
+	// Wake up the thread, whatever it's waiting for
+	WakeUp();
+	m_queueSem.Post();
+
+	wxMutexLocker lock(m_streamMutex);
+	m_streamCond.Signal();
+}
+
+
+void pgQueryThread::InitWakeUp()
+{
+#ifdef __WXMSW__
+	m_wakeUpPipe[0] = m_wakeUpPipe[1] = -1;
+#else
+	if (pipe(m_wakeUpPipe) == 0)
+	{
+		fcntl(m_wakeUpPipe[0], F_SETFL, O_NONBLOCK);
+		fcntl(m_wakeUpPipe[1], F_SETFL, O_NONBLOCK);
+	}
+	else
+	{
+		wxLogError(_("Could not create the wakeup pipe of the query thread."));
+		m_wakeUpPipe[0] = m_wakeUpPipe[1] = -1;
+	}
+#endif
+}
+
+
+// Interrupt WaitForSocket()
+void pgQueryThread::WakeUp()
+{
+#ifndef __WXMSW__
+	if (m_wakeUpPipe[1] >= 0)
+	{
+		char c = 0;
+		if (write(m_wakeUpPipe[1], &c, 1) < 0)
+		{
+			// The pipe is full, so the thread will wake up anyway
+		}
+	}
+#endif
+}
+
+
+// Wait until libpq can read from the connection (or write to it, if it has
+// pending output), or until we've been woken up by CancelExecution().
+void pgQueryThread::WaitForSocket()
+{
+	int sock = PQsocket(m_conn->conn);
+
+	if (sock < 0)
+		return;
+
+	// Nonblocking connections might not have sent the whole query yet
+	bool wantWrite = (PQflush(m_conn->conn) == 1);
+
+#ifdef __WXMSW__
+	// We can't wait for the socket and a pipe at once here, so wake up
+	// periodically to notice the cancellation.
+	fd_set readFds, writeFds;
+	struct timeval timeout;
+
+	FD_ZERO(&readFds);
+	FD_ZERO(&writeFds);
+	FD_SET(sock, &readFds);
+	if (wantWrite)
+		FD_SET(sock, &writeFds);
+
+	timeout.tv_sec = 0;
+	timeout.tv_usec = 100000;
+
+	select(sock + 1, &readFds, &writeFds, NULL, &timeout);
+#else
+	struct pollfd fds[2];
+	int nfds = 1;
+
+	fds[0].fd = sock;
+	fds[0].events = POLLIN | (wantWrite ? POLLOUT : 0);
+	fds[0].revents = 0;
+
+	if (m_wakeUpPipe[0] >= 0)
+	{
+		fds[1].fd = m_wakeUpPipe[0];
+		fds[1].events = POLLIN;
+		fds[1].revents = 0;
+		nfds = 2;
+	}
+
+	// Without the pipe, fall back to a short timeout to notice cancellation
+	if (poll(fds, nfds, nfds == 2 ? -1 : 10) > 0 && nfds == 2 && (fds[1].revents & POLLIN))
+	{
+		char buf[16];
+		while (read(m_wakeUpPipe[0], buf, sizeof(buf)) > 0)
+			;
+	}
+#endif
+}
+
+
 void pgQueryThread::AddQuery(const wxString &_qry, pgParamsArray *_params,
                              long _eventId, void *_data, bool _useCallable, int _resultToRetrieve)
 {
@@ -131,6 +288,8 @@ void pgQueryThread::AddQuery(const wxString &_qry, pgParamsArray *_params,
 	                     m_useCallable && _useCallable, _resultToRetrieve));
 
 	wxLogInfo(wxT("queueing (%ld): %s"), GetId(), _qry.c_str());
+
+	m_queueSem.Post();
 }
 
 
@@ -138,6 +297,14 @@ pgQueryThread::~pgQueryThread()
 {
 	m_conn->RegisterNoticeProcessor(0, 0);
 	WX_CLEAR_ARRAY(m_queries);
+
+#ifndef __WXMSW__
+	if (m_wakeUpPipe[0] >= 0)
+	{
+		close(m_wakeUpPipe[0]);
+		close(m_wakeUpPipe[1]);
+	}
+#endif
 }
 
 
@@ -184,7 +351,6 @@ int pgQueryThread::Execute()
 
 	wxString       &query            = m_queries[m_currIndex]->m_query;
 	int            &resultToRetrieve = m_queries[m_currIndex]->m_resToRetrieve;
-	long           &rowsInserted     = m_queries[m_currIndex]->m_rowsInserted;
 	Oid            &insertedOid      = m_queries[m_currIndex]->m_insertedOid;
 	// using the alias for the pointer here, in order to save the result back
 	// in the pgBatchQuery object
@@ -195,6 +361,7 @@ int pgQueryThread::Execute()
 	pgError        &err              = m_queries[m_currIndex]->m_err;
 
 	wxCharBuffer queryBuf = query.mb_str(conv);
+	m_queryStart = pgQueryProfiler::Now();
 
 	if (PQstatus(m_conn->conn) != CONNECTION_OK)
 	{
@@ -213,6 +380,14 @@ int pgQueryThread::Execute()
 		return(RaiseEvent(rc));
 	}
 
+	// Ask for the result in binary format, if we can render it. Once the
+	// unnamed statement is prepared for that, it's executed as it is rather
+	// than parsed a second time, in whichever format.
+	int resultFormat = -1;
+
+	if (m_binaryResults && !useCallable)
+		resultFormat = DescribeResultFormat(queryBuf, params);
+
 	// Honour the parameters (if any)
 	if (params && params->GetCount() > 0)
 	{
@@ -290,8 +465,10 @@ int pgQueryThread::Execute()
 		}
 		else
 		{
-			// assumptions: we will need the results in text format only
-			ret = PQsendQueryParams(m_conn->conn, queryBuf, pCount, pOids, pParams, pLens, pFormats, 0);
+			if (resultFormat >= 0)
+				ret = PQsendQueryPrepared(m_conn->conn, "", pCount, pParams, pLens, pFormats, resultFormat);
+			else
+				ret = PQsendQueryParams(m_conn->conn, queryBuf, pCount, pOids, pParams, pLens, pFormats, 0);
 
 			if (ret != 1)
 			{
@@ -324,7 +501,14 @@ return_with_error:
 	{
 		// use the PQsendQuery api in case, we don't have any parameters to
 		// pass to the server
-		if (!PQsendQuery(m_conn->conn, queryBuf))
+		int ret;
+
+		if (resultFormat >= 0)
+			ret = PQsendQueryPrepared(m_conn->conn, "", 0, NULL, NULL, NULL, resultFormat);
+		else
+			ret = PQsendQuery(m_conn->conn, queryBuf);
+
+		if (!ret)
 		{
 			rc = pgQueryResultEvent::PGQ_ERROR_SEND_QUERY;
 
@@ -340,6 +524,20 @@ continue_without_error:
 	PGresult *lastResult = 0;
 	bool connExecutionCancelled = false;
 
+	// In streaming mode, the rows of the first result returning any are
+	// retrieved one by one, and the result is done at its final PGresult
+	bool streaming = false, streamStarted = false, streamDone = false;
+
+	m_streamBytes = 0;
+	m_streamLimit = m_streamMaxMemory;
+	m_streamRows = 0;
+	m_streamDataBytes = 0;
+
+#ifdef HAVE_SINGLE_ROW_MODE
+	if (m_streamChunkRows > 0 && !useCallable)
+		streaming = (PQsetSingleRowMode(m_conn->conn) == 1);
+#endif
+
 	while (true)
 	{
 		// This is a 'joinable' thread, it is not advisable to call 'delete'
@@ -416,8 +614,7 @@ continue_without_error:
 
 		if (PQisBusy(m_conn->conn))
 		{
-			Yield();
-			this->Sleep(10);
+			WaitForSocket();
 
 			continue;
 		}
@@ -430,10 +627,45 @@ continue_without_error:
 		if (!res)
 			break;
 
+#ifdef HAVE_SINGLE_ROW_MODE
+		if (PQresultStatus(res) == PGRES_SINGLE_TUPLE)
+		{
+			// Rows of any later result, or arriving after the cancellation,
+			// are not wanted
+			if (m_cancelled || streamDone)
+				PQclear(res);
+			else
+			{
+				streamStarted = true;
+				StreamRow(res);
+			}
+			continue;
+		}
+#endif
+
+		if (streaming && streamStarted && !streamDone)
+		{
+			// The streamed result is complete, hand over the remaining rows
+			FlushStreamChunk();
+			streamDone = true;
+
+			if (PQresultStatus(res) == PGRES_TUPLES_OK)
+			{
+				resultsRetrieved++;
+				result = res;
+				AppendMessage(wxString::Format(wxPLURAL("query result with %d row will be returned.\n", "query result with %d rows will be returned.\n",
+				                                        (int)dataSet->NumRows()), (int)dataSet->NumRows()));
+				continue;
+			}
+		}
+
 		if((PQresultStatus(res) == PGRES_NONFATAL_ERROR) ||
 		        (PQresultStatus(res) == PGRES_FATAL_ERROR) ||
 		        (PQresultStatus(res) == PGRES_BAD_RESPONSE))
 		{
+			// Any result retrieved before is superseded by the error
+			if (result)
+				PQclear(result);
 			result = res;
 			err.SetError(res, &conv);
 
@@ -473,10 +705,7 @@ continue_without_error:
 				res = NULL;
 
 				if (PQisBusy(m_conn->conn))
-				{
-					Yield();
-					this->Sleep(10);
-				}
+					WaitForSocket();
 			}
 			while (true);
 
@@ -507,12 +736,14 @@ continue_without_error:
 
 			rc = PGRES_COPY_OUT;
 
-			AppendMessage(_("query returned copy data:\n"));
+			if (!m_copyOutFile)
+				AppendMessage(_("query returned copy data:\n"));
 
 			while((copyRc = PQgetCopyData(m_conn->conn, &buf, 1)) >= 0)
 			{
 				// Ignore processing the query result, when it has already been
-				// cancelled by the user
+				// cancelled by the user, but keep reading until the server
+				// answers the cancel
 				if (m_cancelled)
 				{
 					if (!connExecutionCancelled)
@@ -520,10 +751,41 @@ continue_without_error:
 						m_conn->CancelExecution();
 						connExecutionCancelled = true;
 					}
-					continue;
+					if (buf != NULL)
+					{
+						PQfreemem(buf);
+						buf = NULL;
+					}
 				}
 
-				if (buf != NULL)
+				if (buf != NULL && m_copyOutFile)
+				{
+					// Each piece of data is a row, ending in a newline
+					if (m_copyOutCRLF && copyRc > 0 && buf[copyRc - 1] == '\n')
+					{
+						m_copyOutFile->Write(buf, copyRc - 1);
+						m_copyOutFile->Write("\r\n", 2);
+					}
+					else
+						m_copyOutFile->Write(buf, copyRc);
+					PQfreemem(buf);
+
+					if (!m_copyOutFile->IsOk())
+					{
+						// There's no point in the server sending more
+						if (!connExecutionCancelled)
+						{
+							AppendMessage(_("Failed to write the file, the query was cancelled.\n"));
+							m_conn->CancelExecution();
+							connExecutionCancelled = true;
+						}
+					}
+					else if (m_copyOutHeader)
+						m_copyOutHeader = false;
+					else
+						m_copyOutRows++;
+				}
+				else if (buf != NULL)
 				{
 					if (copyRows < 100)
 					{
@@ -541,10 +803,7 @@ continue_without_error:
 					copyRows++;
 
 				if (lastCopyRc == 0 && copyRc == 0)
-				{
-					Yield();
-					this->Sleep(10);
-				}
+					WaitForSocket();
 				if (copyRc == 0)
 				{
 					if (!PQconsumeInput(m_conn->conn))
@@ -588,13 +847,17 @@ continue_without_error:
 
 			if (!res)
 				break;
+
+			if (m_copyOutFile && PQresultStatus(res) == PGRES_COMMAND_OK)
+				AppendMessage(wxString::Format(wxPLURAL("query wrote %ld row to the file.\n", "query wrote %ld rows to the file.\n",
+				                                        m_copyOutRows), m_copyOutRows));
 		}
 
 		resultsRetrieved++;
 
 		// Save the current result, as asked by the component
 		// But - only if the execution is not cancelled
-		if (!m_cancelled && resultsRetrieved == resultToRetrieve)
+		if (!m_cancelled && !streaming && resultsRetrieved == resultToRetrieve)
 		{
 			result = res;
 			insertedOid = PQoidValue(res);
@@ -636,6 +899,122 @@ out_of_consume_input_loop:
 
 	if (!result)
 		result = lastResult;
+	else if (lastResult)
+		PQclear(lastResult);
+
+	return StoreResult(result, streamStarted);
+}
+
+
+// Prepare the query as the unnamed statement, and find out whether all the
+// columns it returns can be transferred in binary format: returns the result
+// format to execute the statement with, or -1 if it wasn't prepared and the
+// query has to be sent as it is. Several statements at once simply fail to
+// prepare, but as that would abort a transaction block, it's only tried
+// outside of one.
+int pgQueryThread::DescribeResultFormat(const char *query, pgParamsArray *params)
+{
+	PGconn *conn = m_conn->conn;
+
+	if (PQtransactionStatus(conn) != PQTRANS_IDLE)
+		return -1;
+
+	const char *dateStyle = PQparameterStatus(conn, "DateStyle");
+	const char *intDateTimes = PQparameterStatus(conn, "integer_datetimes");
+	bool isoDateTimes = (dateStyle && !strncmp(dateStyle, "ISO", 3) &&
+	                     intDateTimes && !strcmp(intDateTimes, "on"));
+
+	int  pCount = (params ? params->GetCount() : 0);
+	Oid *pOids  = NULL;
+
+	if (pCount > 0)
+	{
+		pOids = (Oid *)malloc(pCount * sizeof(Oid));
+		for (int idx = 0; idx < pCount; idx++)
+			pOids[idx] = (*params)[idx]->m_type;
+	}
+
+	int ret = PQsendPrepare(conn, "", query, pCount, pOids);
+	free(pOids);
+
+	if (ret != 1)
+		return -1;
+
+	PGresult *res = WaitForResult();
+	bool prepared = (res && PQresultStatus(res) == PGRES_COMMAND_OK);
+	PQclear(res);
+
+	if (!prepared)
+		return -1;
+
+	// The statement stays prepared, and is executed in text format if
+	// the description can't be had
+	if (PQsendDescribePrepared(conn, "") != 1)
+		return 0;
+
+	res = WaitForResult();
+
+	int format = (res && PQresultStatus(res) == PGRES_COMMAND_OK && PQnfields(res) > 0) ? 1 : 0;
+
+	for (int col = 0; format && col < PQnfields(res); col++)
+	{
+		if (!pgSet::CanDecodeBinary(PQftype(res, col), isoDateTimes))
+			format = 0;
+	}
+	PQclear(res);
+
+	return format;
+}
+
+
+// Wait for all the results of the command sent, and return the last one
+PGresult *pgQueryThread::WaitForResult()
+{
+	PGresult *result = NULL, *res;
+
+	while (true)
+	{
+		if (PQconsumeInput(m_conn->conn) != 1)
+			break;
+
+		if (PQisBusy(m_conn->conn))
+		{
+			WaitForSocket();
+			continue;
+		}
+
+		if ((res = PQgetResult(m_conn->conn)) == NULL)
+			return result;
+
+		if (result)
+			PQclear(result);
+		result = res;
+	}
+
+	if (result)
+		PQclear(result);
+	return NULL;
+}
+
+
+// Save the final result of the current query in its pgBatchQuery object,
+// and raise the event for it. A streamed result has its rows in the data set
+// already.
+int pgQueryThread::StoreResult(PGresult *result, bool streamed)
+{
+	wxMBConv       &conv             = *(m_conn->conv);
+	long           &rowsInserted     = m_queries[m_currIndex]->m_rowsInserted;
+	Oid            &insertedOid      = m_queries[m_currIndex]->m_insertedOid;
+	pgSet         *&dataSet          = m_queries[m_currIndex]->m_resultSet;
+	int            &rc               = m_queries[m_currIndex]->m_returnCode;
+	pgError        &err              = m_queries[m_currIndex]->m_err;
+
+	// The final result of a streamed query holds no rows, they were counted
+	// as they arrived
+	if (streamed)
+		pgQueryProfiler::Record(m_queries[m_currIndex]->m_query, m_queryStart, m_streamRows, m_streamDataBytes);
+	else
+		pgQueryProfiler::Record(m_queries[m_currIndex]->m_query, m_queryStart, result);
 
 	err.SetError(result, &conv);
 
@@ -644,8 +1023,11 @@ out_of_consume_input_loop:
 	rc = PQresultStatus(result);
 	if (rc == PGRES_TUPLES_OK)
 	{
-		dataSet = new pgSet(result, m_conn, conv, m_conn->needColQuoting);
-		dataSet->MoveFirst();
+		if (!streamed)
+		{
+			dataSet = new pgSet(result, m_conn, conv, m_conn->needColQuoting);
+			dataSet->MoveFirst();
+		}
 	}
 	else if (rc == PGRES_COMMAND_OK)
 	{
@@ -675,9 +1057,316 @@ out_of_consume_input_loop:
 	if (insertedOid == (Oid) - 1)
 		insertedOid = 0;
 
+	if (rc == PGRES_TUPLES_OK && streamed)
+		PQclear(result);
+
 	return(RaiseEvent(1));
 }
 
+
+// Send all the queued queries at once, and read their results back in order
+// afterwards, instead of waiting for each query to complete before sending
+// the next one. Every query is followed by its own sync point, so an error
+// only fails the query causing it, as it would when run on its own. For
+// the same reason, cancelling only stops the query running at the time;
+// those sent after it still run, and their results are reported.
+//
+// Only a run of two or more queries without callable statements is sent
+// this way. Returns the number of queries executed, or 0 if the queries
+// have to be executed one by one (pipelining is not enabled or supported).
+int pgQueryThread::ExecutePipeline()
+{
+#ifdef LIBPQ_HAS_PIPELINING
+	if (!m_pipelining || m_streamChunkRows > 0 || m_cancelled)
+		return 0;
+
+	int first = m_currIndex + 1,
+	    last  = first;
+
+	while (last < (int)m_queries.GetCount() && !m_queries[last]->m_useCallable)
+		last++;
+
+	if (last - first < 2)
+		return 0;
+
+	wxMutexLocker lock(m_queriesLock);
+
+	PGconn         *conn             = m_conn->conn;
+	wxMBConv       &conv             = *(m_conn->conv);
+
+	// The pipeline needs the extended query protocol
+	if (PQstatus(conn) != CONNECTION_OK || PQprotocolVersion(conn) < 3 ||
+	        PQenterPipelineMode(conn) != 1)
+		return 0;
+
+	int sent = first;
+
+	// Every query of the pipeline is timed from the start
+	m_queryStart = pgQueryProfiler::Now();
+
+	for (; sent < last; sent++)
+	{
+		pgBatchQuery  *qry      = m_queries[sent];
+		wxCharBuffer   queryBuf = qry->m_query.mb_str(conv);
+
+		// Leave the reporting of the error to Execute()
+		if (!queryBuf)
+			break;
+
+		int          pCount   = qry->m_params ? qry->m_params->GetCount() : 0;
+		Oid         *pOids    = NULL;
+		const char **pParams  = NULL;
+		int         *pLens    = NULL;
+		int         *pFormats = NULL;
+
+		if (pCount > 0)
+		{
+			pOids    = (Oid *)malloc(pCount * sizeof(Oid));
+			pParams  = (const char **)malloc(pCount * sizeof(const char *));
+			pLens    = (int *)malloc(pCount * sizeof(int));
+			pFormats = (int *)malloc(pCount * sizeof(int));
+
+			for (int idx = 0; idx < pCount; idx++)
+			{
+				pgParam *param = (*qry->m_params)[idx];
+
+				pOids[idx] = param->m_type;
+				pParams[idx] = (const char *)param->m_val;
+				pLens[idx] = param->m_len;
+				pFormats[idx] = param->GetFormat();
+			}
+		}
+
+		int ret = PQsendQueryParams(conn, queryBuf, pCount, pOids, pParams, pLens, pFormats, 0);
+
+		free(pOids);
+		free(pParams);
+		free(pLens);
+		free(pFormats);
+
+		if (ret != 1 || PQpipelineSync(conn) != 1)
+			break;
+
+		qry->m_returnCode = -2;
+		qry->m_rowsInserted = -1l;
+
+		wxLogSql(wxT("Thread pipelining query (%d:%s:%d): %s"),
+		         sent + 1, m_conn->GetHost().c_str(), m_conn->GetPort(),
+		         qry->m_query.c_str());
+	}
+
+	if (sent == first)
+	{
+		EndPipeline();
+		return 0;
+	}
+
+	m_conn->RegisterNoticeProcessor(m_processor, m_noticeHandler);
+
+	// A single cancel request stops the query running on the server, if
+	// any. The queries queued behind it have been sent already and run all
+	// the same, so they're reported as they came out, not as cancelled.
+	bool connExecutionCancelled = false;
+
+	// Once the input can't be read, none of the queries sent get a result
+	bool failed = false;
+
+	for (int idx = first; idx < sent; idx++)
+	{
+		PGresult *result = NULL;
+
+		m_currIndex = idx;
+
+		int &rc = m_queries[idx]->m_returnCode;
+
+		while (!failed)
+		{
+			if (m_cancelled && !connExecutionCancelled)
+			{
+				m_conn->CancelExecution();
+				connExecutionCancelled = true;
+			}
+
+			if (PQconsumeInput(conn) != 1)
+			{
+				failed = true;
+				break;
+			}
+
+			if (PQisBusy(conn))
+			{
+				WaitForSocket();
+				continue;
+			}
+
+			PGresult *res = PQgetResult(conn);
+
+			// The end of the query's results, its sync point follows
+			if (!res)
+				continue;
+
+			if (PQresultStatus(res) == PGRES_PIPELINE_SYNC)
+			{
+				PQclear(res);
+				break;
+			}
+
+			// Refuse to take part in the copy protocol, the queries should
+			// not have been pipelined.
+			if (PQresultStatus(res) == PGRES_COPY_IN)
+				PQputCopyEnd(conn, "not supported by pgadmin");
+
+			// As in Execute(), the last result of a query is the one returned
+			if (result)
+				PQclear(result);
+			result = res;
+		}
+
+		if (failed)
+		{
+			if (result)
+				PQclear(result);
+
+			// The queries sent after this one fail the same way, rather
+			// than being left to Execute() to run a second time
+			if (PQstatus(conn) == CONNECTION_BAD)
+			{
+				m_queries[idx]->m_err.msg_primary = _("Connection to the database server lost");
+				rc = pgQueryResultEvent::PGQ_CONN_LOST;
+			}
+			else
+			{
+				m_queries[idx]->m_err.msg_primary = wxString(PQerrorMessage(conn), conv);
+				rc = pgQueryResultEvent::PGQ_ERROR_CONSUME_INPUT;
+			}
+			RaiseEvent(rc);
+			continue;
+		}
+
+		// Only the query the cancel request hit was cancelled
+		const char *state = result ? PQresultErrorField(result, PG_DIAG_SQLSTATE) : NULL;
+		if (connExecutionCancelled && state && !strcmp(state, "57014"))
+		{
+			PQclear(result);
+
+			rc = pgQueryResultEvent::PGQ_EXECUTION_CANCELLED;
+			m_queries[idx]->m_err.msg_primary = _("Execution Cancelled");
+
+			if (m_eventOnCancellation)
+				RaiseEvent(rc);
+			continue;
+		}
+
+		StoreResult(result, false);
+	}
+
+	m_conn->RegisterNoticeProcessor(0, 0);
+
+	EndPipeline();
+
+	return sent - first;
+#else
+	return 0;
+#endif
+}
+
+
+// Take the connection out of pipeline mode, on whichever path the pipeline
+// ended, so the queries run on it afterwards work again. Results still due
+// are read and dropped first, unless the connection is gone.
+void pgQueryThread::EndPipeline()
+{
+#ifdef LIBPQ_HAS_PIPELINING
+	PGconn *conn = m_conn->conn;
+
+	while (PQpipelineStatus(conn) != PQ_PIPELINE_OFF && PQexitPipelineMode(conn) != 1)
+	{
+		if (PQstatus(conn) == CONNECTION_BAD)
+			break;
+
+		PGresult *res = PQgetResult(conn);
+		if (res)
+			PQclear(res);
+	}
+
+	if (PQpipelineStatus(conn) != PQ_PIPELINE_OFF)
+		wxLogError(wxT("%s"), wxString(PQerrorMessage(conn), *(m_conn->conv)).c_str());
+#endif
+}
+
+
+// Add a row received in single row mode to the pending chunk, and pass the
+// chunk on to the data set once it's full.
+void pgQueryThread::StreamRow(PGresult *row)
+{
+	int nFields = PQnfields(row);
+
+	if (!m_streamChunk)
+		m_streamChunk = PQcopyResult(row, PG_COPYRES_ATTRS);
+
+	int tuple = PQntuples(m_streamChunk);
+
+	for (int col = 0; col < nFields; col++)
+	{
+		if (PQgetisnull(row, 0, col))
+			PQsetvalue(m_streamChunk, tuple, col, NULL, -1);
+		else
+		{
+			int len = PQgetlength(row, 0, col);
+			PQsetvalue(m_streamChunk, tuple, col, PQgetvalue(row, 0, col), len);
+			m_streamBytes += len;
+			m_streamDataBytes += len;
+		}
+	}
+	m_streamRows++;
+	// libpq keeps a value pointer and a length per field
+	m_streamBytes += nFields * (sizeof(char *) + sizeof(int));
+
+	PQclear(row);
+
+	if (tuple + 1 >= m_streamChunkRows)
+		FlushStreamChunk();
+}
+
+
+void pgQueryThread::FlushStreamChunk()
+{
+	if (!m_streamChunk)
+		return;
+
+	pgSet *&dataSet = m_queries[m_currIndex]->m_resultSet;
+
+	if (!dataSet)
+	{
+		dataSet = new pgSet(m_streamChunk, m_conn, *(m_conn->conv), m_conn->needColQuoting);
+		dataSet->SetSpillThreshold(m_streamSpillThreshold, m_streamSpillDir);
+	}
+	else
+		dataSet->AppendChunk(m_streamChunk);
+	m_streamChunk = NULL;
+
+	// Stop reading once we hold as much as we may. The server will block
+	// as soon as the socket buffers are full.
+	if (m_streamMaxMemory)
+	{
+		wxMutexLocker lock(m_streamMutex);
+
+		if (m_streamBytes >= m_streamLimit && !m_cancelled)
+		{
+			m_streamSuspended = true;
+			RaiseRowsEvent();
+
+			while (m_streamBytes >= m_streamLimit && !m_cancelled)
+				m_streamCond.Wait();
+
+			m_streamSuspended = false;
+			return;
+		}
+	}
+
+	RaiseRowsEvent();
+}
+
 int pgQueryThread::RaiseEvent(int _retval)
 {
 #if !defined(PGSCLI)
@@ -696,6 +1385,24 @@ int pgQueryThread::RaiseEvent(int _retval)
 }
 
 
+void pgQueryThread::RaiseRowsEvent()
+{
+#if !defined(PGSCLI)
+	if (m_caller)
+	{
+		pgQueryResultEvent rowsEvent(GetId(), m_queries[m_currIndex], m_queries[m_currIndex]->m_eventID);
+
+		rowsEvent.SetEventType(PGQueryRowsEvent);
+		rowsEvent.SetClientData(m_queries[m_currIndex]->m_data);
+		rowsEvent.SetInt(m_queries[m_currIndex]->m_resultSet->NumRows());
+		rowsEvent.SetExtraLong(m_streamSuspended ? 1 : 0);
+
+		m_caller->AddPendingEvent(rowsEvent);
+	}
+#endif
+}
+
+
 void *pgQueryThread::Entry()
 {
 	do
@@ -705,23 +1412,36 @@ void *pgQueryThread::Entry()
 			// Create the PGcancel object to enable cancelling the running
 			// query
 			m_conn->SetConnCancel();
-			m_currIndex++;
 
-			m_queries[m_currIndex]->m_returnCode = -2;
-			m_queries[m_currIndex]->m_rowsInserted = -1l;
+			// Send the queued queries in one go, if we may - otherwise
+			// execute the next one
+			if (ExecutePipeline() == 0)
+			{
+				m_currIndex++;
+
+				m_queries[m_currIndex]->m_returnCode = -2;
+				m_queries[m_currIndex]->m_rowsInserted = -1l;
 
-			wxLogSql(wxT("Thread executing query (%d:%s:%d): %s"),
-			         m_currIndex + 1, m_conn->GetHost().c_str(), m_conn->GetPort(),
-			         m_queries[m_currIndex]->m_query.c_str());
+				wxLogSql(wxT("Thread executing query (%d:%s:%d): %s"),
+				         m_currIndex + 1, m_conn->GetHost().c_str(), m_conn->GetPort(),
+				         m_queries[m_currIndex]->m_query.c_str());
 
-			// register the notice processor for the current query
-			m_conn->RegisterNoticeProcessor(m_processor, m_noticeHandler);
+				// register the notice processor for the current query
+				m_conn->RegisterNoticeProcessor(m_processor, m_noticeHandler);
 
-			// execute the current query now
-			Execute();
+				// execute the current query now
+				Execute();
 
-			// remove the notice processor now
-			m_conn->RegisterNoticeProcessor(0, 0);
+				// drop the rows of a streamed result that was not completed
+				if (m_streamChunk)
+				{
+					PQclear(m_streamChunk);
+					m_streamChunk = NULL;
+				}
+
+				// remove the notice processor now
+				m_conn->RegisterNoticeProcessor(0, 0);
+			}
 
 			// reset the PGcancel object
 			m_conn->ResetConnCancel();
@@ -730,7 +1450,9 @@ void *pgQueryThread::Entry()
 		if (!m_multiQueries || m_cancelled)
 			break;
 
-		wxThread::Sleep(10);
+		// Sleep until another query is queued, or we're cancelled
+		if (m_currIndex >= (((int)m_queries.GetCount()) - 1))
+			m_queueSem.Wait();
 	}
 	while (true);
 
@@ -17,29 +17,50 @@
 // PostgreSQL headers
 #include <libpq-fe.h>
 
+// Rendering binary values
+#include <float.h>
+#include <locale.h>
+
 // App headers
 #include "db/pgSet.h"
 #include "db/pgConn.h"
 #include "utils/sysLogger.h"
 #include "utils/pgDefs.h"
+#include "utils/utf8.h"
 
 pgSet::pgSet()
 	: conv(wxConvLibc)
 {
+	needColQuoting = false;
 	conn = 0;
 	res = 0;
 	nCols = 0;
 	nRows = 0;
 	pos = 0;
+	colTypesResolved = false;
+	binary = false;
+	spill = 0;
+	spillThreshold = chunkBytes = 0;
 }
 
-pgSet::pgSet(PGresult *newRes, pgConn *newConn, wxMBConv &cnv, bool needColQt)
+pgSet::pgSet(PGresult *newRes, pgConn *newConn, wxMBConv &cnv, bool needColQt, pgConn *resConn)
 	: conv(cnv)
 {
 	needColQuoting = needColQt;
+	colTypesResolved = false;
 
 	conn = newConn;
 	res = newRes;
+	binary = false;
+	spill = 0;
+	spillThreshold = chunkBytes = 0;
+
+	// Taken now, as the connection may be running an other query later
+	if (!resConn)
+		resConn = conn;
+	const char *style = (resConn && resConn->connection()) ? PQparameterStatus(resConn->connection(), "DateStyle") : NULL;
+	if (style)
+		dateStyle = wxString(style, wxConvUTF8);
 
 	// Make sure we have tuples
 	if (PQresultStatus(res) != PGRES_TUPLES_OK)
@@ -58,7 +79,23 @@ pgSet::pgSet(PGresult *newRes, pgConn *newConn, wxMBConv &cnv, bool needColQt)
 			colClasses.Add(0);
 		}
 
+		// Index the column names, so named accessors don't have to scan
+		// (and convert) all field names for every value. Like PQfnumber,
+		// the first column wins if a name is used more than once.
+		for (int col = 0; col < nCols; col++)
+		{
+			wxString name = Decode(PQfname(res, col));
+			if (colNumbers.find(name) == colNumbers.end())
+				colNumbers[name] = col;
+		}
+
+		binary = (nCols > 0 && PQbinaryTuples(res));
+
 		nRows = PQntuples(res);
+		chunks.Add(res);
+		chunkRecords.Add(NULL);
+		chunkStarts.Add(0);
+
 		MoveFirst();
 	}
 }
@@ -66,10 +103,475 @@ pgSet::pgSet(PGresult *newRes, pgConn *newConn, wxMBConv &cnv, bool needColQt)
 
 pgSet::~pgSet()
 {
+	// The first chunk is res itself
+	for (size_t i = 1; i < chunks.GetCount(); i++)
+	{
+		// Spilled chunks are in the file, records and all
+		if (chunks[i])
+			PQclear((PGresult *)chunks[i]);
+	}
+	delete spill;
+
 	PQclear(res);
 }
 
 
+// Called by the thread that fills the set, while others may be reading it.
+void pgSet::AppendChunk(PGresult *chunk)
+{
+	wxASSERT(PQnfields(chunk) == nCols);
+
+	int chunkRows = PQntuples(chunk);
+	const char **records = NULL;
+
+	if (spillThreshold && !binary)
+	{
+		if (!spill)
+		{
+			// Count what libpq keeps, as in pgQueryThread::StreamRow
+			for (int row = 0; row < chunkRows; row++)
+			{
+				for (int col = 0; col < nCols; col++)
+					chunkBytes += PQgetlength(chunk, row, col);
+				chunkBytes += nCols * (sizeof(char *) + sizeof(int));
+			}
+			if (chunkBytes > spillThreshold)
+			{
+				spill = new pgSetSpill(spillDir);
+				if (!spill->IsOk())
+				{
+					wxLogWarning(_("Could not create a file in \"%s\" for the rows of the result, they are kept in memory."),
+					             spillDir.c_str());
+					spillThreshold = 0;
+				}
+			}
+		}
+
+		// Should the file be full, the rows stay in memory
+		if (spill && spillThreshold)
+		{
+			records = spill->Append(chunk);
+			if (records)
+			{
+				PQclear(chunk);
+				chunk = NULL;
+			}
+			else
+			{
+				wxLogWarning(_("Could not write the rows of the result to a file in \"%s\", the rest of them are kept in memory."),
+				             spillDir.c_str());
+				spillThreshold = 0;
+			}
+		}
+	}
+
+	wxCriticalSectionLocker lock(chunkLock);
+
+	chunkStarts.Add(nRows);
+	chunks.Add(chunk);
+	chunkRecords.Add(records);
+	nRows += chunkRows;
+}
+
+
+void pgSet::FindRow(long row, pgSetRow &values) const
+{
+	wxCriticalSectionLocker lock(chunkLock);
+
+	// Binary search for the last chunk starting at or before the row
+	size_t lo = 0, hi = chunks.GetCount();
+	while (hi - lo > 1)
+	{
+		size_t mid = (lo + hi) / 2;
+		if (chunkStarts[mid] <= row)
+			lo = mid;
+		else
+			hi = mid;
+	}
+
+	if (!hi)
+	{
+		// Not a result with tuples, let libpq deal with it
+		values.chunk = res;
+		values.records = NULL;
+		values.chunkRow = (int)row;
+		values.start = values.end = 0;
+		return;
+	}
+
+	values.chunk = (PGresult *)chunks[lo];
+	values.records = (const char **)chunkRecords[lo];
+	values.start = chunkStarts[lo];
+	values.end = (lo + 1 < chunks.GetCount()) ? chunkStarts[lo + 1] : nRows;
+	values.chunkRow = (int)(row - values.start);
+}
+
+
+// Binary values are sent in network byte order
+static wxUint32 BinaryUInt32(const unsigned char *p)
+{
+	return ((wxUint32)p[0] << 24) | ((wxUint32)p[1] << 16) | ((wxUint32)p[2] << 8) | (wxUint32)p[3];
+}
+
+
+static wxInt64 BinaryInt64(const unsigned char *p)
+{
+	return (wxInt64)(((wxUint64)BinaryUInt32(p) << 32) | (wxUint64)BinaryUInt32(p + 4));
+}
+
+
+static void AppendString(wxMemoryBuffer &buf, const char *str)
+{
+	buf.AppendData(str, strlen(str));
+}
+
+
+static void AppendInt64(wxMemoryBuffer &buf, wxInt64 val)
+{
+	char digits[24];
+	int n = 0;
+	wxUint64 uval = (val < 0 ? (wxUint64)0 - (wxUint64)val : (wxUint64)val);
+
+	do
+	{
+		digits[n++] = (char)('0' + (int)(uval % 10));
+		uval /= 10;
+	}
+	while (uval);
+
+	if (val < 0)
+		buf.AppendByte('-');
+	while (n)
+		buf.AppendByte(digits[--n]);
+}
+
+
+// Like float4out/float8out: with the default extra_float_digits, servers
+// since 12.0 print the shortest text that reads back exactly, older ones
+// FLT_DIG or DBL_DIG significant digits.
+static void AppendFloat(wxMemoryBuffer &buf, double val, bool isFloat4, bool shortest)
+{
+	if (val != val)
+	{
+		AppendString(buf, "NaN");
+		return;
+	}
+	if (val > DBL_MAX || val < -DBL_MAX)
+	{
+		AppendString(buf, val > 0 ? "Infinity" : "-Infinity");
+		return;
+	}
+
+	char str[40];
+	int digits = (isFloat4 ? FLT_DIG : DBL_DIG);
+
+	if (!shortest)
+		sprintf(str, "%.*g", digits, val);
+	else
+	{
+		int maxDigits = (isFloat4 ? 9 : 17);
+
+		for (digits = 1; ; digits++)
+		{
+			sprintf(str, "%.*e", digits - 1, val);
+			double back = strtod(str, NULL);
+			if (digits >= maxDigits || (isFloat4 ? ((float)back == (float)val) : (back == val)))
+				break;
+		}
+
+		// The exponential notation is used from 10^-4 on downwards, and
+		// upwards from the number of digits of the old output
+		int exponent = atoi(strchr(str, 'e') + 1);
+		if (exponent < -4 || exponent >= (isFloat4 ? FLT_DIG : DBL_DIG))
+			sprintf(str, "%.*e", digits - 1, val);
+		else
+			sprintf(str, "%.*f", (digits - 1 - exponent > 0 ? digits - 1 - exponent : 0), val);
+	}
+
+	// sprintf follows the locale of the C library
+	char point = *localeconv()->decimal_point;
+	if (point != '.')
+	{
+		char *p = strchr(str, point);
+		if (p)
+			*p = '.';
+	}
+
+	AppendString(buf, str);
+}
+
+
+// Like numeric_out: base 10000 digits, and dscale decimal digits
+static void AppendNumeric(wxMemoryBuffer &buf, const unsigned char *p, int len)
+{
+	if (len < 8)
+		return;
+
+	int ndigits = (short)((p[0] << 8) | p[1]);
+	int weight = (short)((p[2] << 8) | p[3]);
+	int sign = (p[4] << 8) | p[5];
+	int dscale = (p[6] << 8) | p[7];
+	const unsigned char *digits = p + 8;
+
+	if (len < 8 + ndigits * 2)
+		return;
+
+	switch (sign)
+	{
+		case 0xC000:
+			AppendString(buf, "NaN");
+			return;
+		case 0xD000:
+			AppendString(buf, "Infinity");
+			return;
+		case 0xF000:
+			AppendString(buf, "-Infinity");
+			return;
+		case 0x4000:
+			buf.AppendByte('-');
+			break;
+	}
+
+	char str[8];
+	int d;
+
+	if (weight < 0)
+	{
+		d = weight + 1;
+		buf.AppendByte('0');
+	}
+	else
+	{
+		for (d = 0; d <= weight; d++)
+		{
+			int dig = (d < ndigits ? (digits[d * 2] << 8) | digits[d * 2 + 1] : 0);
+
+			// The first group has no leading zeroes
+			sprintf(str, d ? "%04d" : "%d", dig);
+			AppendString(buf, str);
+		}
+	}
+
+	if (dscale > 0)
+	{
+		buf.AppendByte('.');
+		for (int i = 0; i < dscale; d++, i += 4)
+		{
+			int dig = (d >= 0 && d < ndigits ? (digits[d * 2] << 8) | digits[d * 2 + 1] : 0);
+
+			sprintf(str, "%04d", dig);
+			buf.AppendData(str, (dscale - i < 4 ? dscale - i : 4));
+		}
+	}
+}
+
+
+// The escape format of byteaout, which pgConn asks for
+static void AppendBytea(wxMemoryBuffer &buf, const unsigned char *p, int len)
+{
+	char str[8];
+
+	for (int i = 0; i < len; i++)
+	{
+		if (p[i] == '\\')
+			AppendString(buf, "\\\\");
+		else if (p[i] < 0x20 || p[i] > 0x7e)
+		{
+			sprintf(str, "\\%03o", p[i]);
+			AppendString(buf, str);
+		}
+		else
+			buf.AppendByte(p[i]);
+	}
+}
+
+
+// Dates are days since 2000-01-01, rendered in the ISO style. Returns
+// whether the date is BC, which is shown after the time of a timestamp.
+static bool AppendDate(wxMemoryBuffer &buf, int date)
+{
+	// j2date() of the server, from the Julian day number
+	unsigned int julian = (unsigned int)(date + 2451545 + 32044);
+	unsigned int quad = julian / 146097;
+	unsigned int extra = (julian - quad * 146097) * 4 + 3;
+
+	julian += 60 + quad * 3 + extra / 146097;
+	quad = julian / 1461;
+	julian -= quad * 1461;
+
+	int y = julian * 4 / 1461;
+	julian = ((y != 0) ? ((julian + 305) % 365) : ((julian + 306) % 366)) + 123;
+	y += quad * 4;
+
+	int year = y - 4800;
+	quad = julian * 2141 / 65536;
+	int day = julian - 7834 * quad / 256;
+	int month = (quad + 10) % 12 + 1;
+
+	char str[32];
+	sprintf(str, "%04d-%02d-%02d", (year > 0 ? year : -(year - 1)), month, day);
+	AppendString(buf, str);
+
+	return (year <= 0);
+}
+
+
+static void AppendTime(wxMemoryBuffer &buf, wxInt64 usecs)
+{
+	char str[32];
+	int fsec = (int)(usecs % 1000000);
+	int secs = (int)(usecs / 1000000);
+
+	sprintf(str, "%02d:%02d:%02d", secs / 3600, (secs / 60) % 60, secs % 60);
+	AppendString(buf, str);
+
+	if (fsec)
+	{
+		sprintf(str, ".%06d", fsec);
+
+		// Trailing zeroes are not shown
+		int len = strlen(str);
+		while (str[len - 1] == '0')
+			len--;
+		buf.AppendData(str, len);
+	}
+}
+
+
+char *pgSet::RenderBinary(const pgSetRow &values, int col, wxMemoryBuffer &buf) const
+{
+	// Binary results are never spilled, so the row is in a PGresult
+	char *val = values.Value(col);
+
+	if (PQfformat(values.chunk, col) == 0 || values.IsNull(col))
+		return val;
+
+	const unsigned char *p = (const unsigned char *)val;
+	int len = values.Length(col);
+
+	buf.SetDataLen(0);
+
+	switch (PQftype(values.chunk, col))
+	{
+		case PGOID_TYPE_BOOL:
+			buf.AppendByte(len && *p ? 't' : 'f');
+			break;
+
+		case PGOID_TYPE_INT2:
+			if (len == 2)
+				AppendInt64(buf, (short)((p[0] << 8) | p[1]));
+			break;
+
+		case PGOID_TYPE_INT4:
+			if (len == 4)
+				AppendInt64(buf, (wxInt32)BinaryUInt32(p));
+			break;
+
+		case PGOID_TYPE_OID:
+		case PGOID_TYPE_XID:
+		case PGOID_TYPE_CID:
+			if (len == 4)
+				AppendInt64(buf, BinaryUInt32(p));
+			break;
+
+		case PGOID_TYPE_INT8:
+			if (len == 8)
+				AppendInt64(buf, BinaryInt64(p));
+			break;
+
+		case PGOID_TYPE_FLOAT4:
+			if (len == 4)
+			{
+				union
+				{
+					wxUint32 i;
+					float f;
+				} v;
+				v.i = BinaryUInt32(p);
+				AppendFloat(buf, v.f, true, conn && conn->BackendMinimumVersion(12, 0));
+			}
+			break;
+
+		case PGOID_TYPE_FLOAT8:
+			if (len == 8)
+			{
+				union
+				{
+					wxInt64 i;
+					double d;
+				} v;
+				v.i = BinaryInt64(p);
+				AppendFloat(buf, v.d, false, conn && conn->BackendMinimumVersion(12, 0));
+			}
+			break;
+
+		case PGOID_TYPE_NUMERIC:
+			AppendNumeric(buf, p, len);
+			break;
+
+		case PGOID_TYPE_BYTEA:
+			AppendBytea(buf, p, len);
+			break;
+
+		case PGOID_TYPE_DATE:
+			if (len == 4)
+			{
+				wxInt32 date = (wxInt32)BinaryUInt32(p);
+
+				if (date == (wxInt32)0x80000000)
+					AppendString(buf, "-infinity");
+				else if (date == 0x7FFFFFFF)
+					AppendString(buf, "infinity");
+				else if (AppendDate(buf, date))
+					AppendString(buf, " BC");
+			}
+			break;
+
+		case PGOID_TYPE_TIME:
+			if (len == 8)
+				AppendTime(buf, BinaryInt64(p));
+			break;
+
+		case PGOID_TYPE_TIMESTAMP:
+			if (len == 8)
+			{
+				wxInt64 ts = BinaryInt64(p);
+				const wxInt64 usecsPerDay = (wxInt64)86400 * 1000000;
+
+				if (ts == (wxInt64)((wxUint64)1 << 63))
+					AppendString(buf, "-infinity");
+				else if (ts == (wxInt64)(~((wxUint64)1 << 63)))
+					AppendString(buf, "infinity");
+				else
+				{
+					wxInt64 date = ts / usecsPerDay;
+					wxInt64 time = ts % usecsPerDay;
+
+					if (time < 0)
+					{
+						time += usecsPerDay;
+						date--;
+					}
+
+					bool bc = AppendDate(buf, (int)date);
+					buf.AppendByte(' ');
+					AppendTime(buf, time);
+					if (bc)
+						AppendString(buf, " BC");
+				}
+			}
+			break;
+
+		default:
+			// Text types look the same in both formats
+			return val;
+	}
+
+	buf.AppendByte(0);
+	return (char *)buf.GetData();
+}
+
+
 
 OID pgSet::ColTypeOid(const int col) const
 {
@@ -96,22 +598,13 @@ long pgSet::GetInsertedCount() const
 }
 
 
-pgTypClass pgSet::ColTypClass(const int col) const
+pgTypClass pgSet::TypClassFromOid(OID typeOid)
 {
-	wxASSERT(col < nCols && col >= 0);
-
-	if (colClasses[col] != 0)
-		return (pgTypClass)colClasses[col];
-
-	wxString typoid = ExecuteScalar(
-	                      wxT("SELECT CASE WHEN typbasetype=0 THEN oid else typbasetype END AS basetype\n")
-	                      wxT("  FROM pg_type WHERE oid=") + NumToStr(ColTypeOid(col)));
-
-	switch (StrToLong(typoid))
+	switch (typeOid)
 	{
 		case PGOID_TYPE_BOOL:
-			colClasses[col] = PGTYPCLASS_BOOL;
-			break;
+			return PGTYPCLASS_BOOL;
+
 		case PGOID_TYPE_INT8:
 		case PGOID_TYPE_INT2:
 		case PGOID_TYPE_INT4:
@@ -124,59 +617,124 @@ pgTypClass pgSet::ColTypClass(const int col) const
 		case PGOID_TYPE_MONEY:
 		case PGOID_TYPE_BIT:
 		case PGOID_TYPE_NUMERIC:
-			colClasses[col] = PGTYPCLASS_NUMERIC;
-			break;
+			return PGTYPCLASS_NUMERIC;
+
 		case PGOID_TYPE_BYTEA:
 		case PGOID_TYPE_CHAR:
 		case PGOID_TYPE_NAME:
 		case PGOID_TYPE_TEXT:
 		case PGOID_TYPE_VARCHAR:
-			colClasses[col] = PGTYPCLASS_STRING;
-			break;
+			return PGTYPCLASS_STRING;
+
 		case PGOID_TYPE_TIMESTAMP:
 		case PGOID_TYPE_TIMESTAMPTZ:
 		case PGOID_TYPE_TIME:
 		case PGOID_TYPE_TIMETZ:
 		case PGOID_TYPE_INTERVAL:
-			colClasses[col] = PGTYPCLASS_DATE;
-			break;
+			return PGTYPCLASS_DATE;
+
 		default:
-			colClasses[col] = PGTYPCLASS_OTHER;
-			break;
+			return PGTYPCLASS_OTHER;
 	}
+}
 
-	return (pgTypClass)colClasses[col];
+
+bool pgSet::CanDecodeBinary(OID typeOid, bool isoDateTimes)
+{
+	switch (typeOid)
+	{
+		case PGOID_TYPE_BOOL:
+		case PGOID_TYPE_INT2:
+		case PGOID_TYPE_INT4:
+		case PGOID_TYPE_INT8:
+		case PGOID_TYPE_OID:
+		case PGOID_TYPE_XID:
+		case PGOID_TYPE_CID:
+		case PGOID_TYPE_FLOAT4:
+		case PGOID_TYPE_FLOAT8:
+		case PGOID_TYPE_NUMERIC:
+		case PGOID_TYPE_BYTEA:
+		case PGOID_TYPE_NAME:
+		case PGOID_TYPE_TEXT:
+		case PGOID_TYPE_BPCHAR:
+		case PGOID_TYPE_VARCHAR:
+			return true;
+
+		case PGOID_TYPE_DATE:
+		case PGOID_TYPE_TIME:
+		case PGOID_TYPE_TIMESTAMP:
+			return isoDateTimes;
+
+		default:
+			return false;
+	}
 }
 
 
-wxString pgSet::ColType(const int col) const
+// Look up the types of all columns with (at most) one catalog round trip,
+// using the type cache of the connection.
+void pgSet::ResolveColTypes() const
 {
-	wxASSERT(col < nCols && col >= 0);
+	if (colTypesResolved || !nCols)
+		return;
 
-	if (!colTypes[col].IsEmpty())
-		return colTypes[col];
+	colTypesResolved = true;
 
-	wxString szSQL, szResult;
-	szSQL.Printf(wxT("SELECT format_type(oid,NULL) as typname FROM pg_type WHERE oid = %d"), (int)ColTypeOid(col));
-	szResult = ExecuteScalar(szSQL);
-	colTypes[col] = szResult;
+	OID *oids = new OID[nCols];
+	long *mods = new long[nCols];
+	wxString *names = new wxString[nCols];
+	wxString *fullNames = new wxString[nCols];
+	int *classes = new int[nCols];
+	long col;
 
-	return szResult;
+	for (col = 0 ; col < nCols ; col++)
+	{
+		oids[col] = ColTypeOid(col);
+		mods[col] = ColTypeMod(col);
+		classes[col] = PGTYPCLASS_OTHER;
+	}
+
+	if (conn)
+		conn->ResolveTypes(nCols, oids, mods, names, fullNames, classes);
+
+	for (col = 0 ; col < nCols ; col++)
+	{
+		colTypes[col] = names[col];
+		colFullTypes[col] = fullNames[col];
+		colClasses[col] = classes[col];
+	}
+
+	delete [] oids;
+	delete [] mods;
+	delete [] names;
+	delete [] fullNames;
+	delete [] classes;
 }
 
-wxString pgSet::ColFullType(const int col) const
+
+pgTypClass pgSet::ColTypClass(const int col) const
+{
+	wxASSERT(col < nCols && col >= 0);
+
+	ResolveColTypes();
+	return (pgTypClass)colClasses[col];
+}
+
+
+wxString pgSet::ColType(const int col) const
 {
 	wxASSERT(col < nCols && col >= 0);
 
-	if (!colFullTypes[col].IsEmpty())
-		return colFullTypes[col];
+	ResolveColTypes();
+	return colTypes[col];
+}
 
-	wxString szSQL, szResult;
-	szSQL.Printf(wxT("SELECT format_type(oid,%d) as typname FROM pg_type WHERE oid = %d"), (int)ColTypeMod(col), (int)ColTypeOid(col));
-	szResult = ExecuteScalar(szSQL);
-	colFullTypes[col] = szResult;
+wxString pgSet::ColFullType(const int col) const
+{
+	wxASSERT(col < nCols && col >= 0);
 
-	return szResult;
+	ResolveColTypes();
+	return colFullTypes[col];
 }
 
 int pgSet::ColScale(const int col) const
@@ -190,22 +748,66 @@ wxString pgSet::ColName(const int col) const
 {
 	wxASSERT(col < nCols && col >= 0);
 
-	return wxString(PQfname(res, col), conv);
+	return Decode(PQfname(res, col));
 }
 
 
-int pgSet::ColNumber(const wxString &colname) const
+// Find a column by name, following the rules of PQfnumber: unless the
+// connection requires quoting, names are folded to lower case except for
+// the parts in double quotes.
+int pgSet::LookupColumn(const wxString &colname) const
 {
-	int col;
+	wxString name;
 
 	if (needColQuoting)
+		name = colname;
+	else
 	{
-		wxString quotedColName = colname;
-		quotedColName.Replace(wxT("\""), wxT("\"\""));
-		col = PQfnumber(res, (wxT("\"") + quotedColName + wxT("\"")).mb_str(conv));
+		bool inQuotes = false;
+		size_t len = colname.Length();
+
+		for (size_t i = 0; i < len; i++)
+		{
+			wxChar c = colname[i];
+
+			if (inQuotes)
+			{
+				if (c == wxT('"'))
+				{
+					if (i + 1 < len && colname[i + 1] == wxT('"'))
+					{
+						name += c;
+						i++;
+					}
+					else
+						inQuotes = false;
+				}
+				else
+					name += c;
+			}
+			else if (c == wxT('"'))
+				inQuotes = true;
+			else if (c >= wxT('A') && c <= wxT('Z'))
+				name += (wxChar)(c + (wxT('a') - wxT('A')));
+			else
+				name += c;
+		}
 	}
-	else
-		col = PQfnumber(res, colname.mb_str(conv));
+
+	if (name.IsEmpty())
+		return -1;
+
+	pgSetColumnHash::const_iterator it = colNumbers.find(name);
+	if (it == colNumbers.end())
+		return -1;
+
+	return it->second;
+}
+
+
+int pgSet::ColNumber(const wxString &colname) const
+{
+	int col = LookupColumn(colname);
 
 	if (col < 0)
 	{
@@ -216,15 +818,7 @@ int pgSet::ColNumber(const wxString &colname) const
 
 bool pgSet::HasColumn(const wxString &colname) const
 {
-	if (needColQuoting)
-	{
-		wxString quotedColName = colname;
-		quotedColName.Replace(wxT("\""), wxT("\"\""));
-		return (PQfnumber(res, (wxT("\"") + quotedColName + wxT("\"")).mb_str(conv)) < 0 ? false : true);
-	}
-	else
-		return (PQfnumber(res, colname.mb_str(conv)) < 0 ? false : true);
-
+	return LookupColumn(colname) >= 0;
 }
 
 
@@ -233,13 +827,22 @@ char *pgSet::GetCharPtr(const int col) const
 {
 	wxASSERT(col < nCols && col >= 0);
 
-	return PQgetvalue(res, pos - 1, col);
+	return TextValue(pos - 1, col);
 }
 
 
 char *pgSet::GetCharPtr(const wxString &col) const
 {
-	return PQgetvalue(res, pos - 1, ColNumber(col));
+	return TextValue(pos - 1, ColNumber(col));
+}
+
+
+wxString pgSet::Decode(const char *str) const
+{
+	if (&conv == &wxConvUTF8)
+		return DecodeUTF8(str);
+
+	return wxString(str, conv);
 }
 
 
@@ -247,7 +850,14 @@ wxString pgSet::GetVal(const int col) const
 {
 	wxASSERT(col < nCols && col >= 0);
 
-	return wxString(GetCharPtr(col), conv);
+	// Text values come with their length, which saves scanning them twice
+	if (!binary && &conv == &wxConvUTF8)
+	{
+		const pgSetRow &values = RowAt(pos - 1);
+		return DecodeUTF8(values.Value(col), values.Length(col));
+	}
+
+	return Decode(GetCharPtr(col));
 }
 
 
@@ -261,7 +871,7 @@ long pgSet::GetLong(const int col) const
 {
 	wxASSERT(col < nCols && col >= 0);
 
-	char *c = PQgetvalue(res, pos - 1, col);
+	char *c = TextValue(pos - 1, col);
 	if (c)
 		return atol(c);
 	else
@@ -271,7 +881,7 @@ long pgSet::GetLong(const int col) const
 
 long pgSet::GetLong(const wxString &col) const
 {
-	char *c = PQgetvalue(res, pos - 1, ColNumber(col));
+	char *c = TextValue(pos - 1, ColNumber(col));
 	if (c)
 		return atol(c);
 	else
@@ -283,7 +893,7 @@ bool pgSet::GetBool(const int col) const
 {
 	wxASSERT(col < nCols && col >= 0);
 
-	char *c = PQgetvalue(res, pos - 1, col);
+	char *c = TextValue(pos - 1, col);
 	if (c)
 	{
 		if (*c == 't' || *c == '1' || !strcmp(c, "on"))
@@ -355,7 +965,7 @@ wxULongLong pgSet::GetLongLong(const int col) const
 {
 	wxASSERT(col < nCols && col >= 0);
 
-	char *c = PQgetvalue(res, pos - 1, col);
+	char *c = TextValue(pos - 1, col);
 	if (c)
 		return atolonglong(c);
 	else
@@ -372,7 +982,7 @@ OID pgSet::GetOid(const int col) const
 {
 	wxASSERT(col < nCols && col >= 0);
 
-	char *c = PQgetvalue(res, pos - 1, col);
+	char *c = TextValue(pos - 1, col);
 	if (c)
 		return (OID)strtoul(c, 0, 10);
 	else
@@ -0,0 +1,863 @@
+//////////////////////////////////////////////////////////////////////////
+//
+// pgAdmin III - PostgreSQL Tools
+//
+// Copyright (C) 2002 - 2016, The pgAdmin Development Team
+// This software is released under the PostgreSQL Licence
+//
+// pgSetIndex.cpp - Client side sort and filter of a result
+//
+//////////////////////////////////////////////////////////////////////////
+
+#include "pgAdmin3.h"
+
+// wxWindows headers
+#include <wx/wx.h>
+#include <wx/thread.h>
+
+// PostgreSQL headers
+#include <libpq-fe.h>
+
+#include <ctype.h>
+#include <locale.h>
+#include <math.h>
+
+// App headers
+#include "db/pgSetIndex.h"
+#include "utils/pgDefs.h"
+#include "utils/utf8.h"
+
+#include <wx/arrimpl.cpp>
+WX_DEFINE_OBJARRAY(pgSetFilterArray);
+
+// Fewer rows than this per thread aren't worth one
+#define SORT_ROWS_PER_THREAD    50000
+
+// Runs this short are sorted by insertion
+#define SORT_INSERTION_RUN      16
+
+
+// The order of day, month and year in dates written with numbers only
+enum dateOrder
+{
+	DATEORDER_YMD,
+	DATEORDER_DMY,
+	DATEORDER_MDY
+};
+
+// Infinite dates and times sort outside all others
+#define DATETIME_INFINITY       wxLL(9223372036854775807)
+#define DATETIME_MINUS_INFINITY (-DATETIME_INFINITY - 1)
+
+const wxEventType SetIndexBuiltEvent = wxNewEventType();
+
+
+// The rank of special numeric values: -Infinity, numbers, Infinity, NaN
+static int DecimalRank(const char *text)
+{
+	if (*text == 'N')
+		return 2;
+	if (!strcmp(text, "Infinity"))
+		return 1;
+	if (!strcmp(text, "-Infinity"))
+		return -1;
+	return 0;
+}
+
+
+// Compare two unsigned decimals as the server writes them, digit by digit,
+// so numbers of any size or precision compare exactly
+static int CompareMagnitude(const char *a, const char *b)
+{
+	while (*a == '0' && isdigit((unsigned char)a[1]))
+		a++;
+	while (*b == '0' && isdigit((unsigned char)b[1]))
+		b++;
+
+	size_t intA = strspn(a, "0123456789"), intB = strspn(b, "0123456789");
+	if (intA != intB)
+		return intA < intB ? -1 : 1;
+
+	int result = memcmp(a, b, intA);
+	if (result)
+		return result < 0 ? -1 : 1;
+
+	a += intA;
+	b += intB;
+	if (*a == '.')
+		a++;
+	if (*b == '.')
+		b++;
+
+	// Missing digits of the fraction count as zeros
+	while (isdigit((unsigned char)*a) || isdigit((unsigned char)*b))
+	{
+		char da = isdigit((unsigned char)*a) ? *a++ : '0';
+		char db = isdigit((unsigned char)*b) ? *b++ : '0';
+		if (da != db)
+			return da < db ? -1 : 1;
+	}
+	return 0;
+}
+
+
+static int CompareDecimal(const char *a, const char *b)
+{
+	int rankA = DecimalRank(a), rankB = DecimalRank(b);
+
+	if (rankA != rankB)
+		return rankA < rankB ? -1 : 1;
+	if (rankA)
+		return 0;
+
+	bool negA = (*a == '-'), negB = (*b == '-');
+	if (negA != negB)
+		return negA ? -1 : 1;
+
+	int result = CompareMagnitude(negA ? a + 1 : a, negB ? b + 1 : b);
+	return negA ? -result : result;
+}
+
+
+// Days since 2000-01-01 of a date of the proleptic Gregorian calendar, the
+// year counted astronomically (1 BC is year 0)
+static wxLongLong_t DaysFromCivil(wxLongLong_t year, int month, int day)
+{
+	year -= (month <= 2);
+	wxLongLong_t era = (year >= 0 ? year : year - 399) / 400;
+	wxLongLong_t yearOfEra = year - era * 400;
+	wxLongLong_t dayOfYear = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+	wxLongLong_t dayOfEra = yearOfEra * 365 + yearOfEra / 4 - yearOfEra / 100 + dayOfYear;
+
+	return era * 146097 + dayOfEra - 730425;
+}
+
+
+// Whether the word starts with the lower case ASCII letters given
+static bool WordStartsWith(const char *word, const char *prefix)
+{
+	for ( ; *prefix ; word++, prefix++)
+	{
+		if (tolower((unsigned char)*word) != *prefix)
+			return false;
+	}
+	return true;
+}
+
+
+static wxLongLong_t ReadNumber(const char *&p, int *digits = NULL)
+{
+	wxLongLong_t value = 0;
+	int count = 0;
+
+	while (isdigit((unsigned char)*p))
+	{
+		if (count < 18)
+			value = value * 10 + (*p - '0');
+		count++;
+		p++;
+	}
+	if (digits)
+		*digits = count;
+	return value;
+}
+
+
+// A time zone offset such as +02, -03:30 or +05:45:10, in seconds
+static bool ReadOffset(const char *&p, wxLongLong_t &offset)
+{
+	if ((*p != '+' && *p != '-') || !isdigit((unsigned char)p[1]))
+		return false;
+
+	int sign = (*p++ == '-') ? -1 : 1;
+	offset = ReadNumber(p) * 3600;
+	if (*p == ':' && isdigit((unsigned char)p[1]))
+	{
+		p++;
+		offset += ReadNumber(p) * 60;
+		if (*p == ':' && isdigit((unsigned char)p[1]))
+		{
+			p++;
+			offset += ReadNumber(p);
+		}
+	}
+	offset *= sign;
+	return true;
+}
+
+
+// Read a date, a time or a timestamp as the server writes it in any
+// DateStyle: microseconds since 2000-01-01 00:00 UTC for timestamps, of the
+// day in UTC for times, or days for dates. Weekdays are skipped, and so
+// are time zone abbreviations, which only the server can resolve: values
+// with one compare by their local time.
+static bool ParseDateTime(const char *text, OID type, dateOrder order, wxLongLong_t &key)
+{
+	if (!strcmp(text, "infinity"))
+	{
+		key = DATETIME_INFINITY;
+		return true;
+	}
+	if (!strcmp(text, "-infinity"))
+	{
+		key = DATETIME_MINUS_INFINITY;
+		return true;
+	}
+
+	static const char *months[] = { "jan", "feb", "mar", "apr", "may", "jun", "jul", "aug", "sep", "oct", "nov", "dec" };
+
+	wxLongLong_t nums[3], hour = 0, minute = 0, second = 0, usec = 0, offset = 0;
+	int nNums = 0, firstDigits = 0, month = 0;
+	bool hasTime = false, bc = false;
+	const char *p = text;
+
+	while (*p)
+	{
+		if (isalpha((unsigned char)*p))
+		{
+			const char *word = p;
+			while (isalpha((unsigned char)*p))
+				p++;
+
+			if (p - word == 2 && WordStartsWith(word, "bc"))
+				bc = true;
+			else if (p - word >= 3)
+			{
+				for (int i = 0 ; i < 12 ; i++)
+				{
+					if (WordStartsWith(word, months[i]))
+						month = i + 1;
+				}
+			}
+		}
+		else if (isdigit((unsigned char)*p))
+		{
+			int digits;
+			wxLongLong_t value = ReadNumber(p, &digits);
+
+			if (*p == ':')
+			{
+				if (hasTime)
+					return false;
+				hasTime = true;
+
+				hour = value;
+				p++;
+				minute = ReadNumber(p);
+				if (*p == ':')
+				{
+					p++;
+					second = ReadNumber(p);
+					if (*p == '.')
+					{
+						p++;
+						for (int scale = 100000 ; isdigit((unsigned char)*p) ; p++, scale /= 10)
+							usec += (*p - '0') * scale;
+					}
+				}
+				ReadOffset(p, offset);
+			}
+			else
+			{
+				if (nNums == 3)
+					return false;
+				if (!nNums)
+					firstDigits = digits;
+				nums[nNums++] = value;
+
+				if (*p == '-' || *p == '/' || *p == '.')
+					p++;
+			}
+		}
+		else if (!(hasTime && ReadOffset(p, offset)))
+			p++;
+	}
+
+	if (type == PGOID_TYPE_TIME || type == PGOID_TYPE_TIMETZ)
+	{
+		if (!hasTime || nNums)
+			return false;
+		key = ((hour * 60 + minute) * 60 + second - offset) * 1000000 + usec;
+		return true;
+	}
+
+	wxLongLong_t year;
+	int day;
+	if (month)
+	{
+		if (nNums != 2)
+			return false;
+		day = (int)nums[0];
+		year = nums[1];
+	}
+	else
+	{
+		if (nNums != 3)
+			return false;
+		if (order == DATEORDER_YMD || firstDigits > 2)
+		{
+			year = nums[0];
+			month = (int)nums[1];
+			day = (int)nums[2];
+		}
+		else if (order == DATEORDER_DMY)
+		{
+			day = (int)nums[0];
+			month = (int)nums[1];
+			year = nums[2];
+		}
+		else
+		{
+			month = (int)nums[0];
+			day = (int)nums[1];
+			year = nums[2];
+		}
+	}
+	if (month < 1 || month > 12 || day < 1 || day > 31)
+		return false;
+	if (bc)
+		year = 1 - year;
+
+	key = DaysFromCivil(year, month, day);
+	if (type != PGOID_TYPE_DATE)
+		key = ((key * 24 + hour) * 3600 + minute * 60 + second - offset) * 1000000 + usec;
+	return true;
+}
+
+
+// The order of dates written with numbers in a DateStyle such as "ISO, MDY"
+static dateOrder GetDateOrder(const wxString &dateStyle)
+{
+	wxString style = dateStyle.BeforeFirst(',').Strip(wxString::both).Upper();
+	wxString order = dateStyle.AfterFirst(',').Strip(wxString::both).Upper();
+
+	if (style == wxT("ISO"))
+		return DATEORDER_YMD;
+	if (style == wxT("GERMAN") || order == wxT("DMY"))
+		return DATEORDER_DMY;
+	return DATEORDER_MDY;
+}
+
+
+// What the rows are sorted by, by position in the list of rows to sort
+class sortKeys
+{
+public:
+	const char **texts;
+	wxString *strings;
+	double *numbers;
+	wxLongLong_t *instants;
+	pgSetSortKind kind;
+	bool descending;
+
+	// Set by any thread finding a value it can't read
+	volatile bool unreadable;
+
+	int Compare(int a, int b) const
+	{
+		int result;
+		const char *ta = texts[a], *tb = texts[b];
+
+		// NULLs sort last, or first when descending
+		if (!ta || !tb)
+			result = ta ? -1 : (tb ? 1 : 0);
+		else
+		{
+			switch (kind)
+			{
+				case SETSORT_DECIMAL:
+					result = CompareDecimal(ta, tb);
+					break;
+				case SETSORT_FLOAT:
+				{
+					// NaN sorts above all numbers, Infinity included
+					bool nanA = (numbers[a] != numbers[a]), nanB = (numbers[b] != numbers[b]);
+					if (nanA || nanB)
+						result = (nanA == nanB) ? 0 : (nanA ? 1 : -1);
+					else
+						result = numbers[a] < numbers[b] ? -1 : (numbers[a] > numbers[b] ? 1 : 0);
+					break;
+				}
+				case SETSORT_DATETIME:
+					result = instants[a] < instants[b] ? -1 : (instants[a] > instants[b] ? 1 : 0);
+					break;
+				default:
+					// Text as the user's locale orders it, bytes telling
+					// apart what it holds equal. Dates and times that
+					// couldn't be read have no strings, and go by bytes.
+					result = strings ? wxStrcoll(strings[a].c_str(), strings[b].c_str()) : 0;
+					if (!result)
+						result = strcmp(ta, tb);
+					else
+						result = result < 0 ? -1 : 1;
+					break;
+			}
+		}
+
+		return descending ? -result : result;
+	}
+};
+
+
+// Stable merge sort of positions, using tmp as scratch space
+static void MergeSort(int *items, int *tmp, size_t count, const sortKeys &keys)
+{
+	size_t i, j, k;
+
+	if (count <= SORT_INSERTION_RUN)
+	{
+		for (i = 1 ; i < count ; i++)
+		{
+			int item = items[i];
+			for (j = i ; j > 0 && keys.Compare(items[j - 1], item) > 0 ; j--)
+				items[j] = items[j - 1];
+			items[j] = item;
+		}
+		return;
+	}
+
+	size_t half = count / 2;
+	MergeSort(items, tmp, half, keys);
+	MergeSort(items + half, tmp + half, count - half, keys);
+
+	// Already in order, as happens a lot with sorted data
+	if (keys.Compare(items[half - 1], items[half]) <= 0)
+		return;
+
+	memcpy(tmp, items, count * sizeof(int));
+	for (i = 0, j = half, k = 0 ; i < half && j < count ; k++)
+	{
+		if (keys.Compare(tmp[j], tmp[i]) < 0)
+			items[k] = tmp[j++];
+		else
+			items[k] = tmp[i++];
+	}
+	while (i < half)
+		items[k++] = tmp[i++];
+	while (j < count)
+		items[k++] = tmp[j++];
+}
+
+
+// Merge two adjacent sorted runs
+static void MergeRuns(int *items, int *tmp, size_t first, size_t count, const sortKeys &keys)
+{
+	size_t i = 0, j = first, k = 0;
+
+	memcpy(tmp, items, count * sizeof(int));
+	while (i < first && j < count)
+	{
+		if (keys.Compare(tmp[j], tmp[i]) < 0)
+			items[k++] = tmp[j++];
+		else
+			items[k++] = tmp[i++];
+	}
+	while (i < first)
+		items[k++] = tmp[i++];
+	while (j < count)
+		items[k++] = tmp[j++];
+}
+
+
+// Looks up the keys of a slice of the rows, sorts a slice, or merges two
+// sorted slices.
+enum sortJob
+{
+	SORTJOB_LOOKUP,
+	SORTJOB_SORT,
+	SORTJOB_MERGE
+};
+
+class sortThread : public wxThread
+{
+public:
+	sortThread(sortJob _job, pgSet *_set, const int *_rows, int _col, OID _type, dateOrder _order, char _point,
+	           sortKeys &_keys, int *_items, int *_tmp, size_t _start, size_t _count, size_t _merge = 0)
+		: wxThread(wxTHREAD_JOINABLE), job(_job), set(_set), rows(_rows), col(_col), type(_type), order(_order), point(_point),
+		  keys(_keys), items(_items), tmp(_tmp), start(_start), count(_count), merge(_merge)
+	{
+	}
+
+	void *Entry();
+
+private:
+	void LookUpKeys();
+
+	sortJob job;
+	pgSet *set;
+	const int *rows;
+	int col;
+	OID type;
+	dateOrder order;
+	char point;
+	sortKeys &keys;
+	int *items, *tmp;
+	size_t start, count, merge;
+};
+
+
+void *sortThread::Entry()
+{
+	switch (job)
+	{
+		case SORTJOB_LOOKUP:
+			LookUpKeys();
+			break;
+		case SORTJOB_SORT:
+			MergeSort(items + start, tmp + start, count, keys);
+			break;
+		case SORTJOB_MERGE:
+			MergeRuns(items + start, tmp + start, merge, count, keys);
+			break;
+	}
+	return 0;
+}
+
+
+void sortThread::LookUpKeys()
+{
+	pgSetRow values;
+
+	for (size_t i = start ; i < start + count ; i++)
+	{
+		set->SeekRow(rows[i], values);
+
+		items[i] = (int)i;
+
+		if (values.IsNull(col))
+		{
+			keys.texts[i] = NULL;
+			continue;
+		}
+
+		const char *text = values.Value(col);
+		keys.texts[i] = text;
+
+		if (keys.strings)
+		{
+			if (&set->GetConversion() != &wxConvUTF8)
+				keys.strings[i] = wxString(text, set->GetConversion());
+			else
+				keys.strings[i] = DecodeUTF8(text, values.Length(col));
+			continue;
+		}
+
+		if (keys.kind == SETSORT_DATETIME)
+		{
+			if (!keys.unreadable && !ParseDateTime(text, type, order, keys.instants[i]))
+				keys.unreadable = true;
+			continue;
+		}
+		if (keys.kind != SETSORT_FLOAT)
+			continue;
+
+		// Numbers come with a decimal point, strtod wants the one of the
+		// C library's locale
+		double number;
+		const char *dot = (point != '.') ? strchr(text, '.') : NULL;
+
+		if (!dot)
+			number = strtod(text, NULL);
+		else
+		{
+			size_t len = strlen(text);
+			char buf[64], *copy = (len < sizeof(buf)) ? buf : (char *)malloc(len + 1);
+
+			memcpy(copy, text, len + 1);
+			copy[dot - text] = point;
+			number = strtod(copy, NULL);
+
+			if (copy != buf)
+				free(copy);
+		}
+
+		keys.numbers[i] = number;
+	}
+}
+
+
+// Without a thread, do the work here
+static void StartThread(sortThread *thread, wxArrayPtrVoid &threads)
+{
+	if (thread->Create() != wxTHREAD_NO_ERROR || thread->Run() != wxTHREAD_NO_ERROR)
+	{
+		thread->Entry();
+		delete thread;
+	}
+	else
+		threads.Add(thread);
+}
+
+
+static void WaitThreads(wxArrayPtrVoid &threads)
+{
+	for (size_t i = 0 ; i < threads.GetCount() ; i++)
+	{
+		((sortThread *)threads.Item(i))->Wait();
+		delete (sortThread *)threads.Item(i);
+	}
+	threads.Empty();
+}
+
+
+// Builds the rows of an index for the GUI, and tells it when they're ready
+class pgSetIndexBuilder : public wxThread
+{
+public:
+	pgSetIndexBuilder(pgSetIndex *_index, wxEvtHandler *_handler)
+		: wxThread(wxTHREAD_JOINABLE), index(_index), handler(_handler), done(false)
+	{
+	}
+
+	void *Entry()
+	{
+		index->Build(rows);
+		done = true;
+
+		wxCommandEvent ev(SetIndexBuiltEvent);
+		handler->AddPendingEvent(ev);
+		return 0;
+	}
+
+	wxArrayInt rows;
+	pgSetIndex *index;
+	wxEvtHandler *handler;
+	volatile bool done;
+};
+
+
+pgSetIndex::pgSetIndex(pgSet *_set)
+{
+	set = _set;
+	sortCol = -1;
+	sortDescending = false;
+	sortKind = SETSORT_TEXT;
+	sortType = 0;
+	builder = NULL;
+	cancelled = false;
+}
+
+
+pgSetIndex::~pgSetIndex()
+{
+	StopBuild();
+}
+
+
+void pgSetIndex::AddFilter(long row, int col, bool exclude)
+{
+	pgSetRow values;
+	set->FindRow(row, values);
+
+	pgSetFilter *filter = new pgSetFilter;
+	filter->col = col;
+	filter->exclude = exclude;
+	filter->isNull = values.IsNull(col);
+	if (!filter->isNull)
+		filter->value.AppendData(values.Value(col), values.Length(col));
+
+	filters.Add(filter);
+}
+
+
+void pgSetIndex::SetSort(int col, bool descending)
+{
+	sortCol = col;
+	sortDescending = descending;
+	sortType = set->ColTypeOid(col);
+
+	switch (sortType)
+	{
+		case PGOID_TYPE_INT2:
+		case PGOID_TYPE_INT4:
+		case PGOID_TYPE_INT8:
+		case PGOID_TYPE_OID:
+		case PGOID_TYPE_XID:
+		case PGOID_TYPE_CID:
+		case PGOID_TYPE_NUMERIC:
+			sortKind = SETSORT_DECIMAL;
+			break;
+		case PGOID_TYPE_DATE:
+		case PGOID_TYPE_TIME:
+		case PGOID_TYPE_TIMETZ:
+		case PGOID_TYPE_TIMESTAMP:
+		case PGOID_TYPE_TIMESTAMPTZ:
+			sortKind = SETSORT_DATETIME;
+			break;
+		default:
+			sortKind = (set->ColTypClass(col) == PGTYPCLASS_NUMERIC) ? SETSORT_FLOAT : SETSORT_TEXT;
+			break;
+	}
+}
+
+
+bool pgSetIndex::Matches(const pgSetRow &values) const
+{
+	for (size_t i = 0 ; i < filters.GetCount() ; i++)
+	{
+		const pgSetFilter &filter = filters.Item(i);
+
+		if (values.IsNull(filter.col))
+		{
+			// NULL is neither equal nor unequal to a value
+			if (!filter.isNull || filter.exclude)
+				return false;
+			continue;
+		}
+		if (filter.isNull)
+		{
+			if (!filter.exclude)
+				return false;
+			continue;
+		}
+
+		bool equal = ((size_t)values.Length(filter.col) == filter.value.GetDataLen() &&
+		              !memcmp(values.Value(filter.col), filter.value.GetData(), filter.value.GetDataLen()));
+		if (equal == filter.exclude)
+			return false;
+	}
+	return true;
+}
+
+
+void pgSetIndex::Build(wxArrayInt &rows)
+{
+	long row, nRows = set->NumRows();
+	pgSetRow values;
+
+	rows.Empty();
+	rows.Alloc(nRows);
+
+	for (row = 0 ; row < nRows && !cancelled ; row++)
+	{
+		if (filters.GetCount())
+		{
+			set->SeekRow(row, values);
+			if (!Matches(values))
+				continue;
+		}
+		rows.Add((int)row);
+	}
+
+	size_t count = rows.GetCount();
+	if (sortCol < 0 || count < 2 || cancelled)
+		return;
+
+	int *sorted = new int[count];
+	int *items = new int[count];
+	int *tmp = new int[count];
+	for (size_t i = 0 ; i < count ; i++)
+		sorted[i] = rows.Item(i);
+
+	sortKeys keys;
+	keys.texts = new const char *[count];
+	keys.strings = (sortKind == SETSORT_TEXT) ? new wxString[count] : NULL;
+	keys.kind = sortKind;
+	keys.numbers = (sortKind == SETSORT_FLOAT) ? new double[count] : NULL;
+	keys.instants = (sortKind == SETSORT_DATETIME) ? new wxLongLong_t[count] : NULL;
+	keys.descending = sortDescending;
+	keys.unreadable = false;
+
+	char point = *localeconv()->decimal_point;
+	dateOrder order = GetDateOrder(set->GetDateStyle());
+
+	// Look up the keys and sort a slice per thread, then merge neighbouring
+	// slices pairwise
+	size_t nSlices = wxMax(1, wxMin((size_t)wxThread::GetCPUCount(), count / SORT_ROWS_PER_THREAD));
+	wxArrayLong sliceStarts;
+	wxArrayPtrVoid threads;
+	size_t slice;
+
+	for (slice = 0 ; slice <= nSlices ; slice++)
+		sliceStarts.Add((long)(count * slice / nSlices));
+
+	for (slice = 0 ; slice < nSlices ; slice++)
+		StartThread(new sortThread(SORTJOB_LOOKUP, set, sorted, sortCol, sortType, order, point, keys, items, tmp,
+		                           sliceStarts.Item(slice), sliceStarts.Item(slice + 1) - sliceStarts.Item(slice)), threads);
+	WaitThreads(threads);
+
+	if (keys.unreadable)
+		keys.kind = SETSORT_TEXT;
+
+	for (slice = 0 ; slice < nSlices && !cancelled ; slice++)
+		StartThread(new sortThread(SORTJOB_SORT, set, sorted, sortCol, sortType, order, point, keys, items, tmp,
+		                           sliceStarts.Item(slice), sliceStarts.Item(slice + 1) - sliceStarts.Item(slice)), threads);
+	WaitThreads(threads);
+
+	while (sliceStarts.GetCount() > 2 && !cancelled)
+	{
+		wxArrayLong merged;
+
+		for (slice = 0 ; slice + 1 < sliceStarts.GetCount() ; slice += 2)
+		{
+			size_t first = sliceStarts.Item(slice);
+			merged.Add((long)first);
+
+			if (slice + 2 < sliceStarts.GetCount())
+				StartThread(new sortThread(SORTJOB_MERGE, set, sorted, sortCol, sortType, order, point, keys, items, tmp,
+				                           first, sliceStarts.Item(slice + 2) - first, sliceStarts.Item(slice + 1) - first), threads);
+		}
+		merged.Add((long)count);
+		WaitThreads(threads);
+
+		sliceStarts = merged;
+	}
+
+	if (!cancelled)
+	{
+		for (size_t i = 0 ; i < count ; i++)
+			rows[i] = sorted[items[i]];
+	}
+
+	delete[] keys.texts;
+	delete[] keys.strings;
+	delete[] keys.numbers;
+	delete[] keys.instants;
+	delete[] tmp;
+	delete[] items;
+	delete[] sorted;
+}
+
+
+bool pgSetIndex::StartBuild(wxEvtHandler *handler)
+{
+	StopBuild();
+
+	builder = new pgSetIndexBuilder(this, handler);
+	if (builder->Create() != wxTHREAD_NO_ERROR || builder->Run() != wxTHREAD_NO_ERROR)
+	{
+		delete builder;
+		builder = NULL;
+		return false;
+	}
+	return true;
+}
+
+
+bool pgSetIndex::GetBuilt(wxArrayInt &rows)
+{
+	// The event of a build stopped since may come in late
+	if (!builder || !builder->done)
+		return false;
+
+	builder->Wait();
+	rows = builder->rows;
+
+	delete builder;
+	builder = NULL;
+	return true;
+}
+
+
+void pgSetIndex::StopBuild()
+{
+	if (!builder)
+		return;
+
+	cancelled = true;
+	builder->Wait();
+	cancelled = false;
+
+	delete builder;
+	builder = NULL;
+}
@@ -0,0 +1,498 @@
+//////////////////////////////////////////////////////////////////////////
+//
+// pgAdmin III - PostgreSQL Tools
+//
+// Copyright (C) 2002 - 2016, The pgAdmin Development Team
+// This software is released under the PostgreSQL Licence
+//
+// pgSetSearch.cpp - Find text in the values of a result
+//
+//////////////////////////////////////////////////////////////////////////
+
+#include "pgAdmin3.h"
+
+// wxWindows headers
+#include <wx/wx.h>
+#include <wx/thread.h>
+#include <wx/regex.h>
+
+// PostgreSQL headers
+#include <libpq-fe.h>
+
+// App headers
+#include "db/pgSetSearch.h"
+#include "utils/utf8.h"
+
+// Fewer cells than this per thread aren't worth one
+#define SEARCH_CELLS_PER_THREAD 100000
+
+// Matches are handed over every so many rows
+#define SEARCH_FLUSH_ROWS       256
+
+// How the values are compared to the pattern
+enum
+{
+	SEARCH_BYTES,           // as encoded by the server
+	SEARCH_ASCII_NOCASE,    // an ASCII pattern, ignoring case
+	SEARCH_WIDE,            // decoded
+	SEARCH_REGEX
+};
+
+
+// The rows a thread scans. Rows before scanned have been looked at, and
+// their matches are in rows and cols, in order.
+class searchPart
+{
+public:
+	long start, end, scanned;
+	wxArrayLong rows;
+	wxArrayInt cols;
+};
+
+
+class searchThread : public wxThread
+{
+public:
+	searchThread(pgSetSearch *_search, searchPart *_part)
+		: wxThread(wxTHREAD_JOINABLE), search(_search), part(_part),
+		  pattern(_search->pattern.c_str()), regex(NULL)
+	{
+	}
+
+	void *Entry();
+
+private:
+	bool Matches(const char *text);
+	void Flush(long scanned);
+
+	pgSetSearch *search;
+	searchPart *part;
+
+	// A copy of its own, as strings can't be shared between threads
+	wxString pattern;
+	wxRegEx *regex;
+
+	wxArrayLong foundRows;
+	wxArrayInt foundCols;
+};
+
+
+// Like strstr, ignoring the case of ASCII letters. The pattern is in lower case.
+static const char *FindNoCase(const char *text, const char *pattern)
+{
+	char first = *pattern;
+
+	for ( ; *text ; text++)
+	{
+		if ((*text | 0x20) != first && *text != first)
+			continue;
+
+		const char *t = text, *p = pattern;
+		while (*p && (*t == *p || (*t >= 'A' && *t <= 'Z' && (*t | 0x20) == *p)))
+		{
+			t++;
+			p++;
+		}
+		if (!*p)
+			return text;
+	}
+	return NULL;
+}
+
+
+bool searchThread::Matches(const char *text)
+{
+	switch (search->mode)
+	{
+		case SEARCH_BYTES:
+			return strstr(text, search->bytes) != NULL;
+
+		case SEARCH_ASCII_NOCASE:
+			return FindNoCase(text, search->bytes) != NULL;
+	}
+
+	wxString str;
+	if (search->set && &search->set->GetConversion() != &wxConvUTF8)
+		str = wxString(text, search->set->GetConversion());
+	else
+		str = DecodeUTF8(text);
+
+	if (search->mode == SEARCH_REGEX)
+		return regex->Matches(str);
+
+	if (!search->matchCase)
+		str.MakeLower();
+	return str.Find(pattern) != wxNOT_FOUND;
+}
+
+
+void searchThread::Flush(long scanned)
+{
+	wxCriticalSectionLocker lock(search->matchLock);
+
+	WX_APPEND_ARRAY(part->rows, foundRows);
+	WX_APPEND_ARRAY(part->cols, foundCols);
+	part->scanned = scanned;
+
+	foundRows.Empty();
+	foundCols.Empty();
+}
+
+
+void *searchThread::Entry()
+{
+	if (search->mode == SEARCH_REGEX)
+	{
+		regex = new wxRegEx(pattern, wxRE_DEFAULT | wxRE_NOSUB | (search->matchCase ? 0 : wxRE_ICASE));
+		if (!regex->IsValid())
+		{
+			delete regex;
+			return 0;
+		}
+	}
+
+	pgSetRow values;
+	wxMemoryBuffer buf;
+	long row;
+
+	for (row = part->start ; row < part->end && !search->cancelled ; row++)
+	{
+		long source = search->SourceRow(row);
+
+		for (int col = 0 ; col < search->nCols ; col++)
+		{
+			if (search->skipped.Index(col) != wxNOT_FOUND)
+				continue;
+
+			const char *text = search->CellText(source, col, values, buf);
+			if (text && Matches(text))
+			{
+				foundRows.Add(row);
+				foundCols.Add(col);
+			}
+		}
+
+		if ((row - part->start) % SEARCH_FLUSH_ROWS == SEARCH_FLUSH_ROWS - 1)
+			Flush(row + 1);
+	}
+
+	if (!search->cancelled)
+		Flush(part->end);
+
+	delete regex;
+	return 0;
+}
+
+
+pgSetSearch::pgSetSearch(pgSet *_set, int _nCols, const wxString &_pattern, bool _matchCase, bool useRegex)
+	: set(_set), nCols(_nCols), mode(-1), matchCase(_matchCase), cancelled(false)
+{
+	if (_pattern.IsEmpty())
+		return;
+
+	if (useRegex)
+	{
+		wxRegEx regex(_pattern, wxRE_DEFAULT | wxRE_NOSUB);
+		if (regex.IsValid())
+		{
+			pattern = _pattern;
+			mode = SEARCH_REGEX;
+		}
+		return;
+	}
+
+	wxMBConv &conv = set ? set->GetConversion() : (wxMBConv &)wxConvUTF8;
+
+	if (!matchCase)
+	{
+		if (!_pattern.IsAscii())
+		{
+			pattern = _pattern.Lower();
+			mode = SEARCH_WIDE;
+			return;
+		}
+		bytes = _pattern.Lower().mb_str(conv);
+		mode = SEARCH_ASCII_NOCASE;
+	}
+	else
+	{
+		bytes = _pattern.mb_str(conv);
+		mode = SEARCH_BYTES;
+	}
+
+	// Not to be had in the encoding of the set
+	if (!bytes.data() || !*bytes.data())
+	{
+		pattern = matchCase ? _pattern : _pattern.Lower();
+		mode = SEARCH_WIDE;
+	}
+}
+
+
+pgSetSearch::~pgSetSearch()
+{
+	Stop();
+
+	for (size_t i = 0 ; i < parts.GetCount() ; i++)
+		delete (searchPart *)parts.Item(i);
+	for (size_t i = 0 ; i < texts.GetCount() ; i++)
+		free(texts.Item(i));
+}
+
+
+void pgSetSearch::AddRow(long setRow)
+{
+	sources.Add(setRow);
+}
+
+
+// Values not in the set are kept like the values of spilled rows: the
+// offsets of the values, -1 if there is none, followed by the values.
+void pgSetSearch::AddTextRow(const wxArrayString &values)
+{
+	wxMBConv &conv = set ? set->GetConversion() : (wxMBConv &)wxConvUTF8;
+	wxArrayPtrVoid encoded;
+	size_t size = nCols * sizeof(wxInt32);
+	int col;
+
+	for (col = 0 ; col < nCols ; col++)
+	{
+		wxCharBuffer *value = NULL;
+		if (col < (int)values.GetCount() && !values.Item(col).IsEmpty())
+		{
+			value = new wxCharBuffer(values.Item(col).mb_str(conv));
+			if (value->data())
+				size += strlen(value->data()) + 1;
+		}
+		encoded.Add(value);
+	}
+
+	char *record = (char *)malloc(size);
+	wxInt32 *offsets = (wxInt32 *)record;
+	size_t offset = nCols * sizeof(wxInt32);
+
+	for (col = 0 ; col < nCols ; col++)
+	{
+		wxCharBuffer *value = (wxCharBuffer *)encoded.Item(col);
+		if (value && value->data())
+		{
+			size_t len = strlen(value->data());
+			memcpy(record + offset, value->data(), len + 1);
+			offsets[col] = (wxInt32)offset;
+			offset += len + 1;
+		}
+		else
+			offsets[col] = -1;
+		delete value;
+	}
+
+	texts.Add(record);
+	sources.Add(-(long)texts.GetCount());
+}
+
+
+void pgSetSearch::SkipColumn(int col)
+{
+	skipped.Add(col);
+}
+
+
+long pgSetSearch::SourceRow(long row) const
+{
+	if (sources.GetCount())
+		return sources.Item(row);
+	return row;
+}
+
+
+const char *pgSetSearch::CellText(long source, int col, pgSetRow &values, wxMemoryBuffer &buf) const
+{
+	if (source < 0)
+	{
+		const char *record = (const char *)texts.Item(-source - 1);
+		wxInt32 offset = ((const wxInt32 *)record)[col];
+		return offset < 0 ? NULL : record + offset;
+	}
+
+	set->SeekRow(source, values);
+	if (values.IsNull(col))
+		return NULL;
+	return set->TextValue(values, col, buf);
+}
+
+
+void pgSetSearch::Start()
+{
+	if (!IsOk() || parts.GetCount())
+		return;
+
+	long nRows = GetRowCount();
+	size_t nParts = wxMax(1, wxMin((size_t)wxThread::GetCPUCount(), (size_t)nRows * nCols / SEARCH_CELLS_PER_THREAD));
+
+	for (size_t i = 0 ; i < nParts ; i++)
+	{
+		searchPart *part = new searchPart;
+		part->start = (long)(nRows * i / nParts);
+		part->end = (long)(nRows * (i + 1) / nParts);
+		part->scanned = part->start;
+		parts.Add(part);
+	}
+
+	for (size_t i = 0 ; i < nParts ; i++)
+	{
+		searchThread *thread = new searchThread(this, (searchPart *)parts.Item(i));
+
+		// Without a thread, do the work here
+		if (thread->Create() != wxTHREAD_NO_ERROR || thread->Run() != wxTHREAD_NO_ERROR)
+		{
+			thread->Entry();
+			delete thread;
+		}
+		else
+			threads.Add(thread);
+	}
+}
+
+
+void pgSetSearch::Stop()
+{
+	cancelled = true;
+
+	for (size_t i = 0 ; i < threads.GetCount() ; i++)
+	{
+		((searchThread *)threads.Item(i))->Wait();
+		delete (searchThread *)threads.Item(i);
+	}
+	threads.Empty();
+}
+
+
+bool pgSetSearch::IsDone() const
+{
+	wxCriticalSectionLocker lock(matchLock);
+
+	for (size_t i = 0 ; i < parts.GetCount() ; i++)
+	{
+		searchPart *part = (searchPart *)parts.Item(i);
+		if (part->scanned < part->end)
+			return false;
+	}
+	return true;
+}
+
+
+long pgSetSearch::GetMatchCount() const
+{
+	wxCriticalSectionLocker lock(matchLock);
+	long count = 0;
+
+	for (size_t i = 0 ; i < parts.GetCount() ; i++)
+		count += ((searchPart *)parts.Item(i))->rows.GetCount();
+	return count;
+}
+
+
+long pgSetSearch::GetRowCount() const
+{
+	if (sources.GetCount())
+		return sources.GetCount();
+	return set ? set->NumRows() : 0;
+}
+
+
+long pgSetSearch::GetRowsScanned() const
+{
+	wxCriticalSectionLocker lock(matchLock);
+	long count = 0;
+
+	for (size_t i = 0 ; i < parts.GetCount() ; i++)
+	{
+		searchPart *part = (searchPart *)parts.Item(i);
+		count += part->scanned - part->start;
+	}
+	return count;
+}
+
+
+// Compare match i of the part to a cell
+static int CompareMatch(const searchPart *part, size_t i, long row, int col)
+{
+	long r = part->rows.Item(i);
+	if (r != row)
+		return r < row ? -1 : 1;
+
+	int c = part->cols.Item(i);
+	return c < col ? -1 : (c > col ? 1 : 0);
+}
+
+
+int pgSetSearch::FindNext(long &row, int &col, bool forward) const
+{
+	wxCriticalSectionLocker lock(matchLock);
+
+	size_t nParts = parts.GetCount();
+	if (!nParts)
+		return PGSETSEARCH_NONE;
+
+	size_t first = 0;
+	while (first + 1 < nParts && ((searchPart *)parts.Item(first + 1))->start <= row)
+		first++;
+
+	// Walk the parts from the position on, and around again to the part
+	// holding it. A part can only tell there's no nearer match once its
+	// rows up to where the match would have to be have been scanned.
+	for (size_t n = 0 ; n <= nParts ; n++)
+	{
+		searchPart *part = (searchPart *)parts.Item(forward ? (first + n) % nParts : (first + nParts - n) % nParts);
+		size_t count = part->rows.GetCount();
+		long found = -1;
+
+		if (n == 0)
+		{
+			// The first match after the position, or the last one before it
+			size_t lo = 0, hi = count;
+			while (lo < hi)
+			{
+				size_t mid = (lo + hi) / 2;
+				int cmp = CompareMatch(part, mid, row, col);
+				if (forward ? cmp <= 0 : cmp < 0)
+					lo = mid + 1;
+				else
+					hi = mid;
+			}
+
+			if (forward && lo < count)
+				found = (long)lo;
+			else if (!forward && lo > 0 && part->scanned > row)
+				found = (long)lo - 1;
+			else if (forward || part->scanned <= row)
+			{
+				if (part->scanned < part->end)
+					return PGSETSEARCH_PENDING;
+			}
+		}
+		else if (forward)
+		{
+			if (count)
+				found = 0;
+			else if (part->scanned < part->end)
+				return PGSETSEARCH_PENDING;
+		}
+		else
+		{
+			if (part->scanned < part->end)
+				return PGSETSEARCH_PENDING;
+			if (count)
+				found = (long)count - 1;
+		}
+
+		if (found >= 0)
+		{
+			row = part->rows.Item(found);
+			col = part->cols.Item(found);
+			return PGSETSEARCH_FOUND;
+		}
+	}
+
+	return PGSETSEARCH_NONE;
+}
@@ -0,0 +1,209 @@
+//////////////////////////////////////////////////////////////////////////
+//
+// pgAdmin III - PostgreSQL Tools
+//
+// Copyright (C) 2002 - 2016, The pgAdmin Development Team
+// This software is released under the PostgreSQL Licence
+//
+// pgSetSpill.cpp - File backed storage for the rows of large results
+//
+//////////////////////////////////////////////////////////////////////////
+
+#include "pgAdmin3.h"
+
+// wxWindows headers
+#include <wx/wx.h>
+
+// PostgreSQL headers
+#include <libpq-fe.h>
+
+// File mapping
+#ifdef __WXMSW__
+#include <windows.h>
+#else
+#include <sys/types.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <stdlib.h>
+#include <stdio.h>
+#endif
+
+// App headers
+#include "db/pgSetSpill.h"
+
+// The file grows by this much at a time. A multiple of the allocation
+// granularity of all platforms, as segments are mapped at such offsets.
+#define SPILL_SEGMENT_SIZE      (64 * 1024 * 1024)
+#define SPILL_GRANULARITY       (64 * 1024)
+
+// Records start on this boundary, so their headers can be read as integers
+#define SPILL_ALIGN             8
+
+
+pgSetSpill::pgSetSpill(const wxString &dir)
+{
+	segment = NULL;
+	segmentUsed = segmentSize = 0;
+	fileSize = 0;
+
+	// No wx file functions, as the spill is created by the thread filling
+	// the set, and no directory guessed either: it's up to the caller
+#ifdef __WXMSW__
+	wchar_t path[MAX_PATH + 1];
+
+	file = INVALID_HANDLE_VALUE;
+	if (!dir.IsEmpty() && GetTempFileNameW(dir.wc_str(), L"pga", 0, path))
+		file = CreateFileW(path, GENERIC_READ | GENERIC_WRITE, 0, NULL, CREATE_ALWAYS,
+		                   FILE_ATTRIBUTE_TEMPORARY | FILE_FLAG_DELETE_ON_CLOSE, NULL);
+#else
+	wxCharBuffer dirBuf = dir.fn_str();
+	char path[1024];
+
+	fd = -1;
+	if (dir.IsEmpty() || !dirBuf.data() ||
+	        snprintf(path, sizeof(path), "%s/pgadmin-result-XXXXXX", dirBuf.data()) >= (int)sizeof(path))
+		return;
+
+	// Nobody else needs to find the file, so it goes right away
+	fd = mkstemp(path);
+	if (fd >= 0)
+		unlink(path);
+#endif
+}
+
+
+pgSetSpill::~pgSetSpill()
+{
+	for (size_t i = 0 ; i < segments.GetCount() ; i++)
+	{
+#ifdef __WXMSW__
+		UnmapViewOfFile(segments.Item(i));
+		CloseHandle((HANDLE)mappings.Item(i));
+#else
+		munmap(segments.Item(i), (size_t)segmentSizes.Item(i));
+#endif
+	}
+
+#ifdef __WXMSW__
+	if (file != INVALID_HANDLE_VALUE)
+		CloseHandle((HANDLE)file);
+#else
+	if (fd >= 0)
+		close(fd);
+#endif
+}
+
+
+bool pgSetSpill::IsOk() const
+{
+#ifdef __WXMSW__
+	return file != INVALID_HANDLE_VALUE;
+#else
+	return fd >= 0;
+#endif
+}
+
+
+bool pgSetSpill::AddSegment(size_t minSize)
+{
+	size_t size = SPILL_SEGMENT_SIZE;
+	if (minSize > size)
+		size = (minSize + SPILL_GRANULARITY - 1) / SPILL_GRANULARITY * SPILL_GRANULARITY;
+
+	void *base;
+
+#ifdef __WXMSW__
+	wxLongLong_t end = fileSize + size;
+
+	// Mapping beyond the end of the file extends it
+	HANDLE mapping = CreateFileMappingA((HANDLE)file, NULL, PAGE_READWRITE, (DWORD)(end >> 32), (DWORD)end, NULL);
+	if (!mapping)
+		return false;
+
+	base = MapViewOfFile(mapping, FILE_MAP_WRITE, (DWORD)(fileSize >> 32), (DWORD)fileSize, size);
+	if (!base)
+	{
+		CloseHandle(mapping);
+		return false;
+	}
+	mappings.Add(mapping);
+#else
+	if (ftruncate(fd, (off_t)(fileSize + size)) != 0)
+		return false;
+
+	base = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, (off_t)fileSize);
+	if (base == MAP_FAILED)
+		return false;
+
+	// Start writing the full segment back, so its pages can be dropped
+	// from memory when needed instead of piling up
+	if (segment)
+		msync(segment, segmentSize, MS_ASYNC);
+#endif
+
+	segments.Add(base);
+	segmentSizes.Add((long)size);
+
+	segment = (char *)base;
+	segmentUsed = 0;
+	segmentSize = size;
+	fileSize += size;
+
+	return true;
+}
+
+
+const char **pgSetSpill::Append(PGresult *chunk)
+{
+	if (!IsOk())
+		return NULL;
+
+	int nRows = PQntuples(chunk), nCols = PQnfields(chunk);
+	size_t header = nCols * 2 * sizeof(wxInt32);
+
+	// The index goes first, filled in as the records are written
+	size_t indexSize = (nRows * sizeof(char *) + SPILL_ALIGN - 1) / SPILL_ALIGN * SPILL_ALIGN;
+	if (segmentUsed + indexSize > segmentSize && !AddSegment(indexSize))
+		return NULL;
+
+	const char **records = (const char **)(segment + segmentUsed);
+	segmentUsed += indexSize;
+
+	for (int row = 0 ; row < nRows ; row++)
+	{
+		size_t size = header;
+		int col;
+
+		for (col = 0 ; col < nCols ; col++)
+			size += PQgetlength(chunk, row, col) + 1;
+		size = (size + SPILL_ALIGN - 1) / SPILL_ALIGN * SPILL_ALIGN;
+
+		// Offsets are 32 bits
+		if (size > 0x7fffffff)
+			return NULL;
+
+		if (segmentUsed + size > segmentSize && !AddSegment(size))
+			return NULL;
+
+		char *record = segment + segmentUsed;
+		wxInt32 *entries = (wxInt32 *)record;
+		size_t offset = header;
+
+		for (col = 0 ; col < nCols ; col++)
+		{
+			int len = PQgetlength(chunk, row, col);
+
+			entries[col * 2] = PQgetisnull(chunk, row, col) ? -1 : len;
+			entries[col * 2 + 1] = (wxInt32)offset;
+
+			memcpy(record + offset, PQgetvalue(chunk, row, col), len);
+			record[offset + len] = 0;
+			offset += len + 1;
+		}
+
+		records[row] = record;
+		segmentUsed += size;
+	}
+
+	return records;
+}
@@ -0,0 +1,235 @@
+//////////////////////////////////////////////////////////////////////////
+//
+// pgAdmin III - PostgreSQL Tools
+//
+// Copyright (C) 2002 - 2016, The pgAdmin Development Team
+// This software is released under the PostgreSQL Licence
+//
+// pgSetStats.cpp - Summary of the numbers in part of a result
+//
+//////////////////////////////////////////////////////////////////////////
+
+#include "pgAdmin3.h"
+
+// wxWindows headers
+#include <wx/wx.h>
+#include <wx/thread.h>
+#include <wx/hashset.h>
+
+// PostgreSQL headers
+#include <libpq-fe.h>
+
+#include <locale.h>
+
+// App headers
+#include "db/pgSetStats.h"
+
+const wxEventType SetStatsDoneEvent = wxNewEventType();
+
+// Up to this many digits fit a 64 bit integer whatever they are
+#define STATS_MAX_DIGITS    19
+
+// Integers up to 2^53 convert to a double exactly
+#define STATS_MAX_EXACT     wxULL(9007199254740992)
+
+// Powers of ten up to 10^22 are doubles exactly
+static const double exactPowers[] =
+{
+	1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+	1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+
+// Distinct numbers, with 0 and -0 taken as the same
+class statsNumberHash
+{
+public:
+	statsNumberHash() {}
+	unsigned long operator()(double number) const
+	{
+		wxUint64 bits;
+		memcpy(&bits, &number, sizeof(bits));
+		return (unsigned long)(bits ^ (bits >> 32));
+	}
+	statsNumberHash &operator=(const statsNumberHash &)
+	{
+		return *this;
+	}
+};
+
+class statsNumberEqual
+{
+public:
+	statsNumberEqual() {}
+	bool operator()(double a, double b) const
+	{
+		return a == b;
+	}
+	statsNumberEqual &operator=(const statsNumberEqual &)
+	{
+		return *this;
+	}
+};
+
+WX_DECLARE_HASH_SET(double, statsNumberHash, statsNumberEqual, statsNumberSet);
+
+
+#if wxBYTE_ORDER == wxLITTLE_ENDIAN
+// Eight digits at a time: each is checked and added in as a byte of a
+// 64 bit word, rather than one by one
+static inline bool IsEightDigits(const char *text)
+{
+	wxUint64 word;
+	memcpy(&word, text, sizeof(word));
+	return ((word & wxULL(0xF0F0F0F0F0F0F0F0)) |
+	        (((word + wxULL(0x0606060606060606)) & wxULL(0xF0F0F0F0F0F0F0F0)) >> 4)) == wxULL(0x3333333333333333);
+}
+
+static inline wxUint32 ParseEightDigits(const char *text)
+{
+	wxUint64 word;
+	memcpy(&word, text, sizeof(word));
+	word = ((word & wxULL(0x0F0F0F0F0F0F0F0F)) * 2561) >> 8;
+	word = ((word & wxULL(0x00FF00FF00FF00FF)) * 6553601) >> 16;
+	return (wxUint32)(((word & wxULL(0x0000FFFF0000FFFF)) * wxULL(42949672960001)) >> 32);
+}
+#endif
+
+
+// Adds the digits from p on to the mantissa, false once there are too many
+static inline bool ScanDigits(const char *&p, const char *end, wxUint64 &mantissa, int &digits)
+{
+#if wxBYTE_ORDER == wxLITTLE_ENDIAN
+	while (end - p >= 8 && IsEightDigits(p))
+	{
+		digits += 8;
+		if (digits > STATS_MAX_DIGITS)
+			return false;
+		mantissa = mantissa * 100000000 + ParseEightDigits(p);
+		p += 8;
+	}
+#endif
+	while (p < end && *p >= '0' && *p <= '9')
+	{
+		if (++digits > STATS_MAX_DIGITS)
+			return false;
+		mantissa = mantissa * 10 + (*p++ - '0');
+	}
+	return true;
+}
+
+
+// The number a value of a numeric column stands for. Plain decimals, by far
+// the most common, are taken care of here; exponents, long numbers and the
+// like are left to strtod.
+static bool ParseNumber(const char *text, int len, char point, double &number)
+{
+	const char *p = text, *end = text + len;
+	bool negative = (p < end && *p == '-');
+	if (negative)
+		p++;
+
+	wxUint64 mantissa = 0;
+	int digits = 0, fraction = 0;
+
+	if (ScanDigits(p, end, mantissa, digits) && (p == end || *p == '.'))
+	{
+		bool ok = true;
+		if (p < end)
+		{
+			p++;
+			int intDigits = digits;
+			ok = ScanDigits(p, end, mantissa, digits);
+			fraction = digits - intDigits;
+		}
+		if (ok && p == end && digits && mantissa <= STATS_MAX_EXACT && fraction < (int)WXSIZEOF(exactPowers))
+		{
+			number = (double)mantissa / exactPowers[fraction];
+			if (negative)
+				number = -number;
+			return true;
+		}
+	}
+
+	// Numbers come with a decimal point, strtod wants the one of the
+	// C library's locale
+	const char *dot = (point != '.') ? strchr(text, '.') : NULL;
+	char *stop;
+
+	if (!dot)
+	{
+		number = strtod(text, &stop);
+		return len && stop == end;
+	}
+
+	char buf[64], *copy = (len < (int)sizeof(buf)) ? buf : (char *)malloc(len + 1);
+
+	memcpy(copy, text, len + 1);
+	copy[dot - text] = point;
+	number = strtod(copy, &stop);
+	bool ok = (stop == copy + len);
+
+	if (copy != buf)
+		free(copy);
+	return ok;
+}
+
+
+pgSetStats::pgSetStats(pgSet *_set, const wxArrayInt &_rows, const wxArrayInt &_cols, wxEvtHandler *_handler)
+	: wxThread(wxTHREAD_JOINABLE), count(0), distinct(0), sum(0), min(0), max(0),
+	  set(_set), rows(_rows), cols(_cols), handler(_handler), cancelled(false), done(false)
+{
+}
+
+
+void *pgSetStats::Entry()
+{
+	char point = *localeconv()->decimal_point;
+	statsNumberSet numbers;
+	pgSetRow values;
+
+	// Compensated, so long columns of decimals add up to what they should
+	double compensation = 0;
+
+	for (size_t i = 0 ; i < rows.GetCount() && !cancelled ; i++)
+	{
+		set->SeekRow(rows.Item(i), values);
+
+		for (size_t c = 0 ; c < cols.GetCount() ; c++)
+		{
+			int col = cols.Item(c);
+			if (values.IsNull(col))
+				continue;
+
+			double number;
+			if (!ParseNumber(values.Value(col), values.Length(col), point, number) || number != number)
+				continue;
+
+			if (!count++)
+				min = max = number;
+			else if (number < min)
+				min = number;
+			else if (number > max)
+				max = number;
+
+			double term = number - compensation;
+			double total = sum + term;
+			compensation = (total - sum) - term;
+			sum = total;
+
+			if (number == 0)
+				number = 0;
+			numbers.insert(number);
+		}
+	}
+
+	distinct = (long)numbers.size();
+	done = true;
+
+	if (handler && !cancelled)
+	{
+		wxCommandEvent ev(SetStatsDoneEvent);
+		handler->AddPendingEvent(ev);
+	}
+	return NULL;
+}
@@ -413,6 +413,9 @@ bool dbgController::Start()
 	m_dbgThread = new pgQueryThread(
 	    m_dbgConn, this, &(dbgController::NoticeHandler), this);
 	m_dbgThread->SetEventOnCancellation(false);
+	// The debugger commands are single statements, several of them get
+	// queued at a time whenever the target stops
+	m_dbgThread->SetPipelining(true);
 
 	if (m_dbgThread->Create() != wxTHREAD_NO_ERROR)
 	{
@@ -23,6 +23,7 @@
 #include "utils/pgDefs.h"
 #include "ctl/ctlSecurityPanel.h"
 #include "ctl/ctlDefaultSecurityPanel.h"
+#include "db/pgQueryProfiler.h"
 
 // Images
 #include "images/properties.pngc"
@@ -1048,6 +1049,8 @@ wxArrayString dlgProperty::SplitQueries(const wxString &sql)
 
 void dlgProperty::OnOK(wxCommandEvent &ev)
 {
+	pgProfilerSite site(dlgName + wxT("::OnOK"));
+
 #ifdef __WXGTK__
 	if (!btnOK->IsEnabled())
 		return;
@@ -1241,6 +1244,8 @@ bool dlgProperty::CreateObjectDialog(frmMain *frame, pgObject *node, pgaFactory
 		{
 			dlg->SetTitle(wxGetTranslation(dlg->factory->GetNewString()));
 
+			pgProfilerSite site(dlg->dlgName);
+
 			dlg->CreateAdditionalPages();
 			dlg->Go();
 			dlg->CheckChange();
@@ -1286,6 +1291,8 @@ bool dlgProperty::EditObjectDialog(frmMain *frame, ctlSQLBox *sqlbox, pgObject *
 			wxString typeName = dlg->factory->GetTypeName();
 			dlg->SetTitle(wxString(wxGetTranslation(typeName)) + wxT(" ") + node->GetFullIdentifier());
 
+			pgProfilerSite site(dlg->dlgName);
+
 			dlg->CreateAdditionalPages();
 			dlg->Go();
 
@@ -30,8 +30,10 @@
 #include "ctl/ctlSQLBox.h"
 #include "ctl/ctlMenuToolbar.h"
 #include "db/pgConn.h"
+#include "db/pgConnMonitor.h"
 #include "schema/pgDatabase.h"
 #include "db/pgSet.h"
+#include "db/pgQueryProfiler.h"
 #include "schema/pgServer.h"
 #include "schema/pgObject.h"
 #include "schema/pgCollection.h"
@@ -82,6 +84,8 @@ BEGIN_EVENT_TABLE(frmMain, pgFrame)
 	EVT_TREE_KEY_DOWN(CTL_BROWSER,          frmMain::OnTreeKeyDown)
 #endif
 
+	EVT_COMMAND (wxID_ANY, PGConnStatusEvent, frmMain::OnConnStatus)
+
 #if defined(HAVE_OPENSSL_CRYPTO) || defined(HAVE_GCRYPT)
 	EVT_COMMAND (wxID_ANY, SSH_TUNNEL_ERROR_EVENT, frmMain::OnSSHTunnelEvent)
 #endif
@@ -289,6 +293,15 @@ void frmMain::OnCheckAlive(wxCommandEvent &event)
 }
 
 
+// A connection was found lost by the connection monitor. It may not belong
+// to the browser, and may even be gone by now, so just check ours.
+void frmMain::OnConnStatus(wxCommandEvent &event)
+{
+	if (event.GetInt() == PGCONN_BROKEN)
+		CheckAlive();
+}
+
+
 
 void frmMain::OnPropSelChanged(wxListEvent &event)
 {
@@ -394,6 +407,10 @@ void frmMain::OnTreeSelChanged(wxTreeEvent &event)
 // Reset the list controls
 void frmMain::ResetLists()
 {
+	properties->ClearAsync();
+	statistics->ClearAsync();
+	dependencies->ClearAsync();
+	dependents->ClearAsync();
 	properties->ClearAll();
 	properties->AddColumn(_("Properties"), properties->GetSize().GetWidth() - 10);
 	properties->InsertItem(0, _("No properties are available for the current selection"), PGICON_PROPERTY);
@@ -470,6 +487,7 @@ void frmMain::execSelChange(wxTreeItemId item, bool currentNode)
 						return;
 					}
 
+					pgProfilerSite site(currentObject->GetTypeName() + wxT("::Refresh"));
 					pgObject *newData = currentObject->Refresh(browser, currentItem);
 
 					if (newData != 0)
@@ -518,6 +536,8 @@ void frmMain::setDisplay(pgObject *data, ctlListView *props, ctlSQLBox *sqlbox)
 {
 	pgServer *server = 0;
 
+	// The queries run for the display are profiled as the object's
+	pgProfilerSite site(data->GetTypeName() + wxT("::ShowTree"));
 
 	bool showTree = false;
 
@@ -542,6 +562,8 @@ void frmMain::setDisplay(pgObject *data, ctlListView *props, ctlSQLBox *sqlbox)
 
 	if (sqlbox)
 	{
+		pgProfilerSite sqlSite(data->GetTypeName() + wxT("::GetSql"));
+
 		sqlbox->SetReadOnly(false);
 		sqlbox->SetText(data->GetSql(browser));
 		sqlbox->SetReadOnly(true);
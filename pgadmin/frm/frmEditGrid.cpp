@@ -19,6 +19,7 @@
 #include "frm/frmMain.h"
 #include "frm/menu.h"
 #include "db/pgQueryThread.h"
+#include "db/pgSetSearch.h"
 
 #include <wx/generic/gridctrl.h>
 #include <wx/clipbrd.h>
@@ -26,6 +27,7 @@
 #include "frm/frmAbout.h"
 #include "frm/frmEditGrid.h"
 #include "ctl/ctlMenuToolbar.h"
+#include "ctl/ctlResultFindBar.h"
 #include "dlg/dlgEditGridOptions.h"
 #include "frm/frmHint.h"
 #include "schema/pgCatalogObject.h"
@@ -69,6 +71,7 @@ BEGIN_EVENT_TABLE(frmEditGrid, pgFrame)
 	EVT_MENU(MNU_CONTENTS,      frmEditGrid::OnContents)
 	EVT_MENU(MNU_COPY,          frmEditGrid::OnCopy)
 	EVT_MENU(MNU_PASTE,         frmEditGrid::OnPaste)
+	EVT_MENU(MNU_FIND,          frmEditGrid::OnFind)
 	EVT_MENU(MNU_LIMITBAR,      frmEditGrid::OnToggleLimitBar)
 	EVT_MENU(MNU_TOOLBAR,       frmEditGrid::OnToggleToolBar)
 	EVT_MENU(MNU_SCRATCHPAD,    frmEditGrid::OnToggleScratchPad)
@@ -114,6 +117,7 @@ frmEditGrid::frmEditGrid(frmMain *form, const wxString &_title, pgConn *_conn, p
 
 	sqlGrid = new ctlSQLEditGrid(this, CTL_EDITGRID, wxDefaultPosition, wxDefaultSize);
 	sqlGrid->SetTable(0);
+	findBar = new ctlResultFindBar(this, sqlGrid);
 #ifdef __WXMSW__
 	sqlGrid->SetDefaultRowSize(sqlGrid->GetDefaultRowSize() + 2, true);
 #endif
@@ -174,6 +178,8 @@ frmEditGrid::frmEditGrid(frmMain *form, const wxString &_title, pgConn *_conn, p
 	editMenu->Append(MNU_COPY, _("&Copy\tCtrl-C"), _("Copy selected cells to clipboard."));
 	editMenu->Append(MNU_PASTE, _("&Paste\tCtrl-V"), _("Paste data from the clipboard."));
 	editMenu->Append(MNU_DELETE, _("&Delete"), _("Delete selected rows."));
+	editMenu->AppendSeparator();
+	editMenu->Append(MNU_FIND, _("&Find\tCtrl-F"), _("Find text in the data."));
 	editMenu->Enable(MNU_UNDO, false);
 	editMenu->Enable(MNU_DELETE, false);
 
@@ -222,7 +228,7 @@ frmEditGrid::frmEditGrid(frmMain *form, const wxString &_title, pgConn *_conn, p
 	SetMenuBar(menuBar);
 
 	// Accelerators
-	wxAcceleratorEntry entries[8];
+	wxAcceleratorEntry entries[9];
 
 	entries[0].Set(wxACCEL_CTRL,                (int)'S',      MNU_SAVE);
 	entries[1].Set(wxACCEL_NORMAL,              WXK_F5,        MNU_REFRESH);
@@ -232,8 +238,9 @@ frmEditGrid::frmEditGrid(frmMain *form, const wxString &_title, pgConn *_conn, p
 	entries[5].Set(wxACCEL_CTRL,                (int)'V',      MNU_PASTE);
 	entries[6].Set(wxACCEL_NORMAL,              WXK_DELETE,    MNU_DELETE);
 	entries[7].Set(wxACCEL_CTRL,                (int)'W',      MNU_CLOSE);
+	entries[8].Set(wxACCEL_CTRL,                (int)'F',      MNU_FIND);
 
-	wxAcceleratorTable accel(8, entries);
+	wxAcceleratorTable accel(9, entries);
 	SetAcceleratorTable(accel);
 	sqlGrid->SetAcceleratorTable(accel);
 
@@ -242,6 +249,7 @@ frmEditGrid::frmEditGrid(frmMain *form, const wxString &_title, pgConn *_conn, p
 	manager.AddPane(cbLimit, wxAuiPaneInfo().Name(wxT("limitBar")).Caption(_("Limit bar")).ToolbarPane().Top().LeftDockable(false).RightDockable(false));
 	manager.AddPane(sqlGrid, wxAuiPaneInfo().Name(wxT("sqlGrid")).Caption(_("Data grid")).Center().CaptionVisible(false).CloseButton(false).MinSize(wxSize(200, 100)).BestSize(wxSize(300, 200)));
 	manager.AddPane(scratchPad, wxAuiPaneInfo().Name(wxT("scratchPad")).Caption(_("Scratch pad")).Bottom().MinSize(wxSize(200, 100)).BestSize(wxSize(300, 150)));
+	manager.AddPane(findBar, wxAuiPaneInfo().Name(wxT("findBar")).Caption(_("Find")).Bottom().Layer(1).CaptionVisible(false).CloseButton(false).Floatable(false).Hide());
 
 	// Now load the layout
 	wxString perspective;
@@ -857,6 +865,13 @@ void frmEditGrid::OnPaste(wxCommandEvent &ev)
 	}
 }
 
+void frmEditGrid::OnFind(wxCommandEvent &ev)
+{
+	manager.GetPane(wxT("findBar")).Show(true);
+	manager.Update();
+	findBar->Activate();
+}
+
 void frmEditGrid::OnHelp(wxCommandEvent &ev)
 {
 	DisplayHelp(wxT("editgrid"), HELP_PGADMIN);
@@ -1412,6 +1427,11 @@ void frmEditGrid::Go()
 		qry += wxT(" LIMIT ") + wxString::Format(wxT("%i"), limit);
 
 	thread = new pgQueryThread(connection, qry);
+
+	// Only the visible cells are ever rendered, so let the server send
+	// numbers, dates and bytea in their binary format if it can
+	thread->SetBinaryResults(true);
+
 	if (thread->Create() != wxTHREAD_NO_ERROR)
 	{
 		Abort();
@@ -1483,6 +1503,7 @@ void frmEditGrid::Go()
 	// !!! Is it still required?
 	//sqlGrid->SetSize(10, 10);
 
+	sqlGrid->StopSearch();
 	sqlGrid->SetTable(new sqlTable(connection, thread, tableName, relid, hasOids, primaryKeyColNumbers, relkind), true);
 	sqlGrid->AutoSizeColumns(false);
 
@@ -1526,6 +1547,7 @@ frmEditGrid::~frmEditGrid()
 
 void frmEditGrid::Abort()
 {
+	sqlGrid->StopSearch();
 	if (sqlGrid->GetTable())
 	{
 		sqlGrid->HideCellEditControl();
@@ -2489,6 +2511,7 @@ sqlTable::sqlTable(pgConn *conn, pgQueryThread *_thread, const wxString &tabName
 		// um, we never should reach here because this would mean
 		// that datatypes are unreadable.
 		// *if* we reach here, namespace info is missing.
+		thread->DataSet()->ResolveColTypes();
 		for (i = 0 ; i < nCols ; i++)
 		{
 			columns[i].typeName = thread->DataSet()->ColType(i);
@@ -2551,6 +2574,49 @@ bool ctlSQLEditGrid::IsColText(int col)
 	return GetTable()->IsColText(col);
 }
 
+// Rows read into the cache are searched as shown, with any changes, the
+// others as they are in the data set.
+pgSetSearch *ctlSQLEditGrid::CreateSearch(const wxString &pattern, bool matchCase, bool useRegex)
+{
+	sqlTable *table = GetTable();
+	if (!table)
+		return NULL;
+
+	pgSet *set = table->thread ? table->thread->DataSet() : NULL;
+	pgSetSearch *search = new pgSetSearch(set, table->nCols, pattern, matchCase, useRegex);
+	if (!search->IsOk())
+		return search;
+
+	int row, col;
+	for (col = 0 ; col < table->nCols ; col++)
+	{
+		if (table->columns[col].type == PGOID_TYPE_BYTEA)
+			search->SkipColumn(col);
+	}
+
+	int storedRows = table->nRows - table->rowsDeleted;
+	for (row = 0 ; row < table->GetNumberRows() ; row++)
+	{
+		cacheLinePool *pool = (row < storedRows) ? table->dataPool : table->addPool;
+		int lineNo = (row < storedRows) ? table->lineIndex[row] : row - storedRows;
+		cacheLine *line = pool->IsFilled(lineNo) ? pool->Get(lineNo) : NULL;
+
+		if (line && line->cols)
+		{
+			wxArrayString values;
+			for (col = 0 ; col < table->nCols ; col++)
+				values.Add(line->cols[col]);
+			search->AddTextRow(values);
+		}
+		else if (row < storedRows && set)
+			search->AddRow(lineNo);
+		else
+			search->AddTextRow(wxArrayString());
+	}
+
+	return search;
+}
+
 bool sqlTable::IsColText(int col)
 {
 	return !columns[col].numeric && !(columns[col].type == PGOID_TYPE_BOOL);
@@ -2836,6 +2902,8 @@ bool sqlTable::StoreLine()
 
 void sqlTable::SetValue(int row, int col, const wxString &value)
 {
+	((ctlSQLGrid *)GetView())->StopSearch();
+
 	cacheLine *line = GetLine(row);
 
 	if (!line)
@@ -2910,7 +2978,7 @@ wxString sqlTable::GetValue(int row, int col)
 			for (i = 0 ; i < nCols ; i++)
 			{
 				wxString val;
-				if (thread->DataSet()->ColType(i) == wxT("bytea"))
+				if (thread->DataSet()->ColTypeOid(i) == PGOID_TYPE_BYTEA)
 					val = _("<binary data>");
 				else
 				{
@@ -2929,6 +2997,8 @@ wxString sqlTable::GetValue(int row, int col)
 
 			if (rowsCached == nRows)
 			{
+				// A search may still be reading the data set
+				((ctlSQLGrid *)GetView())->StopSearch();
 				delete thread;
 				thread = 0;
 			}
@@ -2946,6 +3016,8 @@ wxString sqlTable::GetValue(int row, int col)
 
 bool sqlTable::AppendRows(size_t rows)
 {
+	((ctlSQLGrid *)GetView())->StopSearch();
+
 	rowsAdded += rows;
 	GetLine(nRows + rowsAdded - rowsDeleted - 1);
 
@@ -2958,6 +3030,8 @@ bool sqlTable::AppendRows(size_t rows)
 
 bool sqlTable::DeleteRows(size_t pos, size_t rows)
 {
+	((ctlSQLGrid *)GetView())->StopSearch();
+
 	size_t i = pos;
 	size_t rowsDone = 0;
 
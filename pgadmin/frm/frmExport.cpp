@@ -17,7 +17,11 @@
 #include "frm/frmExport.h"
 #include "utils/sysSettings.h"
 #include "utils/misc.h"
-#include "ctl/ctlSQLResult.h"
+#include "utils/dataFile.h"
+#include "utils/utf8.h"
+#include "utils/workerProgress.h"
+#include "db/pgSet.h"
+#include "db/pgConn.h"
 
 #define txtFilename     CTRL_TEXT("txtFilename")
 #define btnOK           CTRL_BUTTON("wxID_OK")
@@ -32,6 +36,9 @@
 #define cbColSeparator  CTRL_COMBOBOX("cbColSeparator")
 #define cbQuoteChar     CTRL_COMBOBOX("cbQuoteChar")
 
+// The export thread reports its progress every so many rows
+#define EXPORT_PROGRESS_ROWS    1000
+
 
 BEGIN_EVENT_TABLE(frmExport, pgDialog)
 	EVT_TEXT(XRCID("txtFilename"),          frmExport::OnChange)
@@ -109,6 +116,12 @@ void frmExport::OnChange(wxCommandEvent &ev)
 
 void frmExport::OnOK(wxCommandEvent &ev)
 {
+	if (!IsDataFileCompressionSupported(GetDataFileCompression(txtFilename->GetValue())))
+	{
+		wxMessageBox(_("This version of pgAdmin can't write zstd compressed files."), _("Export data"), wxICON_WARNING | wxOK, this);
+		return;
+	}
+
 	settings->SetExportUnicode(rbUnicode->GetValue());
 	settings->SetExportRowSeparator(rbCRLF->GetValue() ? wxT("\r\n") : wxT("\n"));
 	settings->SetExportColSeparator(cbColSeparator->GetValue());
@@ -133,158 +146,288 @@ void frmExport::OnOK(wxCommandEvent &ev)
 
 
 
-bool frmExport::Export(pgSet *set)
+// Writes the rows of a result to the file, reading them straight from the
+// set. The text is put together as bytes of the file's encoding, a row at a
+// time; values already in it, as UTF-8 from a UTF-8 connection is, are
+// copied as they are. Rows that can't be converted are left out.
+class exportThread : public wxThread
 {
-	ctlSQLResult *grid = 0;
-	if (!set)
+public:
+	exportThread(pgSet *_set, const wxArrayInt &_rows, dataFileWriter &_file, bool _unicode,
+	             const wxCharBuffer &_separator, const wxCharBuffer &_quoteChar, const wxCharBuffer &_endOfLine,
+	             const wxArrayInt &_quoted, const wxArrayInt &_scanned, workerProgress *_progress);
+
+	void *Entry();
+
+	long RowsDone() const
 	{
-		wxLogInfo(wxT("Exporting data from the grid"));
-		grid = (ctlSQLResult *)parent;
+		return rowsDone;
+	}
+	long RowsSkipped() const
+	{
+		return skipped;
 	}
-	else
-		wxLogInfo(wxT("Exporting data from a resultset"));
 
-	wxFile file(txtFilename->GetValue(), wxFile::write);
-	if (!file.IsOpened())
+private:
+	void Append(const char *data, size_t len)
 	{
-		wxLogError(__("Failed to open file %s."), txtFilename->GetValue().c_str());
-		return false;
+		line.AppendData(data, len);
 	}
+	void AppendValue(const char *value, size_t len, int col);
+	bool AppendConverted(const char *value, size_t len, int col);
 
-	wxString line;
-	long skipped = 0;
-	wxWX2MBbuf buf;
+	pgSet *set;
+	wxArrayInt rows, quoted, scanned;
+	dataFileWriter &file;
+	bool unicode, direct;
+
+	wxCharBuffer separator, quoteChar, endOfLine;
+	size_t separatorLen, quoteLen, endOfLineLen;
+
+	pgSetRow values;
+	wxMemoryBuffer line, rendered, encoded;
+
+	workerProgress *progress;
+	long rowsDone, skipped;
+};
+
+
+exportThread::exportThread(pgSet *_set, const wxArrayInt &_rows, dataFileWriter &_file, bool _unicode,
+                           const wxCharBuffer &_separator, const wxCharBuffer &_quoteChar, const wxCharBuffer &_endOfLine,
+                           const wxArrayInt &_quoted, const wxArrayInt &_scanned, workerProgress *_progress)
+	: wxThread(wxTHREAD_JOINABLE), set(_set), rows(_rows), quoted(_quoted), scanned(_scanned), file(_file),
+	  unicode(_unicode), separator(_separator), quoteChar(_quoteChar), endOfLine(_endOfLine),
+	  progress(_progress), rowsDone(0), skipped(0)
+{
+	separatorLen = strlen(separator);
+	quoteLen = strlen(quoteChar);
+	endOfLineLen = strlen(endOfLine);
+
+	direct = unicode && &set->GetConversion() == &wxConvUTF8;
+}
 
-	int colCount, rowCount;
 
-	if (set)
+void exportThread::AppendValue(const char *value, size_t len, int col)
+{
+	if (!quoted.Item(col))
 	{
-		colCount = set->NumCols();
-		rowCount = set->NumRows();
+		Append(value, len);
+		return;
+	}
+
+	Append(quoteChar, quoteLen);
+
+	// Quotes within the value are doubled. Numbers and booleans can't
+	// hold any, so they aren't looked through.
+	if (scanned.Item(col) && quoteLen)
+	{
+		const char *end = value + len, *quote;
+		while ((quote = (const char *)memchr(value, *(const char *)quoteChar, end - value)) != NULL)
+		{
+			if ((size_t)(end - quote) >= quoteLen && !memcmp(quote, quoteChar, quoteLen))
+			{
+				Append(value, quote - value + quoteLen);
+				Append(quoteChar, quoteLen);
+				value = quote + quoteLen;
+			}
+			else
+			{
+				Append(value, quote - value + 1);
+				value = quote + 1;
+			}
+		}
+		len = end - value;
 	}
+
+	Append(value, len);
+	Append(quoteChar, quoteLen);
+}
+
+
+bool exportThread::AppendConverted(const char *value, size_t len, int col)
+{
+	wxString text;
+	if (&set->GetConversion() == &wxConvUTF8)
+		text = DecodeUTF8(value, len);
 	else
+		text = wxString(value, set->GetConversion());
+
+	if (unicode)
 	{
-		colCount = grid->GetNumberCols();
-		rowCount = grid->NumRows();
+		encoded.SetDataLen(0);
+		EncodeUTF8(text, encoded);
+		AppendValue((const char *)encoded.GetData(), encoded.GetDataLen(), col);
+		return true;
 	}
 
-	int col;
-	if (chkColnames->GetValue())
+	wxCharBuffer local = text.mb_str(wxConvLibc);
+	if (!local)
+		return false;
+
+	AppendValue(local, strlen(local), col);
+	return true;
+}
+
+
+void *exportThread::Entry()
+{
+	long nRows = rows.IsEmpty() ? set->NumRows() : (long)rows.GetCount();
+	int nCols = set->NumCols();
+
+	for (long row = 0 ; row < nRows && !progress->IsCancelled() ; row++)
 	{
-		for (col = 0 ; col < colCount ; col++)
+		set->SeekRow(rows.IsEmpty() ? row : rows.Item(row), values);
+		line.SetDataLen(0);
+
+		bool ok = true;
+		for (int col = 0 ; col < nCols && ok ; col++)
 		{
-			if (!col)
-				line = wxEmptyString;
-			else
-				line += cbColSeparator->GetValue();
+			if (col)
+				Append(separator, separatorLen);
 
-			if (rbQuoteStrings->GetValue() || rbQuoteAll->GetValue())
+			// NULLs are written as empty values
+			if (values.IsNull(col))
 			{
-				wxString qc = cbQuoteChar->GetValue();
+				AppendValue("", 0, col);
+				continue;
+			}
 
-				wxString hdr;
-				if (set)
-					hdr = set->ColName(col);
-				else
-					hdr = grid->OnGetItemText(-1, col + 1).BeforeFirst('\n');
+			const char *value = set->TextValue(values, col, rendered);
+			size_t len = set->IsBinary() ? strlen(value) : (size_t)values.Length(col);
 
-				hdr.Replace(qc, qc + qc);
-				line += qc + hdr + qc;
-			}
+			if (direct)
+				AppendValue(value, len, col);
 			else
-			{
-				if (set)
-					line += set->ColName(col);
-				else
-					line += grid->OnGetItemText(-1, col + 1).BeforeFirst('\n');
-			}
+				ok = AppendConverted(value, len, col);
 		}
-		if (rbCRLF->GetValue())
-			line += wxT("\r\n");
-		else
-			line += wxT("\n");
 
-		if (rbUnicode->GetValue())
-			file.Write(line, wxConvUTF8);
-		else
+		if (ok)
 		{
-			buf = line.mb_str(wxConvLibc);
-			if (!buf)
-				skipped++;
-			else
-				file.Write(line, wxConvLibc);
+			Append(endOfLine, endOfLineLen);
+			if (!file.Write(line.GetData(), line.GetDataLen()))
+				break;
 		}
+		else
+			skipped++;
+
+		if (++rowsDone % EXPORT_PROGRESS_ROWS == 0)
+			progress->Update((int)rowsDone);
 	}
 
+	progress->Done();
+	return 0;
+}
 
-	wxString text;
-	OID typOid;
 
-	int row;
-	for (row = 0 ; row < rowCount ; row++)
+bool frmExport::Export(pgSet *set, const wxArrayInt &rows)
+{
+	if (!set)
+		return false;
+
+	bool unicode = rbUnicode->GetValue();
+	wxMBConv &conv = unicode ? (wxMBConv &)wxConvUTF8 : (wxMBConv &)wxConvLibc;
+
+	wxString sep = cbColSeparator->GetValue();
+	wxString qc = (rbQuoteStrings->GetValue() || rbQuoteAll->GetValue()) ? cbQuoteChar->GetValue() : wxString();
+	wxString eol = rbCRLF->GetValue() ? wxT("\r\n") : wxT("\n");
+
+	wxCharBuffer separator = sep.mb_str(conv), quoteChar = qc.mb_str(conv), endOfLine = eol.mb_str(conv);
+	if (!separator || !quoteChar)
 	{
-		for (col = 0 ; col < colCount ; col++)
+		wxLogError(_("The column separator or quote character can not be converted to the local charset."));
+		return false;
+	}
+
+	long skipped = 0;
+	int col, colCount = set->NumCols();
+	long rowCount = rows.IsEmpty() ? set->NumRows() : (long)rows.GetCount();
+
+	// Quoting is decided per column, up front
+	wxArrayInt quoted, scanned;
+	for (col = 0 ; col < colCount ; col++)
+	{
+		bool numeric = false;
+		switch (set->ColTypClass(col))
 		{
-			if (!col)
-				line = wxEmptyString;
-			else
-				line += cbColSeparator->GetValue();
+			case PGTYPCLASS_NUMERIC:
+			case PGTYPCLASS_BOOL:
+				numeric = true;
+				break;
+			default:
+				break;
+		}
+		quoted.Add(rbQuoteAll->GetValue() || (rbQuoteStrings->GetValue() && !numeric));
+		scanned.Add(!numeric);
+	}
 
-			bool needQuote = rbQuoteAll->GetValue();
+	wxLogInfo(wxT("Exporting %ld rows to %s"), rowCount, txtFilename->GetValue().c_str());
 
-			if (set)
-			{
-				text = set->GetVal(col);
-				typOid = set->ColTypClass(col);
-			}
-			else
-			{
-				text = grid->OnGetItemText(row, col + 1);
-				typOid = grid->colTypClasses[col];
-			}
+	dataFileWriter file;
+	if (!file.Open(txtFilename->GetValue()))
+	{
+		wxLogError(__("Failed to open file %s."), txtFilename->GetValue().c_str());
+		return false;
+	}
 
-			if (!needQuote && rbQuoteStrings->GetValue())
-			{
-				// find out if string
-				switch (typOid)
-				{
-					case PGTYPCLASS_NUMERIC:
-					case PGTYPCLASS_BOOL:
-						break;
-					default:
-						needQuote = true;
-						break;
-				}
-			}
-			if (needQuote)
+	if (chkColnames->GetValue())
+	{
+		wxString line;
+		for (col = 0 ; col < colCount ; col++)
+		{
+			if (col)
+				line += sep;
+
+			if (rbQuoteStrings->GetValue() || rbQuoteAll->GetValue())
 			{
-				wxString qc = cbQuoteChar->GetValue();
-				text.Replace(qc, qc + qc);
-				line += qc + text + qc;
+				wxString hdr = set->ColName(col);
+				if (!qc.IsEmpty())
+					hdr.Replace(qc, qc + qc);
+				line += qc + hdr + qc;
 			}
 			else
-				line += text;
+				line += set->ColName(col);
 		}
-		if (rbCRLF->GetValue())
-			line += wxT("\r\n");
-		else
-			line += wxT("\n");
+		line += eol;
 
-		if (rbUnicode->GetValue())
-			file.Write(line, wxConvUTF8);
+		wxCharBuffer buf = line.mb_str(conv);
+		if (!buf)
+			skipped++;
 		else
-		{
-			buf = line.mb_str(wxConvLibc);
-			if (!buf)
-				skipped++;
-			else
-				file.Write(line, wxConvLibc);
-		}
+			file.Write(buf, strlen(buf));
+	}
+
+	wxLongLong started = wxGetLocalTimeMillis();
+
+	workerProgress progress(parent, _("Export data"), _("Writing the data to the file."), (int)rowCount);
+	exportThread *exporter = new exportThread(set, rows, file, unicode, separator, quoteChar, endOfLine, quoted, scanned, &progress);
+	bool threaded = (exporter->Create() == wxTHREAD_NO_ERROR && exporter->Run() == wxTHREAD_NO_ERROR);
+	if (!threaded)
+		exporter->Entry();
+
+	bool cancelled = !progress.Wait();
+	if (threaded)
+		exporter->Wait();
+
+	long rowsDone = exporter->RowsDone();
+	skipped += exporter->RowsSkipped();
+	delete exporter;
 
-		if (set)
-			set->MoveNext();
+	bool written = file.Close();
+	wxLongLong elapsed = wxGetLocalTimeMillis() - started;
+
+	if (cancelled)
+	{
+		wxLogInfo(wxT("Data export cancelled after %ld rows"), rowsDone);
+		wxRemoveFile(file.GetPath());
+		return false;
 	}
-	file.Close();
+	if (!written)
+	{
+		wxLogError(__("Failed to write file %s."), file.GetPath().c_str());
+		return false;
+	}
+
+	LogExported(rowsDone, file.GetBytesWritten(), elapsed);
 
 	if (skipped)
 		wxLogError(wxPLURAL(
@@ -298,6 +441,68 @@ bool frmExport::Export(pgSet *set)
 }
 
 
+void frmExport::LogExported(long rows, wxFileOffset bytes, wxLongLong elapsed)
+{
+	double seconds = wxMax(elapsed.ToDouble(), 1.0) / 1000;
+	wxLogInfo(wxT("Exported %ld rows, %s bytes in %s (%.1f MB/s)"), rows,
+	          wxLongLong(bytes).ToString().c_str(), ElapsedTimeToStr(elapsed).c_str(),
+	          bytes / seconds / (1024 * 1024));
+}
+
+
+wxString frmExport::GetCopyOptions(pgConn *conn)
+{
+	if (!conn || !conn->BackendMinimumVersion(9, 0))
+		return wxEmptyString;
+
+	// The server writes in the client encoding, which must be the one
+	// of the file then
+	if (conn->GetConv() != (rbUnicode->GetValue() ? (wxMBConv *)&wxConvUTF8 : (wxMBConv *)&wxConvLibc))
+		return wxEmptyString;
+
+	// COPY only takes single byte separators and quotes. Values are
+	// quoted as CSV needs it, or all of them; that strings only are
+	// can't be told it, so they are quoted as needed too.
+	wxString sep = cbColSeparator->GetValue(), qc = cbQuoteChar->GetValue();
+	if (rbQuoteNone->GetValue() && qc.Length() != 1)
+		qc = wxT("\"");
+
+	if (sep.Length() != 1 || qc.Length() != 1 || sep == qc)
+		return wxEmptyString;
+
+	wxChar sepChar = sep.GetChar(0), quoteChar = qc.GetChar(0);
+	if (sepChar >= 128 || quoteChar >= 128 || sepChar == '\r' || sepChar == '\n')
+		return wxEmptyString;
+
+	wxString options = wxT("FORMAT csv");
+	if (chkColnames->GetValue())
+		options += wxT(", HEADER");
+	options += wxT(", DELIMITER ") + conn->qtDbString(sep) + wxT(", QUOTE ") + conn->qtDbString(qc);
+	if (rbQuoteAll->GetValue())
+		options += wxT(", FORCE_QUOTE *");
+
+	return options;
+}
+
+
+wxString frmExport::GetFilename()
+{
+	return txtFilename->GetValue();
+}
+
+
+bool frmExport::IsCRLF()
+{
+	return rbCRLF->GetValue();
+}
+
+
+bool frmExport::HasHeader()
+{
+	return chkColnames->GetValue();
+}
+
+
 void frmExport::OnCancel(wxCommandEvent &ev)
 {
 	if (IsModal())
@@ -321,10 +526,10 @@ void frmExport::OnBrowseFile(wxCommandEvent &ev)
 
 #ifdef __WXMSW__
 	wxFileDialog file(this, _("Select export filename"), directory, filename,
-	                  _("CSV files (*.csv)|*.csv|Data files (*.dat)|*.dat|All files (*.*)|*.*"), wxFD_SAVE | wxFD_OVERWRITE_PROMPT);
+	                  _("CSV files (*.csv)|*.csv|Data files (*.dat)|*.dat|Compressed files (*.gz;*.zst)|*.gz;*.zst|All files (*.*)|*.*"), wxFD_SAVE | wxFD_OVERWRITE_PROMPT);
 #else
 	wxFileDialog file(this, _("Select export filename"), directory, filename,
-	                  _("CSV files (*.csv)|*.csv|Data files (*.dat)|*.dat|All files (*)|*"), wxFD_SAVE | wxFD_OVERWRITE_PROMPT);
+	                  _("CSV files (*.csv)|*.csv|Data files (*.dat)|*.dat|Compressed files (*.gz;*.zst)|*.gz;*.zst|All files (*)|*"), wxFD_SAVE | wxFD_OVERWRITE_PROMPT);
 #endif
 
 	if (file.ShowModal() == wxID_OK)
@@ -19,9 +19,12 @@
 // App headers
 #include "pgAdmin3.h"
 #include "db/pgConn.h"
+#include "db/pgConnPool.h"
 #include "frm/frmMain.h"
 #include "frm/frmImport.h"
 #include "utils/sysLogger.h"
+#include "utils/dataFile.h"
+#include "utils/workerProgress.h"
 #include "schema/pgSchema.h"
 #include "schema/pgTable.h"
 #include "schema/pgColumn.h"
@@ -44,6 +47,16 @@
 #define lstColumnsToImport			  CTRL_CHECKLISTBOX("lstColumnsToImport")
 #define lstIgnoreForColumns			  CTRL_CHECKLISTBOX("lstIgnoreForColumns")
 
+// The size of the pieces the file is read and sent in
+#define IMPORT_CHUNK_SIZE             (1024 * 1024)
+
+// Files smaller than this are sent over one COPY session
+#define IMPORT_PARALLEL_SIZE          wxLL(67108864)
+
+// How long a session waits for the server to take data before it looks
+// for a cancellation, in milliseconds
+#define IMPORT_WAIT_MSEC              100
+
 
 BEGIN_EVENT_TABLE(frmImport, pgDialog)
 	EVT_COMBOBOX(XRCID("cbFormat"),   frmImport::OnChangeFormat)
@@ -154,6 +167,433 @@ void frmImport::OnChangeFormat(wxCommandEvent &ev)
 }
 
 
+// A piece of the file on its way to the server
+struct importChunk
+{
+	char *data;
+	size_t size, len;
+};
+
+WX_DEFINE_ARRAY_PTR(importChunk *, importChunkArray);
+
+
+// The chunks passed from the thread reading the file to those sending it.
+// There are a couple for each session, so the file is read ahead while the
+// data read before is sent.
+class importPipeline
+{
+public:
+	importPipeline(size_t chunks);
+	~importPipeline();
+
+	// For the reader: an empty chunk to fill, NULL once cancelled, and
+	// the filled chunk
+	importChunk *GetFree();
+	void PutFull(importChunk *chunk);
+	void Finish();
+
+	// For the sessions: the next chunk to send, NULL once there are no
+	// more, and the chunk sent
+	importChunk *GetFull();
+	void PutFree(importChunk *chunk);
+
+	void Cancel();
+	bool IsCancelled() const
+	{
+		return cancelled;
+	}
+
+private:
+	wxMutex mutex;
+	wxCondition changed;
+	importChunkArray all, empty, filled;
+	bool finished, cancelled;
+};
+
+
+importPipeline::importPipeline(size_t chunks)
+	: changed(mutex), finished(false), cancelled(false)
+{
+	for (size_t i = 0 ; i < chunks ; i++)
+	{
+		importChunk *chunk = new importChunk;
+		chunk->data = (char *)malloc(IMPORT_CHUNK_SIZE);
+		chunk->size = IMPORT_CHUNK_SIZE;
+		chunk->len = 0;
+		all.Add(chunk);
+		empty.Add(chunk);
+	}
+}
+
+
+importPipeline::~importPipeline()
+{
+	for (size_t i = 0 ; i < all.GetCount() ; i++)
+	{
+		free(all.Item(i)->data);
+		delete all.Item(i);
+	}
+}
+
+
+importChunk *importPipeline::GetFree()
+{
+	wxMutexLocker lock(mutex);
+
+	while (empty.IsEmpty() && !cancelled)
+		changed.Wait();
+	if (cancelled)
+		return NULL;
+
+	importChunk *chunk = empty.Last();
+	empty.RemoveAt(empty.GetCount() - 1);
+	return chunk;
+}
+
+
+void importPipeline::PutFull(importChunk *chunk)
+{
+	wxMutexLocker lock(mutex);
+	filled.Add(chunk);
+	changed.Broadcast();
+}
+
+
+void importPipeline::Finish()
+{
+	wxMutexLocker lock(mutex);
+	finished = true;
+	changed.Broadcast();
+}
+
+
+importChunk *importPipeline::GetFull()
+{
+	wxMutexLocker lock(mutex);
+
+	while (filled.IsEmpty() && !finished && !cancelled)
+		changed.Wait();
+	if (cancelled || filled.IsEmpty())
+		return NULL;
+
+	// In the order read, though the sessions may finish them in any other
+	importChunk *chunk = filled.Item(0);
+	filled.RemoveAt(0);
+	return chunk;
+}
+
+
+void importPipeline::PutFree(importChunk *chunk)
+{
+	wxMutexLocker lock(mutex);
+	empty.Add(chunk);
+	changed.Broadcast();
+}
+
+
+void importPipeline::Cancel()
+{
+	wxMutexLocker lock(mutex);
+	cancelled = true;
+	changed.Broadcast();
+}
+
+
+
+// The progress of the import, shown as the share of the file read, in the
+// gauge of the dialog as well. The wait ends when the last of the threads
+// ends; the caller counts as one until all of them have been started. A
+// cancellation cancels the COPY of every session too, so a server that
+// isn't reading, such as one waiting for a lock, lets its session go.
+class importProgress : public workerProgress
+{
+public:
+	importProgress(wxWindow *parent, wxGauge *_bar, importPipeline &_pipeline, const wxArrayPtrVoid &_conns)
+		: workerProgress(parent, _("Import data"), _("Sending the data to the server."), 1000),
+		  bar(_bar), pipeline(_pipeline), conns(_conns), running(1)
+	{
+	}
+
+	void WorkerStarted()
+	{
+		wxMutexLocker lock(mutex);
+		running++;
+	}
+	void WorkerDone()
+	{
+		wxMutexLocker lock(mutex);
+		if (--running == 0)
+			Done();
+	}
+
+protected:
+	void OnCancel()
+	{
+		pipeline.Cancel();
+		for (size_t i = 0 ; i < conns.GetCount() ; i++)
+			((pgConn *)conns.Item(i))->CancelExecution();
+	}
+	void OnUpdate(int value)
+	{
+		bar->SetValue(value);
+	}
+
+private:
+	wxGauge *bar;
+	importPipeline &pipeline;
+	const wxArrayPtrVoid &conns;
+	wxMutex mutex;
+	int running;
+};
+
+
+
+// Reads the file into the pipeline. When the data is shared out among more
+// than one session, every chunk has to end with a whole record: records are
+// found by scanning for line ends outside of quoted CSV values and not
+// escaped in the text format, and the rest of the data is carried over to
+// the next chunk. A header line is then left out here, as no session would
+// know whether its data starts with it.
+class importReader : public wxThread
+{
+public:
+	importReader(importPipeline &_pipeline, importProgress &_progress, dataFileReader &_file, bool _split, bool _csv,
+	             char _quote, char _escape, bool _skipHeader);
+
+	void *Entry();
+
+	bool HasFailed() const
+	{
+		return failed;
+	}
+
+private:
+	size_t FindRecordEnd(const char *data, size_t len, bool first);
+
+	importPipeline &pipeline;
+	importProgress &progress;
+	dataFileReader &file;
+	bool split, csv;
+	char quote, escape;
+	bool skipHeader, failed;
+};
+
+
+importReader::importReader(importPipeline &_pipeline, importProgress &_progress, dataFileReader &_file, bool _split, bool _csv,
+                           char _quote, char _escape, bool _skipHeader)
+	: wxThread(wxTHREAD_JOINABLE), pipeline(_pipeline), progress(_progress), file(_file), split(_split), csv(_csv),
+	  quote(_quote), escape(_escape), skipHeader(_skipHeader), failed(false)
+{
+}
+
+
+// The offset just after the end of the last, or the first, record in the
+// data, 0 if none ends in it. The data starts at the start of a record; a
+// quote or an escape right at its end is rescanned with what follows once
+// it's carried over.
+size_t importReader::FindRecordEnd(const char *data, size_t len, bool first)
+{
+	size_t end = 0;
+	bool quoted = false;
+
+	for (size_t i = 0 ; i < len ; i++)
+	{
+		char c = data[i];
+
+		if (csv)
+		{
+			if (quoted)
+			{
+				if (c == escape && escape != quote && i + 1 < len && (data[i + 1] == quote || data[i + 1] == escape))
+					i++;
+				else if (c == quote)
+					quoted = false;
+				continue;
+			}
+			if (c == quote)
+			{
+				quoted = true;
+				continue;
+			}
+		}
+		else if (c == '\\')
+		{
+			i++;
+			continue;
+		}
+
+		if (c == '\n' || (c == '\r' && i + 1 < len && data[i + 1] != '\n'))
+		{
+			end = i + 1;
+			if (first)
+				break;
+		}
+	}
+	return end;
+}
+
+
+void *importReader::Entry()
+{
+	wxMemoryBuffer carry;
+	bool eof = false;
+
+	while (!eof)
+	{
+		importChunk *chunk = pipeline.GetFree();
+		if (!chunk)
+			break;
+
+		chunk->len = carry.GetDataLen();
+		memcpy(chunk->data, carry.GetData(), chunk->len);
+
+		size_t start = 0, end;
+		for (;;)
+		{
+			while (chunk->len < chunk->size && !eof)
+			{
+				long count = file.Read(chunk->data + chunk->len, chunk->size - chunk->len);
+				if (count < 0)
+					failed = true;
+				if (count <= 0)
+					eof = true;
+				else
+					chunk->len += count;
+			}
+			if (failed)
+				break;
+
+			if (skipHeader)
+			{
+				start = FindRecordEnd(chunk->data, chunk->len, true);
+				if (start || eof)
+				{
+					if (!start)
+						start = chunk->len;
+					skipHeader = false;
+				}
+			}
+
+			if (!skipHeader)
+			{
+				end = chunk->len;
+				if (!split || eof)
+					break;
+
+				end = FindRecordEnd(chunk->data + start, chunk->len - start, false);
+				if (end)
+				{
+					end += start;
+					break;
+				}
+			}
+
+			// A record longer than the chunk
+			chunk->size *= 2;
+			chunk->data = (char *)realloc(chunk->data, chunk->size);
+		}
+
+		if (failed)
+		{
+			pipeline.PutFree(chunk);
+			pipeline.Cancel();
+			break;
+		}
+
+		carry.SetDataLen(0);
+		carry.AppendData(chunk->data + end, chunk->len - end);
+
+		if (start)
+			memmove(chunk->data, chunk->data + start, end - start);
+		chunk->len = end - start;
+
+		if (chunk->len)
+			pipeline.PutFull(chunk);
+		else
+			pipeline.PutFree(chunk);
+
+		if (file.GetLength() > 0)
+			progress.Update((int)wxMin(file.GetBytesRead() * 1000 / file.GetLength(), 1000));
+	}
+
+	pipeline.Finish();
+	progress.WorkerDone();
+	return NULL;
+}
+
+
+
+// Sends chunks from the pipeline over a nonblocking connection in COPY IN
+// state, so it notices when the import is cancelled even if the server
+// doesn't take the data. All messages are left to the caller.
+class importSession : public wxThread
+{
+public:
+	importSession(importPipeline &_pipeline, importProgress &_progress, pgConn *_conn)
+		: wxThread(wxTHREAD_JOINABLE), pipeline(_pipeline), progress(_progress), conn(_conn), failed(false)
+	{
+	}
+
+	void *Entry();
+
+	pgConn *GetConn() const
+	{
+		return conn;
+	}
+	bool HasFailed() const
+	{
+		return failed;
+	}
+
+private:
+	importPipeline &pipeline;
+	importProgress &progress;
+	pgConn *conn;
+	bool failed;
+};
+
+WX_DEFINE_ARRAY_PTR(importSession *, importSessionArray);
+
+
+void *importSession::Entry()
+{
+	importChunk *chunk;
+	int queued, pending = 0;
+
+	while ((chunk = pipeline.GetFull()) != NULL)
+	{
+		while ((queued = conn->TryPutCopyData(chunk->data, (long)chunk->len)) == 0 && !pipeline.IsCancelled())
+		{
+			if (conn->FlushCopyData(IMPORT_WAIT_MSEC) < 0)
+				queued = -1;
+		}
+		if (queued < 0)
+			failed = true;
+
+		pipeline.PutFree(chunk);
+
+		// Nothing more gets through, so the others shouldn't go on either
+		if (failed)
+		{
+			pipeline.Cancel();
+			break;
+		}
+	}
+
+	// The data queued has to be sent before the COPY can end
+	while (!failed && !pipeline.IsCancelled() && (pending = conn->FlushCopyData(IMPORT_WAIT_MSEC)) == 1)
+		;
+	if (pending < 0)
+	{
+		failed = true;
+		pipeline.Cancel();
+	}
+
+	progress.WorkerDone();
+	return NULL;
+}
+
+
 void frmImport::OnOK(wxCommandEvent &ev)
 {
 	wxString query = wxEmptyString;
@@ -161,11 +601,13 @@ void frmImport::OnOK(wxCommandEvent &ev)
 	wxString columnsToIgnoreForNulls = wxEmptyString;
 	bool allColumnsToImport = true;
 	bool someColumnsToIgnoreForNulls = false;
-	wxFileName fn;
-	wxFile *file;
-	bool copydone = false;
+	dataFileReader file;
+	wxArrayPtrVoid conns;
+	pgConn *errorConn = NULL;
+	wxString errMsg;
+	size_t copying = 0;
+	bool cancelled = false;
 	bool goterror = false;
-	int nCount = 8192;
 
 	if (!done)
 	{
@@ -205,6 +647,61 @@ void frmImport::OnOK(wxCommandEvent &ev)
 			return;
 		}
 
+		// Check CSV file
+		if (!wxFileName::FileExists(pickerImportfile->GetPath()))
+		{
+			wxString msg;
+			msg.Printf(_("The file %s doesn't exist.\nPlease select a valid file."), pickerImportfile->GetPath().c_str());
+			wxLogError(msg);
+			return;
+		}
+
+		// Open CSV file, which is decompressed on the way if its name ends
+		// in .gz or .zst
+		if (!IsDataFileCompressionSupported(GetDataFileCompression(pickerImportfile->GetPath())))
+		{
+			wxMessageBox(_("This version of pgAdmin can't read zstd compressed files."), _("Import"), wxICON_WARNING | wxOK, this);
+			return;
+		}
+		if (!file.Open(pickerImportfile->GetPath()))
+			return;
+
+		// Large files are shared out over sessions of their own from the
+		// pool of the connection, if they can be cut into records. Only
+		// server encodings are offered, in none of which a byte of a
+		// multibyte character is ASCII, so the bytes can be scanned as they
+		// are for line ends, quotes and escapes.
+		bool csv = cbFormat->GetValue() == wxT("csv");
+		wxString quote = cbQuote->GetValue().IsEmpty() ? wxString(wxT("\"")) : cbQuote->GetValue();
+		wxString escape = cbEscape->GetValue().IsEmpty() ? quote : cbEscape->GetValue();
+		bool splittable = cbFormat->GetValue() == wxT("text") ||
+		                  (csv && quote.Length() == 1 && escape.Length() == 1 && quote.GetChar(0) < 128 && escape.GetChar(0) < 128);
+
+		// Each session has a transaction of its own, committed only once
+		// all of them are through. A row waiting for one of an other
+		// session to check a unique or exclusion constraint would wait
+		// forever, and a row referencing one of an other session through
+		// a foreign key to the table itself wouldn't see it, so such
+		// tables are sent over one session.
+		if (splittable && file.GetLength() >= IMPORT_PARALLEL_SIZE)
+			splittable = connection->ExecuteScalar(
+			                 wxT("SELECT EXISTS (SELECT 1 FROM pg_index WHERE indrelid = ") + object->GetOidStr() + wxT(" AND indisunique)\n")
+			                 wxT("    OR EXISTS (SELECT 1 FROM pg_constraint WHERE conrelid = ") + object->GetOidStr() + wxT("\n")
+			                 wxT("                  AND (contype = 'x' OR (contype = 'f' AND confrelid = conrelid)))")) == wxT("f");
+
+		conns.Add(connection);
+		if (splittable && file.GetLength() >= IMPORT_PARALLEL_SIZE)
+		{
+			while ((long)conns.GetCount() < settings->GetImportSessions())
+			{
+				pgConn *conn = connection->GetPool()->Borrow();
+				if (!conn)
+					break;
+				conns.Add(conn);
+			}
+		}
+		bool split = conns.GetCount() > 1;
+
 		// Build COPY query
 		query = wxT("COPY ") + object->GetSchema()->GetQuotedIdentifier() + wxT(".") + object->GetQuotedIdentifier();
 		if (!allColumnsToImport)
@@ -226,7 +723,7 @@ void frmImport::OnOK(wxCommandEvent &ev)
 				query += wxT(", NULL ") + connection->qtDbString(txtNull->GetValue());
 			if (cbFormat->GetValue() == wxT("csv"))
 			{
-				if (chkHeader->GetValue())
+				if (chkHeader->GetValue() && !split)
 					query += wxT(", HEADER");
 				if (!cbQuote->GetValue().IsEmpty())
 					query += wxT(", QUOTE ") + connection->qtDbString(cbQuote->GetValue());
@@ -256,7 +753,7 @@ void frmImport::OnOK(wxCommandEvent &ev)
 			if (cbFormat->GetValue() == wxT("csv"))
 			{
 				query += wxT("CSV ");
-				if (connection->BackendMinimumVersion(8, 0) && chkHeader->GetValue())
+				if (connection->BackendMinimumVersion(8, 0) && chkHeader->GetValue() && !split)
 					query += wxT("HEADER ");
 				if (connection->BackendMinimumVersion(8, 0) && !cbQuote->GetValue().IsEmpty())
 					query += wxT("QUOTE ") + connection->qtDbString(cbQuote->GetValue());
@@ -267,82 +764,122 @@ void frmImport::OnOK(wxCommandEvent &ev)
 			}
 		}
 
-		// Check CSV file
-		if (!wxFileName::FileExists(pickerImportfile->GetPath()))
+		// Start COPY. When the file is shared out, each session has a
+		// transaction of its own, committed once all of them are through.
+		for ( ; copying < conns.GetCount() ; copying++)
 		{
-			wxString msg;
-			msg.Printf(_("The file %s doesn't exist.\nPlease select a valid file."), pickerImportfile->GetPath().c_str());
-			wxLogError(msg);
-			return;
+			pgConn *conn = (pgConn *)conns.Item(copying);
+			if ((split && !conn->ExecuteVoid(wxT("BEGIN"))) || !conn->StartCopy(query))
+			{
+				errorConn = conn;
+				goterror = true;
+				break;
+			}
 		}
 
-		// Open CSV file
-		fn = wxFileName(pickerImportfile->GetPath());
-		file = new wxFile(fn.GetFullPath(), wxFile::read);
+		// Send COPY data
+		wxLongLong started = wxGetLocalTimeMillis();
+		if (!goterror && !SendFile(file, conns, split, (char)quote.GetChar(0), (char)escape.GetChar(0),
+		                           split && csv && chkHeader->GetValue(), cancelled, errMsg))
+			goterror = true;
 
-		// Set range for gauge
-		gauge->SetRange(file->Length());
+		// Close CSV file
+		file.Close();
 
-		// Start COPY
-		if (!connection->StartCopy(query))
+		// End COPY, and get the final status of the COPY commands
+		for (size_t i = 0 ; i < copying ; i++)
 		{
-			goterror = true;
+			pgConn *conn = (pgConn *)conns.Item(i);
+			if (goterror)
+			{
+				conn->EndPutCopy(errMsg.IsEmpty() ? _("Copy failed!") : errMsg);
+			}
+			else if (!conn->EndPutCopy(wxT("")))
+			{
+				errorConn = conn;
+				goterror = true;
+			}
+
+			if (!conn->GetCopyFinalStatus())
+			{
+				if (!errorConn)
+					errorConn = conn;
+				goterror = true;
+			}
 		}
 
-		// Send COPY data
-		while (!copydone && !goterror)
+		// Where the server takes prepared transactions, the sessions are
+		// committed only once all of them are prepared, so the rows go in
+		// as a whole. Otherwise a failed COMMIT leaves the sessions
+		// committed before it, and there is no taking them back.
+		size_t sessions = wxMin(copying + 1, conns.GetCount()), committed = 0;
+		if (split)
 		{
-			// Read a buffer
-			char *buffer = new char[nCount + 4];
-			memset(buffer, 0, nCount + 4);
-			off_t len = file->Read(buffer, nCount);
+			bool twoPhase = !goterror &&
+			                StrToLong(connection->ExecuteScalar(wxT("SHOW max_prepared_transactions"), false)) >= (long)sessions;
+			wxArrayString prepared;
 
-			// If we read something, send it to the server
-			if (len > 0)
+			for (size_t i = 0 ; i < sessions ; i++)
 			{
-				if (!connection->PutCopyData(buffer, len))
+				pgConn *conn = (pgConn *)conns.Item(i);
+				wxString gid = wxString::Format(wxT("pgadmin_import_%d_%d"), connection->GetBackendPID(), (int)i);
+
+				if (goterror)
+					conn->ExecuteVoid(wxT("ROLLBACK"), false);
+				else if (twoPhase ? conn->ExecuteVoid(wxT("PREPARE TRANSACTION ") + connection->qtDbString(gid))
+				         : conn->ExecuteVoid(wxT("COMMIT")))
 				{
-					goterror = true;
+					if (twoPhase)
+						prepared.Add(gid);
+					else
+						committed++;
 				}
 				else
 				{
-					gauge->SetValue(gauge->GetValue() + len);
-					Update();
+					if (!errorConn)
+						errorConn = conn;
+					goterror = true;
 				}
 			}
 
-			// If we read nothing, we're done
-			copydone = len == 0;
-
-			// Clean the buffer
-			delete[] buffer;
+			// All the sessions are done with their transactions by now, so
+			// the prepared ones can be finished on the first
+			for (size_t i = 0 ; i < prepared.GetCount() ; i++)
+			{
+				if (goterror)
+					connection->ExecuteVoid(wxT("ROLLBACK PREPARED ") + connection->qtDbString(prepared.Item(i)), false);
+				else if (connection->ExecuteVoid(wxT("COMMIT PREPARED ") + connection->qtDbString(prepared.Item(i))))
+					committed++;
+				else
+					errorConn = connection;
+			}
+			if (errorConn == connection && committed < sessions)
+				goterror = true;
 		}
+		for (size_t i = 1 ; i < conns.GetCount() ; i++)
+			connection->GetPool()->Return((pgConn *)conns.Item(i));
 
-		// Close CSV file
-		file->Close();
-
-		// End COPY
-		if (goterror)
+		if (cancelled)
 		{
-			connection->EndPutCopy(_("Copy failed!"));
+			gauge->SetValue(0);
 		}
-		else
+		else if (goterror && committed)
 		{
-			goterror = !connection->EndPutCopy(wxT(""));
+			wxLogError(wxString::Format(_("Copy failed after %d of the %d sessions the file was shared out over had committed their rows, which stay in the table.\n"),
+			                            (int)committed, (int)sessions) + (errorConn ? errorConn : connection)->GetLastError());
 		}
-
-		// Get final status of the COPY command
-		if (!connection->GetCopyFinalStatus())
+		else if (goterror)
 		{
-			goterror = true;
-		}
-
-		if (goterror)
-		{
-			wxLogError(_("Copy failed!\n") + connection->GetLastError());
+			wxLogError(_("Copy failed!\n") + (errorConn ? errorConn : connection)->GetLastError());
 		}
 		else
 		{
+			wxLongLong elapsed = wxGetLocalTimeMillis() - started;
+			double seconds = wxMax(elapsed.ToDouble(), 1.0) / 1000;
+			wxLogInfo(wxT("Imported %s bytes over %d sessions in %s (%.1f MB/s)"),
+			          wxLongLong(file.GetBytesRead()).ToString().c_str(), (int)conns.GetCount(),
+			          ElapsedTimeToStr(elapsed).c_str(), file.GetBytesRead() / seconds / (1024 * 1024));
+
 			btnOK->SetLabel(wxT("Done"));
 			done = true;
 		}
@@ -353,6 +890,97 @@ void frmImport::OnOK(wxCommandEvent &ev)
 	}
 }
 
+
+bool frmImport::SendFile(dataFileReader &file, const wxArrayPtrVoid &conns, bool split, char quote, char escape,
+                         bool skipHeader, bool &cancelled, wxString &errMsg)
+{
+	importPipeline pipeline(conns.GetCount() * 2 + 1);
+	importProgress progress(this, gauge, pipeline, conns);
+	importReader *reader = new importReader(pipeline, progress, file, split, cbFormat->GetValue() == wxT("csv"), quote, escape, skipHeader);
+	importSessionArray sessions;
+	size_t i;
+
+	gauge->SetRange(1000);
+
+	bool threaded = true;
+	for (i = 0 ; i < conns.GetCount() && threaded ; i++)
+		threaded = ((pgConn *)conns.Item(i))->SetNonBlocking(true);
+
+	progress.WorkerStarted();
+	if (threaded)
+		threaded = (reader->Create() == wxTHREAD_NO_ERROR && reader->Run() == wxTHREAD_NO_ERROR);
+	if (!threaded)
+	{
+		progress.WorkerDone();
+		delete reader;
+		reader = NULL;
+	}
+	for (i = 0 ; i < conns.GetCount() && threaded ; i++)
+	{
+		importSession *session = new importSession(pipeline, progress, (pgConn *)conns.Item(i));
+		progress.WorkerStarted();
+		threaded = (session->Create() == wxTHREAD_NO_ERROR && session->Run() == wxTHREAD_NO_ERROR);
+		if (threaded)
+			sessions.Add(session);
+		else
+		{
+			progress.WorkerDone();
+			delete session;
+		}
+	}
+
+	// Without all of the threads there'd be no one to take the data
+	if (!threaded)
+		pipeline.Cancel();
+	progress.WorkerDone();
+
+	cancelled = !progress.Wait();
+
+	bool ok = threaded && !cancelled;
+	if (!threaded)
+		errMsg = _("The import could not be started.");
+	else if (cancelled)
+		errMsg = _("Cancelled by the user.");
+
+	if (reader)
+	{
+		reader->Wait();
+		if (reader->HasFailed())
+		{
+			errMsg = _("The file could not be read.");
+			ok = false;
+		}
+		delete reader;
+	}
+	for (i = 0 ; i < sessions.GetCount() ; i++)
+	{
+		importSession *session = sessions.Item(i);
+		session->Wait();
+		if (session->HasFailed())
+			ok = false;
+		delete session;
+	}
+
+	// Whatever the sessions didn't send would be missing
+	if (pipeline.IsCancelled())
+		ok = false;
+
+	// What is still queued is sent before the connections block again. If
+	// the import failed, a server that isn't taking it is cancelled, so it
+	// reads the rest.
+	for (i = 0 ; i < conns.GetCount() ; i++)
+	{
+		pgConn *conn = (pgConn *)conns.Item(i);
+		if (!ok && conn->FlushCopyData(IMPORT_WAIT_MSEC) == 1)
+			conn->CancelExecution();
+		while (conn->FlushCopyData(IMPORT_WAIT_MSEC) == 1)
+			;
+		conn->SetNonBlocking(false);
+	}
+
+	return ok;
+}
+
 importFactory::importFactory(menuFactoryList *list, wxMenu *mnu, ctlMenuToolbar *toolbar) : contextActionFactory(list)
 {
 	mnu->Append(id, _("&Import..."), _("Import CSV file into a relation"));
@@ -43,7 +43,9 @@
 #include "ctl/ctlMenuToolbar.h"
 #include "ctl/ctlSQLBox.h"
 #include "db/pgConn.h"
+#include "db/pgConnMonitor.h"
 #include "db/pgSet.h"
+#include "db/pgQueryProfiler.h"
 #include "agent/pgaJob.h"
 #include "schema/pgDatabase.h"
 #include "schema/pgServer.h"
@@ -63,6 +65,7 @@
 #include "frm/frmReport.h"
 #include "frm/frmMaintenance.h"
 #include "frm/frmStatus.h"
+#include "frm/frmQueryProfiler.h"
 #include "frm/frmPassword.h"
 #ifdef DATABASEDESIGNER
 #include "frm/frmDatabaseDesigner.h"
@@ -108,6 +111,7 @@ frmMain::frmMain(const wxString &title)
 	lastPluginUtility = NULL;
 	pluginUtilityCount = 0;
 	m_refreshing = false;
+	m_checkingAlive = false;
 
 	dlgName = wxT("frmMain");
 	SetMinSize(wxSize(600, 450));
@@ -239,11 +243,16 @@ frmMain::frmMain(const wxString &title)
 	browser->Expand(root);
 	browser->SortChildren(root);
 	browser->SetFocus();
+
+	// Hear about lost connections as soon as they're noticed
+	pgConnMonitor::SetHandler(this);
 }
 
 
 frmMain::~frmMain()
 {
+	pgConnMonitor::SetHandler(NULL);
+
 	// Store the servers, to ensure we store the last database/schema etc
 	StoreServers();
 
@@ -458,6 +467,7 @@ void frmMain::CreateMenus()
 
 	new propertyFactory(menuFactories, editMenu, 0);
 	new serverStatusFactory(menuFactories, toolsMenu, 0);
+	new queryProfilerFactory(menuFactories, toolsMenu, 0);
 
 	// Add the plugin toolbar button/menu
 	new pluginButtonMenuFactory(menuFactories, pluginsMenu, toolBar, pluginUtilityCount);
@@ -584,7 +594,11 @@ void frmMain::Refresh(pgObject *data)
 		// refresh information about the object
 		data->SetDirty();
 
-		pgObject *newData = data->Refresh(browser, currentItem);
+		pgObject *newData;
+		{
+			pgProfilerSite site(data->GetTypeName() + wxT("::Refresh"));
+			newData = data->Refresh(browser, currentItem);
+		}
 		done = !data->GetConnection() || data->GetConnection()->GetStatus() == PGCONN_OK;
 
 		if (newData != data)
@@ -780,6 +794,8 @@ void frmMain::ShowObjStatistics(pgObject *data, wxWindow *ctrl)
 	if ((!ctrl && statistics->IsShownOnScreen()) || ctrl == statistics)
 	{
 		statistics->Freeze();
+		statistics->ClearAsync();
+		pgProfilerSite site(data->GetTypeName() + wxT("::ShowStatistics"));
 		data->ShowStatistics(this, statistics);
 		statistics->Thaw();
 	}
@@ -787,6 +803,7 @@ void frmMain::ShowObjStatistics(pgObject *data, wxWindow *ctrl)
 	if ((!ctrl && dependencies->IsShownOnScreen()) || ctrl == dependencies)
 	{
 		dependencies->Freeze();
+		pgProfilerSite site(data->GetTypeName() + wxT("::ShowDependencies"));
 		data->ShowDependencies(this, dependencies);
 		dependencies->Thaw();
 	}
@@ -794,6 +811,7 @@ void frmMain::ShowObjStatistics(pgObject *data, wxWindow *ctrl)
 	if ((!ctrl && dependents->IsShownOnScreen()) || ctrl == dependents)
 	{
 		dependents->Freeze();
+		pgProfilerSite site(data->GetTypeName() + wxT("::ShowDependents"));
 		data->ShowDependents(this, dependents);
 		dependents->Thaw();
 	}
@@ -832,6 +850,11 @@ bool frmMain::CheckAlive()
 	bool userInformed = false;
 	bool closeIt = false;
 
+	// The dialogs below let further lost connections be reported meanwhile
+	if (m_checkingAlive)
+		return false;
+	m_checkingAlive = true;
+
 	wxTreeItemIdValue foldercookie;
 	wxTreeItemId folderitem = browser->GetFirstChild(browser->GetRootItem(), foldercookie);
 	while (folderitem)
@@ -968,6 +991,8 @@ bool frmMain::CheckAlive()
 		}
 		folderitem = browser->GetNextChild(browser->GetRootItem(), foldercookie);
 	}
+
+	m_checkingAlive = false;
 	return userInformed;
 }
 
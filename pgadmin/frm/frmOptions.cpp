@@ -878,6 +878,7 @@ void frmOptions::OnOK(wxCommandEvent &ev)
 	}
 
 	settings->SetOptionsLastTreeItem(menuSelection);
+	settings->NotifyChanged();
 
 	// Did any display options change? Display this message last, so it's
 	// in the selected language.
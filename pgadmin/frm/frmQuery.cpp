@@ -35,6 +35,7 @@
 
 #include "ctl/ctlMenuToolbar.h"
 #include "ctl/ctlSQLResult.h"
+#include "ctl/ctlResultFindBar.h"
 #include "dlg/dlgSelectConnection.h"
 #include "dlg/dlgAddFavourite.h"
 #include "dlg/dlgManageFavourites.h"
@@ -90,6 +91,9 @@
 #define WXSTRING_FROM_XML(s) wxString((char *)s, wxConvUTF8)
 #define XML_STR(s) ((const xmlChar *)s)
 
+// Execute to file wraps a query into a COPY starting with this
+#define COPY_QUERY_PREFIX       wxT("COPY (")
+
 // Initialize execution 'mutex'. As this will always run in the
 // main thread, there aren't any real concurrency issues, so
 // a simple flag will suffice.
@@ -170,6 +174,16 @@ BEGIN_EVENT_TABLE(frmQuery, pgFrame)
 	EVT_TIMER(CTL_TIMERFRM,         frmQuery::OnTimer)
 // These fire when the queries complete
 	EVT_PGQUERYRESULT(QUERY_COMPLETE, frmQuery::OnQueryComplete)
+	EVT_PGQUERYROWS(QUERY_COMPLETE, frmQuery::OnQueryRows)
+	EVT_COMMAND(CTL_SQLRESULT, SelectionStatsEvent, frmQuery::OnSelectionStats)
+	EVT_GRID_CMD_CELL_RIGHT_CLICK(CTL_SQLRESULT, frmQuery::OnResultCellRightClick)
+	EVT_GRID_CMD_LABEL_RIGHT_CLICK(CTL_SQLRESULT, frmQuery::OnResultLabelRightClick)
+	EVT_MENU(MNU_INCLUDEFILTER,     frmQuery::OnIncludeFilter)
+	EVT_MENU(MNU_EXCLUDEFILTER,     frmQuery::OnExcludeFilter)
+	EVT_MENU(MNU_REMOVEFILTERS,     frmQuery::OnRemoveFilters)
+	EVT_MENU(MNU_ASCSORT,           frmQuery::OnAscSort)
+	EVT_MENU(MNU_DESCSORT,          frmQuery::OnDescSort)
+	EVT_MENU(MNU_REMOVESORT,        frmQuery::OnRemoveSort)
 	EVT_MENU(PGSCRIPT_COMPLETE,     frmQuery::OnScriptComplete)
 	EVT_AUINOTEBOOK_PAGE_CHANGED(CTL_NTBKCENTER, frmQuery::OnChangeNotebook)
 	EVT_AUINOTEBOOK_PAGE_CHANGED(CTL_SQLQUERYBOOK, frmQuery::OnSqlBookPageChanged)
@@ -421,10 +435,12 @@ frmQuery::frmQuery(frmMain *form, const wxString &_title, pgConn *_conn, const w
 
 	queryMenu->Enable(MNU_CANCEL, false);
 
-	int iWidths[7] = {0, -1, 40, 200, 80, 80, 80};
-	statusBar = CreateStatusBar(7);
+	// The last field, for figures on the selected result cells, only
+	// takes room while there are some to show
+	int iWidths[8] = {0, -1, 40, 200, 80, 80, 80, 0};
+	statusBar = CreateStatusBar(8);
 	SetStatusBarPane(-1);
-	SetStatusWidths(7, iWidths);
+	SetStatusWidths(8, iWidths);
 	SetStatusText(_("ready"), STATUSPOS_MSGS);
 
 	toolBar = new ctlMenuToolbar(this, -1, wxDefaultPosition, wxDefaultSize, wxTB_FLAT | wxTB_NODIVIDER);
@@ -522,6 +538,7 @@ frmQuery::frmQuery(frmMain *form, const wxString &_title, pgConn *_conn, const w
 	// Results pane
 	outputPane = new ctlAuiNotebook(this, CTL_NTBKGQB, wxDefaultPosition, wxSize(500, 300), wxAUI_NB_TOP | wxAUI_NB_TAB_SPLIT | wxAUI_NB_TAB_MOVE | wxAUI_NB_SCROLL_BUTTONS | wxAUI_NB_WINDOWLIST_BUTTON);
 	sqlResult = new ctlSQLResult(outputPane, conn, CTL_SQLRESULT, wxDefaultPosition, wxDefaultSize);
+	findBar = new ctlResultFindBar(this, sqlResult);
 	explainCanvas = new ExplainCanvas(outputPane);
 	msgResult = new wxTextCtrl(outputPane, CTL_MSGRESULT, wxT(""), wxDefaultPosition, wxDefaultSize, wxTE_MULTILINE | wxTE_READONLY | wxTE_DONTWRAP);
 	msgResult->SetFont(settings->GetSQLFont());
@@ -557,6 +574,7 @@ frmQuery::frmQuery(frmMain *form, const wxString &_title, pgConn *_conn, const w
 	manager.AddPane(toolBar, wxAuiPaneInfo().Name(wxT("toolBar")).Caption(_("Tool bar")).ToolbarPane().Top().LeftDockable(false).RightDockable(false));
 	manager.AddPane(cbConnection, wxAuiPaneInfo().Name(wxT("databaseBar")).Caption(_("Connection bar")).ToolbarPane().Top().LeftDockable(false).RightDockable(false));
 	manager.AddPane(outputPane, wxAuiPaneInfo().Name(wxT("outputPane")).Caption(_("Output pane")).Bottom().MinSize(wxSize(200, 100)).BestSize(wxSize(550, 300)));
+	manager.AddPane(findBar, wxAuiPaneInfo().Name(wxT("findBar")).Caption(_("Find in results")).Bottom().Layer(1).CaptionVisible(false).CloseButton(false).Floatable(false).Hide());
 	manager.AddPane(scratchPad, wxAuiPaneInfo().Name(wxT("scratchPad")).Caption(_("Scratch pad")).Right().MinSize(wxSize(100, 100)).BestSize(wxSize(250, 200)));
 	manager.AddPane(sqlNotebook, wxAuiPaneInfo().Name(wxT("sqlQuery")).Caption(_("SQL query")).Center().CaptionVisible(false).CloseButton(false).MinSize(wxSize(200, 100)).BestSize(wxSize(350, 200)));
 
@@ -647,6 +665,7 @@ frmQuery::frmQuery(frmMain *form, const wxString &_title, pgConn *_conn, const w
 	queryMenu->Enable(MNU_CLEARHISTORY, false);
 	setTools(false);
 	lastFileFormat = settings->GetUnicodeFile();
+	resultMenuRow = resultMenuCol = -1;
 
 	// Note that under GTK+, SetMaxLength() function may only be used with single line text controls.
 	// (see http://docs.wxwidgets.org/2.8/wx_wxtextctrl.html#wxtextctrlsetmaxlength)
@@ -1386,6 +1405,16 @@ void frmQuery::OnSelectAll(wxCommandEvent &ev)
 
 void frmQuery::OnSearchReplace(wxCommandEvent &ev)
 {
+	// In the results, find in the data instead
+	wxWindow *wnd = currentControl();
+	if (wnd && (relatesToWindow(wnd, sqlResult) || relatesToWindow(wnd, findBar)))
+	{
+		manager.GetPane(wxT("findBar")).Show(true);
+		manager.Update();
+		findBar->Activate();
+		return;
+	}
+
 	sqlQuery->OnSearchReplace(ev);
 }
 
@@ -1487,6 +1516,10 @@ void frmQuery::updateMenu(bool allowUpdateModelSize)
 		{
 			canPaste = true;
 		}
+		else if (relatesToWindow(wnd, sqlResult))
+		{
+			canFind = true;
+		}
 		canCopy = true;
 		canCut = true;
 		canClear = true;
@@ -2488,6 +2521,7 @@ void frmQuery::execQuery(const wxString &query, int resultToRetrieve, bool singl
 	qi->explain = explain;
 	qi->verbose = verbose;
 
+	wxString sentQuery = query;
 	if (toFile)
 	{
 		qi->toFileExportForm = new frmExport(this);
@@ -2498,6 +2532,26 @@ void frmQuery::execQuery(const wxString &query, int resultToRetrieve, bool singl
 			aborted = true;
 			return;
 		}
+
+		// The rows of a single query are streamed into the file by the
+		// server, instead of being read into memory first
+		wxString copyQuery = getCopyQuery(query, qi->toFileExportForm->GetCopyOptions(conn));
+		if (!copyQuery.IsEmpty())
+		{
+			qi->copyOutFile = new dataFileWriter();
+			if (!qi->copyOutFile->Open(qi->toFileExportForm->GetFilename()))
+			{
+				wxLogError(__("Failed to open file %s."), qi->toFileExportForm->GetFilename().c_str());
+				delete qi;
+				setTools(false);
+				aborted = true;
+				return;
+			}
+
+			wxLogInfo(wxT("Executing the query to %s with COPY"), qi->toFileExportForm->GetFilename().c_str());
+			sentQuery = copyQuery;
+			qi->queryOffset += (int)wxStrlen(COPY_QUERY_PREFIX);
+		}
 	}
 
 	// Remember the tab from which execute was called. By the time query completes, SQL tab selection may change.
@@ -2527,7 +2581,13 @@ void frmQuery::execQuery(const wxString &query, int resultToRetrieve, bool singl
 	if (!queryMenu->IsChecked(MNU_AUTOCOMMIT) && conn->GetTxStatus() == PQTRANS_IDLE && !isBeginNotRequired(query))
 		conn->ExecuteVoid(wxT("BEGIN;"));
 
-	if (sqlResult->Execute(query, resultToRetrieve, this, QUERY_COMPLETE, qi) >= 0)
+	// Show the rows as they arrive, unless they go somewhere else than the
+	// grid, or the query may return several results.
+	bool progressive = !toFile && !singleResult && !explain && isSingleStatement(query);
+
+	if (sqlResult->Execute(sentQuery, resultToRetrieve, this, QUERY_COMPLETE, qi, progressive,
+	                       qi->copyOutFile, qi->toFileExportForm && qi->toFileExportForm->IsCRLF(),
+	                       qi->toFileExportForm && qi->toFileExportForm->HasHeader()) >= 0)
 	{
 		// Return and wait for the result
 		return;
@@ -2536,6 +2596,137 @@ void frmQuery::execQuery(const wxString &query, int resultToRetrieve, bool singl
 	completeQuery(false, false, false);
 }
 
+bool frmQuery::isSingleStatement(const wxString &query, size_t *end, wxArrayString *words)
+{
+	size_t pos = 0, len = query.Length();
+	bool ended = false;
+
+	if (end)
+		*end = len;
+
+	while (pos < len)
+	{
+		wxChar c = query.GetChar(pos);
+
+		if (wxIsspace(c))
+		{
+			pos++;
+			continue;
+		}
+
+		// Comments may follow the last statement
+		if (c == '-' && pos + 1 < len && query.GetChar(pos + 1) == '-')
+		{
+			while (pos < len && query.GetChar(pos) != '\n')
+				pos++;
+			continue;
+		}
+		if (c == '/' && pos + 1 < len && query.GetChar(pos + 1) == '*')
+		{
+			int depth = 1;
+			pos += 2;
+			while (pos < len && depth)
+			{
+				if (query.Mid(pos, 2) == wxT("/*"))
+				{
+					depth++;
+					pos += 2;
+				}
+				else if (query.Mid(pos, 2) == wxT("*/"))
+				{
+					depth--;
+					pos += 2;
+				}
+				else
+					pos++;
+			}
+			continue;
+		}
+
+		if (ended)
+			return false;
+
+		if (c == ';')
+		{
+			ended = true;
+			if (end)
+				*end = pos;
+		}
+		else if (c == '\'' || c == '"')
+		{
+			// Doubled quotes just end and restart the literal. Whether a
+			// backslash escapes depends on the string syntax and settings:
+			// don't guess.
+			pos++;
+			while (pos < len && query.GetChar(pos) != c)
+			{
+				if (query.GetChar(pos) == '\\')
+					return false;
+				pos++;
+			}
+		}
+		else if (c == '$')
+		{
+			size_t end = pos + 1;
+			while (end < len && (wxIsalnum(query.GetChar(end)) || query.GetChar(end) == '_'))
+				end++;
+
+			if (end < len && query.GetChar(end) == '$' && !wxIsdigit(query.GetChar(pos + 1)))
+			{
+				wxString tag = query.Mid(pos, end - pos + 1);
+				int close = query.Mid(end + 1).Find(tag);
+				if (close == wxNOT_FOUND)
+					return false;
+				pos = end + 1 + close + tag.Length();
+				continue;
+			}
+		}
+		else if (wxIsalnum(c) || c == '_')
+		{
+			// Skip identifiers whole, they may contain dollars
+			size_t start = pos;
+			while (pos + 1 < len && (wxIsalnum(query.GetChar(pos + 1)) || query.GetChar(pos + 1) == '_' || query.GetChar(pos + 1) == '$'))
+				pos++;
+
+			if (words && !ended)
+				words->Add(query.Mid(start, pos - start + 1).Upper());
+		}
+		pos++;
+	}
+
+	return true;
+}
+
+
+// Wrap a single query returning rows into a COPY writing them out with the
+// options given, or return nothing if it can't be.
+wxString frmQuery::getCopyQuery(const wxString &query, const wxString &options)
+{
+	size_t end;
+	wxArrayString words;
+	if (options.IsEmpty() || !isSingleStatement(query, &end, &words) || words.IsEmpty())
+		return wxEmptyString;
+
+	wxString word = words.Item(0);
+	if (word != wxT("SELECT") && word != wxT("WITH") && word != wxT("VALUES") && word != wxT("TABLE"))
+		return wxEmptyString;
+
+	// COPY takes none of SELECT ... INTO, locking clauses or data modifying
+	// statements in WITH. Telling those apart from a column or a function
+	// argument of the same name takes a parser, so any of these words
+	// outside literals and comments keeps the query as it is.
+	static const wxChar *notPlain[] = { wxT("INTO"), wxT("FOR"), wxT("INSERT"), wxT("UPDATE"), wxT("DELETE"), wxT("MERGE") };
+	for (size_t i = 0 ; i < sizeof(notPlain) / sizeof(notPlain[0]) ; i++)
+	{
+		if (words.Index(notPlain[i]) != wxNOT_FOUND)
+			return wxEmptyString;
+	}
+
+	// The query may end in a comment
+	return COPY_QUERY_PREFIX + query.Left(end) + wxT("\n) TO STDOUT WITH (") + options + wxT(")");
+}
+
+
 bool frmQuery::isBeginNotRequired(wxString query)
 {
 	int	wordlen = 0;
@@ -2719,6 +2910,139 @@ bool frmQuery::isBeginNotRequired(wxString query)
 	return false;
 }
 
+void frmQuery::OnResultCellRightClick(wxGridEvent &event)
+{
+	if (!sqlResult->CanSortRows())
+	{
+		event.Skip();
+		return;
+	}
+
+	resultMenuRow = event.GetRow();
+	resultMenuCol = event.GetCol();
+	sqlResult->SetGridCursor(resultMenuRow, resultMenuCol);
+
+	wxMenu *xmenu = new wxMenu();
+
+	xmenu->Append(MNU_INCLUDEFILTER, _("Filter By &Selection"), _("Display only those rows that have this value in this column."));
+	xmenu->Append(MNU_EXCLUDEFILTER, _("Filter E&xcluding Selection"), _("Display only those rows that do not have this value in this column."));
+	xmenu->Append(MNU_REMOVEFILTERS, _("&Remove Filter"), _("Display all the rows of the result."));
+	xmenu->InsertSeparator(3);
+	xmenu->Append(MNU_ASCSORT, _("Sort &Ascending"), _("Sort the rows by this column, in ascending order."));
+	xmenu->Append(MNU_DESCSORT, _("Sort &Descending"), _("Sort the rows by this column, in descending order."));
+	xmenu->Append(MNU_REMOVESORT, _("&Remove Sort"), _("Display the rows in the order the server returned them."));
+
+	xmenu->Enable(MNU_REMOVEFILTERS, sqlResult->IsFiltered());
+	xmenu->Enable(MNU_REMOVESORT, sqlResult->IsSorted());
+
+	sqlResult->PopupMenu(xmenu);
+	delete xmenu;
+}
+
+
+void frmQuery::OnResultLabelRightClick(wxGridEvent &event)
+{
+	if (event.GetCol() < 0 || !sqlResult->CanSortRows())
+	{
+		event.Skip();
+		return;
+	}
+
+	resultMenuRow = -1;
+	resultMenuCol = event.GetCol();
+
+	wxMenu *xmenu = new wxMenu();
+
+	xmenu->Append(MNU_ASCSORT, _("Sort &Ascending"), _("Sort the rows by this column, in ascending order."));
+	xmenu->Append(MNU_DESCSORT, _("Sort &Descending"), _("Sort the rows by this column, in descending order."));
+	xmenu->Append(MNU_REMOVESORT, _("&Remove Sort"), _("Display the rows in the order the server returned them."));
+
+	xmenu->Enable(MNU_REMOVESORT, sqlResult->IsSorted());
+
+	sqlResult->PopupMenu(xmenu);
+	delete xmenu;
+}
+
+
+void frmQuery::OnIncludeFilter(wxCommandEvent &event)
+{
+	sqlResult->FilterRows(resultMenuRow, resultMenuCol, false);
+	ShowResultRows();
+}
+
+
+void frmQuery::OnExcludeFilter(wxCommandEvent &event)
+{
+	sqlResult->FilterRows(resultMenuRow, resultMenuCol, true);
+	ShowResultRows();
+}
+
+
+void frmQuery::OnRemoveFilters(wxCommandEvent &event)
+{
+	sqlResult->RemoveFilters();
+	ShowResultRows();
+}
+
+
+void frmQuery::OnAscSort(wxCommandEvent &event)
+{
+	sqlResult->SortRows(resultMenuCol, false);
+}
+
+
+void frmQuery::OnDescSort(wxCommandEvent &event)
+{
+	sqlResult->SortRows(resultMenuCol, true);
+}
+
+
+void frmQuery::OnRemoveSort(wxCommandEvent &event)
+{
+	sqlResult->RemoveSort();
+}
+
+
+void frmQuery::ShowResultRows()
+{
+	long rows = sqlResult->NumRows();
+
+	if (sqlResult->IsFiltered())
+		SetStatusText(wxString::Format(wxPLURAL("%ld of %ld row.", "%ld of %ld rows.", rows), (long)sqlResult->GetNumberRows(), rows), STATUSPOS_ROWS);
+	else
+		SetStatusText(wxString::Format(wxPLURAL("%ld row.", "%ld rows.", rows), rows), STATUSPOS_ROWS);
+}
+
+
+void frmQuery::OnQueryRows(pgQueryResultEvent &ev)
+{
+	if (sqlResult->RunStatus() != CTLSQL_RUNNING)
+		return;
+
+	if (!sqlResult->GetNumberRows())
+		outputPane->SetSelection(0);
+
+	sqlResult->AppendRows();
+
+	long rows = sqlResult->GetNumberRows();
+	SetStatusText(wxString::Format(wxPLURAL("%ld row so far.", "%ld rows so far.", rows), rows), STATUSPOS_ROWS);
+	SetStatusText(_("Retrieving data."), STATUSPOS_MSGS);
+}
+
+
+void frmQuery::OnSelectionStats(wxCommandEvent &ev)
+{
+	wxString text = ev.GetString();
+	int iWidths[8] = {0, -1, 40, 200, 80, 80, 80, 0};
+
+	if (!text.IsEmpty())
+		iWidths[STATUSPOS_STATS] = statusBar->GetTextExtent(text).GetWidth() + 20;
+
+	SetStatusWidths(8, iWidths);
+	SetStatusText(text, STATUSPOS_STATS);
+}
+
+
 // When the query completes, it raises an event which we process here.
 void frmQuery::OnQueryComplete(pgQueryResultEvent &ev)
 {
@@ -2747,8 +3071,32 @@ void frmQuery::OnQueryComplete(pgQueryResultEvent &ev)
 	elapsedQuery = wxGetLocalTimeMillis() - startTimeQuery;
 	SetStatusText(ElapsedTimeToStr(elapsedQuery), STATUSPOS_SECS);
 
+	// The data went straight to the file, which is left alone unless
+	// all of it got there
+	bool copiedOut = false;
+	if (qi->copyOutFile)
+	{
+		bool written = qi->copyOutFile->Close();
+		copiedOut = written && sqlResult->RunStatus() == PGRES_COMMAND_OK;
+
+		if (copiedOut)
+			frmExport::LogExported(sqlResult->InsertedCount(), qi->copyOutFile->GetBytesWritten(), elapsedQuery);
+		else
+		{
+			if (!written)
+				wxLogError(__("Failed to write file %s."), qi->copyOutFile->GetPath().c_str());
+			wxRemoveFile(qi->copyOutFile->GetPath());
+		}
+	}
+
 	if (sqlResult->RunStatus() != PGRES_TUPLES_OK)
 	{
+		// Rows streamed in before the failure are not the result
+		if (sqlResult->IsStreaming())
+		{
+			sqlResult->DiscardRows();
+			SetStatusText(wxT(""), STATUSPOS_ROWS);
+		}
 		outputPane->SetSelection(2);
 		if (sqlResult->RunStatus() == PGRES_COMMAND_OK)
 		{
@@ -2756,7 +3104,22 @@ void frmQuery::OnQueryComplete(pgQueryResultEvent &ev)
 
 			int insertedCount = sqlResult->InsertedCount();
 			OID insertedOid = sqlResult->InsertedOid();
-			if (insertedCount < 0)
+			if (qi->copyOutFile)
+			{
+				if (copiedOut)
+				{
+					SetStatusText(wxString::Format(wxPLURAL("%d row.", "%d rows.", insertedCount), insertedCount), STATUSPOS_ROWS);
+					showMessage(
+					    wxString::Format(
+					        _("Query returned successfully: %d rows written to file, %s execution time."),
+					        insertedCount,
+					        ElapsedTimeToStr(elapsedQuery).c_str()),
+					    _("Data written to file."));
+				}
+				else
+					showMessage(_("Data export aborted."));
+			}
+			else if (insertedCount < 0)
 			{
 				showMessage(
 				    wxString::Format(
@@ -3184,6 +3547,10 @@ void frmQuery::OnTimer(wxTimerEvent &event)
 		msgHistory->AppendText(str + wxT("\n"));
 	}
 
+	long copied = sqlResult->CopyRowsWritten();
+	if (copied)
+		SetStatusText(wxString::Format(wxPLURAL("%ld row written so far.", "%ld rows written so far.", copied), copied), STATUSPOS_ROWS);
+
 	// Increase the granularity for longer running queries
 	if (timer.IsRunning())
 	{
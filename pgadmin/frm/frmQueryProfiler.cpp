@@ -0,0 +1,272 @@
+//////////////////////////////////////////////////////////////////////////
+//
+// pgAdmin III - PostgreSQL Tools
+//
+// Copyright (C) 2002 - 2016, The pgAdmin Development Team
+// This software is released under the PostgreSQL Licence
+//
+// frmQueryProfiler.cpp - The queries run by pgAdmin, by shape
+//
+//////////////////////////////////////////////////////////////////////////
+
+#include "pgAdmin3.h"
+
+// wxWindows headers
+#include <wx/wx.h>
+#include <wx/clipbrd.h>
+#include <wx/hashmap.h>
+
+// App headers
+#include "frm/frmQueryProfiler.h"
+#include "frm/frmMain.h"
+#include "frm/menu.h"
+#include "ctl/ctlListView.h"
+#include "db/pgQueryProfiler.h"
+
+
+// The queries of one shape
+class profiledShape
+{
+public:
+	wxString shape;
+	wxArrayString sites;
+	wxArrayDouble msecs;
+	double total;
+	long rows, bytes;
+};
+
+WX_DECLARE_STRING_HASH_MAP(profiledShape *, profiledShapeMap);
+
+
+static int CompareDouble(double *a, double *b)
+{
+	return *a < *b ? -1 : (*a > *b ? 1 : 0);
+}
+
+
+static int CompareTotal(profiledShape **a, profiledShape **b)
+{
+	// Most expensive first
+	return (*a)->total < (*b)->total ? 1 : ((*a)->total > (*b)->total ? -1 : 0);
+}
+
+WX_DEFINE_ARRAY_PTR(profiledShape *, profiledShapeArray);
+
+
+static wxString FormatMsec(double msec)
+{
+	return wxString::Format(wxT("%.1f"), msec);
+}
+
+
+// Nearest-rank percentile of sorted timings
+static double Percentile(const wxArrayDouble &msecs, int percent)
+{
+	size_t rank = (msecs.GetCount() * percent + 99) / 100;
+
+	if (rank < 1)
+		rank = 1;
+
+	return msecs.Item(rank - 1);
+}
+
+
+BEGIN_EVENT_TABLE(frmQueryProfiler, pgFrame)
+	EVT_MENU(MNU_EXIT,          frmQueryProfiler::OnExit)
+	EVT_MENU(MNU_COPY,          frmQueryProfiler::OnCopy)
+	EVT_MENU(MNU_REFRESH,       frmQueryProfiler::OnRefresh)
+	EVT_MENU(MNU_CLEAR,         frmQueryProfiler::OnClear)
+	EVT_CLOSE(                  frmQueryProfiler::OnClose)
+END_EVENT_TABLE()
+
+
+frmQueryProfiler::frmQueryProfiler(frmMain *form) : pgFrame(NULL, _("Query Profiler"))
+{
+	dlgName = wxT("frmQueryProfiler");
+	mainForm = form;
+
+	appearanceFactory->SetIcons(this);
+	RestorePosition(-1, -1, 800, 500, 400, 200);
+	SetFont(settings->GetSystemFont());
+
+	// Build menu bar
+	menuBar = new wxMenuBar();
+
+	fileMenu = new wxMenu();
+	fileMenu->Append(MNU_EXIT, _("E&xit\tCtrl-W"), _("Exit query profiler window"));
+	menuBar->Append(fileMenu, _("&File"));
+
+	editMenu = new wxMenu();
+	editMenu->Append(MNU_COPY, _("&Copy\tCtrl-C"), _("Copy selected lines to clipboard"), wxITEM_NORMAL);
+	menuBar->Append(editMenu, _("&Edit"));
+
+	viewMenu = new wxMenu();
+	viewMenu->Append(MNU_REFRESH, _("&Refresh\tCtrl-R"), _("Show the queries recorded since the last refresh."));
+	viewMenu->Append(MNU_CLEAR, _("C&lear"), _("Forget the queries recorded so far."));
+	menuBar->Append(viewMenu, _("&View"));
+
+	SetMenuBar(menuBar);
+
+	statusBar = CreateStatusBar(1);
+	SetStatusBarPane(-1);
+
+	queryList = new ctlListView(this, -1, wxDefaultPosition, wxDefaultSize, wxSUNKEN_BORDER | wxLC_REPORT);
+	queryList->AddColumn(_("Query"), 300);
+	queryList->AddColumn(_("Count"), 60, wxLIST_FORMAT_RIGHT);
+	queryList->AddColumn(_("Total (ms)"), 80, wxLIST_FORMAT_RIGHT);
+	queryList->AddColumn(_("p50 (ms)"), 70, wxLIST_FORMAT_RIGHT);
+	queryList->AddColumn(_("p99 (ms)"), 70, wxLIST_FORMAT_RIGHT);
+	queryList->AddColumn(_("Rows"), 70, wxLIST_FORMAT_RIGHT);
+	queryList->AddColumn(_("Bytes"), 80, wxLIST_FORMAT_RIGHT);
+	queryList->AddColumn(_("Called from"), 200);
+}
+
+
+frmQueryProfiler::~frmQueryProfiler()
+{
+	if (mainForm)
+		mainForm->RemoveFrame(this);
+
+	SavePosition();
+}
+
+
+void frmQueryProfiler::Go()
+{
+	Aggregate();
+	Show(true);
+}
+
+
+void frmQueryProfiler::OnClose(wxCloseEvent &event)
+{
+	Destroy();
+}
+
+
+void frmQueryProfiler::OnRefresh(wxCommandEvent &event)
+{
+	Aggregate();
+}
+
+
+void frmQueryProfiler::OnClear(wxCommandEvent &event)
+{
+	pgQueryProfiler::Clear();
+	Aggregate();
+}
+
+
+void frmQueryProfiler::OnCopy(wxCommandEvent &event)
+{
+	wxString text;
+	long row = queryList->GetFirstSelected();
+
+	while (row >= 0)
+	{
+		for (int col = 0; col < queryList->GetColumnCount(); col++)
+			text.Append(queryList->GetText(row, col) + wxT("\t"));
+#ifdef __WXMSW__
+		text.Append(wxT("\r\n"));
+#else
+		text.Append(wxT("\n"));
+#endif
+		row = queryList->GetNextSelected(row);
+	}
+
+	if (!text.IsEmpty() && wxTheClipboard->Open())
+	{
+		wxTheClipboard->SetData(new wxTextDataObject(text));
+		wxTheClipboard->Close();
+	}
+}
+
+
+void frmQueryProfiler::Aggregate()
+{
+	pgProfiledQueryArray queries;
+	pgQueryProfiler::GetQueries(queries);
+
+	profiledShapeMap byShape;
+	profiledShapeArray shapes;
+	double total = 0;
+	size_t i;
+
+	for (i = 0 ; i < queries.GetCount() ; i++)
+	{
+		pgProfiledQuery &query = queries.Item(i);
+		wxString key = pgQueryProfiler::GetShape(query.sql);
+
+		profiledShape *shape = byShape[key];
+		if (!shape)
+		{
+			shape = new profiledShape;
+			shape->shape = key;
+			shape->total = 0;
+			shape->rows = 0;
+			shape->bytes = 0;
+			byShape[key] = shape;
+		}
+
+		shape->msecs.Add(query.msec);
+		shape->total += query.msec;
+		shape->rows += query.rows;
+		shape->bytes += query.bytes;
+		if (!query.site.IsEmpty() && shape->sites.Index(query.site) == wxNOT_FOUND)
+			shape->sites.Add(query.site);
+
+		total += query.msec;
+	}
+
+	profiledShapeMap::iterator it;
+	for (it = byShape.begin() ; it != byShape.end() ; ++it)
+		shapes.Add(it->second);
+	shapes.Sort(CompareTotal);
+
+	queryList->Freeze();
+	queryList->DeleteAllItems();
+
+	for (i = 0 ; i < shapes.GetCount() ; i++)
+	{
+		profiledShape *shape = shapes.Item(i);
+		shape->msecs.Sort(CompareDouble);
+
+		long pos = queryList->InsertItem(i, shape->shape);
+		queryList->SetItem(pos, 1, NumToStr((long)shape->msecs.GetCount()));
+		queryList->SetItem(pos, 2, FormatMsec(shape->total));
+		queryList->SetItem(pos, 3, FormatMsec(Percentile(shape->msecs, 50)));
+		queryList->SetItem(pos, 4, FormatMsec(Percentile(shape->msecs, 99)));
+		queryList->SetItem(pos, 5, NumToStr(shape->rows));
+		queryList->SetItem(pos, 6, NumToStr(shape->bytes));
+
+		wxString sites;
+		for (size_t site = 0 ; site < shape->sites.GetCount() ; site++)
+		{
+			if (site)
+				sites += wxT(", ");
+			sites += shape->sites.Item(site);
+		}
+		queryList->SetItem(pos, 7, sites);
+
+		delete shape;
+	}
+
+	queryList->Thaw();
+
+	SetStatusText(wxString::Format(_("%d queries of %d kinds, %s ms in total"),
+	                               (int)queries.GetCount(), (int)shapes.GetCount(), FormatMsec(total).c_str()));
+}
+
+
+queryProfilerFactory::queryProfilerFactory(menuFactoryList *list, wxMenu *mnu, ctlMenuToolbar *toolbar) : actionFactory(list)
+{
+	mnu->Append(id, _("Query &Profiler"), _("Shows the queries pgAdmin has run, and the time they took."));
+}
+
+
+wxWindow *queryProfilerFactory::StartDialog(frmMain *form, pgObject *obj)
+{
+	frmQueryProfiler *profiler = new frmQueryProfiler(form);
+	profiler->Go();
+	return profiler;
+}
@@ -1471,6 +1471,7 @@ void reportObjectDependenciesFactory::GenerateReport(frmReport *report, pgObject
 
 	ctlListView *list = GetFrmMain()->GetDependencies();
 	object->ShowDependencies(parent, list);
+	list->WaitAsync();
 
 	report->XmlAddSectionTableFromListView(section, list);
 }
@@ -1504,6 +1505,7 @@ void reportObjectDependentsFactory::GenerateReport(frmReport *report, pgObject *
 
 	ctlListView *list = GetFrmMain()->GetReferencedBy();
 	object->ShowDependents(parent, list);
+	list->WaitAsync();
 
 	report->XmlAddSectionTableFromListView(section, list);
 }
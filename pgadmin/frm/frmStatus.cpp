@@ -1428,15 +1428,38 @@ void frmStatus::OnRefreshStatusTimer(wxTimerEvent &event)
 		// Clear the queries array content
 		queries.Clear();
 
+		// Look up the columns once, rather than by name on every row
+		bool hasAppName = connection->BackendMinimumVersion(8, 5);
+		bool hasClient = connection->BackendMinimumVersion(8, 1);
+		bool hasXactStart = connection->BackendMinimumVersion(8, 3);
+		bool hasState = connection->BackendMinimumVersion(9, 2);
+		bool hasXid = connection->BackendMinimumVersion(9, 4);
+
+		int pidCol = dataSet1->ColNumber(wxT("pid"));
+		int queryCol = dataSet1->ColNumber(wxT("query"));
+		int appNameCol = hasAppName ? dataSet1->ColNumber(wxT("application_name")) : -1;
+		int datnameCol = dataSet1->ColNumber(wxT("datname"));
+		int usenameCol = dataSet1->ColNumber(wxT("usename"));
+		int clientCol = hasClient ? dataSet1->ColNumber(wxT("client")) : -1;
+		int backendStartCol = hasClient ? dataSet1->ColNumber(wxT("backend_start")) : -1;
+		int queryStartCol = dataSet1->ColNumber(wxT("query_start"));
+		int xactStartCol = hasXactStart ? dataSet1->ColNumber(wxT("xact_start")) : -1;
+		int stateCol = hasState ? dataSet1->ColNumber(wxT("state")) : -1;
+		int stateChangeCol = hasState ? dataSet1->ColNumber(wxT("state_change")) : -1;
+		int xidCol = hasXid ? dataSet1->ColNumber(wxT("backend_xid")) : -1;
+		int xminCol = hasXid ? dataSet1->ColNumber(wxT("backend_xmin")) : -1;
+		int blockedByCol = dataSet1->ColNumber(wxT("blockedby"));
+		int slowQueryCol = dataSet1->ColNumber(wxT("slowquery"));
+
 		while (!dataSet1->Eof())
 		{
-			pid = dataSet1->GetLong(wxT("pid"));
+			pid = dataSet1->GetLong(pidCol);
 
 			// Update the UI
 			if (pid != backend_pid)
 			{
 				// Add the query content to the queries array
-				queries.Add(dataSet1->GetVal(wxT("query")));
+				queries.Add(dataSet1->GetVal(queryCol));
 
 				if (row >= statusList->GetItemCount())
 				{
@@ -1448,40 +1471,40 @@ void frmStatus::OnRefreshStatusTimer(wxTimerEvent &event)
 					statusList->SetItem(row, 0, NumToStr(pid));
 				}
 
-				wxString qry = dataSet1->GetVal(wxT("query"));
+				wxString qry = dataSet1->GetVal(queryCol);
 
 				int colpos = 1;
-				if (connection->BackendMinimumVersion(8, 5))
-					statusList->SetItem(row, colpos++, dataSet1->GetVal(wxT("application_name")));
-				statusList->SetItem(row, colpos++, dataSet1->GetVal(wxT("datname")));
-				statusList->SetItem(row, colpos++, dataSet1->GetVal(wxT("usename")));
+				if (hasAppName)
+					statusList->SetItem(row, colpos++, dataSet1->GetVal(appNameCol));
+				statusList->SetItem(row, colpos++, dataSet1->GetVal(datnameCol));
+				statusList->SetItem(row, colpos++, dataSet1->GetVal(usenameCol));
 
-				if (connection->BackendMinimumVersion(8, 1))
+				if (hasClient)
 				{
-					statusList->SetItem(row, colpos++, dataSet1->GetVal(wxT("client")));
-					statusList->SetItem(row, colpos++, dataSet1->GetVal(wxT("backend_start")));
+					statusList->SetItem(row, colpos++, dataSet1->GetVal(clientCol));
+					statusList->SetItem(row, colpos++, dataSet1->GetVal(backendStartCol));
 				}
 				if (connection->BackendMinimumVersion(7, 4))
 				{
-					statusList->SetItem(row, colpos++, dataSet1->GetVal(wxT("query_start")));
+					statusList->SetItem(row, colpos++, dataSet1->GetVal(queryStartCol));
 				}
 
-				if (connection->BackendMinimumVersion(8, 3))
-					statusList->SetItem(row, colpos++, dataSet1->GetVal(wxT("xact_start")));
+				if (hasXactStart)
+					statusList->SetItem(row, colpos++, dataSet1->GetVal(xactStartCol));
 
-				if (connection->BackendMinimumVersion(9, 2))
+				if (hasState)
 				{
-					statusList->SetItem(row, colpos++, dataSet1->GetVal(wxT("state")));
-					statusList->SetItem(row, colpos++, dataSet1->GetVal(wxT("state_change")));
+					statusList->SetItem(row, colpos++, dataSet1->GetVal(stateCol));
+					statusList->SetItem(row, colpos++, dataSet1->GetVal(stateChangeCol));
 				}
 
-				if (connection->BackendMinimumVersion(9, 4))
+				if (hasXid)
 				{
-					statusList->SetItem(row, colpos++, dataSet1->GetVal(wxT("backend_xid")));
-					statusList->SetItem(row, colpos++, dataSet1->GetVal(wxT("backend_xmin")));
+					statusList->SetItem(row, colpos++, dataSet1->GetVal(xidCol));
+					statusList->SetItem(row, colpos++, dataSet1->GetVal(xminCol));
 				}
 
-				statusList->SetItem(row, colpos++, dataSet1->GetVal(wxT("blockedby")));
+				statusList->SetItem(row, colpos++, dataSet1->GetVal(blockedByCol));
 				statusList->SetItem(row, colpos, qry);
 
 				// Colorize the new line
@@ -1492,17 +1515,17 @@ void frmStatus::OnRefreshStatusTimer(wxTimerEvent &event)
 					if (qry == wxT("<IDLE>") || qry == wxT("<IDLE> in transaction0"))
 						statusList->SetItemBackgroundColour(row,
 						                                    wxColour(settings->GetIdleProcessColour()));
-					if (connection->BackendMinimumVersion(9, 2))
+					if (hasState)
 					{
-						if (dataSet1->GetVal(wxT("state")) != wxT("active"))
+						if (dataSet1->GetVal(stateCol) != wxT("active"))
 							statusList->SetItemBackgroundColour(row,
 							                                    wxColour(settings->GetIdleProcessColour()));
 					}
 
-					if (dataSet1->GetVal(wxT("blockedby")).Length() > 0)
+					if (dataSet1->GetVal(blockedByCol).Length() > 0)
 						statusList->SetItemBackgroundColour(row,
 						                                    wxColour(settings->GetBlockedProcessColour()));
-					if (dataSet1->GetBool(wxT("slowquery")))
+					if (dataSet1->GetBool(slowQueryCol))
 						statusList->SetItemBackgroundColour(row,
 						                                    wxColour(settings->GetSlowProcessColour()));
 				}
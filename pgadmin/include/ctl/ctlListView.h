@@ -15,14 +15,20 @@
 // wxWindows headers
 #include <wx/wx.h>
 #include <wx/listctrl.h>
+#include <wx/evtloop.h>
 #include "utils/misc.h"
 
 class frmMain;
+class pgConn;
+class pgConnResultEvent;
+class pgObject;
+class pgSet;
 
 class ctlListView : public wxListView
 {
 public:
 	ctlListView(wxWindow *p, int id, wxPoint pos, wxSize siz, long attr = 0);
+	~ctlListView();
 	long GetSelection();
 	wxString GetText(long row, long col = 0);
 
@@ -69,6 +75,38 @@ public:
 	{
 		DeleteItem(GetSelection());
 	}
+
+	// Fill the list from queries run in the background: AppendItemsAsync()
+	// appends the columns of the first row as name/value pairs, and
+	// SetItemAsync() shows the first value in the given cell, handing the
+	// result to the owner's SetAsyncResult() first if there is one.
+	// AppendRowsAsync() leaves the rows to the owner's ShowAsyncRows(), in
+	// the order the queries were queued in. Results still outstanding are
+	// dropped by ClearAsync(), or waited for by WaitAsync().
+	long AppendItemsAsync(pgConn *conn, const wxString &query, const wxArrayString &params = wxArrayString());
+	long SetItemAsync(long item, int column, pgConn *conn, const wxString &query, const wxArrayString &params = wxArrayString(), pgObject *owner = 0);
+	long AppendRowsAsync(pgConn *conn, const wxString &query, pgObject *owner, int step);
+	void ClearAsync();
+	void WaitAsync();
+
+	// Objects being deleted aren't handed their results any more
+	static void ForgetAsyncOwner(pgObject *owner);
+
+private:
+	void OnAsyncResult(pgConnResultEvent &ev);
+	void ShowAsyncRows();
+
+	wxArrayLong asyncRequests, asyncItems;
+	wxArrayInt asyncColumns;
+	wxArrayPtrVoid asyncOwners;
+
+	// The results of AppendRowsAsync() waiting for those queued before
+	wxArrayPtrVoid asyncSets;
+	wxArrayString asyncErrors;
+	wxEventLoop *asyncLoop;
+
+	// All the list views there are, for ForgetAsyncOwner()
+	static wxArrayPtrVoid s_views;
 };
 
 
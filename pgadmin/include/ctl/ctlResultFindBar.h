@@ -0,0 +1,57 @@
+//////////////////////////////////////////////////////////////////////////
+//
+// pgAdmin III - PostgreSQL Tools
+//
+// Copyright (C) 2002 - 2016, The pgAdmin Development Team
+// This software is released under the PostgreSQL Licence
+//
+// ctlResultFindBar.h - Find bar for result grids
+//
+//////////////////////////////////////////////////////////////////////////
+
+#ifndef CTLRESULTFINDBAR_H
+#define CTLRESULTFINDBAR_H
+
+// wxWindows headers
+#include <wx/wx.h>
+#include <wx/timer.h>
+
+class ctlSQLGrid;
+
+// Finds text in the values of a grid, as the user types. Meant to be a
+// pane of the wxAuiManager of the frame; closing it hides the pane.
+class ctlResultFindBar : public wxPanel
+{
+public:
+	ctlResultFindBar(wxWindow *parent, ctlSQLGrid *_grid);
+	~ctlResultFindBar();
+
+	// Focus the text, searching the current rows for it
+	void Activate();
+
+private:
+	void OnTextChanged(wxCommandEvent &ev);
+	void OnOptionChanged(wxCommandEvent &ev);
+	void OnFindNext(wxCommandEvent &ev);
+	void OnFindPrevious(wxCommandEvent &ev);
+	void OnClose(wxCommandEvent &ev);
+	void OnTimer(wxTimerEvent &ev);
+
+	void Restart();
+	void Find(bool forward);
+	void UpdateStatus();
+
+	ctlSQLGrid *grid;
+	wxTextCtrl *txtFind;
+	wxCheckBox *chkMatchCase, *chkRegex;
+	wxStaticText *stStatus;
+	wxTimer timer;
+
+	// A move waiting for the rows it needs to be scanned
+	bool movePending, moveForward;
+	wxString errMsg;
+
+	DECLARE_EVENT_TABLE()
+};
+
+#endif
@@ -15,15 +15,17 @@
 // wxWindows headers
 #include <wx/grid.h>
 
+class pgSetSearch;
 
 class ctlSQLGrid : public wxGrid
 {
 public:
 	ctlSQLGrid(wxWindow *parent, wxWindowID id, const wxPoint &pos, const wxSize &size);
 	ctlSQLGrid();
+	~ctlSQLGrid();
 
 	wxString GetExportLine(int row);
-	wxString GetExportLine(int row, wxArrayInt cols);
+	wxString GetExportLine(int row, const wxArrayInt &cols);
 	wxString GetExportLine(int row, int col1, int col2);
 	virtual bool IsColText(int col)
 	{
@@ -31,10 +33,29 @@ public:
 	}
 	int Copy();
 
+	// The rows and columns of the selection, or of the cursor cell if
+	// nothing is selected, which returns false
+	bool GetSelectedRowsAndCols(wxArrayInt &rows, wxArrayInt &cols);
+
+	// Append the text of the cells to copy, a line per row. Returns false
+	// if the copy was cancelled.
+	virtual bool AppendLines(wxString &str, const wxArrayInt &rows, const wxArrayInt &cols);
+
 	virtual bool CheckRowPresent(int row)
 	{
 		return true;
 	}
+
+	// Find in the values of the grid. The search runs in the background;
+	// FindMatch moves the cursor to the next match from it, returning one
+	// of the PGSETSEARCH_ values. Grids changing their rows stop it.
+	bool StartSearch(const wxString &pattern, bool matchCase, bool useRegex, wxString &errMsg);
+	int FindMatch(bool forward);
+	void StopSearch();
+	pgSetSearch *GetSearch() const
+	{
+		return search;
+	}
 	wxSize GetBestSize(int row, int col);
 	void OnLabelDoubleClick(wxGridEvent &event);
 	void OnLabelClick(wxGridEvent &event);
@@ -47,19 +68,36 @@ public:
 	DECLARE_DYNAMIC_CLASS(ctlSQLGrid)
 	DECLARE_EVENT_TABLE()
 
+protected:
+	// The search over the current rows, NULL if they can't be searched
+	virtual pgSetSearch *CreateSearch(const wxString &pattern, bool matchCase, bool useRegex)
+	{
+		return NULL;
+	}
+
 private:
 	void OnCopy(wxCommandEvent &event);
 	void OnMouseWheel(wxMouseEvent &event);
 	void OnGridColSize(wxGridSizeEvent &event);
 	wxString GetColumnName(int colNum);
 	wxString GetColKeyValue(int col);
-	void AppendColumnHeader(wxString &str, int start, int end);
-	void AppendColumnHeader(wxString &str, wxArrayInt columns);
+	void AppendColumnHeader(wxString &str, const wxArrayInt &columns);
+	int EstimateTextWidth(wxDC &dc, const wxString &text);
+
+	WX_DECLARE_HASH_MAP( int, int, wxIntegerHash, wxIntegerEqual, GlyphWidthHashMap );
 
 	// Stores sizes of colums explicitly resized by user
 	ColKeySizeHashMap colSizes;
 	// Max size for each column
 	wxArrayInt colMaxSizes;
+
+	// Character widths of the font text widths are estimated for
+	wxFont glyphFont;
+	int asciiWidths[128];
+	GlyphWidthHashMap glyphWidths;
+
+	pgSetSearch *search;
+	bool searchFromCursor;
 };
 
 #endif
@@ -14,14 +14,23 @@
 
 // wxWindows headers
 #include <wx/thread.h>
+#include <wx/timer.h>
 
 #include "db/pgSet.h"
+#include "db/pgSetIndex.h"
 #include "db/pgConn.h"
 #include "ctlSQLGrid.h"
 #include "frm/frmExport.h"
 
 #define CTLSQL_RUNNING 100  // must be greater than ExecStatusType PGRES_xxx values
 
+class pgSetStats;
+class dataFileWriter;
+
+// Sent up from the result as the figures for the numbers selected in it
+// come in, as the text of the event: empty when there are none to show.
+extern const wxEventType SelectionStatsEvent;
+
 class ctlSQLResult : public ctlSQLGrid
 {
 public:
@@ -29,11 +38,13 @@ public:
 	~ctlSQLResult();
 
 
-	int Execute(const wxString &query, int resultToDisplay = 0, wxWindow *caller = 0, long eventId = 0, void *data = 0); // > 0: resultset to display, <=0: last result
+	int Execute(const wxString &query, int resultToDisplay = 0, wxWindow *caller = 0, long eventId = 0, void *data = 0, bool progressive = false, // > 0: resultset to display, <=0: last result
+	            dataFileWriter *copyOutFile = 0, bool copyOutCRLF = false, bool copyOutHeader = false); // the data of a COPY TO STDOUT goes to the file
 	void SetConnection(pgConn *conn);
 	long NumRows() const;
 	long InsertedCount() const;
 	OID  InsertedOid() const;
+	long CopyRowsWritten() const;
 
 	int Abort();
 
@@ -47,6 +58,7 @@ public:
 
 	wxString OnGetItemText(long item, long col) const;
 	bool IsColText(int col);
+	bool AppendLines(wxString &str, const wxArrayInt &rows, const wxArrayInt &cols);
 	bool hasRowNumber()
 	{
 		return !rowcountSuppressed;
@@ -59,6 +71,30 @@ public:
 
 	void DisplayData(bool single = false);
 
+	// Show the rows received so far by a progressive query, as announced
+	// by its PGQueryRowsEvent. DisplayData() completes the result, or
+	// DiscardRows() removes the rows shown if the query failed or was
+	// cancelled before all of them arrived.
+	void AppendRows();
+	void DiscardRows();
+	bool IsStreaming();
+
+	// Order and filter the rows shown, without asking the server. Rows and
+	// columns are those of the grid. The result must be complete.
+	bool CanSortRows();
+	void SortRows(int col, bool descending);
+	void FilterRows(int row, int col, bool exclude);
+	void RemoveSort();
+	void RemoveFilters();
+	bool IsSorted() const
+	{
+		return index && index->IsSorted();
+	}
+	bool IsFiltered() const
+	{
+		return index && index->IsFiltered();
+	}
+
 	bool GetRowCountSuppressed()
 	{
 		return rowcountSuppressed;
@@ -67,21 +103,85 @@ public:
 	void SetMaxRows(int rows);
 	void ResultsFinished();
 	void OnGridSelect(wxGridRangeSelectEvent &event);
+	void OnCellSelect(wxGridEvent &event);
+	void OnSettingsChanged(wxCommandEvent &event);
 
 	wxArrayString colNames;
 	wxArrayString colTypes;
 	wxArrayLong colTypClasses;
 
+protected:
+	pgSetSearch *CreateSearch(const wxString &pattern, bool matchCase, bool useRegex);
+
 private:
+	void ApplyIndex();
+	void OnIndexBuilt(wxCommandEvent &event);
+	void StopIndexBuild();
+	void ShowIndexRows(const wxArrayInt *rows);
+
+	// Summing up the selected numbers waits for the selection to settle,
+	// and starts over whenever it changes
+	void SelectionChanged();
+	void StartStats();
+	void StopStats();
+	void ShowStats(const wxString &text);
+	void OnStatsTimer(wxTimerEvent &event);
+	void OnStatsDone(wxCommandEvent &event);
+
 	pgQueryThread *thread;
+	pgSetIndex *index;
+	pgSetStats *stats;
+	wxTimer statsTimer;
+	wxString statsText;
 	pgConn *conn;
 	bool rowcountSuppressed;
 };
 
+// A rendered cell, in the cache of recently shown cells. The key is the
+// row times the number of columns plus the column, which may not fit a long.
+struct sqlResultCell
+{
+	wxLongLong_t key;
+	wxString value;
+	int newer, older;
+};
+
+class sqlResultCellKeyHash
+{
+public:
+	sqlResultCellKeyHash() { }
+	unsigned long operator()(const wxLongLong_t &key) const
+	{
+		return (unsigned long)(key ^ (key >> 32));
+	}
+	sqlResultCellKeyHash &operator=(const sqlResultCellKeyHash &)
+	{
+		return *this;
+	}
+};
+
+class sqlResultCellKeyEqual
+{
+public:
+	sqlResultCellKeyEqual() { }
+	bool operator()(const wxLongLong_t &a, const wxLongLong_t &b) const
+	{
+		return a == b;
+	}
+	sqlResultCellKeyEqual &operator=(const sqlResultCellKeyEqual &)
+	{
+		return *this;
+	}
+};
+
+WX_DECLARE_HASH_MAP(wxLongLong_t, int, sqlResultCellKeyHash, sqlResultCellKeyEqual, sqlResultCellHash);
+
 class sqlResultTable : public wxGridTableBase
 {
 public:
 	sqlResultTable();
+	~sqlResultTable();
+
 	wxString GetValue(int row, int col);
 	int GetNumberRows();
 	int GetNumberCols();
@@ -97,7 +197,47 @@ public:
 	void SetThread(pgQueryThread *t)
 	{
 		thread = t;
+		streaming = false;
+		mapped = false;
+		rowMap.Empty();
+		ClearCache();
+	}
+
+	// The rows of the result to show, in order, instead of all of them
+	void SetRowMap(const wxArrayInt &rows)
+	{
+		rowMap = rows;
+		mapped = true;
+	}
+	void ClearRowMap()
+	{
+		rowMap.Empty();
+		mapped = false;
+	}
+	long MapRow(int row) const
+	{
+		return mapped ? rowMap.Item(row) : row;
 	}
+	bool IsMapped() const
+	{
+		return mapped;
+	}
+
+	// While rows stream in, the connection is busy, so the column types
+	// can't be looked up: cells are shown unformatted meanwhile.
+	void SetStreaming(bool s)
+	{
+		streaming = s;
+	}
+	bool IsStreaming() const
+	{
+		return streaming;
+	}
+
+	// Take the formatting rules for the result, once its column types are
+	// known. Cells are rendered with them until the next call.
+	void SetFormat();
+	void ClearCache();
 	bool DeleteRows(size_t pos = 0, size_t numRows = 1)
 	{
 		return true;
@@ -108,7 +248,28 @@ public:
 	}
 
 private:
+	friend class sqlResultCopier;
+
+	wxString Render(int row, int col);
+	void Unlink(int cell);
+	void MakeNewest(int cell);
+
 	pgQueryThread *thread;
+	bool streaming;
+
+	wxArrayInt rowMap;
+	bool mapped;
+
+	// Formatting snapshot
+	bool indicateNull;
+	wxString decimalMark, thousandsSeparator;
+	size_t maxColSize;
+	wxArrayInt numericCols;
+
+	// Most recently used cells, newest first
+	sqlResultCell *cells;
+	sqlResultCellHash cellIndex;
+	int cellCount, newestCell, oldestCell;
 };
 
 #endif
@@ -11,9 +11,16 @@
 
 pgadmin3_SOURCES += \
 	  include/db/pgConn.h \
+	  include/db/pgConnMonitor.h \
+	  include/db/pgConnPool.h \
+	  include/db/pgQueryProfiler.h \
 	  include/db/pgQueryThread.h \
 	  include/db/pgQueryResultEvent.h \
-	  include/db/pgSet.h
+	  include/db/pgSet.h \
+	  include/db/pgSetIndex.h \
+	  include/db/pgSetSearch.h \
+	  include/db/pgSetStats.h \
+	  include/db/pgSetSpill.h
 
 EXTRA_DIST += \
     include/db/module.mk
@@ -82,6 +82,78 @@ typedef struct pgError
 	void SetError(PGresult *_res = NULL, wxMBConv *_conv = NULL);
 } pgError;
 
+// A cached pg_type entry
+typedef struct pgTypeCacheEntry
+{
+	OID baseType;
+	int typClass;
+	wxString name;
+} pgTypeCacheEntry;
+
+WX_DECLARE_HASH_MAP(OID, pgTypeCacheEntry, wxIntegerHash, wxIntegerEqual, pgTypeCacheHash);
+WX_DECLARE_STRING_HASH_MAP(wxString, pgFullTypeCacheHash);
+
+// A statement prepared for the queries with parameters, keyed by SQL text
+typedef struct pgPreparedStatement
+{
+	wxString name;
+	long lastUsed;
+} pgPreparedStatement;
+
+WX_DECLARE_STRING_HASH_MAP(pgPreparedStatement, pgPreparedStatementHash);
+WX_DECLARE_HASH_SET(wxString, wxStringHash, wxStringEqual, pgStatementTextSet);
+
+class pgConnPool;
+
+// Sent to the handler of a query run by pgConn::ExecuteSetAsync() once it's
+// done. GetId() is the id the query was queued with, and GetClientData() its
+// data. The handler takes over the set with DetachSet(), which is NULL if the
+// query failed.
+extern const wxEventType PGConnResultEvent;
+
+class pgConnResultEvent : public wxCommandEvent
+{
+public:
+	pgConnResultEvent(int id, long request, pgSet *set, const wxString &error);
+	pgConnResultEvent(const pgConnResultEvent &ev);
+
+	// Required for sending with wxPostEvent()
+	wxEvent *Clone() const
+	{
+		return new pgConnResultEvent(*this);
+	}
+
+	long GetRequest() const
+	{
+		return m_request;
+	}
+	wxString GetError() const
+	{
+		return m_error;
+	}
+	pgSet *DetachSet()
+	{
+		pgSet *set = m_set;
+		m_set = 0;
+		return set;
+	}
+
+private:
+	long m_request;
+	pgSet *m_set;
+	wxString m_error;
+};
+
+typedef void (wxEvtHandler::*pgConnResultEventFunc)(pgConnResultEvent &);
+
+#define pgConnResultEventHandler(func)                               \
+	(wxObjectEventFunction)(wxEventFunction)(wxCommandEventFunction) \
+	wxStaticCastEvent(pgConnResultEventFunc, &func)
+
+#define EVT_PGCONNRESULT(id, fn)                                 \
+	DECLARE_EVENT_TABLE_ENTRY(PGConnResultEvent, id, wxID_ANY,   \
+	pgConnResultEventHandler(fn), (wxObject*) NULL),
+
 class pgConn
 {
 public:
@@ -133,6 +205,36 @@ public:
 	pgSet *ExecuteSet(const wxString &sql, bool reportError = true);
 	void CancelExecution(void);
 
+	// Queries with parameters ($1, $2, ...) passed as text. The statement is
+	// prepared on first use, and reused for as long as it stays in the
+	// cache of the connection. Queries without parameters are only prepared
+	// the second time they are run.
+	wxString ExecuteScalar(const wxString &sql, const wxArrayString &params, bool reportError = true);
+	pgSet *ExecuteSet(const wxString &sql, const wxArrayString &params, bool reportError = true);
+	// Queries run in the background, on the connections of the pool. The
+	// result is sent as a pgConnResultEvent to the handler; the request
+	// number returned (0 if the query couldn't be queued) identifies it, and
+	// can be cancelled.
+	long ExecuteSetAsync(const wxString &sql, wxEvtHandler *handler, int id = wxID_ANY, void *data = NULL);
+	long ExecuteSetAsync(const wxString &sql, const wxArrayString &params, wxEvtHandler *handler, int id = wxID_ANY, void *data = NULL);
+	static void CancelAsync(long request);
+	static void CancelAsync(wxEvtHandler *handler);
+
+	// Connections to the same database for read-only background work
+	pgConnPool *GetPool();
+
+	// The number of connections to servers open at the moment
+	static long GetBackendCount();
+
+	long GetStatementCacheHits() const
+	{
+		return statementCacheHits;
+	}
+	long GetStatementCacheMisses() const
+	{
+		return statementCacheMisses;
+	}
+
 	wxString GetHostAddr() const
 	{
 		return save_hostaddr;
@@ -259,8 +361,25 @@ public:
 	bool EndPutCopy(const wxString errormsg);
 	bool GetCopyFinalStatus(void);
 
+	// COPY IN over a nonblocking connection, so that the sender isn't stuck
+	// when the server stops reading. TryPutCopyData() returns 1 once the
+	// data is queued, 0 if it can't be yet. FlushCopyData() waits up to
+	// msec milliseconds for the server to take some of the queued data,
+	// and returns 0 once all of it is sent, 1 if some is left. Both return
+	// -1 on failure. CancelExecution() cancels the COPY until its final
+	// status is in.
+	bool SetNonBlocking(bool nonBlocking);
+	int TryPutCopyData(const char *data, long count);
+	int FlushCopyData(int msec);
+
 	bool TableHasColumn(wxString schemaname, wxString tblname, const wxString &colname);
 
+	// Resolve the type information of count columns at once, querying the
+	// catalog only for types not already known to this connection.
+	bool ResolveTypes(long count, const OID *oids, const long *mods,
+	                  wxString *names, wxString *fullNames, int *classes);
+	void FlushTypeCache();
+
 protected:
 	PGconn   *conn;
 	PGcancel *m_cancelConn;
@@ -282,9 +401,39 @@ protected:
 
 	void *noticeArg;
 	PQnoticeProcessor noticeProc;
+
+	// Type catalog cache
+	pgTypeCacheHash typeCache;
+	pgFullTypeCacheHash fullTypeCache;
+	bool typeCacheLoaded;
+	wxMutex typeCacheMutex;
+	bool CacheTypes(const wxString &restriction);
+
+	// Prepared statement cache
+	pgPreparedStatementHash preparedStatements;
+	pgStatementTextSet statementsSeen;
+	long statementCacheSerial, statementCacheClock;
+	long statementCacheHits, statementCacheMisses;
+	bool statementCacheDisabled;
+	PGresult *ExecutePrepared(const wxString &sql, const wxArrayString &params);
+	wxString PrepareStatement(const wxString &sql, const char *query, int nParams, PGresult *&errorResult);
+	void FlushStatementCache();
 	static double libpqVersion;
 
+	// Background work
+	pgConnPool *pool;
+	void ClosePool();
+
+	bool backendCounted;
+	void CountBackend(bool open);
+
+	// Set by the connection monitor
+	int healthStatus;
+	bool monitored;
+
 	friend class pgQueryThread;
+	friend class pgConnWorker;
+	friend class pgConnMonitor;
 
 private:
 	bool DoConnect();
@@ -0,0 +1,54 @@
+//////////////////////////////////////////////////////////////////////////
+//
+// pgAdmin III - PostgreSQL Tools
+//
+// Copyright (C) 2002 - 2016, The pgAdmin Development Team
+// This software is released under the PostgreSQL Licence
+//
+// pgConnMonitor.h - Watches the health of open connections
+//
+//////////////////////////////////////////////////////////////////////////
+
+#ifndef PGCONNMONITOR_H
+#define PGCONNMONITOR_H
+
+// wxWindows headers
+#include <wx/wx.h>
+#include <wx/thread.h>
+
+class pgConn;
+
+// Sent to the handler of the monitor when it finds a connection lost.
+// GetClientData() is the pgConn, which may have been deleted by the time the
+// event is handled, and GetInt() its new status.
+extern const wxEventType PGConnStatusEvent;
+
+// Checks the sockets of all open connections from a background thread, so
+// pgConn::IsAlive() can answer from the last check instead of asking the
+// server. A check doesn't touch the protocol state of the connection: it
+// looks at the error state of the socket and whether the server has closed
+// it, while TCP keepalives make the system notice a peer that went away
+// silently.
+class pgConnMonitor : public wxThread
+{
+public:
+	static void Watch(pgConn *conn);
+	static void Unwatch(pgConn *conn);
+
+	static void SetHandler(wxEvtHandler *handler);
+	static void Shutdown();
+
+protected:
+	void *Entry();
+
+private:
+	pgConnMonitor(long _interval);
+	void Check();
+
+	long interval;
+	bool stopping;
+	wxMutex sleepMutex;
+	wxCondition wakeUp;
+};
+
+#endif
@@ -0,0 +1,90 @@
+//////////////////////////////////////////////////////////////////////////
+//
+// pgAdmin III - PostgreSQL Tools
+//
+// Copyright (C) 2002 - 2016, The pgAdmin Development Team
+// This software is released under the PostgreSQL Licence
+//
+// pgConnPool.h - Pool of connections for background work
+//
+//////////////////////////////////////////////////////////////////////////
+
+#ifndef PGCONNPOOL_H
+#define PGCONNPOOL_H
+
+// wxWindows headers
+#include <wx/wx.h>
+#include <wx/thread.h>
+
+class pgConn;
+class pgConnWorker;
+struct pgAsyncRequest;
+
+WX_DEFINE_ARRAY_PTR(pgAsyncRequest *, pgAsyncRequestArray);
+
+// Connections to the database of a master connection, opened on demand with
+// the same settings, for read-only work that doesn't need the session of the
+// master. Connections idle for too long are closed down to the minimum size
+// of the pool, and no pool opens a connection once pgAdmin has as many
+// backends as allowed in total. That cap only holds the pools back: the
+// connections the user opens are counted, but never refused.
+//
+// The pool also runs the queries of pgConn::ExecuteSetAsync(), with as many
+// threads as it may have connections.
+//
+// Its users so far are the statistics pane, the row count of the
+// properties and the dependencies and dependents panes, through
+// ExecuteSetAsync(), and the parallel sessions of the import dialog. Not
+// yet moved: the SQL pane, whose SQL is put together by the objects
+// themselves, which may only be used from the GUI thread, and the objects
+// overriding the dependency panes with queries of their own (servers,
+// roles, tablespaces, Slony sets). The server status window opens
+// connections of its own, so it doesn't wait on the browser connection
+// anyway.
+class pgConnPool
+{
+public:
+	pgConnPool(pgConn *_master);
+	~pgConnPool();
+
+	// Get a connection for a while, waiting up to timeout milliseconds for
+	// one to be returned if the pool is at its maximum size. Returns NULL if
+	// there is none to be had.
+	pgConn *Borrow(long timeout = 0);
+	void Return(pgConn *conn);
+
+	long Queue(const wxString &sql, const wxArrayString &params, wxEvtHandler *handler, int id, void *data);
+	static void Cancel(long request);
+	static void Cancel(wxEvtHandler *handler);
+
+	int GetOpenCount();
+	int GetIdleCount();
+
+private:
+	pgConn *Open(bool &capped);
+	void Discard(pgConn *conn);
+	void Evict();
+	bool CancelRequest(long request);
+	void CancelRequests(wxEvtHandler *handler);
+
+	pgConn *master;
+	int minSize, maxSize;
+	long idleTimeout, maxBackends;
+
+	wxMutex mutex;
+	wxCondition returned, queued;
+	bool stopping;
+
+	// Idle connections, the one returned last at the end
+	wxArrayPtrVoid idle;
+	wxArrayLong idleSince;
+	int open;
+
+	pgAsyncRequestArray requests;
+	wxArrayPtrVoid workers;
+	int waitingWorkers;
+
+	friend class pgConnWorker;
+};
+
+#endif
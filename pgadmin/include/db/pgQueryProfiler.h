@@ -0,0 +1,77 @@
+//////////////////////////////////////////////////////////////////////////
+//
+// pgAdmin III - PostgreSQL Tools
+//
+// Copyright (C) 2002 - 2016, The pgAdmin Development Team
+// This software is released under the PostgreSQL Licence
+//
+// pgQueryProfiler.h - Records the queries pgAdmin runs
+//
+//////////////////////////////////////////////////////////////////////////
+
+#ifndef PGQUERYPROFILER_H
+#define PGQUERYPROFILER_H
+
+// wxWindows headers
+#include <wx/wx.h>
+#include <wx/dynarray.h>
+
+// PostgreSQL headers
+#include <libpq-fe.h>
+
+// A query, as recorded by the profiler
+class pgProfiledQuery
+{
+public:
+	wxString sql;
+	wxString site;
+	double msec;
+	long rows;
+	long bytes;
+};
+
+WX_DECLARE_OBJARRAY(pgProfiledQuery, pgProfiledQueryArray);
+
+// The last few thousand queries run by any connection, with the time they
+// took and the amount of data they returned. Recording doesn't take any
+// lock, so it is cheap enough to be done for every query, from any thread;
+// a query recorded while a snapshot is taken may be missing from it.
+class pgQueryProfiler
+{
+public:
+	// A timestamp in milliseconds, for measuring the time queries take
+	static double Now();
+
+	static void Record(const wxString &sql, double start, PGresult *res);
+	// For results whose rows and bytes were counted as they arrived
+	static void Record(const wxString &sql, double start, long rows, long bytes);
+	static void GetQueries(pgProfiledQueryArray &queries);
+	static void Clear();
+
+	// The calling site set for this thread
+	static wxString GetSite();
+
+	// The query with literals replaced by '?', so queries only differing in
+	// the values they use are counted as one.
+	static wxString GetShape(const wxString &sql);
+};
+
+// Names the calling site of the queries run by the thread while it exists,
+// such as the class of the object or dialog the queries are run for.
+class pgProfilerSite
+{
+public:
+	pgProfilerSite(const wxString &site);
+	~pgProfilerSite();
+
+	const char *GetName() const
+	{
+		return name;
+	}
+
+private:
+	char name[64];
+	pgProfilerSite *previous;
+};
+
+#endif
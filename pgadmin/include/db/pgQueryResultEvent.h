@@ -18,6 +18,10 @@
 class pgBatchQuery;
 
 extern const wxEventType PGQueryResultEvent;
+// Sent by a streaming pgQueryThread whenever a chunk of rows arrived. GetInt()
+// returns the number of rows received so far, GetExtraLong() is non-zero if
+// fetching has been suspended until pgQueryThread::FetchMore() is called.
+extern const wxEventType PGQueryRowsEvent;
 
 
 class pgQueryResultEvent : public wxCommandEvent
@@ -76,4 +80,8 @@ typedef void (wxEvtHandler::*pgQueryResultEventFunc)(pgQueryResultEvent &);
 	DECLARE_EVENT_TABLE_ENTRY(PGQueryResultEvent, id1, id2, \
 	pgQueryResultEventHandler(fn), (wxObject*) NULL),
 
+#define EVT_PGQUERYROWS(id, fn)                                  \
+	DECLARE_EVENT_TABLE_ENTRY(PGQueryRowsEvent, id, wxID_ANY,    \
+	pgQueryResultEventHandler(fn), (wxObject*) NULL),
+
 #endif // PGQUERYRESULTEVENT_H
@@ -20,6 +20,7 @@
 class pgSet;
 class pgQueryThread;
 class pgBatchQuery;
+class dataFileWriter;
 
 // Support for the IN & INOUT parameters type
 class pgParam : public wxObject
@@ -232,9 +233,60 @@ public:
 		return (_idx >= 0 && _idx > m_currIndex ? -1L : m_queries[_idx]->m_insertedOid);
 	}
 
-	inline void CancelExecution()
+	void CancelExecution();
+
+	// Streaming mode: the rows of the first result returning any are handed
+	// to the data set in chunks of chunkRows rows while the query is still
+	// running, instead of waiting for the complete result (resultToRetrieve
+	// is not honoured then). Once maxMemory bytes have been received, the
+	// thread stops reading from the server until FetchMore() is called.
+	// Requires libpq single row mode, without it the query runs normally.
+	void SetStreaming(long chunkRows, size_t maxMemory = 0);
+	bool IsStreaming() const
+	{
+		return m_streamChunkRows > 0;
+	}
+	bool IsFetchSuspended() const
+	{
+		return m_streamSuspended;
+	}
+	void FetchMore();
+	// Rows streamed beyond this many bytes go to a file in the directory,
+	// see pgSet::SetSpillThreshold()
+	void SetSpillThreshold(size_t bytes, const wxString &dir);
+
+	// The data of a COPY TO STDOUT is written to the file as it arrives,
+	// rather than shown in the messages; with CRLF row ends if asked for.
+	// With a header, the first line isn't counted as a row.
+	void SetCopyOutFile(dataFileWriter *file, bool crlf, bool header);
+	long CopyRowsWritten() const
+	{
+		return m_copyOutRows;
+	}
+
+	// Pipeline mode: all the queued queries are sent to the server before
+	// reading any results, saving a round trip per query. Each query must
+	// be a single statement not using COPY, as they are sent through the
+	// extended query protocol. Requires libpq 14 or later, without it the
+	// queries are executed one by one.
+	void SetPipelining(bool pipelining)
+	{
+		m_pipelining = pipelining;
+	}
+	bool IsPipelining() const
 	{
-		m_cancelled = true;
+		return m_pipelining;
+	}
+
+	// Binary results: a single statement returning only columns of types
+	// pgSet can render itself gets its result in binary format, which is
+	// turned into text only for the values actually looked at. Finding out
+	// takes two extra round trips, to prepare and describe the statement,
+	// which is then executed without being parsed again. It's skipped in a
+	// transaction block.
+	void SetBinaryResults(bool binary)
+	{
+		m_binaryResults = binary;
 	}
 
 	inline size_t GetNumberQueries()
@@ -256,7 +308,18 @@ public:
 
 private:
 	int Execute();
+	int ExecutePipeline();
+	void EndPipeline();
+	int StoreResult(PGresult *result, bool streamed);
+	int DescribeResultFormat(const char *query, pgParamsArray *params);
+	PGresult *WaitForResult();
 	int RaiseEvent(int _retval = 0);
+	void RaiseRowsEvent();
+	void InitWakeUp();
+	void WakeUp();
+	void WaitForSocket();
+	void StreamRow(PGresult *row);
+	void FlushStreamChunk();
 
 	// Queries to be executed
 	pgBatchQueryArray  m_queries;
@@ -272,8 +335,14 @@ private:
 	bool               m_multiQueries;
 	// Use EDB callable statement (if available and require)
 	bool               m_useCallable;
+	// Send the queued queries at once
+	bool               m_pipelining;
+	// Ask for binary results if possible
+	bool               m_binaryResults;
 	// Is executing a query
 	bool               m_executing;
+	// When the query being executed was sent, for the profiler
+	double             m_queryStart;
 	// Queries are being accessed at this time
 	wxMutex            m_queriesLock;
 	// When one thread is accesing messages, other should not be able to access it
@@ -285,6 +354,34 @@ private:
 	// Notice Handler
 	void              *m_noticeHandler;
 
+	// Written to by CancelExecution() to interrupt waiting for the server
+	int                m_wakeUpPipe[2];
+	// Posted whenever a query is queued (or the execution cancelled)
+	wxSemaphore        m_queueSem;
+
+	// Streaming: rows per chunk (0 = not streaming), and the memory ceiling
+	long               m_streamChunkRows;
+	size_t             m_streamMaxMemory;
+	size_t             m_streamSpillThreshold;
+	wxString           m_streamSpillDir;
+	// Rows received but not handed to the data set yet
+	PGresult          *m_streamChunk;
+	// Bytes received, and the limit at which to suspend fetching
+	size_t             m_streamBytes;
+	size_t             m_streamLimit;
+	bool               m_streamSuspended;
+	// Rows and value bytes of the streamed result, for the profiler
+	long               m_streamRows;
+	long               m_streamDataBytes;
+	wxMutex            m_streamMutex;
+	wxCondition        m_streamCond;
+
+	// COPY TO STDOUT into a file
+	dataFileWriter    *m_copyOutFile;
+	bool               m_copyOutCRLF;
+	bool               m_copyOutHeader;
+	long               m_copyOutRows;
+
 };
 
 #endif
@@ -15,11 +15,13 @@
 // wxWindows headers
 #include <wx/wx.h>
 #include <wx/datetime.h>
+#include <wx/thread.h>
 
 // PostgreSQL headers
 #include <libpq-fe.h>
 
 #include "utils/misc.h"
+#include "db/pgSetSpill.h"
 
 typedef enum
 {
@@ -32,12 +34,55 @@ typedef enum
 
 class pgConn;
 
+// Column name to column number map of a result
+WX_DECLARE_STRING_HASH_MAP(int, pgSetColumnHash);
+
+// Where the values of a row are kept: in a PGresult chunk, or in a record
+// of the spill file. The chunk holds the rows from start to end, so reading
+// on from one row to the next only needs chunkRow to move.
+class pgSetRow
+{
+public:
+	pgSetRow() : chunk(NULL), records(NULL), chunkRow(0), start(0), end(0) {}
+
+	bool Contains(long row) const
+	{
+		return row >= start && row < end;
+	}
+
+	bool IsNull(int col) const
+	{
+		if (records)
+			return pgSetSpill::IsNull(records[chunkRow], col);
+		return PQgetisnull(chunk, chunkRow, col) != 0;
+	}
+	char *Value(int col) const
+	{
+		if (records)
+			return (char *)pgSetSpill::Value(records[chunkRow], col);
+		return PQgetvalue(chunk, chunkRow, col);
+	}
+	int Length(int col) const
+	{
+		if (records)
+			return pgSetSpill::Length(records[chunkRow], col);
+		return PQgetlength(chunk, chunkRow, col);
+	}
+
+	PGresult *chunk;
+	const char **records;
+	int chunkRow;
+	long start, end;
+};
+
 // Class declarations
 class pgSet
 {
 public:
 	pgSet();
-	pgSet(PGresult *newRes, pgConn *newConn, wxMBConv &cnv, bool needColQt);
+	// The result may come from an other connection than the one the set
+	// belongs to, such as a pooled one: its settings are taken from there.
+	pgSet(PGresult *newRes, pgConn *newConn, wxMBConv &cnv, bool needColQt, pgConn *resConn = NULL);
 	~pgSet();
 	long NumRows() const
 	{
@@ -87,6 +132,14 @@ public:
 	wxString ColType(const int col) const;
 	wxString ColFullType(const int col) const;
 	pgTypClass ColTypClass(const int col) const;
+	void ResolveColTypes() const;
+
+	static pgTypClass TypClassFromOid(OID typeOid);
+
+	// Can values of the type be transferred in binary format, and rendered
+	// as text here just like the server would? Dates and times only can
+	// with the ISO DateStyle and integer datetimes.
+	static bool CanDecodeBinary(OID typeOid, bool isoDateTimes);
 
 	OID GetInsertedOid() const
 	{
@@ -99,9 +152,12 @@ public:
 	}
 	bool IsNull(const int col) const
 	{
-		return (PQgetisnull(res, pos - 1, col) != 0);
+		return RowAt(pos - 1).IsNull(col);
 	}
 	int ColScale(const int col) const;
+
+	// Column numbers are stable for the lifetime of the set, so loops over
+	// many rows should look them up once and use the numeric accessors.
 	int ColNumber(const wxString &colName) const;
 	bool HasColumn(const wxString &colname) const;
 
@@ -123,6 +179,8 @@ public:
 	OID GetOid(const int col) const;
 	OID GetOid(const wxString &col) const;
 
+	// For a binary result, the text of a value is only valid up to the
+	// next call.
 	char *GetCharPtr(const int col) const;
 	char *GetCharPtr(const wxString &col) const;
 
@@ -130,25 +188,113 @@ public:
 	{
 		return conv;
 	}
+	bool IsBinary() const
+	{
+		return binary;
+	}
+
+	// Point values at the row. Unlike the other accessors, these don't
+	// change the state of the set, so other threads may use them to read
+	// the rows. SeekRow only looks the row up if it's in an other chunk
+	// than the one values already points at.
+	void FindRow(long row, pgSetRow &values) const;
+	void SeekRow(long row, pgSetRow &values) const
+	{
+		if (values.Contains(row))
+			values.chunkRow = (int)(row - values.start);
+		else
+			FindRow(row, values);
+	}
+
+	// The value as text, like GetCharPtr(). Binary values are rendered
+	// into buf, so each thread reading the set needs its own.
+	char *TextValue(const pgSetRow &values, int col, wxMemoryBuffer &buf) const
+	{
+		if (!binary)
+			return values.Value(col);
+		return RenderBinary(values, col, buf);
+	}
+
+	// Rows streamed in after the set was created are kept in further
+	// PGresult chunks with the same columns. The set takes ownership.
+	void AppendChunk(PGresult *chunk);
+
+	// Once the chunks appended hold more than this many bytes of text, the
+	// rows of further ones are moved to a file in the directory and only
+	// mapped into memory, so a result larger than memory can still be read.
+	// 0 never does. Text results only, and to be set before the first chunk
+	// is appended.
+	void SetSpillThreshold(size_t bytes, const wxString &dir)
+	{
+		spillThreshold = bytes;
+		spillDir = dir;
+	}
 
 	wxString GetCommandStatus() const
 	{
 		if (res)
 		{
-			return wxString(PQcmdStatus(res), conv);
+			return Decode(PQcmdStatus(res));
 		}
 		return wxEmptyString;
 	}
 
+	// The DateStyle of the connection when the set was made, which its
+	// dates and times are written in
+	const wxString &GetDateStyle() const
+	{
+		return dateStyle;
+	}
+
 protected:
 	pgConn *conn;
 	PGresult *res;
 	long pos, nRows, nCols;
+
+	// The first chunk is res, starting at row 0
+	const pgSetRow &RowAt(long row) const
+	{
+		SeekRow(row, curRow);
+		return curRow;
+	}
+	char *Value(long row, int col) const
+	{
+		return RowAt(row).Value(col);
+	}
+	// Values of a binary result are turned into text on demand only
+	char *TextValue(long row, int col) const
+	{
+		if (!binary)
+			return Value(row, col);
+		return RenderBinary(RowAt(row), col, textBuf);
+	}
+	char *RenderBinary(const pgSetRow &values, int col, wxMemoryBuffer &buf) const;
+
+	// Text from the server, taking the fast path for UTF-8
+	wxString Decode(const char *str) const;
+
+	// A spilled chunk has its records instead of a PGresult
+	wxArrayPtrVoid chunks, chunkRecords;
+	wxArrayLong chunkStarts;
+	mutable pgSetRow curRow;
+	mutable wxCriticalSection chunkLock;
+
+	pgSetSpill *spill;
+	size_t spillThreshold, chunkBytes;
+	wxString spillDir;
+
+	bool binary;
+	mutable wxMemoryBuffer textBuf;
+	wxString dateStyle;
+
 	wxString ExecuteScalar(const wxString &sql) const;
 	wxMBConv &conv;
 	bool needColQuoting;
+	pgSetColumnHash colNumbers;
+	int LookupColumn(const wxString &colname) const;
 	mutable wxArrayString colTypes, colFullTypes;
-	wxArrayInt colClasses;
+	mutable wxArrayInt colClasses;
+	mutable bool colTypesResolved;
 };
 
 
@@ -171,6 +317,11 @@ public:
 		return set;
 	}
 
+	int ColNumber(const wxString &col) const
+	{
+		return set->ColNumber(col);
+	}
+
 	wxString GetVal(const int col) const
 	{
 		return set->GetVal(col);
@@ -0,0 +1,113 @@
+//////////////////////////////////////////////////////////////////////////
+//
+// pgAdmin III - PostgreSQL Tools
+//
+// Copyright (C) 2002 - 2016, The pgAdmin Development Team
+// This software is released under the PostgreSQL Licence
+//
+// pgSetIndex.h - Client side sort and filter of a result
+//
+//////////////////////////////////////////////////////////////////////////
+
+#ifndef PGSETINDEX_H
+#define PGSETINDEX_H
+
+// wxWindows headers
+#include <wx/wx.h>
+#include <wx/thread.h>
+
+#include "db/pgSet.h"
+
+// Posted to the handler given to pgSetIndex::StartBuild() once the rows
+// are ready
+extern const wxEventType SetIndexBuiltEvent;
+
+class pgSetIndexBuilder;
+
+// A condition on the value of a column
+class pgSetFilter
+{
+public:
+	int col;
+	bool isNull, exclude;
+	wxMemoryBuffer value;
+};
+
+WX_DECLARE_OBJARRAY(pgSetFilter, pgSetFilterArray);
+
+// How the values of the sort column are compared
+enum pgSetSortKind
+{
+	SETSORT_TEXT,           // by the locale's collation
+	SETSORT_DECIMAL,        // integers and numeric, exactly, as decimals
+	SETSORT_FLOAT,          // other numbers, as doubles
+	SETSORT_DATETIME        // dates and times, read in the set's DateStyle
+};
+
+// Orders and filters the rows of a text result without touching the set
+// itself: the rows to show are a list of row numbers of the set. Rows are
+// compared the way their type suggests: integers and numeric exactly,
+// other numbers by value, dates and times by the instant they stand for,
+// and everything else by its text, as the locale collates it. NaN sorts
+// above every other number. Dates and times fall back to their text if any
+// of them can't be read. The sort is stable, and spread over as many
+// threads as there are processors.
+class pgSetIndex
+{
+public:
+	pgSetIndex(pgSet *_set);
+	~pgSetIndex();
+
+	// Keep only the rows with the value the row has in the column, or with
+	// exclude, the rows with an other value that isn't NULL - just as the
+	// = and <> operators would.
+	void AddFilter(long row, int col, bool exclude);
+	void RemoveFilters()
+	{
+		filters.Empty();
+	}
+	bool IsFiltered() const
+	{
+		return filters.GetCount() > 0;
+	}
+
+	void SetSort(int col, bool descending);
+	void RemoveSort()
+	{
+		sortCol = -1;
+	}
+	bool IsSorted() const
+	{
+		return sortCol >= 0;
+	}
+
+	// Fill rows with the row numbers to show, in order
+	void Build(wxArrayInt &rows);
+
+	// Build the rows on a thread of its own, which posts SetIndexBuiltEvent
+	// to the handler when done. Returns false if no thread could be started.
+	// The sort and the filters must not be changed until the build is over:
+	// GetBuilt() takes the rows once it is, and StopBuild() abandons it.
+	bool StartBuild(wxEvtHandler *handler);
+	bool GetBuilt(wxArrayInt &rows);
+	void StopBuild();
+	bool IsBuilding() const
+	{
+		return builder != NULL;
+	}
+
+private:
+	bool Matches(const pgSetRow &values) const;
+
+	pgSet *set;
+	pgSetFilterArray filters;
+	int sortCol;
+	bool sortDescending;
+	pgSetSortKind sortKind;
+	OID sortType;
+
+	pgSetIndexBuilder *builder;
+	volatile bool cancelled;
+};
+
+#endif
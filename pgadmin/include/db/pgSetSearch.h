@@ -0,0 +1,87 @@
+//////////////////////////////////////////////////////////////////////////
+//
+// pgAdmin III - PostgreSQL Tools
+//
+// Copyright (C) 2002 - 2016, The pgAdmin Development Team
+// This software is released under the PostgreSQL Licence
+//
+// pgSetSearch.h - Find text in the values of a result
+//
+//////////////////////////////////////////////////////////////////////////
+
+#ifndef PGSETSEARCH_H
+#define PGSETSEARCH_H
+
+// wxWindows headers
+#include <wx/wx.h>
+#include <wx/thread.h>
+
+#include "db/pgSet.h"
+
+enum
+{
+	PGSETSEARCH_NONE = 0,
+	PGSETSEARCH_FOUND,
+	PGSETSEARCH_PENDING
+};
+
+// Looks for a text, or a regular expression, in the values of the rows of a
+// grid. The rows are split into as many ranges as there are processors, each
+// scanned by a thread of its own, and matches can be asked for while the
+// threads are still at it. NULLs never match.
+//
+// A grid row is a row of the set, or a row of text for a grid keeping
+// values of its own, as the edit grid does for rows it has read or changed.
+class pgSetSearch
+{
+public:
+	pgSetSearch(pgSet *_set, int _nCols, const wxString &pattern, bool matchCase, bool useRegex);
+	~pgSetSearch();
+
+	// False for an empty text or an invalid regular expression
+	bool IsOk() const
+	{
+		return mode >= 0;
+	}
+
+	// The rows to search, in grid order. Without any, the rows of the set
+	// are searched in their own order.
+	void AddRow(long setRow);
+	void AddTextRow(const wxArrayString &values);
+	void SkipColumn(int col);
+
+	void Start();
+	void Stop();
+
+	bool IsDone() const;
+	long GetMatchCount() const;
+	long GetRowCount() const;
+	long GetRowsScanned() const;
+
+	// The match next to the cell, moving the position to it. PENDING if the
+	// rows which would hold it are still being scanned.
+	int FindNext(long &row, int &col, bool forward) const;
+
+private:
+	friend class searchThread;
+
+	long SourceRow(long row) const;
+	const char *CellText(long source, int col, pgSetRow &values, wxMemoryBuffer &buf) const;
+
+	pgSet *set;
+	int nCols;
+	int mode;
+	bool matchCase;
+	wxString pattern;
+	wxCharBuffer bytes;
+
+	wxArrayLong sources;
+	wxArrayPtrVoid texts;
+	wxArrayInt skipped;
+
+	wxArrayPtrVoid parts, threads;
+	mutable wxCriticalSection matchLock;
+	bool cancelled;
+};
+
+#endif
@@ -0,0 +1,76 @@
+//////////////////////////////////////////////////////////////////////////
+//
+// pgAdmin III - PostgreSQL Tools
+//
+// Copyright (C) 2002 - 2016, The pgAdmin Development Team
+// This software is released under the PostgreSQL Licence
+//
+// pgSetSpill.h - File backed storage for the rows of large results
+//
+//////////////////////////////////////////////////////////////////////////
+
+#ifndef PGSETSPILL_H
+#define PGSETSPILL_H
+
+// wxWindows headers
+#include <wx/wx.h>
+
+// PostgreSQL headers
+#include <libpq-fe.h>
+
+// An append-only file of row records, mapped into memory, so the rows of a
+// result too large to keep in memory can still be read like those of a
+// PGresult. The file is a temporary one in the directory given, gone when
+// the spill is deleted. The directory must be on disk: on a tmpfs, the file
+// would be held in memory all the same.
+// Mapped segments stay in place until then, so a record once written can be
+// read through its pointer from any thread.
+//
+// A record starts with the length and the offset of each value, a NULL
+// having a length of -1. The values follow, each with a terminating NUL as
+// libpq keeps them, a NULL reading as an empty string. The records of a
+// chunk of rows are preceded by their index, the pointers to each of them,
+// so nothing grows in memory with the number of rows.
+class pgSetSpill
+{
+public:
+	pgSetSpill(const wxString &dir);
+	~pgSetSpill();
+
+	bool IsOk() const;
+
+	// Write the rows of the result, returning the index of their records
+	// in the file, or NULL if the file couldn't be grown to take them.
+	const char **Append(PGresult *chunk);
+
+	static bool IsNull(const char *record, int col)
+	{
+		return ((const wxInt32 *)record)[col * 2] < 0;
+	}
+	static int Length(const char *record, int col)
+	{
+		wxInt32 len = ((const wxInt32 *)record)[col * 2];
+		return len < 0 ? 0 : len;
+	}
+	static const char *Value(const char *record, int col)
+	{
+		return record + ((const wxInt32 *)record)[col * 2 + 1];
+	}
+
+private:
+	bool AddSegment(size_t minSize);
+
+#ifdef __WXMSW__
+	void *file;
+	wxArrayPtrVoid mappings;
+#else
+	int fd;
+#endif
+	wxArrayPtrVoid segments;
+	wxArrayLong segmentSizes;
+	char *segment;
+	size_t segmentUsed, segmentSize;
+	wxLongLong_t fileSize;
+};
+
+#endif
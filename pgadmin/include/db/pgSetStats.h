@@ -0,0 +1,56 @@
+//////////////////////////////////////////////////////////////////////////
+//
+// pgAdmin III - PostgreSQL Tools
+//
+// Copyright (C) 2002 - 2016, The pgAdmin Development Team
+// This software is released under the PostgreSQL Licence
+//
+// pgSetStats.h - Summary of the numbers in part of a result
+//
+//////////////////////////////////////////////////////////////////////////
+
+#ifndef PGSETSTATS_H
+#define PGSETSTATS_H
+
+// wxWindows headers
+#include <wx/wx.h>
+#include <wx/thread.h>
+
+#include "db/pgSet.h"
+
+// Posted to the handler of a pgSetStats once its figures are ready
+extern const wxEventType SetStatsDoneEvent;
+
+// Counts, sums and finds the extremes of the values in some columns of some
+// rows of a text result, in a thread of its own. The columns should hold
+// numbers; values that aren't, NULLs and NaNs are left out. The handler, if
+// any, is sent SetStatsDoneEvent when the figures are ready.
+class pgSetStats : public wxThread
+{
+public:
+	pgSetStats(pgSet *_set, const wxArrayInt &_rows, const wxArrayInt &_cols, wxEvtHandler *_handler = NULL);
+
+	void Cancel()
+	{
+		cancelled = true;
+	}
+	bool IsDone() const
+	{
+		return done;
+	}
+
+	// Valid once done
+	long count, distinct;
+	double sum, min, max;
+
+protected:
+	void *Entry();
+
+private:
+	pgSet *set;
+	wxArrayInt rows, cols;
+	wxEvtHandler *handler;
+	volatile bool cancelled, done;
+};
+
+#endif
@@ -153,6 +153,9 @@ public:
 	wxArrayInt GetSelectedRows() const;
 	bool CheckRowPresent(int row);
 	virtual bool IsColText(int col);
+
+protected:
+	pgSetSearch *CreateSearch(const wxString &pattern, bool matchCase, bool useRegex);
 };
 
 class sqlTable : public wxGridTableBase
@@ -234,6 +237,7 @@ private:
 
 class frmMain;
 class pgSchemaObject;
+class ctlResultFindBar;
 
 class frmEditGrid : public pgFrame
 {
@@ -295,6 +299,7 @@ private:
 	void OnDescSort(wxCommandEvent &event);
 	void OnRemoveSort(wxCommandEvent &event);
 	void OnPaste(wxCommandEvent &event);
+	void OnFind(wxCommandEvent &event);
 	void OnLabelDoubleClick(wxGridEvent &event);
 	void OnLabelRightClick(wxGridEvent &event);
 	void OnCellRightClick(wxGridEvent &event);
@@ -307,6 +312,7 @@ private:
 
 	wxAuiManager manager;
 	ctlSQLEditGrid *sqlGrid;
+	ctlResultFindBar *findBar;
 
 	frmMain *mainForm;
 	pgConn *connection;
@@ -15,6 +15,7 @@
 
 class ctlSQLResult;
 class pgSet;
+class pgConn;
 
 #include "dlg/dlgClasses.h"
 
@@ -25,7 +26,20 @@ public:
 	frmExport(wxWindow *parent);
 	~frmExport();
 
-	bool Export(pgSet *set);
+	// Writes the rows of the set, or only those given, in that order. The
+	// work is done by a thread of its own, showing progress if it takes a
+	// while.
+	bool Export(pgSet *set, const wxArrayInt &rows = wxArrayInt());
+
+	// The options of a COPY ... TO STDOUT writing the file as chosen, so the
+	// server can stream the data straight into it: empty if the choices
+	// can't be expressed that way.
+	wxString GetCopyOptions(pgConn *conn);
+	wxString GetFilename();
+	bool IsCRLF();
+	bool HasHeader();
+
+	static void LogExported(long rows, wxFileOffset bytes, wxLongLong elapsed);
 
 private:
 	void OnChange(wxCommandEvent &ev);
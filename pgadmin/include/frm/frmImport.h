@@ -17,6 +17,7 @@
 #include "utils/factory.h"
 
 class frmMain;
+class dataFileReader;
 
 class frmImport : public pgDialog
 {
@@ -30,6 +31,11 @@ private:
 	void OnChangeFormat(wxCommandEvent &ev);
 	void OnOK(wxCommandEvent &ev);
 
+	// Sends the file over the connections, which are all in COPY IN state,
+	// showing the progress. Returns false if it failed or was cancelled.
+	bool SendFile(dataFileReader &file, const wxArrayPtrVoid &conns, bool split, char quote, char escape,
+	              bool skipHeader, bool &cancelled, wxString &errMsg);
+
 	pgConn *connection;
 	pgObject *object;
 	bool done;
@@ -203,6 +203,7 @@ private:
 	long msgLevel;
 
 	bool m_refreshing;
+	bool m_checkingAlive;
 
 	wxTreeItemId denyCollapseItem;
 	pgObject *currentObject;
@@ -243,6 +244,7 @@ private:
 	void OnCopy(wxCommandEvent &ev);
 
 	void OnCheckAlive(wxCommandEvent &event);
+	void OnConnStatus(wxCommandEvent &event);
 
 	void OnPositionStc(wxStyledTextEvent &event);
 
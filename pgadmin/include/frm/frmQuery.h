@@ -18,6 +18,7 @@
 #include "gqb/gqbViewController.h"
 #include "gqb/gqbModel.h"
 #include "frm/frmExport.h"
+#include "utils/dataFile.h"
 #include "utils/factory.h"
 #include "utils/favourites.h"
 #include "utils/macros.h"
@@ -25,6 +26,7 @@
 #include <wx/sstream.h>
 #include <wx/txtstrm.h>
 #include <wx/bmpcbox.h>
+#include <wx/grid.h>
 
 // wxAUI
 #include <wx/aui/aui.h>
@@ -48,6 +50,7 @@
 
 class ExplainCanvas;
 class ctlSQLResult;
+class ctlResultFindBar;
 class pgsApplication;
 class pgScriptTimer;
 
@@ -57,15 +60,20 @@ public:
 	QueryExecInfo()
 	{
 		toFileExportForm = NULL;
+		copyOutFile = NULL;
 	}
 	~QueryExecInfo()
 	{
 		if (toFileExportForm)
 			delete toFileExportForm;
+		if (copyOutFile)
+			delete copyOutFile;
 	}
 
 	int queryOffset;
 	frmExport *toFileExportForm;
+	// Execute to file through COPY TO STDOUT: the file it goes to
+	dataFileWriter *copyOutFile;
 	bool singleResult;
 	bool explain;
 	bool verbose;
@@ -126,6 +134,7 @@ private:
 	ctlSQLBox *sqlQuery;
 	ctlAuiNotebook *outputPane;
 	ctlSQLResult *sqlResult;
+	ctlResultFindBar *findBar;
 	ExplainCanvas *explainCanvas;
 	wxTextCtrl *msgResult, *msgHistory;
 	wxBitmapComboBox *cbConnection;
@@ -246,8 +255,21 @@ private:
 	void updateMenu(bool allowUpdateModelSize = true);
 	void execQuery(const wxString &query, int resultToRetrieve = 0, bool singleResult = false, const int queryOffset = 0, bool toFile = false, bool explain = false, bool verbose = false);
 	void OnQueryComplete(pgQueryResultEvent &ev);
+	void OnQueryRows(pgQueryResultEvent &ev);
+	void OnSelectionStats(wxCommandEvent &ev);
+	void OnResultCellRightClick(wxGridEvent &event);
+	void OnResultLabelRightClick(wxGridEvent &event);
+	void OnIncludeFilter(wxCommandEvent &event);
+	void OnExcludeFilter(wxCommandEvent &event);
+	void OnRemoveFilters(wxCommandEvent &event);
+	void OnAscSort(wxCommandEvent &event);
+	void OnDescSort(wxCommandEvent &event);
+	void OnRemoveSort(wxCommandEvent &event);
+	void ShowResultRows();
 	void completeQuery(bool done, bool explain, bool verbose);
 	bool isBeginNotRequired(wxString query);
+	bool isSingleStatement(const wxString &query, size_t *end = NULL, wxArrayString *words = NULL);
+	wxString getCopyQuery(const wxString &query, const wxString &options);
 	void OnScriptComplete(wxCommandEvent &ev);
 	void setTools(const bool running);
 	void showMessage(const wxString &msg, const wxString &msgShort = wxT(""));
@@ -306,6 +328,9 @@ private:
 
 	bool aborted;
 	bool lastFileFormat;
+
+	// The cell of the data output a context menu was opened for
+	int resultMenuRow, resultMenuCol;
 	bool m_loadingfile;
 
 	// A simple mutex-like flag to prevent concurrent script execution.
@@ -323,7 +348,8 @@ enum
 	STATUSPOS_POS,
 	STATUSPOS_SEL,
 	STATUSPOS_ROWS,
-	STATUSPOS_SECS
+	STATUSPOS_SECS,
+	STATUSPOS_STATS
 };
 
 enum
@@ -0,0 +1,53 @@
+//////////////////////////////////////////////////////////////////////////
+//
+// pgAdmin III - PostgreSQL Tools
+//
+// Copyright (C) 2002 - 2016, The pgAdmin Development Team
+// This software is released under the PostgreSQL Licence
+//
+// frmQueryProfiler.h - The queries run by pgAdmin, by shape
+//
+//////////////////////////////////////////////////////////////////////////
+
+#ifndef FRMQUERYPROFILER_H
+#define FRMQUERYPROFILER_H
+
+// wxWindows headers
+#include <wx/wx.h>
+
+#include "dlg/dlgClasses.h"
+#include "utils/factory.h"
+
+class ctlListView;
+
+class frmQueryProfiler : public pgFrame
+{
+public:
+	frmQueryProfiler(frmMain *form);
+	~frmQueryProfiler();
+
+	void Go();
+
+private:
+	void OnRefresh(wxCommandEvent &event);
+	void OnClear(wxCommandEvent &event);
+	void OnCopy(wxCommandEvent &event);
+	void OnClose(wxCloseEvent &event);
+
+	void Aggregate();
+
+	frmMain *mainForm;
+	ctlListView *queryList;
+
+	DECLARE_EVENT_TABLE()
+};
+
+
+class queryProfilerFactory : public actionFactory
+{
+public:
+	queryProfilerFactory(menuFactoryList *list, wxMenu *mnu, ctlMenuToolbar *toolbar);
+	wxWindow *StartDialog(frmMain *form, pgObject *obj);
+};
+
+#endif
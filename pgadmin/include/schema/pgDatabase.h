@@ -63,6 +63,8 @@ public:
 
 	pgSet *ExecuteSet(const wxString &sql);
 	wxString ExecuteScalar(const wxString &sql);
+	pgSet *ExecuteSet(const wxString &sql, const wxArrayString &params);
+	wxString ExecuteScalar(const wxString &sql, const wxArrayString &params);
 	bool ExecuteVoid(const wxString &sql, bool reportError = true);
 	void UpdateDefaultSchema();
 
@@ -330,6 +332,7 @@ public:
 	pgServer *GetServer() const;
 
 	void DisplayStatistics(ctlListView *statistics, const wxString &query);
+	void DisplayStatistics(ctlListView *statistics, const wxString &query, const wxArrayString &params);
 
 	// compiles a prefix from the schema name with '.', if necessary
 	wxString GetSchemaPrefix(const wxString &schemaname) const;
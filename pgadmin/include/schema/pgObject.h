@@ -78,6 +78,8 @@ protected:
 	pgObject(pgaFactory &factory, const wxString &newName = wxEmptyString);
 
 public:
+	virtual ~pgObject();
+
 	/*
 	*  Except column level privileges, column will be always an empty
 	*  string in any case
@@ -271,6 +273,11 @@ public:
 	virtual void ShowStatistics(frmMain *form, ctlListView *statistics);
 	virtual void ShowDependencies(frmMain *form, ctlListView *Dependencies, const wxString &where = wxEmptyString);
 	virtual void ShowDependents(frmMain *form, ctlListView *referencedBy, const wxString &where = wxEmptyString);
+
+	// The result of a query the object passed to ctlListView::SetItemAsync()
+	virtual void SetAsyncResult(pgSet *set) {}
+	// The rows of a query the object passed to ctlListView::AppendRowsAsync()
+	virtual void ShowAsyncRows(ctlListView *list, pgSet *set, int step);
 	virtual pgObject *Refresh(ctlTree *browser, const wxTreeItemId item)
 	{
 		return this;
@@ -378,7 +385,8 @@ private:
 	*/
 	static void AppendRight(wxString &rights, const wxString &acl, wxChar c, const wxChar *rightName, const wxString &column = wxEmptyString);
 	static wxString GetPrivilegeGrant(const wxString &allPattern, const wxString &acl, const wxString &grantObject, const wxString &user, const wxString &column);
-	void ShowDependency(pgDatabase *db, ctlListView *list, const wxString &query, const wxString &clsOrder);
+	void ShowDependency(ctlListView *list, const wxString &query, const wxString &clsOrder);
+	void ShowDependencyRows(ctlListView *list, pgSet *set);
 	wxString name, owner, schema, comment, acl;
 	int type;
 	OID oid, xid;
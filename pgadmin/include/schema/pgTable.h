@@ -219,6 +219,7 @@ public:
 	}
 	bool EnableTriggers(const bool b);
 	void UpdateRows();
+	void SetAsyncResult(pgSet *set);
 	bool DropObject(wxFrame *frame, ctlTree *browser, bool cascaded);
 	bool Truncate(bool cascaded);
 	bool ResetStats();
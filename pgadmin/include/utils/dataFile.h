@@ -0,0 +1,149 @@
+//////////////////////////////////////////////////////////////////////////
+//
+// pgAdmin III - PostgreSQL Tools
+//
+// Copyright (C) 2002 - 2016, The pgAdmin Development Team
+// This software is released under the PostgreSQL Licence
+//
+// dataFile.h - Reading and writing of imported and exported data
+//
+//////////////////////////////////////////////////////////////////////////
+
+#ifndef DATAFILE_H
+#define DATAFILE_H
+
+// wxWindows headers
+#include <wx/wx.h>
+#include <wx/file.h>
+
+// The size of the output buffer
+#define DATAFILE_BUFFER_SIZE    (4 * 1024 * 1024)
+
+// How a data file is compressed, going by the extension of its name:
+// .gz for gzip and .zst for zstd
+enum dataFileCompression
+{
+	DATAFILE_PLAIN,
+	DATAFILE_GZIP,
+	DATAFILE_ZSTD
+};
+
+dataFileCompression GetDataFileCompression(const wxString &path);
+
+// False if this build can't read or write files compressed that way;
+// zstd is only there if the library was found
+bool IsDataFileCompressionSupported(dataFileCompression compression);
+
+// Writes a file through a large buffer, so data can be handed over in small
+// pieces at little cost. Once opened, it may be used from any one thread; a
+// failed write is remembered rather than logged, for the caller to report.
+// The data is compressed on its way to the file if its name asks for it.
+class dataFileWriter
+{
+public:
+	dataFileWriter();
+	~dataFileWriter();
+
+	// Creates the file, replacing any of that name
+	bool Open(const wxString &path);
+
+	bool Write(const void *data, size_t len)
+	{
+		if (len <= bufSize - used)
+		{
+			memcpy(buffer + used, data, len);
+			used += len;
+			return true;
+		}
+		return WriteThrough(data, len);
+	}
+
+	// Flushes and closes the file, false if anything failed to be written
+	bool Close();
+
+	bool IsOk() const
+	{
+		return file.IsOpened() && !failed;
+	}
+
+	// The bytes handed over, before any compression
+	wxFileOffset GetBytesWritten() const
+	{
+		return written + used;
+	}
+	const wxString &GetPath() const
+	{
+		return path;
+	}
+
+private:
+	bool Flush(bool finish = false);
+	bool WriteThrough(const void *data, size_t len);
+	bool WriteRaw(const char *data, size_t len);
+	void EndCompression();
+
+	wxFile file;
+	wxString path;
+	char *buffer;
+	size_t bufSize, used;
+	wxFileOffset written;
+	bool failed;
+
+	// The compressor's state, and its output on the way to the file
+	dataFileCompression compression;
+	void *stream;
+	char *packed;
+};
+
+
+// Reads a file in the large pieces it is asked for. Like the writer, it may
+// be used from any one thread once opened, and doesn't log read errors. A
+// compressed file is read as the data it holds.
+class dataFileReader
+{
+public:
+	dataFileReader();
+	~dataFileReader();
+
+	bool Open(const wxString &path);
+
+	// Reads up to len bytes, returning how many were read, 0 at the end of
+	// the file and -1 if it failed
+	long Read(void *data, size_t len);
+
+	void Close();
+
+	// In bytes of the file, compressed or not
+	wxFileOffset GetLength() const
+	{
+		return length;
+	}
+	wxFileOffset GetBytesRead() const
+	{
+		return bytesRead;
+	}
+	const wxString &GetPath() const
+	{
+		return path;
+	}
+
+private:
+	long ReadRaw(void *data, size_t len);
+	bool ReadPacked();
+	long Inflate(char *data, size_t len);
+	long Decompress(char *data, size_t len);
+	void EndCompression();
+
+	wxFile file;
+	wxString path;
+	wxFileOffset length, bytesRead;
+
+	// The decompressor's state, and the file's data waiting for it
+	dataFileCompression compression;
+	void *stream;
+	char *packed;
+	size_t packedStart, packedLen;
+	bool eof, midStream;
+};
+
+#endif
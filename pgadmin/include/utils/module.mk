@@ -11,6 +11,7 @@
 
 pgadmin3_SOURCES += \
 	include/utils/csvfiles.h \
+	include/utils/dataFile.h \
 	include/utils/factory.h \
 	include/utils/favourites.h \
 	include/utils/misc.h \
@@ -21,7 +22,9 @@ pgadmin3_SOURCES += \
 	include/utils/sysLogger.h \
 	include/utils/sysProcess.h \
 	include/utils/sysSettings.h \
+	include/utils/utf8.h \
 	include/utils/utffile.h \
+	include/utils/workerProgress.h \
 	include/utils/macros.h
 
 if BUILD_SSH_TUNNEL
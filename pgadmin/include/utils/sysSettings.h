@@ -19,12 +19,38 @@
 #include <wx/config.h>
 #include <wx/fileconf.h>
 
+// Settings read on hot paths, such as for every cell shown or copied. They
+// are kept in memory, so reading them doesn't go to the config backend.
+struct sysSettingsSnapshot
+{
+	bool indicateNull;
+	long maxColSize;
+	wxString decimalMark, thousandsSeparator;
+	bool columnNames;
+	int copyQuoting;
+	wxString copyQuoteChar, copyColSeparator;
+};
+
+// Sent to the handlers added with sysSettings::AddChangeHandler() once the
+// options have been changed.
+extern const wxEventType SettingsChangedEvent;
+
 // Class declarations
 class sysSettings : private wxConfig
 {
 public:
 	sysSettings(const wxString &name);
 	~sysSettings();
+
+	const sysSettingsSnapshot &GetSnapshot() const
+	{
+		return snapshot;
+	}
+
+	// Reload the snapshot, and let the handlers know about the change
+	void NotifyChanged();
+	void AddChangeHandler(wxEvtHandler *handler);
+	void RemoveChangeHandler(wxEvtHandler *handler);
 	// Display options
 	bool GetDisplayOption(const wxString &objtype, bool GetDefault = false);
 	void SetDisplayOption(const wxString &objtype, bool display);
@@ -182,25 +208,26 @@ public:
 	// Copy options
 	wxString GetCopyQuoteChar() const
 	{
-		wxString s;
-		Read(wxT("Copy/QuoteChar"), &s, wxT("\""));
-		return s;
+		return snapshot.copyQuoteChar;
 	}
 	void SetCopyQuoteChar(const wxString &newval)
 	{
 		Write(wxT("Copy/QuoteChar"), newval);
+		snapshot.copyQuoteChar = newval;
 	}
 	wxString GetCopyColSeparator() const
 	{
-		wxString s;
-		Read(wxT("Copy/ColSeparator"), &s, wxT(";"));
-		return s;
+		return snapshot.copyColSeparator;
 	}
 	void SetCopyColSeparator(const wxString &newval)
 	{
 		Write(wxT("Copy/ColSeparator"), newval);
+		snapshot.copyColSeparator = newval;
+	}
+	int GetCopyQuoting() const // 0=none 1=string 2=all
+	{
+		return snapshot.copyQuoting;
 	}
-	int GetCopyQuoting(); // 0=none 1=string 2=all
 	void SetCopyQuoting(const int i);
 
 	// Export options
@@ -249,6 +276,21 @@ public:
 		WriteBool(wxT("Export/WriteBOM"), newval);
 	}
 
+	// Import options
+	// The most COPY sessions a large file is loaded over, 1 for just one.
+	// Tables with a unique index, an exclusion constraint or a foreign key
+	// to themselves always get one.
+	long GetImportSessions() const
+	{
+		long l;
+		Read(wxT("Import/Sessions"), &l, 4L);
+		return l;
+	}
+	void SetImportSessions(const long newval)
+	{
+		WriteLong(wxT("Import/Sessions"), newval);
+	}
+
 	// Explain options
 	bool GetExplainVerbose() const
 	{
@@ -346,23 +388,21 @@ public:
 	}
 	bool GetIndicateNull() const
 	{
-		bool b;
-		Read(wxT("frmQuery/IndicateNull"), &b, false);
-		return b;
+		return snapshot.indicateNull;
 	}
 	void SetIndicateNull(const bool newval)
 	{
 		WriteBool(wxT("frmQuery/IndicateNull"), newval);
+		snapshot.indicateNull = newval;
 	}
 	wxString GetThousandsSeparator() const
 	{
-		wxString s;
-		Read(wxT("frmQuery/ThousandsSeparator"), &s, wxEmptyString);
-		return s;
+		return snapshot.thousandsSeparator;
 	}
 	void SetThousandsSeparator(const wxString &newval)
 	{
 		Write(wxT("frmQuery/ThousandsSeparator"), newval);
+		snapshot.thousandsSeparator = newval;
 	}
 	bool GetAutoRollback() const
 	{
@@ -386,23 +426,21 @@ public:
 	}
 	wxString GetDecimalMark() const
 	{
-		wxString s;
-		Read(wxT("DecimalMark"), &s, wxEmptyString);
-		return s;
+		return snapshot.decimalMark;
 	}
 	void SetDecimalMark(const wxString &newval)
 	{
 		Write(wxT("DecimalMark"), newval);
+		snapshot.decimalMark = newval;
 	}
 	bool GetColumnNames() const
 	{
-		bool b;
-		Read(wxT("ColumnNames"), &b, false);
-		return b;
+		return snapshot.columnNames;
 	}
 	void SetColumnNames(const bool newval)
 	{
 		WriteBool(wxT("ColumnNames"), newval);
+		snapshot.columnNames = newval;
 	}
 	bool GetLineNumber() const
 	{
@@ -642,6 +680,70 @@ public:
 		WriteBool(wxT("KeywordsInUppercase"), newval);
 	}
 
+	// Connection pool options
+	long GetPoolMinConnections() const
+	{
+		long l;
+		Read(wxT("ConnectionPool/MinConnections"), &l, 0L);
+		return l;
+	}
+	void SetPoolMinConnections(const long newval)
+	{
+		WriteLong(wxT("ConnectionPool/MinConnections"), newval);
+	}
+	long GetPoolMaxConnections() const
+	{
+		long l;
+		Read(wxT("ConnectionPool/MaxConnections"), &l, 2L);
+		return l;
+	}
+	void SetPoolMaxConnections(const long newval)
+	{
+		WriteLong(wxT("ConnectionPool/MaxConnections"), newval);
+	}
+	long GetPoolIdleTimeout() const
+	{
+		long l;
+		Read(wxT("ConnectionPool/IdleTimeout"), &l, 120L);
+		return l;
+	}
+	void SetPoolIdleTimeout(const long newval)
+	{
+		WriteLong(wxT("ConnectionPool/IdleTimeout"), newval);
+	}
+	long GetMaxBackends() const
+	{
+		long l;
+		Read(wxT("ConnectionPool/MaxBackends"), &l, 32L);
+		return l;
+	}
+	void SetMaxBackends(const long newval)
+	{
+		WriteLong(wxT("ConnectionPool/MaxBackends"), newval);
+	}
+
+	// Connection health options
+	long GetConnectionCheckInterval() const
+	{
+		long l;
+		Read(wxT("ConnectionHealth/CheckInterval"), &l, 5L);
+		return l;
+	}
+	void SetConnectionCheckInterval(const long newval)
+	{
+		WriteLong(wxT("ConnectionHealth/CheckInterval"), newval);
+	}
+	long GetKeepaliveIdle() const
+	{
+		long l;
+		Read(wxT("ConnectionHealth/KeepaliveIdle"), &l, 60L);
+		return l;
+	}
+	void SetKeepaliveIdle(const long newval)
+	{
+		WriteLong(wxT("ConnectionHealth/KeepaliveIdle"), newval);
+	}
+
 	// Misc options
 	long GetAutoRowCountThreshold() const
 	{
@@ -703,15 +805,32 @@ public:
 	{
 		WriteLong(wxT("frmQuery/MaxRows"), newval);
 	}
-	long GetMaxColSize() const
+	// In MB, 0 keeps all results in memory
+	long GetResultSpillThreshold() const
 	{
 		long l;
-		Read(wxT("frmQuery/MaxColSize"), &l, 256L);
+		Read(wxT("frmQuery/ResultSpillThreshold"), &l, 512L);
 		return l;
 	}
+	void SetResultSpillThreshold(const long newval)
+	{
+		WriteLong(wxT("frmQuery/ResultSpillThreshold"), newval);
+	}
+	// Where spilled results go: on disk, as a file on a tmpfs is held in
+	// memory all the same
+	wxString GetResultSpillDirectory();
+	void SetResultSpillDirectory(const wxString &newval)
+	{
+		Write(wxT("frmQuery/ResultSpillDirectory"), newval);
+	}
+	long GetMaxColSize() const
+	{
+		return snapshot.maxColSize;
+	}
 	void SetMaxColSize(const long newval)
 	{
 		WriteLong(wxT("frmQuery/MaxColSize"), newval);
+		snapshot.maxColSize = newval;
 	}
 	bool GetAskSaveConfirmation() const
 	{
@@ -840,7 +959,11 @@ private:
 	bool moveStringValue(const wxChar *oldKey, const wxChar *newKey, int index = -1);
 	bool moveLongValue(const wxChar *oldKey, const wxChar *newKey, int index = -1);
 
+	void LoadSnapshot();
+
 	wxFileConfig *defaultSettings;
+	sysSettingsSnapshot snapshot;
+	wxArrayPtrVoid changeHandlers;
 };
 
 #endif
@@ -0,0 +1,30 @@
+//////////////////////////////////////////////////////////////////////////
+//
+// pgAdmin III - PostgreSQL Tools
+//
+// Copyright (C) 2002 - 2016, The pgAdmin Development Team
+// This software is released under the PostgreSQL Licence
+//
+// utf8.h - Fast UTF-8 decoding and encoding
+//
+//////////////////////////////////////////////////////////////////////////
+
+#ifndef UTF8_H
+#define UTF8_H
+
+// wxWindows headers
+#include <wx/wx.h>
+
+// Decode UTF-8 text into a wxString, as wxString(str, wxConvUTF8) does but
+// without its generic conversion machinery: runs of ASCII are widened
+// several bytes at a time, and only multibyte sequences are decoded one
+// character at a time. Invalid text is handed to wxConvUTF8, so the result
+// is always the same as with it.
+wxString DecodeUTF8(const char *str);
+wxString DecodeUTF8(const char *str, size_t len);
+
+// Append the text to the buffer as UTF-8, as mb_str(wxConvUTF8) would
+// convert it, but straight into the buffer and without a terminating NUL.
+void EncodeUTF8(const wxString &str, wxMemoryBuffer &buf);
+
+#endif
@@ -0,0 +1,73 @@
+//////////////////////////////////////////////////////////////////////////
+//
+// pgAdmin III - PostgreSQL Tools
+//
+// Copyright (C) 2002 - 2016, The pgAdmin Development Team
+// This software is released under the PostgreSQL Licence
+//
+// workerProgress.h - Waiting for worker threads, with their progress shown
+//
+//////////////////////////////////////////////////////////////////////////
+
+#ifndef WORKERPROGRESS_H
+#define WORKERPROGRESS_H
+
+// wxWindows headers
+#include <wx/wx.h>
+#include <wx/progdlg.h>
+
+class wxEventLoop;
+
+// Lets the GUI wait for work done by other threads. The workers report
+// through Update() and Done(), which post events, so the GUI only wakes up
+// when there is something to show. The other windows are disabled while
+// waiting, and a progress dialog, which lets the user cancel, appears once
+// the work takes more than half a second.
+class workerProgress : public wxEvtHandler
+{
+public:
+	workerProgress(wxWindow *parent, const wxString &title, const wxString &message, int range);
+	virtual ~workerProgress();
+
+	// Called by the workers: the progress, out of the range, and the end
+	// of the work, which must come even if it was cancelled
+	void Update(int value);
+	void Done();
+
+	bool IsCancelled() const
+	{
+		return cancelled;
+	}
+
+	// Process the events of the GUI until Done() is called. Returns false
+	// if the user cancelled.
+	bool Wait();
+
+protected:
+	// Called on the GUI thread when the user cancels, to stop workers that
+	// may be blocked and unable to check IsCancelled()
+	virtual void OnCancel() {}
+
+	// Called on the GUI thread with the progress reported, for showing it
+	// elsewhere as well
+	virtual void OnUpdate(int value) {}
+
+private:
+	void OnProgress(wxCommandEvent &ev);
+	void OnDone(wxCommandEvent &ev);
+	void OnTimer(wxTimerEvent &ev);
+	void Cancel();
+
+	wxWindow *parent;
+	wxString title, message;
+	int range;
+
+	wxProgressDialog *dialog;
+	wxTimer timer;
+	wxEventLoop *loop;
+
+	volatile int value;
+	volatile bool posted, cancelled, done;
+};
+
+#endif
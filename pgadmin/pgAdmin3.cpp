@@ -62,6 +62,7 @@
 #include "frm/frmSplash.h"
 #include "dlg/dlgSelectConnection.h"
 #include "db/pgConn.h"
+#include "db/pgConnMonitor.h"
 #include "utils/sysLogger.h"
 #include "utils/registry.h"
 #include "frm/frmHint.h"
@@ -838,6 +839,8 @@ int pgAdmin3::OnExit()
 		delete updateThread;
 	}
 
+	pgConnMonitor::Shutdown();
+
 	// Delete the settings object to ensure settings are saved.
 	delete settings;
 
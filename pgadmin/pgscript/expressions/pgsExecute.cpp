@@ -90,24 +90,9 @@ pgsOperand pgsExecute::eval(pgsVarMap &vars) const
 		{
 			if (thread.Run() == wxTHREAD_NO_ERROR)
 			{
-				while (true)
-				{
-					if (m_app->TestDestroy()) // wxThread::TestDestroy()
-					{
-						thread.Delete();
-						break;
-					}
-					else if (thread.IsRunning())
-					{
-						m_app->Yield();
-						m_app->Sleep(20);
-					}
-					else
-					{
-						thread.Wait();
-						break;
-					}
-				}
+				// pgsApplication::Terminate() cancels the running query, so
+				// we can simply wait for the thread to finish
+				thread.Wait();
 
 				if (thread.ReturnCode() != PGRES_COMMAND_OK
 				        && thread.ReturnCode() != PGRES_TUPLES_OK)
@@ -159,6 +144,7 @@ pgsOperand pgsExecute::eval(pgsVarMap &vars) const
 						rec = pnew pgsRecord(set->NumCols());
 						wxArrayLong columns_int; // List of columns that contain integers
 						wxArrayLong columns_real; // List of columns that contain reals
+						set->ResolveColTypes();
 						for (long i = 0; i < set->NumCols(); i++)
 						{
 							rec->set_column_name(i, set->ColName(i));
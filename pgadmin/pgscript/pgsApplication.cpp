@@ -136,6 +136,12 @@ void pgsApplication::Terminate()
 	if (IsRunning())
 	{
 		wxLogScript(wxT("Deleting pgScript"));
+
+		// Interrupt the statement being executed (if any), so the
+		// thread gets to check whether it should stop
+		if (m_connection)
+			m_connection->CancelExecution();
+
 		m_thread->Delete();
 	}
 }
@@ -565,6 +565,10 @@ pgObject *pgColumnFactory::CreateObjects(pgCollection *coll, ctlTree *browser, c
 	pgDatabase *database = collection->GetDatabase();
 	inheritHashMap inhMap;
 
+	// Both queries are run for every table, so have them prepared once
+	wxArrayString params;
+	params.Add(collection->GetOidStr());
+
 	// grab inherited tables with attibute names
 	pgSet *inhtables = database->ExecuteSet(
 	                       wxT("SELECT\n")
@@ -578,9 +582,9 @@ pgObject *pgColumnFactory::CreateObjects(pgCollection *coll, ctlTree *browser, c
 	                       wxT("        pg_inherits i\n")
 	                       wxT("        LEFT JOIN pg_attribute a ON\n")
 	                       wxT("            (attrelid = inhparent AND attnum > 0)\n")
-	                       wxT("    WHERE inhrelid = ") + collection->GetOidStr() + wxT("::oid\n")
+	                       wxT("    WHERE inhrelid = $1::oid\n")
 	                       wxT("    ORDER BY inhseqno) a\n")
-	                       wxT("GROUP BY attrname"));
+	                       wxT("GROUP BY attrname"), params);
 
 	if (inhtables)
 	{
@@ -634,12 +638,12 @@ pgObject *pgColumnFactory::CreateObjects(pgCollection *coll, ctlTree *browser, c
 	if (database->BackendMinimumVersion(9, 1))
 		sql += wxT("  LEFT OUTER JOIN pg_collation coll ON att.attcollation=coll.oid\n")
 		       wxT("  LEFT OUTER JOIN pg_namespace nspc ON coll.collnamespace=nspc.oid\n");
-	sql += wxT(" WHERE att.attrelid = ") + collection->GetOidStr()
+	sql += wxT(" WHERE att.attrelid = $1")
 	       + restriction + systemRestriction + wxT("\n")
 	       wxT("   AND att.attisdropped IS FALSE\n")
 	       wxT(" ORDER BY att.attnum");
 
-	pgSet *columns = database->ExecuteSet(sql);
+	pgSet *columns = database->ExecuteSet(sql, params);
 	if (columns)
 	{
 		while (!columns->Eof())
@@ -386,6 +386,32 @@ wxString pgDatabase::ExecuteScalar(const wxString &sql)
 }
 
 
+pgSet *pgDatabase::ExecuteSet(const wxString &sql, const wxArrayString &params)
+{
+	pgSet *set = 0;
+	if (connection())
+	{
+		set = connection()->ExecuteSet(sql, params);
+		if (!set)
+			CheckAlive();
+	}
+	return set;
+}
+
+
+wxString pgDatabase::ExecuteScalar(const wxString &sql, const wxArrayString &params)
+{
+	wxString str;
+	if (connection())
+	{
+		str = connection()->ExecuteScalar(sql, params);
+		if (str.IsEmpty() && connection()->GetLastResultStatus() != PGRES_TUPLES_OK)
+			CheckAlive();
+	}
+	return str;
+}
+
+
 bool pgDatabase::ExecuteVoid(const wxString &sql, bool reportError)
 {
 	bool rc = 0;
@@ -752,6 +778,15 @@ void pgDatabase::ShowTreeDetail(ctlTree *browser, frmMain *form, ctlListView *pr
 		}
 		properties->AppendYesNoItem(_("Allow connections?"), GetAllowConnections());
 		properties->AppendYesNoItem(_("Connected?"), GetConnected());
+		if (GetConnection())
+		{
+			long hits = GetConnection()->GetStatementCacheHits();
+			long total = hits + GetConnection()->GetStatementCacheMisses();
+
+			if (total)
+				properties->AppendItem(_("Statement cache hits"),
+				                       wxString::Format(_("%ld of %ld (%ld%%)"), hits, total, hits * 100 / total));
+		}
 		if (GetConnection() && GetConnection()->BackendMinimumVersion(8, 1))
 		{
 			wxString strConnLimit;
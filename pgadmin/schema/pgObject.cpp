@@ -18,6 +18,7 @@
 #include "schema/pgObject.h"
 #include "schema/pgServer.h"
 #include "frm/frmMain.h"
+#include "ctl/ctlListView.h"
 #include "frm/frmReport.h"
 #include "schema/pgDomain.h"
 #include "schema/pgAggregate.h"
@@ -67,6 +68,16 @@
 #include "agent/pgaSchedule.h"
 #include "agent/pgaStep.h"
 
+// The queries filling the dependencies and dependents panes, which run in
+// the background, see ShowAsyncRows()
+enum
+{
+	DEPSTEP_OBJECTS,
+	DEPSTEP_ROLES,
+	DEPSTEP_SEQUENCE_COLUMNS,
+	DEPSTEP_SEQUENCES
+};
+
 
 int pgObject::GetType() const
 {
@@ -194,6 +205,12 @@ pgObject::pgObject(int newType, const wxString &newName)
 }
 
 
+pgObject::~pgObject()
+{
+	ctlListView::ForgetAsyncOwner(this);
+}
+
+
 void pgObject::AppendMenu(wxMenu *menu, int type)
 {
 	if (menu)
@@ -238,8 +255,9 @@ bool pgObject::UpdateIcon(ctlTree *browser)
 }
 
 
-void pgObject::ShowDependency(pgDatabase *db, ctlListView *list, const wxString &query, const wxString &clsorder)
+void pgObject::ShowDependency(ctlListView *list, const wxString &query, const wxString &clsorder)
 {
+	list->ClearAsync();
 	list->ClearAll();
 	list->AddColumn(_("Type"), 60);
 	list->AddColumn(_("Name"), 100);
@@ -248,7 +266,6 @@ void pgObject::ShowDependency(pgDatabase *db, ctlListView *list, const wxString
 	pgConn *conn = GetConnection();
 	if (conn)
 	{
-		pgSet *set;
 		// currently missing:
 		// - pg_cast
 		// - pg_operator
@@ -257,179 +274,183 @@ void pgObject::ShowDependency(pgDatabase *db, ctlListView *list, const wxString
 		// not being implemented:
 		// - pg_index (done by pg_class)
 
-		set = conn->ExecuteSet(query + wxT("\n")
-		                       wxT("   AND ") + clsorder + wxT(" IN (\n")
-		                       wxT("   SELECT oid FROM pg_class\n")
-		                       wxT("    WHERE relname IN ('pg_class', 'pg_constraint', 'pg_conversion', 'pg_language', 'pg_proc',\n")
-		                       wxT("                      'pg_rewrite', 'pg_namespace', 'pg_trigger', 'pg_type', 'pg_attrdef', 'pg_event_trigger'))\n")
-		                       wxT(" ORDER BY ") + clsorder + wxT(", cl.relkind"));
+		list->AppendRowsAsync(conn, query + wxT("\n")
+		                      wxT("   AND ") + clsorder + wxT(" IN (\n")
+		                      wxT("   SELECT oid FROM pg_class\n")
+		                      wxT("    WHERE relname IN ('pg_class', 'pg_constraint', 'pg_conversion', 'pg_language', 'pg_proc',\n")
+		                      wxT("                      'pg_rewrite', 'pg_namespace', 'pg_trigger', 'pg_type', 'pg_attrdef', 'pg_event_trigger'))\n")
+		                      wxT(" ORDER BY ") + clsorder + wxT(", cl.relkind"),
+		                      this, DEPSTEP_OBJECTS);
+	}
+}
 
-		if (set)
+
+void pgObject::ShowDependencyRows(ctlListView *list, pgSet *set)
+{
+	pgDatabase *db = GetDatabase();
+
+	while (!set->Eof())
+	{
+		wxString refname;
+		wxString _refname = set->GetVal(wxT("refname"));
+
+		if (db)
+			refname = db->GetQuotedSchemaPrefix(set->GetVal(wxT("nspname")));
+		else
 		{
-			while (!set->Eof())
-			{
-				wxString refname;
-				wxString _refname = set->GetVal(wxT("refname"));
+			refname = qtIdent(set->GetVal(wxT("nspname")));
+			if (!refname.IsEmpty())
+				refname += wxT(".");
+		}
 
-				if (db)
-					refname = db->GetQuotedSchemaPrefix(set->GetVal(wxT("nspname")));
-				else
-				{
-					refname = qtIdent(set->GetVal(wxT("nspname")));
-					if (!refname.IsEmpty())
-						refname += wxT(".");
-				}
+		wxString typestr = set->GetVal(wxT("type"));
+		pgaFactory *depFactory = 0;
+		switch ((wxChar)typestr.c_str()[0])
+		{
+			case 'c':
+			case 's':   // we don't know these; internally handled
+			case 't':
+				set->MoveNext();
+				continue;
 
-				wxString typestr = set->GetVal(wxT("type"));
-				pgaFactory *depFactory = 0;
-				switch ((wxChar)typestr.c_str()[0])
+			case 'r':
+			{
+				if (StrToLong(typestr.Mid(1)) > 0)
+					depFactory = &columnFactory;
+				else
+					depFactory = &tableFactory;
+				break;
+			}
+			case 'i':
+				depFactory = &indexFactory;
+				break;
+			case 'S':
+				depFactory = &sequenceFactory;
+				break;
+			case 'v':
+				depFactory = &viewFactory;
+				break;
+			case 'x':
+				depFactory = &extTableFactory;
+				break;
+			case 'p':
+				depFactory = &functionFactory;
+				break;
+			case 'n':
+				depFactory = &schemaFactory;
+				break;
+			case 'y':
+				depFactory = &typeFactory;
+				break;
+			case 'T':
+				depFactory = &triggerFactory;
+				break;
+			case 'l':
+				depFactory = &languageFactory;
+				break;
+			case 'R':
+			{
+				refname = _refname + wxT(" ON ") + refname + set->GetVal(wxT("ownertable"));
+				_refname = wxEmptyString;
+				depFactory = &ruleFactory;
+				break;
+			}
+			case 'C':
+			{
+				switch ((wxChar)typestr.c_str()[1])
 				{
 					case 'c':
-					case 's':   // we don't know these; internally handled
-					case 't':
-						set->MoveNext();
-						continue;
-
-					case 'r':
-					{
-						if (StrToLong(typestr.Mid(1)) > 0)
-							depFactory = &columnFactory;
-						else
-							depFactory = &tableFactory;
-						break;
-					}
-					case 'i':
-						depFactory = &indexFactory;
-						break;
-					case 'S':
-						depFactory = &sequenceFactory;
+						depFactory = &checkFactory;
 						break;
-					case 'v':
-						depFactory = &viewFactory;
-						break;
-					case 'x':
-						depFactory = &extTableFactory;
+					case 'f':
+						refname += set->GetVal(wxT("ownertable")) + wxT(".");
+						depFactory = &foreignKeyFactory;
 						break;
 					case 'p':
-						depFactory = &functionFactory;
-						break;
-					case 'n':
-						depFactory = &schemaFactory;
-						break;
-					case 'y':
-						depFactory = &typeFactory;
+						depFactory = &primaryKeyFactory;
 						break;
-					case 'T':
-						depFactory = &triggerFactory;
+					case 'u':
+						depFactory = &uniqueFactory;
 						break;
-					case 'l':
-						depFactory = &languageFactory;
-						break;
-					case 'R':
-					{
-						refname = _refname + wxT(" ON ") + refname + set->GetVal(wxT("ownertable"));
-						_refname = wxEmptyString;
-						depFactory = &ruleFactory;
-						break;
-					}
-					case 'C':
-					{
-						switch ((wxChar)typestr.c_str()[1])
-						{
-							case 'c':
-								depFactory = &checkFactory;
-								break;
-							case 'f':
-								refname += set->GetVal(wxT("ownertable")) + wxT(".");
-								depFactory = &foreignKeyFactory;
-								break;
-							case 'p':
-								depFactory = &primaryKeyFactory;
-								break;
-							case 'u':
-								depFactory = &uniqueFactory;
-								break;
-							case 'x':
-								depFactory = &excludeFactory;
-								break;
-							default:
-								break;
-						}
+					case 'x':
+						depFactory = &excludeFactory;
 						break;
-					}
-					case 'A':
-					{
-						// Include only functions
-						if (set->GetVal(wxT("adbin")).StartsWith(wxT("{FUNCEXPR")))
-						{
-							depFactory = &functionFactory;
-							refname = set->GetVal(wxT("adsrc"));
-							break;
-						}
-						else
-						{
-							set->MoveNext();
-							continue;
-						}
-					}
 					default:
 						break;
 				}
-
-				refname += _refname;
-
-				wxString typname;
-				int icon;
-				if (depFactory)
+				break;
+			}
+			case 'A':
+			{
+				// Include only functions
+				if (set->GetVal(wxT("adbin")).StartsWith(wxT("{FUNCEXPR")))
 				{
-					typname = depFactory->GetTypeName();
-					icon = depFactory->GetIconId();
+					depFactory = &functionFactory;
+					refname = set->GetVal(wxT("adsrc"));
+					break;
 				}
 				else
 				{
-					typname = _("Unknown");
-					icon = -1;
+					set->MoveNext();
+					continue;
 				}
+			}
+			default:
+				break;
+		}
 
-				wxString deptype;
+		refname += _refname;
 
-				switch ( (wxChar) set->GetVal(wxT("deptype")).c_str()[0])
+		wxString typname;
+		int icon;
+		if (depFactory)
+		{
+			typname = depFactory->GetTypeName();
+			icon = depFactory->GetIconId();
+		}
+		else
+		{
+			typname = _("Unknown");
+			icon = -1;
+		}
+
+		wxString deptype;
+
+		switch ( (wxChar) set->GetVal(wxT("deptype")).c_str()[0])
+		{
+			case 'n':
+				deptype = wxT("normal");
+				break;
+			case 'a':
+				deptype = wxT("auto");
+				break;
+			case 'i':
+			{
+				if (settings->GetShowSystemObjects())
+					deptype = wxT("internal");
+				else
 				{
-					case 'n':
-						deptype = wxT("normal");
-						break;
-					case 'a':
-						deptype = wxT("auto");
-						break;
-					case 'i':
-					{
-						if (settings->GetShowSystemObjects())
-							deptype = wxT("internal");
-						else
-						{
-							set->MoveNext();
-							continue;
-						}
-						break;
-					}
-					case 'p':
-						deptype = wxT("pin");
-						typname = wxEmptyString;
-						break;
-					default:
-						break;
+					set->MoveNext();
+					continue;
 				}
-
-				list->AppendItem(icon, typname, refname, deptype);
-				set->MoveNext();
+				break;
 			}
-			delete set;
+			case 'p':
+				deptype = wxT("pin");
+				typname = wxEmptyString;
+				break;
+			default:
+				break;
 		}
+
+		list->AppendItem(icon, typname, refname, deptype);
+		set->MoveNext();
 	}
 }
 
 void pgObject::CreateList3Columns(ctlListView *list, const wxString &left, const wxString &middle, const wxString &right)
 {
+	list->ClearAsync();
 	list->ClearAll();
 	list->AddColumn(left, 80);
 	list->AddColumn(middle, 80);
@@ -439,6 +460,7 @@ void pgObject::CreateList3Columns(ctlListView *list, const wxString &left, const
 
 void pgObject::CreateListColumns(ctlListView *list, const wxString &left, const wxString &right)
 {
+	list->ClearAsync();
 	list->ClearAll();
 	list->AddColumn(left, 130);
 	list->AddColumn(right, list->GetSize().GetWidth() - 140);
@@ -483,7 +505,7 @@ void pgObject::ShowDependencies(frmMain *form, ctlListView *Dependencies, const
 	*                        la.lanname, rw.rulename, ns.nspname)
 	*     END
 	*/
-	ShowDependency(GetDatabase(), Dependencies,
+	ShowDependency(Dependencies,
 	               wxT("SELECT DISTINCT dep.deptype, dep.refclassid, cl.relkind, ad.adbin, ad.adsrc, \n")
 	               wxT("       CASE WHEN cl.relkind IS NOT NULL THEN cl.relkind || COALESCE(dep.refobjsubid::text, '')\n")
 	               wxT("            WHEN tg.oid IS NOT NULL THEN 'T'::text\n")
@@ -525,26 +547,13 @@ void pgObject::ShowDependencies(frmMain *form, ctlListView *Dependencies, const
 	{
 		if (where.Find(wxT("subid")) < 0 && conn->BackendMinimumVersion(8, 1))
 		{
-			int iconId = groupRoleFactory.GetCollectionFactory()->GetIconId();
-			pgSetIterator set(conn,
-			                  wxT("SELECT rolname AS refname, refclassid, deptype\n")
-			                  wxT("  FROM pg_shdepend dep\n")
-			                  wxT("  LEFT JOIN pg_roles r ON refclassid=1260 AND refobjid=r.oid\n")
-			                  + where + wxT("\n")
-			                  wxT(" ORDER BY 1"));
-
-			while (set.RowsLeft())
-			{
-				wxString refname = set.GetVal(wxT("refname"));
-				wxString deptype = set.GetVal(wxT("deptype"));
-				if (deptype == wxT("a"))
-					deptype = wxT("ACL");
-				else if (deptype == wxT("o"))
-					deptype = _("Owner");
-
-				if (set.GetOid(wxT("refclassid")) == PGOID_CLASS_PG_AUTHID)
-					Dependencies->AppendItem(iconId, wxT("Role"), refname, deptype);
-			}
+			Dependencies->AppendRowsAsync(conn,
+			                              wxT("SELECT rolname AS refname, refclassid, deptype\n")
+			                              wxT("  FROM pg_shdepend dep\n")
+			                              wxT("  LEFT JOIN pg_roles r ON refclassid=1260 AND refobjid=r.oid\n")
+			                              + where + wxT("\n")
+			                              wxT(" ORDER BY 1"),
+			                              this, DEPSTEP_ROLES);
 		}
 		/*
 		*
@@ -567,7 +576,6 @@ void pgObject::ShowDependencies(frmMain *form, ctlListView *Dependencies, const
 		*/
 		if (GetMetaType() == PGM_SEQUENCE)
 		{
-			int iconId = columnFactory.GetIconId();
 			/*
 			* Behavior of concatinating operator (||) is different for EnterpriseDB.
 			* For the following query:
@@ -585,32 +593,20 @@ void pgObject::ShowDependencies(frmMain *form, ctlListView *Dependencies, const
 			*          ELSE ref.relname
 			*     END
 			*/
-			pgSetIterator set(conn,
-			                  wxT("SELECT \n")
-			                  wxT("  CASE WHEN att.attname IS NOT NULL AND ref.relname IS NOT NULL THEN ref.relname || '.' || att.attname\n")
-			                  wxT("       ELSE ref.relname \n")
-			                  wxT("  END AS refname, \n")
-			                  wxT("  d2.refclassid, d1.deptype AS deptype\n")
-			                  wxT("FROM pg_depend d1\n")
-			                  wxT("  LEFT JOIN pg_depend d2 ON d1.objid=d2.objid AND d1.refobjid != d2.refobjid\n")
-			                  wxT("  LEFT JOIN pg_class ref ON ref.oid = d2.refobjid\n")
-			                  wxT("  LEFT JOIN pg_attribute att ON d2.refobjid=att.attrelid AND d2.refobjsubid=att.attnum\n")
-			                  wxT("WHERE d1.classid=(SELECT oid FROM pg_class WHERE relname='pg_attrdef')\n")
-			                  wxT("  AND d2.refobjid NOT IN (SELECT d3.refobjid FROM pg_depend d3 WHERE d3.objid=d1.refobjid)\n")
-			                  wxT("  AND d1.refobjid=") + GetOidStr());
-			while (set.RowsLeft())
-			{
-				wxString refname = set.GetVal(wxT("refname"));
-				wxString deptype = set.GetVal(wxT("deptype"));
-				if (deptype == wxT("n"))
-					deptype = wxT("normal");
-				else if (deptype == wxT("i"))
-					deptype = _("internal");
-				else if (deptype == wxT("a"))
-					deptype = _("auto");
-
-				Dependencies->AppendItem(iconId, wxT("Column"), refname, deptype);
-			}
+			Dependencies->AppendRowsAsync(conn,
+			                              wxT("SELECT \n")
+			                              wxT("  CASE WHEN att.attname IS NOT NULL AND ref.relname IS NOT NULL THEN ref.relname || '.' || att.attname\n")
+			                              wxT("       ELSE ref.relname \n")
+			                              wxT("  END AS refname, \n")
+			                              wxT("  d2.refclassid, d1.deptype AS deptype\n")
+			                              wxT("FROM pg_depend d1\n")
+			                              wxT("  LEFT JOIN pg_depend d2 ON d1.objid=d2.objid AND d1.refobjid != d2.refobjid\n")
+			                              wxT("  LEFT JOIN pg_class ref ON ref.oid = d2.refobjid\n")
+			                              wxT("  LEFT JOIN pg_attribute att ON d2.refobjid=att.attrelid AND d2.refobjsubid=att.attnum\n")
+			                              wxT("WHERE d1.classid=(SELECT oid FROM pg_class WHERE relname='pg_attrdef')\n")
+			                              wxT("  AND d2.refobjid NOT IN (SELECT d3.refobjid FROM pg_depend d3 WHERE d3.objid=d1.refobjid)\n")
+			                              wxT("  AND d1.refobjid=") + GetOidStr(),
+			                              this, DEPSTEP_SEQUENCE_COLUMNS);
 		}
 	}
 
@@ -650,7 +646,7 @@ void pgObject::ShowDependents(frmMain *form, ctlListView *referencedBy, const wx
 	*                        la.lanname, rw.rulename, ns.nspname)
 	*     END
 	*/
-	ShowDependency(GetDatabase(), referencedBy,
+	ShowDependency(referencedBy,
 	               wxT("SELECT DISTINCT dep.deptype, dep.classid, cl.relkind, ad.adbin, ad.adsrc, \n")
 	               wxT("       CASE WHEN cl.relkind IS NOT NULL THEN cl.relkind || COALESCE(dep.objsubid::text, '')\n")
 	               wxT("            WHEN tg.oid IS NOT NULL THEN 'T'::text\n")
@@ -709,7 +705,6 @@ void pgObject::ShowDependents(frmMain *form, ctlListView *referencedBy, const wx
 	pgConn *conn = GetConnection();
 	if (conn && (GetMetaType() == PGM_TABLE || GetMetaType() == PGM_COLUMN))
 	{
-		int iconId = sequenceFactory.GetIconId();
 		wxString strQuery =
 		    wxT("SELECT ref.relname AS refname, d2.refclassid, dep.deptype AS deptype\n")
 		    wxT("  FROM pg_depend dep\n")
@@ -720,24 +715,78 @@ void pgObject::ShowDependents(frmMain *form, ctlListView *referencedBy, const wx
 		    wxT("    AND dep.classid=(SELECT oid FROM pg_class WHERE relname='pg_attrdef')\n")
 		    wxT("    AND dep.refobjid NOT IN (SELECT d3.refobjid FROM pg_depend d3 WHERE d3.objid=d2.refobjid)");
 
+		referencedBy->AppendRowsAsync(conn, strQuery, this, DEPSTEP_SEQUENCES);
+	}
+}
+
 
-		pgSetIterator set(conn, strQuery);
+// The rows of the queries the dependencies and dependents panes are filled
+// from, in the order they were queued
+void pgObject::ShowAsyncRows(ctlListView *list, pgSet *set, int step)
+{
+	switch (step)
+	{
+		case DEPSTEP_OBJECTS:
+			ShowDependencyRows(list, set);
+			break;
 
-		while (set.RowsLeft())
+		case DEPSTEP_ROLES:
 		{
-			wxString refname = set.GetVal(wxT("refname"));
-			if (refname.IsEmpty())
-				continue;
+			int iconId = groupRoleFactory.GetCollectionFactory()->GetIconId();
+			for ( ; !set->Eof() ; set->MoveNext())
+			{
+				wxString refname = set->GetVal(wxT("refname"));
+				wxString deptype = set->GetVal(wxT("deptype"));
+				if (deptype == wxT("a"))
+					deptype = wxT("ACL");
+				else if (deptype == wxT("o"))
+					deptype = _("Owner");
+
+				if (set->GetOid(wxT("refclassid")) == PGOID_CLASS_PG_AUTHID)
+					list->AppendItem(iconId, wxT("Role"), refname, deptype);
+			}
+			break;
+		}
+
+		case DEPSTEP_SEQUENCE_COLUMNS:
+		{
+			int iconId = columnFactory.GetIconId();
+			for ( ; !set->Eof() ; set->MoveNext())
+			{
+				wxString refname = set->GetVal(wxT("refname"));
+				wxString deptype = set->GetVal(wxT("deptype"));
+				if (deptype == wxT("n"))
+					deptype = wxT("normal");
+				else if (deptype == wxT("i"))
+					deptype = _("internal");
+				else if (deptype == wxT("a"))
+					deptype = _("auto");
+
+				list->AppendItem(iconId, wxT("Column"), refname, deptype);
+			}
+			break;
+		}
 
-			wxString deptype = set.GetVal(wxT("deptype"));
-			if (deptype == wxT("a"))
-				deptype = _("auto");
-			else if (deptype == wxT("n"))
-				deptype = _("normal");
-			else if (deptype == wxT("i"))
-				deptype = _("internal");
+		case DEPSTEP_SEQUENCES:
+		{
+			int iconId = sequenceFactory.GetIconId();
+			for ( ; !set->Eof() ; set->MoveNext())
+			{
+				wxString refname = set->GetVal(wxT("refname"));
+				if (refname.IsEmpty())
+					continue;
 
-			referencedBy->AppendItem(iconId, wxT("Sequence"), refname, deptype);
+				wxString deptype = set->GetVal(wxT("deptype"));
+				if (deptype == wxT("a"))
+					deptype = _("auto");
+				else if (deptype == wxT("n"))
+					deptype = _("normal");
+				else if (deptype == wxT("i"))
+					deptype = _("internal");
+
+				list->AppendItem(iconId, wxT("Sequence"), refname, deptype);
+			}
+			break;
 		}
 	}
 }
@@ -1355,6 +1404,13 @@ wxString pgDatabaseObject::GetQuotedSchemaPrefix(const wxString &schemaname) con
 
 
 void pgDatabaseObject::DisplayStatistics(ctlListView *statistics, const wxString &query)
+{
+	DisplayStatistics(statistics, query, wxArrayString());
+}
+
+
+// With parameters, the query is run as a prepared statement
+void pgDatabaseObject::DisplayStatistics(ctlListView *statistics, const wxString &query, const wxArrayString &params)
 {
 	if (statistics)
 	{
@@ -1363,18 +1419,10 @@ void pgDatabaseObject::DisplayStatistics(ctlListView *statistics, const wxString
 		// Add the statistics view columns
 		CreateListColumns(statistics, _("Statistic"), _("Value"));
 
-		pgSet *stats = database->ExecuteSet(query);
-
-		if (stats)
-		{
-			int col;
-			for (col = 0 ; col < stats->NumCols() ; col++)
-			{
-				if (!stats->ColName(col).IsEmpty())
-					statistics->AppendItem(stats->ColName(col), stats->GetVal(col));
-			}
-			delete stats;
-		}
+		// The statistics views can be slow, so the pane is filled once the
+		// query is done in the background.
+		if (GetConnection())
+			statistics->AppendItemsAsync(GetConnection(), query, params);
 	}
 }
 
@@ -875,6 +875,17 @@ void pgTable::UpdateRows()
 }
 
 
+// The count of the rows made in the background for the properties
+void pgTable::SetAsyncResult(pgSet *set)
+{
+	if (!set->Eof())
+	{
+		rows = set->GetLongLong(0);
+		rowsCounted = true;
+	}
+}
+
+
 void pgTable::UpdateInheritance()
 {
 	// not checked so far
@@ -958,9 +969,6 @@ void pgTable::ShowTreeDetail(ctlTree *browser, frmMain *form, ctlListView *prope
 			}
 		}
 
-		if (settings->GetAutoRowCountThreshold() >= GetEstimatedRows())
-			UpdateRows();
-
 		UpdateInheritance();
 	}
 
@@ -994,6 +1002,14 @@ void pgTable::ShowTreeDetail(ctlTree *browser, frmMain *form, ctlListView *prope
 
 		if (rowsCounted)
 			properties->AppendItem(_("Rows (counted)"), rows);
+		else if (settings->GetAutoRowCountThreshold() >= GetEstimatedRows())
+		{
+			// Even small tables may take a while to count, so it's done in the
+			// background
+			long pos = properties->AppendItem(_("Rows (counted)"), _("counting..."));
+			properties->SetItemAsync(pos, 1, GetConnection(), wxT("SELECT count(*) AS rows FROM ONLY ") + GetQuotedFullIdentifier(),
+			                         wxArrayString(), this);
+		}
 		else
 			properties->AppendItem(_("Rows (counted)"), _("not counted"));
 
@@ -1396,7 +1412,7 @@ void pgTable::ShowStatistics(frmMain *form, ctlListView *statistics)
 		       wxT("  dead_tuple_percent AS ") + qtIdent(_("Dead Tuple Percent")) + wxT(",\n")
 		       wxT("  pg_size_pretty(free_space) AS ") + qtIdent(_("Free Space")) + wxT(",\n")
 		       wxT("  free_percent AS ") + qtIdent(_("Free Percent")) + wxT("\n")
-		       wxT("  FROM pgstattuple('") + GetQuotedFullIdentifier() + wxT("'), pg_stat_all_tables stat");
+		       wxT("  FROM pgstattuple($2), pg_stat_all_tables stat");
 	}
 	else
 	{
@@ -1406,10 +1422,14 @@ void pgTable::ShowStatistics(frmMain *form, ctlListView *statistics)
 	sql +=  wxT("\n")
 	        wxT("  JOIN pg_statio_all_tables statio ON stat.relid = statio.relid\n")
 	        wxT("  JOIN pg_class cl ON cl.oid=stat.relid\n")
-	        wxT(" WHERE stat.relid = ") + GetOidStr();
+	        wxT(" WHERE stat.relid = $1");
 
+	wxArrayString params;
+	params.Add(GetOidStr());
+	if (showExtendedStatistics)
+		params.Add(GetQuotedFullIdentifier());
 
-	DisplayStatistics(statistics, sql);
+	DisplayStatistics(statistics, sql, params);
 }
 
 
@@ -1514,7 +1534,7 @@ pgObject *pgTableFactory::CreateObjects(pgCollection *collection, ctlTree *brows
 		if (collection->GetConnection()->BackendMinimumVersion(9, 0))
 			query += wxT("LEFT JOIN pg_type typ ON rel.reloftype=typ.oid\n");
 
-		query += wxT(" WHERE rel.relkind IN ('r','s','t') AND rel.relnamespace = ") + collection->GetSchema()->GetOidStr() + wxT("\n");
+		query += wxT(" WHERE rel.relkind IN ('r','s','t') AND rel.relnamespace = $1\n");
 
 		// Greenplum: Eliminate (sub)partitions from the display, only show the parent partitioned table
 		// and eliminate external tables
@@ -1537,135 +1557,200 @@ pgObject *pgTableFactory::CreateObjects(pgCollection *collection, ctlTree *brows
 		        wxT("  FROM pg_class rel\n")
 		        wxT("  LEFT OUTER JOIN pg_description des ON (des.objoid=rel.oid AND des.objsubid=0 AND des.classoid='pg_class'::regclass)\n")
 		        wxT("  LEFT OUTER JOIN pg_constraint con ON con.conrelid=rel.oid AND con.contype='p'\n")
-		        wxT(" WHERE rel.relkind IN ('r','s','t') AND rel.relnamespace = ") + collection->GetSchema()->GetOidStr() + wxT("\n")
+		        wxT(" WHERE rel.relkind IN ('r','s','t') AND rel.relnamespace = $1\n")
 		        + restriction +
 		        wxT(" ORDER BY rel.relname");
 	}
-	tables = collection->GetDatabase()->ExecuteSet(query);
+	// The same query is run for every schema, so prepare it once
+	wxArrayString params;
+	params.Add(collection->GetSchema()->GetOidStr());
+
+	tables = collection->GetDatabase()->ExecuteSet(query, params);
 	if (tables)
 	{
+		// Look up the columns once, rather than by name on every row
+		pgConn *conn = collection->GetConnection();
+		bool has80 = conn->BackendMinimumVersion(8, 0);
+		bool has82 = conn->BackendMinimumVersion(8, 2);
+		bool has84 = conn->BackendMinimumVersion(8, 4);
+		bool has90 = conn->BackendMinimumVersion(9, 0);
+		bool has91 = conn->BackendMinimumVersion(9, 1);
+		bool isGreenplum = conn->GetIsGreenplum();
+		bool hasPartitioned = isGreenplum && conn->BackendMinimumVersion(8, 2, 9);
+
+		int relnameCol = tables->ColNumber(wxT("relname"));
+		int oidCol = tables->ColNumber(wxT("oid"));
+		int relownerCol = tables->ColNumber(wxT("relowner"));
+		int relaclCol = tables->ColNumber(wxT("relacl"));
+		int spcoidCol = has80 ? tables->ColNumber(wxT("spcoid")) : -1;
+		int spcnameCol = has80 ? tables->ColNumber(wxT("spcname")) : -1;
+		int reloftypeCol = has90 ? tables->ColNumber(wxT("reloftype")) : -1;
+		int typnameCol = has90 ? tables->ColNumber(wxT("typname")) : -1;
+		int descriptionCol = tables->ColNumber(wxT("description"));
+		int relpersistenceCol = has91 ? tables->ColNumber(wxT("relpersistence")) : -1;
+		int relhasoidsCol = tables->ColNumber(wxT("relhasoids"));
+		int reltuplesCol = tables->ColNumber(wxT("reltuples"));
+		int fillfactorCol = has82 ? tables->ColNumber(wxT("fillfactor")) : -1;
+		int reloptionsCol = has84 ? tables->ColNumber(wxT("reloptions")) : -1;
+		int autovacuumEnabledCol = has84 ? tables->ColNumber(wxT("autovacuum_enabled")) : -1;
+		int autovacuumVacuumThresholdCol = has84 ? tables->ColNumber(wxT("autovacuum_vacuum_threshold")) : -1;
+		int autovacuumVacuumScaleFactorCol = has84 ? tables->ColNumber(wxT("autovacuum_vacuum_scale_factor")) : -1;
+		int autovacuumAnalyzeThresholdCol = has84 ? tables->ColNumber(wxT("autovacuum_analyze_threshold")) : -1;
+		int autovacuumAnalyzeScaleFactorCol = has84 ? tables->ColNumber(wxT("autovacuum_analyze_scale_factor")) : -1;
+		int autovacuumVacuumCostDelayCol = has84 ? tables->ColNumber(wxT("autovacuum_vacuum_cost_delay")) : -1;
+		int autovacuumVacuumCostLimitCol = has84 ? tables->ColNumber(wxT("autovacuum_vacuum_cost_limit")) : -1;
+		int autovacuumFreezeMinAgeCol = has84 ? tables->ColNumber(wxT("autovacuum_freeze_min_age")) : -1;
+		int autovacuumFreezeMaxAgeCol = has84 ? tables->ColNumber(wxT("autovacuum_freeze_max_age")) : -1;
+		int autovacuumFreezeTableAgeCol = has84 ? tables->ColNumber(wxT("autovacuum_freeze_table_age")) : -1;
+		int hastoasttableCol = has84 ? tables->ColNumber(wxT("hastoasttable")) : -1;
+		int toastReloptionsCol = has84 ? tables->ColNumber(wxT("toast_reloptions")) : -1;
+		int toastAutovacuumEnabledCol = has84 ? tables->ColNumber(wxT("toast_autovacuum_enabled")) : -1;
+		int toastAutovacuumVacuumThresholdCol = has84 ? tables->ColNumber(wxT("toast_autovacuum_vacuum_threshold")) : -1;
+		int toastAutovacuumVacuumScaleFactorCol = has84 ? tables->ColNumber(wxT("toast_autovacuum_vacuum_scale_factor")) : -1;
+		int toastAutovacuumVacuumCostDelayCol = has84 ? tables->ColNumber(wxT("toast_autovacuum_vacuum_cost_delay")) : -1;
+		int toastAutovacuumVacuumCostLimitCol = has84 ? tables->ColNumber(wxT("toast_autovacuum_vacuum_cost_limit")) : -1;
+		int toastAutovacuumFreezeMinAgeCol = has84 ? tables->ColNumber(wxT("toast_autovacuum_freeze_min_age")) : -1;
+		int toastAutovacuumFreezeMaxAgeCol = has84 ? tables->ColNumber(wxT("toast_autovacuum_freeze_max_age")) : -1;
+		int toastAutovacuumFreezeTableAgeCol = has84 ? tables->ColNumber(wxT("toast_autovacuum_freeze_table_age")) : -1;
+		int relhassubclassCol = tables->ColNumber(wxT("relhassubclass"));
+		int connameCol = tables->ColNumber(wxT("conname"));
+		int isreplCol = tables->ColNumber(wxT("isrepl"));
+		int triggercountCol = tables->ColNumber(wxT("triggercount"));
+		int conkeyCol = tables->ColNumber(wxT("conkey"));
+		int localoidCol = isGreenplum ? tables->ColNumber(wxT("localoid")) : -1;
+		int attrnumsCol = isGreenplum ? tables->ColNumber(wxT("attrnums")) : -1;
+		int appendonlyCol = isGreenplum ? tables->ColNumber(wxT("appendonly")) : -1;
+		int compresslevelCol = isGreenplum ? tables->ColNumber(wxT("compresslevel")) : -1;
+		int orientationCol = isGreenplum ? tables->ColNumber(wxT("orientation")) : -1;
+		int compresstypeCol = isGreenplum ? tables->ColNumber(wxT("compresstype")) : -1;
+		int blocksizeCol = isGreenplum ? tables->ColNumber(wxT("blocksize")) : -1;
+		int checksumCol = isGreenplum ? tables->ColNumber(wxT("checksum")) : -1;
+		int ispartitionedCol = hasPartitioned ? tables->ColNumber(wxT("ispartitioned")) : -1;
+		int providersCol = has91 ? tables->ColNumber(wxT("providers")) : -1;
+		int labelsCol = has91 ? tables->ColNumber(wxT("labels")) : -1;
+
 		while (!tables->Eof())
 		{
-			table = new pgTable(collection->GetSchema(), tables->GetVal(wxT("relname")));
+			table = new pgTable(collection->GetSchema(), tables->GetVal(relnameCol));
 
-			table->iSetOid(tables->GetOid(wxT("oid")));
-			table->iSetOwner(tables->GetVal(wxT("relowner")));
-			table->iSetAcl(tables->GetVal(wxT("relacl")));
-			if (collection->GetConnection()->BackendMinimumVersion(8, 0))
+			table->iSetOid(tables->GetOid(oidCol));
+			table->iSetOwner(tables->GetVal(relownerCol));
+			table->iSetAcl(tables->GetVal(relaclCol));
+			if (has80)
 			{
-				if (tables->GetOid(wxT("spcoid")) == 0)
+				if (tables->GetOid(spcoidCol) == 0)
 					table->iSetTablespaceOid(collection->GetDatabase()->GetTablespaceOid());
 				else
-					table->iSetTablespaceOid(tables->GetOid(wxT("spcoid")));
+					table->iSetTablespaceOid(tables->GetOid(spcoidCol));
 
-				if (tables->GetVal(wxT("spcname")) == wxEmptyString)
+				if (tables->GetVal(spcnameCol) == wxEmptyString)
 					table->iSetTablespace(collection->GetDatabase()->GetTablespace());
 				else
-					table->iSetTablespace(tables->GetVal(wxT("spcname")));
+					table->iSetTablespace(tables->GetVal(spcnameCol));
 			}
-			if (collection->GetConnection()->BackendMinimumVersion(9, 0))
+			if (has90)
 			{
-				table->iSetOfTypeOid(tables->GetOid(wxT("reloftype")));
-				table->iSetOfType(tables->GetVal(wxT("typname")));
+				table->iSetOfTypeOid(tables->GetOid(reloftypeCol));
+				table->iSetOfType(tables->GetVal(typnameCol));
 			}
 			else
 			{
 				table->iSetOfTypeOid(0);
 				table->iSetOfType(wxT(""));
 			}
-			table->iSetComment(tables->GetVal(wxT("description")));
-			if (collection->GetConnection()->BackendMinimumVersion(9, 1))
-				table->iSetUnlogged(tables->GetVal(wxT("relpersistence")) == wxT("u"));
+			table->iSetComment(tables->GetVal(descriptionCol));
+			if (has91)
+				table->iSetUnlogged(tables->GetVal(relpersistenceCol) == wxT("u"));
 			else
 				table->iSetUnlogged(false);
-			table->iSetHasOids(tables->GetBool(wxT("relhasoids")));
-			table->iSetEstimatedRows(tables->GetDouble(wxT("reltuples")) * gp_segments);
-			if (collection->GetConnection()->BackendMinimumVersion(8, 2))
+			table->iSetHasOids(tables->GetBool(relhasoidsCol));
+			table->iSetEstimatedRows(tables->GetDouble(reltuplesCol) * gp_segments);
+			if (has82)
 			{
-				table->iSetFillFactor(tables->GetVal(wxT("fillfactor")));
+				table->iSetFillFactor(tables->GetVal(fillfactorCol));
 			}
-			if (collection->GetConnection()->BackendMinimumVersion(8, 4))
+			if (has84)
 			{
-				table->iSetRelOptions(tables->GetVal(wxT("reloptions")));
+				table->iSetRelOptions(tables->GetVal(reloptionsCol));
 				if (table->GetCustomAutoVacuumEnabled())
 				{
-					if (tables->GetVal(wxT("autovacuum_enabled")).IsEmpty())
+					if (tables->GetVal(autovacuumEnabledCol).IsEmpty())
 						table->iSetAutoVacuumEnabled(2);
-					else if (tables->GetBool(wxT("autovacuum_enabled")))
+					else if (tables->GetBool(autovacuumEnabledCol))
 						table->iSetAutoVacuumEnabled(1);
 					else
 						table->iSetAutoVacuumEnabled(0);
-					table->iSetAutoVacuumVacuumThreshold(tables->GetVal(wxT("autovacuum_vacuum_threshold")));
-					table->iSetAutoVacuumVacuumScaleFactor(tables->GetVal(wxT("autovacuum_vacuum_scale_factor")));
-					table->iSetAutoVacuumAnalyzeThreshold(tables->GetVal(wxT("autovacuum_analyze_threshold")));
-					table->iSetAutoVacuumAnalyzeScaleFactor(tables->GetVal(wxT("autovacuum_analyze_scale_factor")));
-					table->iSetAutoVacuumVacuumCostDelay(tables->GetVal(wxT("autovacuum_vacuum_cost_delay")));
-					table->iSetAutoVacuumVacuumCostLimit(tables->GetVal(wxT("autovacuum_vacuum_cost_limit")));
-					table->iSetAutoVacuumFreezeMinAge(tables->GetVal(wxT("autovacuum_freeze_min_age")));
-					table->iSetAutoVacuumFreezeMaxAge(tables->GetVal(wxT("autovacuum_freeze_max_age")));
-					table->iSetAutoVacuumFreezeTableAge(tables->GetVal(wxT("autovacuum_freeze_table_age")));
+					table->iSetAutoVacuumVacuumThreshold(tables->GetVal(autovacuumVacuumThresholdCol));
+					table->iSetAutoVacuumVacuumScaleFactor(tables->GetVal(autovacuumVacuumScaleFactorCol));
+					table->iSetAutoVacuumAnalyzeThreshold(tables->GetVal(autovacuumAnalyzeThresholdCol));
+					table->iSetAutoVacuumAnalyzeScaleFactor(tables->GetVal(autovacuumAnalyzeScaleFactorCol));
+					table->iSetAutoVacuumVacuumCostDelay(tables->GetVal(autovacuumVacuumCostDelayCol));
+					table->iSetAutoVacuumVacuumCostLimit(tables->GetVal(autovacuumVacuumCostLimitCol));
+					table->iSetAutoVacuumFreezeMinAge(tables->GetVal(autovacuumFreezeMinAgeCol));
+					table->iSetAutoVacuumFreezeMaxAge(tables->GetVal(autovacuumFreezeMaxAgeCol));
+					table->iSetAutoVacuumFreezeTableAge(tables->GetVal(autovacuumFreezeTableAgeCol));
 				}
-				table->iSetHasToastTable(tables->GetBool(wxT("hastoasttable")));
+				table->iSetHasToastTable(tables->GetBool(hastoasttableCol));
 				if (table->GetHasToastTable())
 				{
-					table->iSetToastRelOptions(tables->GetVal(wxT("toast_reloptions")));
+					table->iSetToastRelOptions(tables->GetVal(toastReloptionsCol));
 
 					if (table->GetToastCustomAutoVacuumEnabled())
 					{
-						if (tables->GetVal(wxT("toast_autovacuum_enabled")).IsEmpty())
+						if (tables->GetVal(toastAutovacuumEnabledCol).IsEmpty())
 							table->iSetToastAutoVacuumEnabled(2);
-						else if (tables->GetBool(wxT("toast_autovacuum_enabled")))
+						else if (tables->GetBool(toastAutovacuumEnabledCol))
 							table->iSetToastAutoVacuumEnabled(1);
 						else
 							table->iSetToastAutoVacuumEnabled(0);
 
-						table->iSetToastAutoVacuumVacuumThreshold(tables->GetVal(wxT("toast_autovacuum_vacuum_threshold")));
-						table->iSetToastAutoVacuumVacuumScaleFactor(tables->GetVal(wxT("toast_autovacuum_vacuum_scale_factor")));
-						table->iSetToastAutoVacuumVacuumCostDelay(tables->GetVal(wxT("toast_autovacuum_vacuum_cost_delay")));
-						table->iSetToastAutoVacuumVacuumCostLimit(tables->GetVal(wxT("toast_autovacuum_vacuum_cost_limit")));
-						table->iSetToastAutoVacuumFreezeMinAge(tables->GetVal(wxT("toast_autovacuum_freeze_min_age")));
-						table->iSetToastAutoVacuumFreezeMaxAge(tables->GetVal(wxT("toast_autovacuum_freeze_max_age")));
-						table->iSetToastAutoVacuumFreezeTableAge(tables->GetVal(wxT("toast_autovacuum_freeze_table_age")));
+						table->iSetToastAutoVacuumVacuumThreshold(tables->GetVal(toastAutovacuumVacuumThresholdCol));
+						table->iSetToastAutoVacuumVacuumScaleFactor(tables->GetVal(toastAutovacuumVacuumScaleFactorCol));
+						table->iSetToastAutoVacuumVacuumCostDelay(tables->GetVal(toastAutovacuumVacuumCostDelayCol));
+						table->iSetToastAutoVacuumVacuumCostLimit(tables->GetVal(toastAutovacuumVacuumCostLimitCol));
+						table->iSetToastAutoVacuumFreezeMinAge(tables->GetVal(toastAutovacuumFreezeMinAgeCol));
+						table->iSetToastAutoVacuumFreezeMaxAge(tables->GetVal(toastAutovacuumFreezeMaxAgeCol));
+						table->iSetToastAutoVacuumFreezeTableAge(tables->GetVal(toastAutovacuumFreezeTableAgeCol));
 					}
 				}
 			}
-			table->iSetHasSubclass(tables->GetBool(wxT("relhassubclass")));
-			table->iSetPrimaryKeyName(tables->GetVal(wxT("conname")));
-			table->iSetIsReplicated(tables->GetBool(wxT("isrepl")));
-			table->iSetTriggerCount(tables->GetLong(wxT("triggercount")));
-			wxString cn = tables->GetVal(wxT("conkey"));
+			table->iSetHasSubclass(tables->GetBool(relhassubclassCol));
+			table->iSetPrimaryKeyName(tables->GetVal(connameCol));
+			table->iSetIsReplicated(tables->GetBool(isreplCol));
+			table->iSetTriggerCount(tables->GetLong(triggercountCol));
+			wxString cn = tables->GetVal(conkeyCol);
 			cn = cn.Mid(1, cn.Length() - 2);
 			table->iSetPrimaryKeyColNumbers(cn);
 
-			if (collection->GetConnection()->GetIsGreenplum())
+			if (isGreenplum)
 			{
-				Oid lo = tables->GetOid(wxT("localoid"));
-				wxString db = tables->GetVal(wxT("attrnums"));
+				Oid lo = tables->GetOid(localoidCol);
+				wxString db = tables->GetVal(attrnumsCol);
 				db = db.Mid(1, db.Length() - 2);
 				table->iSetDistributionColNumbers(db);
 				if (lo > 0 && db.Length() == 0)
 					table->iSetDistributionIsRandom();
-				table->iSetAppendOnly(tables->GetVal(wxT("appendonly")));
-				table->iSetCompressLevel(tables->GetVal(wxT("compresslevel")));
-				table->iSetOrientation(tables->GetVal(wxT("orientation")));
-				table->iSetCompressType(tables->GetVal(wxT("compresstype")));
-				table->iSetBlocksize(tables->GetVal(wxT("blocksize")));
-				table->iSetChecksum(tables->GetVal(wxT("checksum")));
+				table->iSetAppendOnly(tables->GetVal(appendonlyCol));
+				table->iSetCompressLevel(tables->GetVal(compresslevelCol));
+				table->iSetOrientation(tables->GetVal(orientationCol));
+				table->iSetCompressType(tables->GetVal(compresstypeCol));
+				table->iSetBlocksize(tables->GetVal(blocksizeCol));
+				table->iSetChecksum(tables->GetVal(checksumCol));
 
 				table->iSetPartitionDef(wxT(""));
 				table->iSetIsPartitioned(false);
 
-				if (collection->GetConnection()->BackendMinimumVersion(8, 2, 9))
+				if (hasPartitioned)
 				{
-					table->iSetIsPartitioned(tables->GetBool(wxT("ispartitioned")));
+					table->iSetIsPartitioned(tables->GetBool(ispartitionedCol));
 				}
 
 			}
 
-			if (collection->GetConnection()->BackendMinimumVersion(9, 1))
+			if (has91)
 			{
-				table->iSetProviders(tables->GetVal(wxT("providers")));
-				table->iSetLabels(tables->GetVal(wxT("labels")));
+				table->iSetProviders(tables->GetVal(providersCol));
+				table->iSetLabels(tables->GetVal(labelsCol));
 			}
 
 			if (browser)
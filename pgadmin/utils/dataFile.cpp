@@ -0,0 +1,450 @@
+//////////////////////////////////////////////////////////////////////////
+//
+// pgAdmin III - PostgreSQL Tools
+//
+// Copyright (C) 2002 - 2016, The pgAdmin Development Team
+// This software is released under the PostgreSQL Licence
+//
+// dataFile.cpp - Reading and writing of imported and exported data
+//
+//////////////////////////////////////////////////////////////////////////
+
+#include "pgAdmin3.h"
+
+// wxWindows headers
+#include <wx/wx.h>
+#include <wx/file.h>
+#include <wx/filefn.h>
+
+#include <zlib.h>
+#ifdef HAVE_LIBZSTD
+#include <zstd.h>
+#endif
+
+// App headers
+#include "utils/dataFile.h"
+
+// The size of the buffer compressed data passes through
+#define DATAFILE_PACKED_SIZE    (256 * 1024)
+
+#define DATAFILE_ZSTD_LEVEL     3
+
+
+dataFileCompression GetDataFileCompression(const wxString &path)
+{
+	wxString name = path.Lower();
+
+	if (name.EndsWith(wxT(".gz")))
+		return DATAFILE_GZIP;
+	if (name.EndsWith(wxT(".zst")))
+		return DATAFILE_ZSTD;
+	return DATAFILE_PLAIN;
+}
+
+
+bool IsDataFileCompressionSupported(dataFileCompression compression)
+{
+#ifndef HAVE_LIBZSTD
+	if (compression == DATAFILE_ZSTD)
+		return false;
+#endif
+	return true;
+}
+
+
+dataFileWriter::dataFileWriter()
+	: buffer(NULL), bufSize(0), used(0), written(0), failed(false),
+	  compression(DATAFILE_PLAIN), stream(NULL), packed(NULL)
+{
+}
+
+
+dataFileWriter::~dataFileWriter()
+{
+	if (file.IsOpened())
+		Close();
+	EndCompression();
+	delete[] buffer;
+}
+
+
+bool dataFileWriter::Open(const wxString &_path)
+{
+	path = _path;
+	used = 0;
+	written = 0;
+	failed = false;
+
+	EndCompression();
+	compression = GetDataFileCompression(path);
+	if (!IsDataFileCompressionSupported(compression))
+		return false;
+
+	if (compression == DATAFILE_GZIP)
+	{
+		// A gzip header and trailer around the deflated data
+		z_stream *z = new z_stream;
+		memset(z, 0, sizeof(z_stream));
+		stream = z;
+		if (deflateInit2(z, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+		{
+			delete z;
+			stream = NULL;
+			return false;
+		}
+	}
+#ifdef HAVE_LIBZSTD
+	else if (compression == DATAFILE_ZSTD)
+	{
+		ZSTD_CStream *zs = ZSTD_createCStream();
+		if (!zs)
+			return false;
+		stream = zs;
+		if (ZSTD_isError(ZSTD_initCStream(zs, DATAFILE_ZSTD_LEVEL)))
+		{
+			EndCompression();
+			return false;
+		}
+	}
+#endif
+	if (stream)
+		packed = new char[DATAFILE_PACKED_SIZE];
+
+	if (!file.Create(path, true))
+		return false;
+
+	if (!buffer)
+	{
+		buffer = new char[DATAFILE_BUFFER_SIZE];
+		bufSize = DATAFILE_BUFFER_SIZE;
+	}
+	return true;
+}
+
+
+void dataFileWriter::EndCompression()
+{
+	if (stream)
+	{
+		if (compression == DATAFILE_GZIP)
+		{
+			deflateEnd((z_stream *)stream);
+			delete (z_stream *)stream;
+		}
+#ifdef HAVE_LIBZSTD
+		else if (compression == DATAFILE_ZSTD)
+			ZSTD_freeCStream((ZSTD_CStream *)stream);
+#endif
+		stream = NULL;
+	}
+	delete[] packed;
+	packed = NULL;
+}
+
+
+bool dataFileWriter::WriteRaw(const char *data, size_t len)
+{
+	// Written straight to the descriptor, as wxFile would log the error
+	// from whatever thread this runs on
+	size_t done = 0;
+	while (done < len && !failed)
+	{
+		int count = (int)wxWrite(file.fd(), data + done, (unsigned int)(len - done));
+		if (count <= 0)
+			failed = true;
+		else
+			done += count;
+	}
+	return !failed;
+}
+
+
+// Writes out the buffer, compressing it first if need be. When finishing,
+// whatever the compressor still holds is written too, and the end of its
+// stream.
+bool dataFileWriter::Flush(bool finish)
+{
+	if (compression == DATAFILE_GZIP)
+	{
+		z_stream *z = (z_stream *)stream;
+		z->next_in = (Bytef *)buffer;
+		z->avail_in = (uInt)used;
+
+		int result = Z_OK;
+		while (!failed && (z->avail_in || (finish && result != Z_STREAM_END)))
+		{
+			z->next_out = (Bytef *)packed;
+			z->avail_out = DATAFILE_PACKED_SIZE;
+
+			result = deflate(z, finish ? Z_FINISH : Z_NO_FLUSH);
+			if (result == Z_STREAM_ERROR)
+				failed = true;
+			else
+				WriteRaw(packed, DATAFILE_PACKED_SIZE - z->avail_out);
+		}
+	}
+#ifdef HAVE_LIBZSTD
+	else if (compression == DATAFILE_ZSTD)
+	{
+		ZSTD_CStream *zs = (ZSTD_CStream *)stream;
+		ZSTD_inBuffer in = { buffer, used, 0 };
+
+		size_t rest = 1;
+		while (!failed && (in.pos < in.size || (finish && rest)))
+		{
+			ZSTD_outBuffer out = { packed, DATAFILE_PACKED_SIZE, 0 };
+
+			if (in.pos < in.size)
+				rest = ZSTD_compressStream(zs, &out, &in);
+			else
+				rest = ZSTD_endStream(zs, &out);
+
+			if (ZSTD_isError(rest))
+				failed = true;
+			else
+				WriteRaw(packed, out.pos);
+		}
+	}
+#endif
+	else
+		WriteRaw(buffer, used);
+
+	written += used;
+	used = 0;
+	return !failed;
+}
+
+
+bool dataFileWriter::WriteThrough(const void *data, size_t len)
+{
+	if (failed || !file.IsOpened())
+		return false;
+
+	const char *src = (const char *)data;
+	while (len)
+	{
+		if (used == bufSize && !Flush())
+			return false;
+
+		size_t part = wxMin(len, bufSize - used);
+		memcpy(buffer + used, src, part);
+		used += part;
+		src += part;
+		len -= part;
+	}
+	return true;
+}
+
+
+bool dataFileWriter::Close()
+{
+	if (!file.IsOpened())
+		return false;
+
+	Flush(true);
+	EndCompression();
+	file.Close();
+	return !failed;
+}
+
+
+dataFileReader::dataFileReader()
+	: length(0), bytesRead(0), compression(DATAFILE_PLAIN), stream(NULL), packed(NULL),
+	  packedStart(0), packedLen(0), eof(false), midStream(false)
+{
+}
+
+
+dataFileReader::~dataFileReader()
+{
+	Close();
+}
+
+
+bool dataFileReader::Open(const wxString &_path)
+{
+	path = _path;
+	bytesRead = 0;
+	packedStart = packedLen = 0;
+	eof = midStream = false;
+
+	EndCompression();
+	compression = GetDataFileCompression(path);
+	if (!IsDataFileCompressionSupported(compression))
+		return false;
+
+	if (compression == DATAFILE_GZIP)
+	{
+		// Taking gzip and zlib headers alike
+		z_stream *z = new z_stream;
+		memset(z, 0, sizeof(z_stream));
+		stream = z;
+		if (inflateInit2(z, 15 + 32) != Z_OK)
+		{
+			delete z;
+			stream = NULL;
+			return false;
+		}
+	}
+#ifdef HAVE_LIBZSTD
+	else if (compression == DATAFILE_ZSTD)
+	{
+		ZSTD_DStream *zs = ZSTD_createDStream();
+		if (!zs)
+			return false;
+		stream = zs;
+		if (ZSTD_isError(ZSTD_initDStream(zs)))
+		{
+			EndCompression();
+			return false;
+		}
+	}
+#endif
+	if (stream)
+		packed = new char[DATAFILE_PACKED_SIZE];
+
+	if (!file.Open(path, wxFile::read))
+		return false;
+
+	length = file.Length();
+	return true;
+}
+
+
+void dataFileReader::EndCompression()
+{
+	if (stream)
+	{
+		if (compression == DATAFILE_GZIP)
+		{
+			inflateEnd((z_stream *)stream);
+			delete (z_stream *)stream;
+		}
+#ifdef HAVE_LIBZSTD
+		else if (compression == DATAFILE_ZSTD)
+			ZSTD_freeDStream((ZSTD_DStream *)stream);
+#endif
+		stream = NULL;
+	}
+	delete[] packed;
+	packed = NULL;
+}
+
+
+long dataFileReader::ReadRaw(void *data, size_t len)
+{
+	long count = (long)wxRead(file.fd(), data, (unsigned int)len);
+	if (count > 0)
+		bytesRead += count;
+	return count < 0 ? -1 : count;
+}
+
+
+// Reads more of the file once the decompressor has taken all it had, false
+// if that failed
+bool dataFileReader::ReadPacked()
+{
+	if (packedStart < packedLen || eof)
+		return true;
+
+	long count = ReadRaw(packed, DATAFILE_PACKED_SIZE);
+	if (count < 0)
+		return false;
+
+	eof = (count == 0);
+	packedStart = 0;
+	packedLen = count;
+	return true;
+}
+
+
+long dataFileReader::Inflate(char *data, size_t len)
+{
+	z_stream *z = (z_stream *)stream;
+	z->next_out = (Bytef *)data;
+	z->avail_out = (uInt)len;
+
+	while (z->avail_out)
+	{
+		if (!ReadPacked())
+			return -1;
+		if (packedStart == packedLen)
+			break;
+
+		z->next_in = (Bytef *)packed + packedStart;
+		z->avail_in = (uInt)(packedLen - packedStart);
+
+		int result = inflate(z, Z_NO_FLUSH);
+		packedStart = packedLen - z->avail_in;
+
+		// Files made by concatenating others have a gzip member for each
+		if (result == Z_STREAM_END)
+		{
+			inflateReset(z);
+			midStream = false;
+		}
+		else if (result == Z_OK)
+			midStream = true;
+		else
+			return -1;
+	}
+
+	size_t count = len - z->avail_out;
+
+	// A file that ends in the middle of the data is cut short
+	if (!count && midStream)
+		return -1;
+	return (long)count;
+}
+
+
+long dataFileReader::Decompress(char *data, size_t len)
+{
+#ifdef HAVE_LIBZSTD
+	ZSTD_DStream *zs = (ZSTD_DStream *)stream;
+	ZSTD_outBuffer out = { data, len, 0 };
+
+	while (out.pos < out.size)
+	{
+		if (!ReadPacked())
+			return -1;
+		if (packedStart == packedLen)
+			break;
+
+		ZSTD_inBuffer in = { packed + packedStart, packedLen - packedStart, 0 };
+		size_t rest = ZSTD_decompressStream(zs, &out, &in);
+		packedStart += in.pos;
+
+		if (ZSTD_isError(rest))
+			return -1;
+		midStream = (rest != 0);
+	}
+
+	if (!out.pos && midStream)
+		return -1;
+	return (long)out.pos;
+#else
+	return -1;
+#endif
+}
+
+
+long dataFileReader::Read(void *data, size_t len)
+{
+	if (!file.IsOpened())
+		return -1;
+
+	if (compression == DATAFILE_GZIP)
+		return Inflate((char *)data, len);
+	if (compression == DATAFILE_ZSTD)
+		return Decompress((char *)data, len);
+	return ReadRaw(data, len);
+}
+
+
+void dataFileReader::Close()
+{
+	EndCompression();
+	if (file.IsOpened())
+		file.Close();
+}
@@ -11,6 +11,7 @@
 
 pgadmin3_SOURCES += \
 	utils/csvfiles.cpp \
+	utils/dataFile.cpp \
 	utils/factory.cpp \
 	utils/favourites.cpp \
 	utils/misc.cpp \
@@ -20,7 +21,9 @@ pgadmin3_SOURCES += \
 	utils/sysProcess.cpp \
 	utils/sysSettings.cpp \
 	utils/tabcomplete.c \
+	utils/utf8.cpp \
 	utils/utffile.cpp \
+	utils/workerProgress.cpp \
 	utils/macros.cpp
 
 if BUILD_SSH_TUNNEL
@@ -29,6 +29,9 @@
 #include "utils/sysSettings.h"
 #include "utils/sysLogger.h"
 #include "utils/misc.h"
+
+const wxEventType SettingsChangedEvent = wxNewEventType();
+
 sysSettings::sysSettings(const wxString &name) : wxConfig(name)
 {
 	// Open the default settings file
@@ -58,6 +61,8 @@ sysSettings::sysSettings(const wxString &name) : wxConfig(name)
 			moveLongValue(wxT("Servers/SSL%d"), wxT("Servers/%d/SSL"), i);
 		}
 	}
+
+	LoadSnapshot();
 }
 
 sysSettings::~sysSettings()
@@ -541,24 +546,64 @@ wxString sysSettings::GetGpHelpPath()
 	return path;
 }
 //////////////////////////////////////////////////////////////////////////
-// Copy quoting
+// Snapshot
 //////////////////////////////////////////////////////////////////////////
 
-int sysSettings::GetCopyQuoting()
+void sysSettings::LoadSnapshot()
 {
-	wxString val;
+	Read(wxT("frmQuery/IndicateNull"), &snapshot.indicateNull, false);
+	Read(wxT("frmQuery/MaxColSize"), &snapshot.maxColSize, 256L);
+	Read(wxT("DecimalMark"), &snapshot.decimalMark, wxEmptyString);
+	Read(wxT("frmQuery/ThousandsSeparator"), &snapshot.thousandsSeparator, wxEmptyString);
+	Read(wxT("ColumnNames"), &snapshot.columnNames, false);
+	Read(wxT("Copy/QuoteChar"), &snapshot.copyQuoteChar, wxT("\""));
+	Read(wxT("Copy/ColSeparator"), &snapshot.copyColSeparator, wxT(";"));
 
+	wxString val;
 	Read(wxT("Copy/Quote"), &val, wxT("Strings"));
 	if (val == wxT("All"))
-		return 2;
+		snapshot.copyQuoting = 2;
 	else if (val == wxT("Strings"))
-		return 1;
+		snapshot.copyQuoting = 1;
 	else
-		return 0;
+		snapshot.copyQuoting = 0;
+}
+
+
+void sysSettings::NotifyChanged()
+{
+	LoadSnapshot();
+
+	for (size_t i = 0 ; i < changeHandlers.GetCount() ; i++)
+	{
+		wxCommandEvent ev(SettingsChangedEvent);
+		((wxEvtHandler *)changeHandlers.Item(i))->AddPendingEvent(ev);
+	}
+}
+
+
+void sysSettings::AddChangeHandler(wxEvtHandler *handler)
+{
+	if (changeHandlers.Index(handler) == wxNOT_FOUND)
+		changeHandlers.Add(handler);
+}
+
+
+void sysSettings::RemoveChangeHandler(wxEvtHandler *handler)
+{
+	int index = changeHandlers.Index(handler);
+	if (index != wxNOT_FOUND)
+		changeHandlers.RemoveAt(index);
 }
 
+//////////////////////////////////////////////////////////////////////////
+// Copy quoting
+//////////////////////////////////////////////////////////////////////////
+
 void sysSettings::SetCopyQuoting(const int i)
 {
+	snapshot.copyQuoting = i;
+
 	switch (i)
 	{
 		case 2:
@@ -886,6 +931,26 @@ wxString sysSettings::GetMacrosFile()
 }
 
 
+wxString sysSettings::GetResultSpillDirectory()
+{
+	wxString s, tmp;
+
+#if wxCHECK_VERSION(2, 9, 5)
+	wxStandardPaths &stdp = wxStandardPaths::Get();
+#else
+	wxStandardPaths stdp;
+#endif
+	tmp = stdp.GetUserDataDir();
+
+	Read(wxT("frmQuery/ResultSpillDirectory"), &s, tmp);
+
+	if (!s.IsEmpty() && !wxDirExists(s))
+		wxMkdir(s);
+
+	return s;
+}
+
+
 wxString sysSettings::GetHistoryFile()
 {
 	wxString s, tmp;
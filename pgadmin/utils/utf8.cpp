@@ -0,0 +1,244 @@
+//////////////////////////////////////////////////////////////////////////
+//
+// pgAdmin III - PostgreSQL Tools
+//
+// Copyright (C) 2002 - 2016, The pgAdmin Development Team
+// This software is released under the PostgreSQL Licence
+//
+// utf8.cpp - Fast UTF-8 decoding and encoding
+//
+//////////////////////////////////////////////////////////////////////////
+
+#include "pgAdmin3.h"
+
+// wxWindows headers
+#include <wx/wx.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define UTF8_SSE2
+#endif
+
+// App headers
+#include "utils/utf8.h"
+
+
+#if wxUSE_UNICODE
+
+// Widen the leading ASCII characters of the text, and return how many there
+// were.
+static size_t WidenASCII(const unsigned char *src, size_t len, wxChar *dest)
+{
+	size_t i = 0;
+
+#ifdef UTF8_SSE2
+	const __m128i zero = _mm_setzero_si128();
+
+	for (; i + 16 <= len; i += 16)
+	{
+		__m128i bytes = _mm_loadu_si128((const __m128i *)(src + i));
+
+		// Any byte with its top bit set starts or continues a sequence
+		if (_mm_movemask_epi8(bytes))
+			break;
+
+		__m128i lo = _mm_unpacklo_epi8(bytes, zero);
+		__m128i hi = _mm_unpackhi_epi8(bytes, zero);
+
+		if (sizeof(wxChar) == 2)
+		{
+			_mm_storeu_si128((__m128i *)(dest + i), lo);
+			_mm_storeu_si128((__m128i *)(dest + i + 8), hi);
+		}
+		else
+		{
+			_mm_storeu_si128((__m128i *)(dest + i), _mm_unpacklo_epi16(lo, zero));
+			_mm_storeu_si128((__m128i *)(dest + i + 4), _mm_unpackhi_epi16(lo, zero));
+			_mm_storeu_si128((__m128i *)(dest + i + 8), _mm_unpacklo_epi16(hi, zero));
+			_mm_storeu_si128((__m128i *)(dest + i + 12), _mm_unpackhi_epi16(hi, zero));
+		}
+	}
+#else
+	for (; i + sizeof(unsigned long) <= len; i += sizeof(unsigned long))
+	{
+		unsigned long word;
+		memcpy(&word, src + i, sizeof(word));
+
+		if (word & (~0UL / 0xFF * 0x80))
+			break;
+
+		for (size_t j = 0; j < sizeof(word); j++)
+			dest[i + j] = src[i + j];
+	}
+#endif
+
+	while (i < len && src[i] < 0x80)
+	{
+		dest[i] = src[i];
+		i++;
+	}
+
+	return i;
+}
+
+
+// Decode the text into dest, which must have room for len characters.
+// Returns the number of characters written, or (size_t)-1 if the text isn't
+// valid UTF-8.
+static size_t Decode(const unsigned char *src, size_t len, wxChar *dest)
+{
+	size_t in = 0, out = 0;
+
+	while (in < len)
+	{
+		size_t ascii = WidenASCII(src + in, len - in, dest + out);
+		in += ascii;
+		out += ascii;
+
+		if (in >= len)
+			break;
+
+		unsigned char c = src[in];
+		wxUint32 code;
+		size_t extra;
+
+		if (c >= 0xC2 && c <= 0xDF)
+		{
+			code = c & 0x1F;
+			extra = 1;
+		}
+		else if (c >= 0xE0 && c <= 0xEF)
+		{
+			code = c & 0x0F;
+			extra = 2;
+		}
+		else if (c >= 0xF0 && c <= 0xF4)
+		{
+			code = c & 0x07;
+			extra = 3;
+		}
+		else
+			return (size_t) - 1;
+
+		if (in + extra >= len)
+			return (size_t) - 1;
+
+		for (size_t i = 1; i <= extra; i++)
+		{
+			unsigned char cont = src[in + i];
+			if ((cont & 0xC0) != 0x80)
+				return (size_t) - 1;
+			code = (code << 6) | (cont & 0x3F);
+		}
+
+		// Overlong forms, surrogates and code points beyond Unicode
+		if ((extra == 2 && code < 0x800) || (extra == 3 && code < 0x10000) ||
+		        (code >= 0xD800 && code <= 0xDFFF) || code > 0x10FFFF)
+			return (size_t) - 1;
+
+		in += extra + 1;
+
+		if (sizeof(wxChar) == 2 && code >= 0x10000)
+		{
+			code -= 0x10000;
+			dest[out++] = (wxChar)(0xD800 + (code >> 10));
+			dest[out++] = (wxChar)(0xDC00 + (code & 0x3FF));
+		}
+		else
+			dest[out++] = (wxChar)code;
+	}
+
+	return out;
+}
+
+#endif
+
+
+wxString DecodeUTF8(const char *str)
+{
+	if (!str)
+		return wxEmptyString;
+
+	return DecodeUTF8(str, strlen(str));
+}
+
+
+wxString DecodeUTF8(const char *str, size_t len)
+{
+#if wxUSE_UNICODE
+	wxString result;
+	size_t decoded;
+
+	if (!str || !len)
+		return result;
+
+	// A character never takes fewer bytes than UTF-16 code units
+	{
+		wxStringBufferLength buf(result, len);
+		decoded = Decode((const unsigned char *)str, len, buf);
+		buf.SetLength(decoded == (size_t) - 1 ? 0 : decoded);
+	}
+
+	if (decoded == (size_t) - 1)
+		return wxString(str, wxConvUTF8, len);
+
+	return result;
+#else
+	return wxString(str, wxConvUTF8, len);
+#endif
+}
+
+
+void EncodeUTF8(const wxString &str, wxMemoryBuffer &buf)
+{
+#if wxUSE_UNICODE
+	const wxChar *src = str.c_str();
+	size_t len = str.length();
+
+	// No character takes more than four bytes, nor a surrogate pair more
+	// than two per code unit
+	unsigned char *dest = (unsigned char *)buf.GetAppendBuf(len * 4 + 1), *out = dest;
+
+	for (size_t i = 0; i < len; i++)
+	{
+		wxUint32 code = (wxUint32)src[i];
+
+		if (code < 0x80)
+		{
+			*out++ = (unsigned char)code;
+			continue;
+		}
+
+		if (sizeof(wxChar) == 2 && code >= 0xD800 && code <= 0xDBFF &&
+		        i + 1 < len && (wxUint32)src[i + 1] >= 0xDC00 && (wxUint32)src[i + 1] <= 0xDFFF)
+		{
+			code = 0x10000 + ((code - 0xD800) << 10) + ((wxUint32)src[++i] - 0xDC00);
+		}
+
+		if (code < 0x800)
+		{
+			*out++ = (unsigned char)(0xC0 | (code >> 6));
+			*out++ = (unsigned char)(0x80 | (code & 0x3F));
+		}
+		else if (code < 0x10000)
+		{
+			*out++ = (unsigned char)(0xE0 | (code >> 12));
+			*out++ = (unsigned char)(0x80 | ((code >> 6) & 0x3F));
+			*out++ = (unsigned char)(0x80 | (code & 0x3F));
+		}
+		else
+		{
+			*out++ = (unsigned char)(0xF0 | (code >> 18));
+			*out++ = (unsigned char)(0x80 | ((code >> 12) & 0x3F));
+			*out++ = (unsigned char)(0x80 | ((code >> 6) & 0x3F));
+			*out++ = (unsigned char)(0x80 | (code & 0x3F));
+		}
+	}
+
+	buf.UngetAppendBuf(out - dest);
+#else
+	wxCharBuffer utf8 = str.mb_str(wxConvUTF8);
+	if (utf8)
+		buf.AppendData((const char *)utf8, strlen(utf8));
+#endif
+}
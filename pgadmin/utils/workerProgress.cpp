@@ -0,0 +1,134 @@
+//////////////////////////////////////////////////////////////////////////
+//
+// pgAdmin III - PostgreSQL Tools
+//
+// Copyright (C) 2002 - 2016, The pgAdmin Development Team
+// This software is released under the PostgreSQL Licence
+//
+// workerProgress.cpp - Waiting for worker threads, with their progress shown
+//
+//////////////////////////////////////////////////////////////////////////
+
+#include "pgAdmin3.h"
+
+// wxWindows headers
+#include <wx/wx.h>
+#include <wx/evtloop.h>
+
+// App headers
+#include "utils/workerProgress.h"
+
+// How long the work may take before the progress dialog appears, and how
+// often the dialog is refreshed when no progress is reported
+#define WORKER_PROGRESS_DELAY   500
+
+static const wxEventType WorkerProgressEvent = wxNewEventType();
+static const wxEventType WorkerDoneEvent = wxNewEventType();
+
+
+workerProgress::workerProgress(wxWindow *_parent, const wxString &_title, const wxString &_message, int _range)
+	: parent(_parent), title(_title), message(_message), range(_range),
+	  dialog(NULL), timer(this), loop(NULL), value(0), posted(false), cancelled(false), done(false)
+{
+	Connect(wxID_ANY, WorkerProgressEvent, wxCommandEventHandler(workerProgress::OnProgress));
+	Connect(wxID_ANY, WorkerDoneEvent, wxCommandEventHandler(workerProgress::OnDone));
+	Connect(wxID_ANY, wxEVT_TIMER, wxTimerEventHandler(workerProgress::OnTimer));
+}
+
+
+workerProgress::~workerProgress()
+{
+	timer.Stop();
+	delete dialog;
+}
+
+
+void workerProgress::Update(int _value)
+{
+	value = wxMin(_value, range);
+
+	// One event at a time is enough, it shows the latest value
+	if (!posted)
+	{
+		posted = true;
+		wxCommandEvent ev(WorkerProgressEvent);
+		AddPendingEvent(ev);
+	}
+}
+
+
+void workerProgress::Done()
+{
+	wxCommandEvent ev(WorkerDoneEvent);
+	AddPendingEvent(ev);
+}
+
+
+bool workerProgress::Wait()
+{
+	{
+		wxWindowDisabler disabler;
+
+		timer.Start(WORKER_PROGRESS_DELAY);
+		if (!done)
+		{
+			wxEventLoop eventLoop;
+			loop = &eventLoop;
+			eventLoop.Run();
+			loop = NULL;
+		}
+		timer.Stop();
+	}
+
+	delete dialog;
+	dialog = NULL;
+
+	return !cancelled;
+}
+
+
+void workerProgress::OnProgress(wxCommandEvent &ev)
+{
+	posted = false;
+
+	if (done)
+		return;
+
+	OnUpdate(value);
+	if (dialog && !dialog->Update(value))
+		Cancel();
+}
+
+
+void workerProgress::OnDone(wxCommandEvent &ev)
+{
+	done = true;
+
+	if (loop)
+		loop->Exit();
+}
+
+
+void workerProgress::OnTimer(wxTimerEvent &ev)
+{
+	if (done)
+		return;
+
+	if (!dialog)
+		dialog = new wxProgressDialog(title, message, range, parent,
+		                              wxPD_APP_MODAL | wxPD_AUTO_HIDE | wxPD_CAN_ABORT | wxPD_ELAPSED_TIME | wxPD_REMAINING_TIME);
+
+	// Also notices a cancellation while the workers report nothing
+	if (!dialog->Update(value))
+		Cancel();
+}
+
+
+void workerProgress::Cancel()
+{
+	if (cancelled)
+		return;
+
+	cancelled = true;
+	OnCancel();
+}